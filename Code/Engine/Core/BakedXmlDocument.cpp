@@ -0,0 +1,740 @@
+#include "Engine/Core/BakedXmlDocument.hpp"
+#include "Engine/Core/BufferParser.hpp"
+#include "Engine/Core/BufferWriter.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/MemoryMappedFile.hpp"
+#include <cstring>
+
+constexpr unsigned int BAKED_XML_FOURCC = 'B' | ('X' << 8) | ('M' << 16) | ('L' << 24);
+constexpr unsigned int BAKED_XML_VERSION = 1; // bump whenever the layout below changes
+constexpr size_t BAKED_XML_HEADER_SIZE = 4 + 4 + 8 + 8 + 4 * 4;
+constexpr size_t WORDS_PER_ATTRIBUTE = sizeof(BakedXmlAttribute) / sizeof(unsigned int);
+constexpr size_t WORDS_PER_ELEMENT = sizeof(BakedXmlElementRecord) / sizeof(unsigned int);
+static_assert(sizeof(BakedXmlAttribute) == 5 * sizeof(unsigned int), "BakedXmlAttribute is bulk-copied as words");
+static_assert(sizeof(BakedXmlElementRecord) == 5 * sizeof(unsigned int), "BakedXmlElementRecord is bulk-copied as words");
+
+//-----------------------------------------------------------------------------------------------
+static uint64_t HashBytes(uint64_t hash, void const* data, size_t size)
+{
+	// FNV-1a
+	unsigned char const* bytes = static_cast<unsigned char const*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+
+//-----------------------------------------------------------------------------------------------
+void BakedXmlSchema::AddAttribute(std::string const& elementName, std::string const& attributeName, BakedAttributeType type)
+{
+	m_attributeTypes[std::make_pair(elementName, attributeName)] = type;
+}
+
+BakedAttributeType BakedXmlSchema::GetAttributeType(char const* elementName, char const* attributeName) const
+{
+	auto found = m_attributeTypes.find(std::make_pair(std::string(elementName), std::string(attributeName)));
+	if (found == m_attributeTypes.end())
+	{
+		found = m_attributeTypes.find(std::make_pair(std::string("*"), std::string(attributeName)));
+	}
+	return found != m_attributeTypes.end() ? found->second : BakedAttributeType::STRING;
+}
+
+uint64_t BakedXmlSchema::GetHash() const
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (auto const& attributeType : m_attributeTypes)
+	{
+		hash = HashBytes(hash, attributeType.first.first.c_str(), attributeType.first.first.size() + 1);
+		hash = HashBytes(hash, attributeType.first.second.c_str(), attributeType.first.second.size() + 1);
+		hash = HashBytes(hash, &attributeType.second, sizeof(attributeType.second));
+	}
+	return hash;
+}
+
+//-----------------------------------------------------------------------------------------------
+char const* BakedXmlElement::Name() const
+{
+	return m_document->GetString(m_record.m_nameIndex);
+}
+
+BakedXmlElement const* BakedXmlElement::FirstChildElement(char const* name) const
+{
+	for (unsigned int childIndex = m_record.m_firstChildIndex; childIndex != 0; childIndex = m_document->GetElement(childIndex).m_record.m_nextSiblingIndex)
+	{
+		BakedXmlElement const& child = m_document->GetElement(childIndex);
+		if (name == nullptr || strcmp(child.Name(), name) == 0)
+		{
+			return &child;
+		}
+	}
+	return nullptr;
+}
+
+BakedXmlElement const* BakedXmlElement::NextSiblingElement(char const* name) const
+{
+	for (unsigned int siblingIndex = m_record.m_nextSiblingIndex; siblingIndex != 0; siblingIndex = m_document->GetElement(siblingIndex).m_record.m_nextSiblingIndex)
+	{
+		BakedXmlElement const& sibling = m_document->GetElement(siblingIndex);
+		if (name == nullptr || strcmp(sibling.Name(), name) == 0)
+		{
+			return &sibling;
+		}
+	}
+	return nullptr;
+}
+
+BakedXmlAttribute const* BakedXmlElement::FindAttribute(char const* name) const
+{
+	for (unsigned int i = 0; i < m_record.m_numAttributes; ++i)
+	{
+		BakedXmlAttribute const& attribute = m_document->GetAttribute(m_record.m_firstAttributeIndex + i);
+		if (strcmp(m_document->GetString(attribute.m_nameIndex), name) == 0)
+		{
+			return &attribute;
+		}
+	}
+	return nullptr;
+}
+
+BakedXmlDocument const& BakedXmlElement::GetDocument() const
+{
+	return *m_document;
+}
+
+//-----------------------------------------------------------------------------------------------
+BakedXmlLoadResult BakedXmlDocument::LoadFile(std::string const& xmlFilePath, std::string const& bakedFilePath, BakedXmlSchema const& schema, bool writeBakedFileIfStale)
+{
+	MemoryMappedFile xmlFile;
+	MemoryMappedFile bakedFile;
+	bool hasBakedFile = bakedFile.Open(bakedFilePath) && bakedFile.GetData() != nullptr;
+	if (!xmlFile.Open(xmlFilePath) || xmlFile.GetData() == nullptr)
+	{
+		// Shipped builds may only have the baked file, which then can't be checked against anything
+		if (hasBakedFile && LoadFromBlob(bakedFile.GetData(), (size_t)bakedFile.GetFileSize()))
+		{
+			return BakedXmlLoadResult::LOADED_BAKED;
+		}
+		ERROR_RECOVERABLE(Stringf("Could not load %s or %s", xmlFilePath.c_str(), bakedFilePath.c_str()));
+		return BakedXmlLoadResult::FAILED;
+	}
+
+	uint64_t xmlContentHash = ComputeContentHash(xmlFile.GetData(), (size_t)xmlFile.GetFileSize());
+	if (hasBakedFile && IsBlobFresh(bakedFile.GetData(), (size_t)bakedFile.GetFileSize(), xmlContentHash, schema)
+		&& LoadFromBlob(bakedFile.GetData(), (size_t)bakedFile.GetFileSize()))
+	{
+		return BakedXmlLoadResult::LOADED_BAKED;
+	}
+	bakedFile.Close();
+
+	XmlDocument xmlDocument;
+	XmlResult result = xmlDocument.Parse(reinterpret_cast<char const*>(xmlFile.GetData()), (size_t)xmlFile.GetFileSize());
+	if (result != XmlResult::XML_SUCCESS)
+	{
+		ERROR_RECOVERABLE(Stringf("Could not parse %s", xmlFilePath.c_str()));
+		return BakedXmlLoadResult::FAILED;
+	}
+	std::vector<unsigned char> blob;
+	Bake(xmlDocument, schema, xmlContentHash, blob);
+	LoadFromBlob(blob.data(), blob.size());
+	if (writeBakedFileIfStale)
+	{
+		FileWriteToBuffer(blob, bakedFilePath);
+	}
+	return BakedXmlLoadResult::LOADED_XML;
+}
+
+bool BakedXmlDocument::LoadFromBlob(unsigned char const* blobData, size_t blobSize)
+{
+	Clear();
+	if (blobSize < BAKED_XML_HEADER_SIZE)
+	{
+		return false;
+	}
+	BufferParser parser(blobData, blobSize, BufferEndianMode::Little);
+	if (parser.ParseUInt() != BAKED_XML_FOURCC || parser.ParseUInt() != BAKED_XML_VERSION)
+	{
+		return false;
+	}
+	parser.ParseUInt64(); // source content hash
+	parser.ParseUInt64(); // schema hash
+	unsigned int numStringBytes = parser.ParseUInt();
+	unsigned int numStrings = parser.ParseUInt();
+	unsigned int numAttributes = parser.ParseUInt();
+	unsigned int numElements = parser.ParseUInt();
+	size_t numBodyBytes = numStringBytes + 4 * ((size_t)numStrings + WORDS_PER_ATTRIBUTE * numAttributes + WORDS_PER_ELEMENT * numElements);
+	if (blobSize - BAKED_XML_HEADER_SIZE != numBodyBytes)
+	{
+		return false;
+	}
+
+	// Everything is already binary, so loading is one bulk copy per table
+	m_stringPool.resize(numStringBytes);
+	m_stringOffsets.resize(numStrings);
+	m_attributes.resize(numAttributes);
+	std::vector<BakedXmlElementRecord> elementRecords(numElements);
+	parser.ParseArray(m_stringPool.data(), numStringBytes);
+	parser.ParseArray(m_stringOffsets.data(), numStrings);
+	parser.ParseArray(reinterpret_cast<unsigned int*>(m_attributes.data()), WORDS_PER_ATTRIBUTE * numAttributes);
+	parser.ParseArray(reinterpret_cast<unsigned int*>(elementRecords.data()), WORDS_PER_ELEMENT * numElements);
+
+	m_elements.resize(numElements);
+	for (unsigned int i = 0; i < numElements; ++i)
+	{
+		m_elements[i].m_document = this;
+		m_elements[i].m_record = elementRecords[i];
+	}
+
+	// A corrupt blob must not send lookups off the end of a table
+	bool isValid = numStringBytes == 0 || m_stringPool.back() == '\0';
+	for (unsigned int i = 0; i < numStrings && isValid; ++i)
+	{
+		isValid = m_stringOffsets[i] < numStringBytes;
+	}
+	for (unsigned int i = 0; i < numAttributes && isValid; ++i)
+	{
+		isValid = m_attributes[i].m_nameIndex < numStrings && m_attributes[i].m_type < BakedAttributeType::COUNT
+			&& (m_attributes[i].m_type != BakedAttributeType::STRING || m_attributes[i].m_value[0] < numStrings);
+	}
+	for (unsigned int i = 0; i < numElements && isValid; ++i)
+	{
+		BakedXmlElementRecord const& record = elementRecords[i];
+		isValid = record.m_nameIndex < numStrings && record.m_firstChildIndex < numElements && record.m_nextSiblingIndex < numElements
+			&& (size_t)record.m_firstAttributeIndex + record.m_numAttributes <= numAttributes;
+	}
+	if (!isValid)
+	{
+		Clear();
+	}
+	return isValid;
+}
+
+BakedXmlElement const* BakedXmlDocument::RootElement() const
+{
+	return m_elements.empty() ? nullptr : &m_elements[0];
+}
+
+char const* BakedXmlDocument::GetString(unsigned int stringIndex) const
+{
+	return &m_stringPool[m_stringOffsets[stringIndex]];
+}
+
+BakedXmlAttribute const& BakedXmlDocument::GetAttribute(unsigned int attributeIndex) const
+{
+	return m_attributes[attributeIndex];
+}
+
+BakedXmlElement const& BakedXmlDocument::GetElement(unsigned int elementIndex) const
+{
+	return m_elements[elementIndex];
+}
+
+void BakedXmlDocument::Clear()
+{
+	m_stringPool.clear();
+	m_stringOffsets.clear();
+	m_attributes.clear();
+	m_elements.clear();
+}
+
+//-----------------------------------------------------------------------------------------------
+bool BakedXmlDocument::BakeXmlFile(std::string const& xmlFilePath, std::string const& bakedFilePath, BakedXmlSchema const& schema)
+{
+	std::vector<uint8_t> xmlBytes;
+	if (!IsFileExists(xmlFilePath) || FileReadToBuffer(xmlBytes, xmlFilePath) <= 0)
+	{
+		ERROR_RECOVERABLE(Stringf("Could not read %s to bake it", xmlFilePath.c_str()));
+		return false;
+	}
+	XmlDocument xmlDocument;
+	if (xmlDocument.Parse(reinterpret_cast<char const*>(xmlBytes.data()), xmlBytes.size()) != XmlResult::XML_SUCCESS)
+	{
+		ERROR_RECOVERABLE(Stringf("Could not parse %s to bake it", xmlFilePath.c_str()));
+		return false;
+	}
+	std::vector<unsigned char> blob;
+	return Bake(xmlDocument, schema, ComputeContentHash(xmlBytes.data(), xmlBytes.size()), blob) && FileWriteToBuffer(blob, bakedFilePath);
+}
+
+struct XmlBakeContext
+{
+	XmlBakeContext(BakedXmlSchema const& schema) : m_schema(schema) {}
+
+	unsigned int AddString(char const* text)
+	{
+		auto found = m_stringIndices.find(text);
+		if (found != m_stringIndices.end())
+		{
+			return found->second;
+		}
+		unsigned int stringIndex = (unsigned int)m_stringOffsets.size();
+		m_stringOffsets.push_back((unsigned int)m_stringPool.size());
+		m_stringPool.insert(m_stringPool.end(), text, text + strlen(text) + 1);
+		m_stringIndices[text] = stringIndex;
+		return stringIndex;
+	}
+
+	BakedXmlSchema const& m_schema;
+	std::map<std::string, unsigned int> m_stringIndices;
+	std::vector<char> m_stringPool;
+	std::vector<unsigned int> m_stringOffsets;
+	std::vector<BakedXmlAttribute> m_attributes;
+	std::vector<BakedXmlElementRecord> m_elements;
+};
+
+static void CopyFloatsToWords(unsigned int* out_words, float const* floats, int numFloats)
+{
+	memcpy(out_words, floats, sizeof(float) * numFloats);
+}
+
+static bool ConvertAttributeText(char const* text, BakedAttributeType type, unsigned int* out_value)
+{
+	// Mirrors the conversions ParseXmlAttribute(XmlElement...) does, so baked and XML loads agree
+	switch (type)
+	{
+	case BakedAttributeType::INT:
+	{
+		int value;
+		if (!XmlUtil::ToInt(text, &value)) return false;
+		out_value[0] = (unsigned int)value;
+		return true;
+	}
+	case BakedAttributeType::BOOL:
+	{
+		bool value;
+		if (!XmlUtil::ToBool(text, &value)) return false;
+		out_value[0] = value ? 1 : 0;
+		return true;
+	}
+	case BakedAttributeType::CHAR:
+	{
+		if (text[0] == '\0') return false;
+		out_value[0] = (unsigned char)text[0];
+		return true;
+	}
+	case BakedAttributeType::FLOAT:
+	{
+		float value;
+		if (!XmlUtil::ToFloat(text, &value)) return false;
+		CopyFloatsToWords(out_value, &value, 1);
+		return true;
+	}
+	case BakedAttributeType::RGBA8:
+	{
+		Rgba8 value;
+		if (!value.SetFromText(text)) return false;
+		out_value[0] = value.r | (value.g << 8) | (value.b << 16) | ((unsigned int)value.a << 24);
+		return true;
+	}
+	case BakedAttributeType::VEC2:
+	{
+		Vec2 value;
+		if (!value.SetFromText(text)) return false;
+		float floats[2] = { value.x, value.y };
+		CopyFloatsToWords(out_value, floats, 2);
+		return true;
+	}
+	case BakedAttributeType::VEC3:
+	{
+		Vec3 value;
+		if (!value.SetFromText(text)) return false;
+		float floats[3] = { value.x, value.y, value.z };
+		CopyFloatsToWords(out_value, floats, 3);
+		return true;
+	}
+	case BakedAttributeType::INTVEC2:
+	{
+		IntVec2 value;
+		if (!value.SetFromText(text)) return false;
+		out_value[0] = (unsigned int)value.x;
+		out_value[1] = (unsigned int)value.y;
+		return true;
+	}
+	case BakedAttributeType::EULER_ANGLES:
+	{
+		EulerAngles value;
+		if (!value.SetFromText(text)) return false;
+		float floats[3] = { value.m_yawDegrees, value.m_pitchDegrees, value.m_rollDegrees };
+		CopyFloatsToWords(out_value, floats, 3);
+		return true;
+	}
+	case BakedAttributeType::FLOAT_RANGE:
+	{
+		FloatRange value;
+		if (!value.SetFromText(text)) return false;
+		float floats[2] = { value.m_min, value.m_max };
+		CopyFloatsToWords(out_value, floats, 2);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+static unsigned int BakeElement(XmlElement const& element, XmlBakeContext& context)
+{
+	unsigned int elementIndex = (unsigned int)context.m_elements.size();
+	context.m_elements.emplace_back();
+	BakedXmlElementRecord record;
+	record.m_nameIndex = context.AddString(element.Name());
+	record.m_firstAttributeIndex = (unsigned int)context.m_attributes.size();
+	for (XmlAttribute const* attribute = element.FirstAttribute(); attribute != nullptr; attribute = attribute->Next())
+	{
+		BakedXmlAttribute bakedAttribute;
+		bakedAttribute.m_nameIndex = context.AddString(attribute->Name());
+		bakedAttribute.m_type = context.m_schema.GetAttributeType(element.Name(), attribute->Name());
+		if (bakedAttribute.m_type == BakedAttributeType::STRING || !ConvertAttributeText(attribute->Value(), bakedAttribute.m_type, bakedAttribute.m_value))
+		{
+			// Keep the text; asking for it at runtime then warns exactly like the XML path would
+			bakedAttribute.m_type = BakedAttributeType::STRING;
+			bakedAttribute.m_value[0] = context.AddString(attribute->Value());
+		}
+		context.m_attributes.push_back(bakedAttribute);
+		++record.m_numAttributes;
+	}
+
+	unsigned int previousChildIndex = 0;
+	for (XmlElement const* child = element.FirstChildElement(); child != nullptr; child = child->NextSiblingElement())
+	{
+		unsigned int childIndex = BakeElement(*child, context);
+		if (previousChildIndex == 0)
+		{
+			record.m_firstChildIndex = childIndex;
+		}
+		else
+		{
+			context.m_elements[previousChildIndex].m_nextSiblingIndex = childIndex;
+		}
+		previousChildIndex = childIndex;
+	}
+	context.m_elements[elementIndex].m_nameIndex = record.m_nameIndex;
+	context.m_elements[elementIndex].m_firstAttributeIndex = record.m_firstAttributeIndex;
+	context.m_elements[elementIndex].m_numAttributes = record.m_numAttributes;
+	context.m_elements[elementIndex].m_firstChildIndex = record.m_firstChildIndex;
+	return elementIndex;
+}
+
+bool BakedXmlDocument::Bake(XmlDocument const& document, BakedXmlSchema const& schema, uint64_t sourceContentHash, std::vector<unsigned char>& out_blob)
+{
+	XmlBakeContext context(schema);
+	XmlElement const* rootElement = document.RootElement();
+	if (rootElement != nullptr)
+	{
+		BakeElement(*rootElement, context);
+	}
+
+	out_blob.clear();
+	BufferWriter writer(out_blob, BufferEndianMode::Little);
+	writer.AppendUInt(BAKED_XML_FOURCC);
+	writer.AppendUInt(BAKED_XML_VERSION);
+	writer.AppendUInt64(sourceContentHash);
+	writer.AppendUInt64(schema.GetHash());
+	writer.AppendUInt((unsigned int)context.m_stringPool.size());
+	writer.AppendUInt((unsigned int)context.m_stringOffsets.size());
+	writer.AppendUInt((unsigned int)context.m_attributes.size());
+	writer.AppendUInt((unsigned int)context.m_elements.size());
+	writer.AppendArray(context.m_stringPool.data(), context.m_stringPool.size());
+	writer.AppendArray(context.m_stringOffsets.data(), context.m_stringOffsets.size());
+	writer.AppendArray(reinterpret_cast<unsigned int const*>(context.m_attributes.data()), WORDS_PER_ATTRIBUTE * context.m_attributes.size());
+	writer.AppendArray(reinterpret_cast<unsigned int const*>(context.m_elements.data()), WORDS_PER_ELEMENT * context.m_elements.size());
+	return rootElement != nullptr;
+}
+
+uint64_t BakedXmlDocument::ComputeContentHash(unsigned char const* data, size_t size)
+{
+	return HashBytes(FNV_OFFSET_BASIS, data, size);
+}
+
+bool BakedXmlDocument::IsBlobFresh(unsigned char const* blobData, size_t blobSize, uint64_t sourceContentHash, BakedXmlSchema const& schema)
+{
+	if (blobSize < BAKED_XML_HEADER_SIZE)
+	{
+		return false;
+	}
+	BufferParser parser(blobData, blobSize, BufferEndianMode::Little);
+	return parser.ParseUInt() == BAKED_XML_FOURCC && parser.ParseUInt() == BAKED_XML_VERSION
+		&& parser.ParseUInt64() == sourceContentHash && parser.ParseUInt64() == schema.GetHash();
+}
+
+//-----------------------------------------------------------------------------------------------
+static char const* GetAttributeText(BakedXmlElement const& element, BakedXmlAttribute const& attribute)
+{
+	return attribute.m_type == BakedAttributeType::STRING ? element.GetDocument().GetString(attribute.m_value[0]) : nullptr;
+}
+
+static float GetAttributeFloat(BakedXmlAttribute const& attribute, int wordIndex)
+{
+	float value;
+	memcpy(&value, &attribute.m_value[wordIndex], sizeof(value));
+	return value;
+}
+
+int ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, int defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		int value;
+		char const* text = GetAttributeText(element, *attribute);
+		if (attribute->m_type == BakedAttributeType::INT)
+		{
+			return (int)attribute->m_value[0];
+		}
+		else if (text != nullptr && XmlUtil::ToInt(text, &value))
+		{
+			return value;
+		}
+		else
+		{
+			ERROR_RECOVERABLE("Can't find the int value of the attribute");
+		}
+	}
+	return defaultValue;
+}
+
+char ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, char defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		char const* text = GetAttributeText(element, *attribute);
+		if (attribute->m_type == BakedAttributeType::CHAR)
+		{
+			return (char)attribute->m_value[0];
+		}
+		else if (text != nullptr && text[0] != '\0')
+		{
+			return text[0];
+		}
+		else
+		{
+			ERROR_RECOVERABLE("Can't find the chat value of the attribute");
+		}
+	}
+	return defaultValue;
+}
+
+bool ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, bool defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		bool value;
+		char const* text = GetAttributeText(element, *attribute);
+		if (attribute->m_type == BakedAttributeType::BOOL)
+		{
+			return attribute->m_value[0] != 0;
+		}
+		else if (text != nullptr && XmlUtil::ToBool(text, &value))
+		{
+			return value;
+		}
+		else
+		{
+			ERROR_RECOVERABLE("Can't find the bool value of the attribute");
+		}
+	}
+	return defaultValue;
+}
+
+float ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, float defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		float value;
+		char const* text = GetAttributeText(element, *attribute);
+		if (attribute->m_type == BakedAttributeType::FLOAT)
+		{
+			return GetAttributeFloat(*attribute, 0);
+		}
+		else if (text != nullptr && XmlUtil::ToFloat(text, &value))
+		{
+			return value;
+		}
+		else
+		{
+			ERROR_RECOVERABLE("Can't find the float value of the attribute");
+		}
+	}
+	return defaultValue;
+}
+
+Rgba8 ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, Rgba8 const& defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		Rgba8 value;
+		char const* text = GetAttributeText(element, *attribute);
+		if (attribute->m_type == BakedAttributeType::RGBA8)
+		{
+			unsigned int packedColor = attribute->m_value[0];
+			return Rgba8((unsigned char)packedColor, (unsigned char)(packedColor >> 8), (unsigned char)(packedColor >> 16), (unsigned char)(packedColor >> 24));
+		}
+		else if (text != nullptr && value.SetFromText(text))
+		{
+			return value;
+		}
+		else
+		{
+			ERROR_RECOVERABLE("Can't find the correct rgb8 value of the attribute");
+		}
+	}
+	return defaultValue;
+}
+
+Vec2 ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, Vec2 const& defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		Vec2 value;
+		char const* text = GetAttributeText(element, *attribute);
+		if (attribute->m_type == BakedAttributeType::VEC2)
+		{
+			return Vec2(GetAttributeFloat(*attribute, 0), GetAttributeFloat(*attribute, 1));
+		}
+		else if (text != nullptr && value.SetFromText(text))
+		{
+			return value;
+		}
+		else
+		{
+			ERROR_RECOVERABLE("Can't find the correct Vec2 value of the attribute");
+		}
+	}
+	return defaultValue;
+}
+
+Vec3 ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, Vec3 const& defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		Vec3 value;
+		char const* text = GetAttributeText(element, *attribute);
+		if (attribute->m_type == BakedAttributeType::VEC3)
+		{
+			return Vec3(GetAttributeFloat(*attribute, 0), GetAttributeFloat(*attribute, 1), GetAttributeFloat(*attribute, 2));
+		}
+		else if (text != nullptr && value.SetFromText(text))
+		{
+			return value;
+		}
+		else
+		{
+			ERROR_RECOVERABLE("Can't find the correct Vec3 value of the attribute");
+		}
+	}
+	return defaultValue;
+}
+
+EulerAngles ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, EulerAngles const& defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		EulerAngles value;
+		char const* text = GetAttributeText(element, *attribute);
+		if (attribute->m_type == BakedAttributeType::EULER_ANGLES)
+		{
+			return EulerAngles(GetAttributeFloat(*attribute, 0), GetAttributeFloat(*attribute, 1), GetAttributeFloat(*attribute, 2));
+		}
+		else if (text != nullptr && value.SetFromText(text))
+		{
+			return value;
+		}
+		else
+		{
+			ERROR_RECOVERABLE("Can't find the correct EulerAngles value of the attribute");
+		}
+	}
+	return defaultValue;
+}
+
+IntVec2 ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, IntVec2 const& defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		IntVec2 value;
+		char const* text = GetAttributeText(element, *attribute);
+		if (attribute->m_type == BakedAttributeType::INTVEC2)
+		{
+			return IntVec2((int)attribute->m_value[0], (int)attribute->m_value[1]);
+		}
+		else if (text != nullptr && value.SetFromText(text))
+		{
+			return value;
+		}
+		else
+		{
+			ERROR_RECOVERABLE("Can't find the correct IntVec2 value of the attribute");
+		}
+	}
+	return defaultValue;
+}
+
+FloatRange ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, FloatRange const& defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		FloatRange value;
+		char const* text = GetAttributeText(element, *attribute);
+		if (attribute->m_type == BakedAttributeType::FLOAT_RANGE)
+		{
+			return FloatRange(GetAttributeFloat(*attribute, 0), GetAttributeFloat(*attribute, 1));
+		}
+		else if (text != nullptr && value.SetFromText(text))
+		{
+			return value;
+		}
+		else
+		{
+			ERROR_RECOVERABLE("Can't find the correct FloatRange value of the attribute");
+		}
+	}
+	return defaultValue;
+}
+
+std::string ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, std::string const& defaultValue)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		char const* text = GetAttributeText(element, *attribute);
+		if (text != nullptr)
+		{
+			return std::string(text);
+		}
+		ERROR_RECOVERABLE("The attribute was baked as a typed value, read it with a matching type or drop it from the schema");
+	}
+	return defaultValue;
+}
+
+Strings ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, Strings const& defaultValues)
+{
+	BakedXmlAttribute const* attribute = element.FindAttribute(attributeName);
+	if (attribute != nullptr)
+	{
+		char const* text = GetAttributeText(element, *attribute);
+		if (text != nullptr)
+		{
+			return SplitStringOnDelimiter(text, ';');
+		}
+		ERROR_RECOVERABLE("The attribute was baked as a typed value, read it with a matching type or drop it from the schema");
+	}
+	return defaultValues;
+}
+
+std::string ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, char const* defaultValue)
+{
+	return ParseXmlAttribute(element, attributeName, std::string(defaultValue));
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "Engine/Core/XmlUtils.hpp"
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Game definitions are authored as XML, but string-parsing every attribute on every launch is slow. A bake turns an
+// XML document into a binary blob where the attributes named in a schema are already converted to their binary
+// values, so loading it is a few bulk copies and reading an attribute is a lookup. The blob remembers a hash of the
+// XML it came from and of the schema, and LoadFile() falls back to the XML (rebaking it) when either has changed.
+//
+// Loaders can be written once against both element types, e.g.
+//	template<typename T_Element> void ActorDefinition::LoadFrom(T_Element const& element)
+// since ParseXmlAttribute() has matching overloads for BakedXmlElement.
+
+enum class BakedAttributeType : unsigned int
+{
+	STRING, // anything not in the schema, or whose text didn't convert, stays text and is parsed on request like XML
+	INT,
+	BOOL,
+	CHAR,
+	FLOAT,
+	RGBA8,
+	VEC2,
+	VEC3,
+	INTVEC2,
+	EULER_ANGLES,
+	FLOAT_RANGE,
+	COUNT
+};
+
+class BakedXmlSchema
+{
+public:
+	// An elementName of "*" applies to that attribute on every element without a more specific entry
+	void AddAttribute(std::string const& elementName, std::string const& attributeName, BakedAttributeType type);
+	BakedAttributeType GetAttributeType(char const* elementName, char const* attributeName) const;
+	uint64_t GetHash() const;
+
+private:
+	std::map<std::pair<std::string, std::string>, BakedAttributeType> m_attributeTypes;
+};
+
+struct BakedXmlAttribute
+{
+	unsigned int m_nameIndex = 0;
+	BakedAttributeType m_type = BakedAttributeType::STRING;
+	unsigned int m_value[3] = {}; // binary value (floats as their bits), or a string index for STRING
+};
+
+struct BakedXmlElementRecord
+{
+	unsigned int m_nameIndex = 0;
+	unsigned int m_firstAttributeIndex = 0;
+	unsigned int m_numAttributes = 0;
+	unsigned int m_firstChildIndex = 0;		// 0 means none, the root is element 0 and is nobody's child
+	unsigned int m_nextSiblingIndex = 0;	// 0 means none
+};
+
+class BakedXmlDocument;
+
+class BakedXmlElement
+{
+	friend class BakedXmlDocument;
+public:
+	char const* Name() const;
+	BakedXmlElement const* FirstChildElement(char const* name = nullptr) const;
+	BakedXmlElement const* NextSiblingElement(char const* name = nullptr) const;
+	BakedXmlAttribute const* FindAttribute(char const* name) const;
+	BakedXmlDocument const& GetDocument() const;
+
+private:
+	BakedXmlDocument const* m_document = nullptr;
+	BakedXmlElementRecord m_record;
+};
+
+enum class BakedXmlLoadResult
+{
+	LOADED_BAKED,		// the baked file was fresh
+	LOADED_XML,			// the baked file was missing or stale, so the XML was parsed and baked in memory
+	FAILED
+};
+
+class BakedXmlDocument
+{
+public:
+	BakedXmlDocument() = default;
+	BakedXmlDocument(BakedXmlDocument const& copy) = delete; // elements point back at their document
+	void operator=(BakedXmlDocument const& copy) = delete;
+
+	// Loads bakedFilePath if it was baked from the current contents of xmlFilePath with the same schema, otherwise
+	// parses the XML instead, and (if writeBakedFileIfStale) writes a fresh baked file for next time
+	BakedXmlLoadResult LoadFile(std::string const& xmlFilePath, std::string const& bakedFilePath, BakedXmlSchema const& schema, bool writeBakedFileIfStale = true);
+	bool LoadFromBlob(unsigned char const* blobData, size_t blobSize); // copies out what it needs, the blob can go afterwards
+
+	BakedXmlElement const* RootElement() const;
+	char const* GetString(unsigned int stringIndex) const;
+	BakedXmlAttribute const& GetAttribute(unsigned int attributeIndex) const;
+	BakedXmlElement const& GetElement(unsigned int elementIndex) const;
+
+	// The offline step: tools or a dev console command can bake every definition file ahead of shipping
+	static bool BakeXmlFile(std::string const& xmlFilePath, std::string const& bakedFilePath, BakedXmlSchema const& schema);
+	static bool Bake(XmlDocument const& document, BakedXmlSchema const& schema, uint64_t sourceContentHash, std::vector<unsigned char>& out_blob);
+	static uint64_t ComputeContentHash(unsigned char const* data, size_t size);
+	static bool IsBlobFresh(unsigned char const* blobData, size_t blobSize, uint64_t sourceContentHash, BakedXmlSchema const& schema);
+
+private:
+	void Clear();
+
+private:
+	std::vector<char> m_stringPool;
+	std::vector<unsigned int> m_stringOffsets;
+	std::vector<BakedXmlAttribute> m_attributes;
+	std::vector<BakedXmlElement> m_elements;
+};
+
+int ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, int defaultValue);
+char ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, char defaultValue);
+bool ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, bool defaultValue);
+float ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, float defaultValue);
+Rgba8 ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, Rgba8 const& defaultValue);
+Vec2 ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, Vec2 const& defaultValue);
+Vec3 ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, Vec3 const& defaultValue);
+EulerAngles ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, EulerAngles const& defaultValue);
+IntVec2 ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, IntVec2 const& defaultValue);
+FloatRange ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, FloatRange const& defaultValue);
+std::string ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, std::string const& defaultValue);
+Strings ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, Strings const& defaultValues);
+std::string ParseXmlAttribute(BakedXmlElement const& element, char const* attributeName, char const* defaultValue);
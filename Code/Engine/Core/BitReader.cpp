@@ -0,0 +1,61 @@
+#include "Engine/Core/BitReader.hpp"
+#include "Engine/Core/BufferUtils.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+BitReader::BitReader(unsigned char const* bufferData, size_t bufferSize)
+    : m_bufferData(bufferData)
+    , m_bufferSize(bufferSize)
+{
+}
+
+BitReader::BitReader(std::vector<unsigned char> const& buffer)
+    : BitReader(buffer.data(), buffer.size())
+{
+}
+
+uint32_t BitReader::ReadBits(int numBits)
+{
+    GUARANTEE_OR_DIE(numBits >= 0 && numBits <= 32, "BitReader can only read 0 to 32 bits at a time");
+    if (m_numBitsRead + numBits > m_bufferSize * 8)
+    {
+        ERROR_AND_DIE("Attempted to read beyond bit buffer end.");
+    }
+
+    // The bits span at most 5 bytes; gather them (without reading past the buffer) and shift into place
+    size_t byteIndex = m_numBitsRead >> 3;
+    int bitOffset = (int)(m_numBitsRead & 7);
+    int numBytes = (bitOffset + numBits + 7) >> 3;
+    uint64_t gatheredBits = 0;
+    for (int i = 0; i < numBytes; ++i)
+    {
+        gatheredBits |= (uint64_t)m_bufferData[byteIndex + i] << (8 * i);
+    }
+    m_numBitsRead += numBits;
+    uint64_t mask = (1ull << numBits) - 1;
+    return (uint32_t)((gatheredBits >> bitOffset) & mask);
+}
+
+bool BitReader::ReadBool()
+{
+    return ReadBits(1) != 0;
+}
+
+float BitReader::ReadQuantizedFloat(float minValue, float maxValue, int numBits)
+{
+    return DequantizeFloat(ReadBits(numBits), minValue, maxValue, numBits);
+}
+
+void BitReader::SkipToNextByte()
+{
+    m_numBitsRead = (m_numBitsRead + 7) & ~(size_t)7;
+}
+
+size_t BitReader::GetNumBitsRead() const
+{
+    return m_numBitsRead;
+}
+
+bool BitReader::IsAtEnd() const
+{
+    return m_numBitsRead >= m_bufferSize * 8;
+}
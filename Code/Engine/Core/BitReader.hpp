@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Reads back what a BitWriter packed, in place from the caller's memory.
+class BitReader
+{
+public:
+    BitReader(unsigned char const* bufferData, size_t bufferSize);
+    BitReader(std::vector<unsigned char> const& buffer);
+
+    uint32_t ReadBits(int numBits); // 0-32 bits
+    bool ReadBool();
+    float ReadQuantizedFloat(float minValue, float maxValue, int numBits);
+    void SkipToNextByte(); // matches BitWriter::Flush()
+
+    size_t GetNumBitsRead() const;
+    bool IsAtEnd() const;
+
+private:
+    unsigned char const* m_bufferData = nullptr;
+    size_t m_bufferSize = 0;
+    size_t m_numBitsRead = 0;
+};
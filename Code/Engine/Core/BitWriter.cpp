@@ -0,0 +1,56 @@
+#include "Engine/Core/BitWriter.hpp"
+#include "Engine/Core/BufferUtils.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+BitWriter::BitWriter(std::vector<unsigned char>& buffer)
+    : m_buffer(buffer)
+{
+}
+
+BitWriter::~BitWriter()
+{
+    Flush();
+}
+
+void BitWriter::WriteBits(uint32_t value, int numBits)
+{
+    GUARANTEE_OR_DIE(numBits >= 0 && numBits <= 32, "BitWriter can only write 0 to 32 bits at a time");
+    // At most 7 bits are left pending between calls, so 32 more always fit in the 64-bit accumulator
+    uint64_t mask = (1ull << numBits) - 1;
+    m_pendingBits |= ((uint64_t)value & mask) << m_numPendingBits;
+    m_numPendingBits += numBits;
+    m_numBitsWritten += numBits;
+
+    while (m_numPendingBits >= 8)
+    {
+        m_buffer.push_back((unsigned char)m_pendingBits);
+        m_pendingBits >>= 8;
+        m_numPendingBits -= 8;
+    }
+}
+
+void BitWriter::WriteBool(bool value)
+{
+    WriteBits(value ? 1 : 0, 1);
+}
+
+void BitWriter::WriteQuantizedFloat(float value, float minValue, float maxValue, int numBits)
+{
+    WriteBits(QuantizeFloat(value, minValue, maxValue, numBits), numBits);
+}
+
+void BitWriter::Flush()
+{
+    if (m_numPendingBits > 0)
+    {
+        m_buffer.push_back((unsigned char)m_pendingBits);
+        m_numBitsWritten += 8 - m_numPendingBits;
+        m_pendingBits = 0;
+        m_numPendingBits = 0;
+    }
+}
+
+size_t BitWriter::GetNumBitsWritten() const
+{
+    return m_numBitsWritten;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Packs values into an arbitrary number of bits each, appending whole bytes to the buffer as they fill.
+// Bits go in least significant first, so the byte stream is the same on every platform.
+class BitWriter
+{
+public:
+    BitWriter(std::vector<unsigned char>& buffer);
+    ~BitWriter(); // flushes any partial byte
+
+    void WriteBits(uint32_t value, int numBits); // the low numBits (0-32) of value
+    void WriteBool(bool value);
+    void WriteQuantizedFloat(float value, float minValue, float maxValue, int numBits);
+    void Flush(); // zero-pads the last partial byte out to the buffer
+
+    size_t GetNumBitsWritten() const;
+
+private:
+    std::vector<unsigned char>& m_buffer;
+    uint64_t m_pendingBits = 0;
+    int m_numPendingBits = 0;
+    size_t m_numBitsWritten = 0;
+};
@@ -1,38 +1,51 @@
 #include "Engine/Core/BufferParser.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/MemoryMappedFile.hpp"
+#include "Engine/Core/Vertex_PCU.hpp"
+#include <cstring>
 #define UNUSED(x) (void)(x)
 
 BufferParser::BufferParser(unsigned char const* bufferData, size_t bufferSize, BufferEndianMode mode)
-    :m_mode(mode)
-    ,m_bufferSize(bufferSize)
-    ,m_scanStartPos(bufferData)
+    :m_scanPosition(bufferData)
     ,m_scanEndPos(bufferData + (bufferSize))
-    ,m_scanPosition(bufferData)
+    ,m_scanStartPos(bufferData)
+    ,m_bufferSize(bufferSize)
 {
-    m_dataCopy.resize(bufferSize);
-    std::memcpy(m_dataCopy.data(), bufferData, bufferSize);
-    if (mode == BufferEndianMode::Native)
-    {
-        m_mode = GetPlatformNativeEndian();
-    }
-
-    bool platformIsLittleEndian = IsPlatformLittleEndian();
-    m_isOppositeEndiannessFromNative = (m_mode == BufferEndianMode::Little && !platformIsLittleEndian) 
-        || (m_mode == BufferEndianMode::Big && platformIsLittleEndian);
-
+    SetEndianMode(mode);
 }
 
 BufferParser::BufferParser(std::vector<unsigned char> const& buffer, BufferEndianMode mode)
-    : m_mode(mode)
-    , m_dataCopy(buffer)
-    , m_bufferSize(buffer.size())
-    , m_scanStartPos(buffer.data())
-    , m_scanEndPos(buffer.data() + (buffer.size()))
-    , m_scanPosition(buffer.data())
+    :BufferParser(buffer.data(), buffer.size(), mode)
 {
 
 }
 
+BufferParser::BufferParser(MemoryMappedFile& file, BufferEndianMode mode, size_t streamingWindowSize)
+    :m_bufferSize((size_t)file.GetFileSize())
+{
+    SetEndianMode(mode);
+    if (m_bufferSize == 0)
+    {
+        return;
+    }
+    if (streamingWindowSize == 0)
+    {
+        unsigned char const* fileData = file.GetData();
+        if (fileData == nullptr)
+        {
+            fileData = file.MapView(0, m_bufferSize);
+            GUARANTEE_OR_DIE(fileData != nullptr, "Failed to map the file for parsing");
+        }
+        m_scanStartPos = fileData;
+        m_scanPosition = fileData;
+        m_scanEndPos = fileData + m_bufferSize;
+        return;
+    }
+    m_streamingFile = &file;
+    m_streamingWindowSize = streamingWindowSize;
+    GUARANTEE_OR_DIE(MapStreamingWindow(0, 0), "Failed to map the first streaming window of the file");
+}
+
 unsigned char const* BufferParser::ParseBytes(size_t byteSize)
 {
     GuaranteeBufferDataAvailable(byteSize);
@@ -56,19 +69,8 @@ char BufferParser::ParseChar()
 
 unsigned short BufferParser::ParseUShort()
 {
-    GuaranteeBufferDataAvailable(2);
-
     unsigned short finalValue;
-    unsigned char* bytesArray = reinterpret_cast<unsigned char*>(&finalValue);
-
-    bytesArray[0] = ParseByte();
-    bytesArray[1] = ParseByte();
-
-    if (m_isOppositeEndiannessFromNative)
-    {
-        Reverse2BytesInPlace(bytesArray);
-    }
-
+    ParseWords(&finalValue, 1, sizeof(finalValue));
     return finalValue;
 }
 
@@ -79,21 +81,8 @@ short BufferParser::ParseShort()
 
 unsigned int BufferParser::ParseUInt()
 {
-    GuaranteeBufferDataAvailable(4);
-
     unsigned int finalValue;
-    unsigned char* bytesArray = reinterpret_cast<unsigned char*>(&finalValue);
-
-    bytesArray[0] = ParseByte();
-    bytesArray[1] = ParseByte();
-    bytesArray[2] = ParseByte();
-    bytesArray[3] = ParseByte();
-
-    if (m_isOppositeEndiannessFromNative)
-    {
-        Reverse4BytesInPlace(&finalValue);
-    }
-
+    ParseWords(&finalValue, 1, sizeof(finalValue));
     return finalValue;
 }
 
@@ -105,25 +94,8 @@ int BufferParser::ParseInt()
 
 uint64_t BufferParser::ParseUInt64()
 {
-    GuaranteeBufferDataAvailable(8);
-
     uint64_t finalValue;
-    unsigned char* bytesArray = reinterpret_cast<unsigned char*>(&finalValue);
-
-    bytesArray[0] = ParseByte();
-    bytesArray[1] = ParseByte();
-    bytesArray[2] = ParseByte();
-    bytesArray[3] = ParseByte();
-    bytesArray[4] = ParseByte();
-    bytesArray[5] = ParseByte();
-    bytesArray[6] = ParseByte();
-    bytesArray[7] = ParseByte();
-
-    if (m_isOppositeEndiannessFromNative)
-    {
-        Reverse8BytesInPlace(&finalValue);
-    }
-
+    ParseWords(&finalValue, 1, sizeof(finalValue));
     return finalValue;
 }
 
@@ -136,50 +108,144 @@ int64_t BufferParser::ParseInt64()
 
 float BufferParser::ParseFloat()
 {
-    GuaranteeBufferDataAvailable(4); 
     float finalValue;
-    unsigned char* floatAsArrayOfBytes = reinterpret_cast<unsigned char*> (&finalValue);
-    floatAsArrayOfBytes[0] = ParseByte();
-    floatAsArrayOfBytes[1] = ParseByte();
-    floatAsArrayOfBytes[2] = ParseByte();
-    floatAsArrayOfBytes[3] = ParseByte();
-
-    if (m_isOppositeEndiannessFromNative)
-    {
-        Reverse4BytesInPlace(&finalValue);
-    }
-
+    ParseWords(&finalValue, 1, sizeof(finalValue));
     return finalValue;
 }
 
 double BufferParser::ParseDouble()
 {
-    GuaranteeBufferDataAvailable(8);
-
     double finalValue;
-    unsigned char* bytesArray = reinterpret_cast<unsigned char*>(&finalValue);
+    ParseWords(&finalValue, 1, sizeof(finalValue));
+    return finalValue;
+}
 
-    bytesArray[0] = ParseByte();
-    bytesArray[1] = ParseByte();
-    bytesArray[2] = ParseByte();
-    bytesArray[3] = ParseByte();
-    bytesArray[4] = ParseByte();
-    bytesArray[5] = ParseByte();
-    bytesArray[6] = ParseByte();
-    bytesArray[7] = ParseByte();
+void BufferParser::ParseArray(unsigned char* out_array, size_t count)
+{
+    ParseWords(out_array, count, 1);
+}
+
+void BufferParser::ParseArray(char* out_array, size_t count)
+{
+    ParseWords(out_array, count, 1);
+}
+
+void BufferParser::ParseArray(unsigned short* out_array, size_t count)
+{
+    ParseWords(out_array, count, sizeof(unsigned short));
+}
+
+void BufferParser::ParseArray(short* out_array, size_t count)
+{
+    ParseWords(out_array, count, sizeof(short));
+}
+
+void BufferParser::ParseArray(unsigned int* out_array, size_t count)
+{
+    ParseWords(out_array, count, sizeof(unsigned int));
+}
+
+void BufferParser::ParseArray(int* out_array, size_t count)
+{
+    ParseWords(out_array, count, sizeof(int));
+}
 
+void BufferParser::ParseArray(uint64_t* out_array, size_t count)
+{
+    ParseWords(out_array, count, sizeof(uint64_t));
+}
+
+void BufferParser::ParseArray(int64_t* out_array, size_t count)
+{
+    ParseWords(out_array, count, sizeof(int64_t));
+}
+
+void BufferParser::ParseArray(float* out_array, size_t count)
+{
+    ParseWords(out_array, count, sizeof(float));
+}
+
+void BufferParser::ParseArray(double* out_array, size_t count)
+{
+    ParseWords(out_array, count, sizeof(double));
+}
+
+void BufferParser::ParseArray(Vec2* out_array, size_t count)
+{
+    ParseWords(out_array, count * 2, sizeof(float));
+}
+
+void BufferParser::ParseArray(Vec3* out_array, size_t count)
+{
+    ParseWords(out_array, count * 3, sizeof(float));
+}
+
+void BufferParser::ParseArray(Vertex_PCU* out_array, size_t count)
+{
+    size_t numBytes = count * sizeof(Vertex_PCU);
+    GuaranteeBufferDataAvailable(numBytes);
     if (m_isOppositeEndiannessFromNative)
     {
-        Reverse8BytesInPlace(&finalValue);
+        CopyWithReversedBytes(out_array, m_scanPosition, count);
+    }
+    else
+    {
+        memcpy(static_cast<void*>(out_array), m_scanPosition, numBytes);
     }
+    m_scanPosition += numBytes;
+}
 
-    return finalValue;
+uint64_t BufferParser::ParseVarUInt()
+{
+    constexpr size_t MAX_VARUINT_BYTES = 10;
+    uint64_t value = 0;
+    if (m_scanEndPos - m_scanPosition >= (ptrdiff_t)MAX_VARUINT_BYTES)
+    {
+        // Enough bytes left in the buffer for the longest encoding, so skip the per-byte bounds checks
+        for (size_t byteIndex = 0; byteIndex < MAX_VARUINT_BYTES; ++byteIndex)
+        {
+            unsigned char byte = m_scanPosition[byteIndex];
+            value |= (uint64_t)(byte & 0x7F) << (7 * byteIndex);
+            if ((byte & 0x80) == 0)
+            {
+                m_scanPosition += byteIndex + 1;
+                return value;
+            }
+        }
+    }
+    else
+    {
+        for (size_t byteIndex = 0; byteIndex < MAX_VARUINT_BYTES; ++byteIndex)
+        {
+            unsigned char byte = ParseByte();
+            value |= (uint64_t)(byte & 0x7F) << (7 * byteIndex);
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+    }
+    ERROR_AND_DIE("Malformed varint: more than 10 bytes long.");
+}
+
+int64_t BufferParser::ParseVarInt()
+{
+    return ZigZagDecode(ParseVarUInt());
+}
+
+void BufferParser::ParseDeltaVarIntArray(int* out_array, size_t count)
+{
+    int64_t previousValue = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        previousValue += ParseVarInt();
+        out_array[i] = (int)previousValue;
+    }
 }
 
 void BufferParser::ParseStringOfLength(std::string& out_string, unsigned int stringLength)
 {
     GuaranteeBufferDataAvailable(stringLength);
-    out_string.reserve(stringLength);
     out_string.assign((char const*)m_scanPosition, stringLength);
     m_scanPosition += stringLength;
 }
@@ -203,16 +269,27 @@ void BufferParser::ParseStringZeroTerminated(std::string& out_string)
 {
     out_string.clear();
 
-    while (m_scanPosition < m_scanEndPos && *m_scanPosition != 0)
-    {
-        out_string.push_back(static_cast<char>(*m_scanPosition));
-        m_scanPosition++;
-    }
-
-    // Skip the terminating zero byte if we're not at the end
-    if (m_scanPosition < m_scanEndPos)
+    for (;;)
     {
-        m_scanPosition++;
+        unsigned char const* terminator = nullptr;
+        if (m_scanPosition < m_scanEndPos)
+        {
+            terminator = static_cast<unsigned char const*>(memchr(m_scanPosition, 0, m_scanEndPos - m_scanPosition));
+        }
+        if (terminator)
+        {
+            out_string.append((char const*)m_scanPosition, terminator - m_scanPosition);
+            m_scanPosition = terminator + 1; // skip the terminating zero byte
+            return;
+        }
+        out_string.append((char const*)m_scanPosition, m_scanEndPos - m_scanPosition);
+        m_scanPosition = m_scanEndPos;
+
+        // The string may carry on into the next streaming window
+        if (m_streamingFile == nullptr || !MapStreamingWindow(GetPosition(), 1))
+        {
+            return;
+        }
     }
 }
 
@@ -222,16 +299,29 @@ void BufferParser::JumpToPosition(size_t position)
     {
         ERROR_RECOVERABLE("Position is beyond buffer data end.");
     }
+    else if (position >= m_windowFileOffset && position < m_windowFileOffset + (m_scanEndPos - m_scanStartPos))
+    {
+        m_scanPosition = m_scanStartPos + (position - m_windowFileOffset);
+    }
     else
     {
-        m_scanPosition = m_scanStartPos + position;
+        MapStreamingWindow(position, 0);
     }
 }
 
+size_t BufferParser::GetPosition() const
+{
+    return (size_t)m_windowFileOffset + (m_scanPosition - m_scanStartPos);
+}
+
 void BufferParser::GuaranteeBufferDataAvailable(size_t bytesNeeded)
 {
     if (m_scanPosition + bytesNeeded > m_scanEndPos )
     {
+        if (m_streamingFile && MapStreamingWindow(GetPosition(), bytesNeeded))
+        {
+            return;
+        }
         ERROR_AND_DIE("Attempted to read beyond buffer data end.");
     }
 }
@@ -253,7 +343,7 @@ void BufferParser::SetEndianMode(BufferEndianMode mode)
 
 bool BufferParser::IsAtEnd() const
 {
-    return m_scanPosition >= m_scanEndPos;
+    return GetPosition() >= m_bufferSize;
 }
 
 Vec2 BufferParser::ParseVec2()
@@ -296,3 +386,47 @@ Plane2 BufferParser::ParsePlane2()
     result.m_distFromOriginAlongNormal = ParseFloat();
     return result;
 }
+
+void BufferParser::ParseWords(void* out_words, size_t numWords, size_t bytesPerWord)
+{
+    // One bounds check and one pass for the whole run, swapping on the way if the buffer's endianness differs
+    size_t numBytes = numWords * bytesPerWord;
+    GuaranteeBufferDataAvailable(numBytes);
+    if (m_isOppositeEndiannessFromNative && bytesPerWord > 1)
+    {
+        CopyWithReversedBytes(out_words, m_scanPosition, numWords, bytesPerWord);
+    }
+    else
+    {
+        memcpy(out_words, m_scanPosition, numBytes);
+    }
+    m_scanPosition += numBytes;
+}
+
+bool BufferParser::MapStreamingWindow(uint64_t fileOffset, size_t bytesNeeded)
+{
+    if (fileOffset + bytesNeeded > m_bufferSize)
+    {
+        return false;
+    }
+    // Windows are at least big enough for the value being parsed, and never run past the end of the file
+    size_t windowSize = (m_streamingWindowSize > bytesNeeded) ? m_streamingWindowSize : bytesNeeded;
+    if (fileOffset + windowSize > m_bufferSize)
+    {
+        windowSize = (size_t)(m_bufferSize - fileOffset);
+    }
+    if (windowSize == 0)
+    {
+        return false;
+    }
+    unsigned char const* windowData = m_streamingFile->MapView(fileOffset, windowSize);
+    if (windowData == nullptr)
+    {
+        return false;
+    }
+    m_windowFileOffset = fileOffset;
+    m_scanStartPos = windowData;
+    m_scanPosition = windowData;
+    m_scanEndPos = windowData + windowSize;
+    return true;
+}
@@ -8,12 +8,19 @@
 #include "Engine/Math/AABB2.hpp"
 #include "Engine/Core/BufferUtils.hpp"
 #include "Engine/Math/Plane2.hpp"
+class MemoryMappedFile;
+struct Vertex_PCU;
+
+// Parses in place, straight out of the caller's memory, so the buffer must outlive the parser.
 class BufferParser
 {
 public:
     BufferParser(unsigned char const* bufferData, size_t bufferSize, BufferEndianMode mode = BufferEndianMode::Native);
     BufferParser( std::vector<unsigned char> const& buffer, BufferEndianMode mode = BufferEndianMode::Native);
-    unsigned char const* ParseBytes(size_t byteSize); // returns pointer to the data and advances position
+    // With a streamingWindowSize of 0 the whole file is parsed in place; otherwise only a window of about that many
+    // bytes is mapped at a time and slides forward as parsing goes, for files too big to map at once.
+    BufferParser(MemoryMappedFile& file, BufferEndianMode mode = BufferEndianMode::Native, size_t streamingWindowSize = 0);
+    unsigned char const* ParseBytes(size_t byteSize); // returns pointer to the data and advances position (when streaming, valid until the window next moves)
     unsigned char ParseByte();
     char ParseChar();
     unsigned short ParseUShort();
@@ -25,12 +32,32 @@ public:
     float ParseFloat();
     double ParseDouble();
 
+    // Bulk versions: one bounds check and one copy for the whole array, with SIMD byte swapping if needed
+    void ParseArray(unsigned char* out_array, size_t count);
+    void ParseArray(char* out_array, size_t count);
+    void ParseArray(unsigned short* out_array, size_t count);
+    void ParseArray(short* out_array, size_t count);
+    void ParseArray(unsigned int* out_array, size_t count);
+    void ParseArray(int* out_array, size_t count);
+    void ParseArray(uint64_t* out_array, size_t count);
+    void ParseArray(int64_t* out_array, size_t count);
+    void ParseArray(float* out_array, size_t count);
+    void ParseArray(double* out_array, size_t count);
+    void ParseArray(Vec2* out_array, size_t count);
+    void ParseArray(Vec3* out_array, size_t count);
+    void ParseArray(Vertex_PCU* out_array, size_t count);
+
+    uint64_t ParseVarUInt(); // see BufferWriter::AppendVarUInt
+    int64_t ParseVarInt();
+    void ParseDeltaVarIntArray(int* out_array, size_t count);
+
     void ParseStringZeroTerminated(std::string& out_string);
     void ParseStringOfLength(std::string& out_string, unsigned int stringLength);
     std::string ParseStringZeroTerminated();
     std::string ParseStringLengthPreceded();
 
-    void JumpToPosition(size_t position);
+    void JumpToPosition(size_t position); // positions are always from the start of the buffer/file, even when streaming
+    size_t GetPosition() const;
     void GuaranteeBufferDataAvailable(size_t bytesNeeded);
     void SetEndianMode(BufferEndianMode mode);
     bool IsAtEnd() const;
@@ -41,12 +68,18 @@ public:
     AABB2 ParseAABB2();
     Plane2 ParsePlane2();
 private:
+    void ParseWords(void* out_words, size_t numWords, size_t bytesPerWord);
+    bool MapStreamingWindow(uint64_t fileOffset, size_t bytesNeeded);
 
-    std::vector<unsigned char>  m_dataCopy;
+private:
     unsigned char const* m_scanPosition = nullptr;
     unsigned char const* m_scanEndPos = nullptr;
     unsigned char const* m_scanStartPos = nullptr;
-    size_t m_bufferSize;
+    size_t m_bufferSize = 0; // the whole file's size when streaming
     BufferEndianMode m_mode = BufferEndianMode::Native;
     bool m_isOppositeEndiannessFromNative = false;
+
+    MemoryMappedFile* m_streamingFile = nullptr;
+    uint64_t m_windowFileOffset = 0; // file offset of m_scanStartPos
+    size_t m_streamingWindowSize = 0;
 };
@@ -1,6 +1,22 @@
 #include "Engine/Core/BufferUtils.hpp"
+#include "Engine/Core/Vertex_PCU.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include <cstddef>
+#include <cstring>
 //#define UNUSED(x) (void)(x)
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BUFFER_UTILS_HAS_SSSE3_PATH
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BUFFER_UTILS_SSSE3_FUNCTION
+#else
+#include <cpuid.h>
+#define BUFFER_UTILS_SSSE3_FUNCTION __attribute__((target("ssse3")))
+#endif
+#endif
+
 bool IsPlatformLittleEndian()
 {
     uint16_t value = 0x0001;
@@ -47,5 +63,138 @@ void Reverse8BytesInPlace(void* ptrTo64BitQword)
     *asUint64Ptr = reversedUint64;
 }
 
+uint64_t ZigZagEncode(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t ZigZagDecode(uint64_t encoded)
+{
+    return (int64_t)(encoded >> 1) ^ -(int64_t)(encoded & 1);
+}
+
+unsigned int QuantizeFloat(float value, float minValue, float maxValue, int numBits)
+{
+    double maxQuantized = (double)(0xFFFFFFFFull >> (32 - numBits));
+    double fraction = ((double)value - (double)minValue) / ((double)maxValue - (double)minValue);
+    if (!(fraction > 0.0)) // also catches NaN
+    {
+        return 0;
+    }
+    if (fraction >= 1.0)
+    {
+        return (unsigned int)maxQuantized;
+    }
+    return (unsigned int)(fraction * maxQuantized + 0.5);
+}
 
+float DequantizeFloat(unsigned int quantized, float minValue, float maxValue, int numBits)
+{
+    double maxQuantized = (double)(0xFFFFFFFFull >> (32 - numBits));
+    return (float)((double)minValue + ((double)maxValue - (double)minValue) * ((double)quantized / maxQuantized));
+}
 
+#if defined(BUFFER_UTILS_HAS_SSSE3_PATH)
+static bool IsSSSE3Supported()
+{
+    int cpuInfo[4] = {};
+#if defined(_MSC_VER)
+    __cpuid(cpuInfo, 1);
+#else
+    __cpuid(1, cpuInfo[0], cpuInfo[1], cpuInfo[2], cpuInfo[3]);
+#endif
+    return (cpuInfo[2] & (1 << 9)) != 0;
+}
+
+static bool const s_isSSSE3Supported = IsSSSE3Supported();
+
+// Shuffles 16-byte blocks from in to out, cycling through the masks; each mask says where each output byte comes from
+BUFFER_UTILS_SSSE3_FUNCTION static size_t ShuffleBytesInBlocks_SSSE3(unsigned char* out_bytes, unsigned char const* bytes, size_t numBytes, __m128i const* blockMasks, size_t numBlockMasks)
+{
+    size_t const bytesPerPattern = 16 * numBlockMasks;
+    size_t byteIndex = 0;
+    for (; byteIndex + bytesPerPattern <= numBytes; byteIndex += bytesPerPattern)
+    {
+        for (size_t maskIndex = 0; maskIndex < numBlockMasks; ++maskIndex)
+        {
+            size_t blockIndex = byteIndex + 16 * maskIndex;
+            __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(bytes + blockIndex));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out_bytes + blockIndex), _mm_shuffle_epi8(block, blockMasks[maskIndex]));
+        }
+    }
+    return byteIndex;
+}
+#endif
+
+void CopyWithReversedBytes(void* out_words, void const* words, size_t numWords, size_t bytesPerWord)
+{
+    unsigned char* outBytes = static_cast<unsigned char*>(out_words);
+    unsigned char const* bytes = static_cast<unsigned char const*>(words);
+    size_t numBytes = numWords * bytesPerWord;
+    size_t byteIndex = 0;
+#if defined(BUFFER_UTILS_HAS_SSSE3_PATH)
+    if (s_isSSSE3Supported && numBytes >= 16)
+    {
+        __m128i blockMask;
+        switch (bytesPerWord)
+        {
+        case 2: blockMask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14); break;
+        case 4: blockMask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12); break;
+        case 8: blockMask = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8); break;
+        default: blockMask = _mm_setzero_si128(); break;
+        }
+        if (bytesPerWord == 2 || bytesPerWord == 4 || bytesPerWord == 8)
+        {
+            byteIndex = ShuffleBytesInBlocks_SSSE3(outBytes, bytes, numBytes, &blockMask, 1);
+        }
+    }
+#endif
+    if (outBytes != bytes)
+    {
+        memcpy(outBytes + byteIndex, bytes + byteIndex, numBytes - byteIndex);
+    }
+    for (; byteIndex < numBytes; byteIndex += bytesPerWord)
+    {
+        switch (bytesPerWord)
+        {
+        case 2: Reverse2BytesInPlace(outBytes + byteIndex); break;
+        case 4: Reverse4BytesInPlace(outBytes + byteIndex); break;
+        case 8: Reverse8BytesInPlace(outBytes + byteIndex); break;
+        default: ERROR_AND_DIE("CopyWithReversedBytes only handles 2, 4 and 8 byte words");
+        }
+    }
+}
+
+void CopyWithReversedBytes(Vertex_PCU* out_vertices, void const* vertices, size_t numVertices)
+{
+    static_assert(sizeof(Vertex_PCU) == 24 && offsetof(Vertex_PCU, m_color) == 12, "Vertex_PCU byte swapping assumes a packed xyz|rgba|uv layout");
+    unsigned char* outBytes = reinterpret_cast<unsigned char*>(out_vertices);
+    unsigned char const* bytes = static_cast<unsigned char const*>(vertices);
+    size_t numBytes = numVertices * sizeof(Vertex_PCU);
+    size_t byteIndex = 0;
+#if defined(BUFFER_UTILS_HAS_SSSE3_PATH)
+    if (s_isSSSE3Supported)
+    {
+        // Two vertices are three 16-byte blocks: xyzC uvxy zCuv, where C is a color that keeps its byte order
+        __m128i const blockMasks[3] = {
+            _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 12, 13, 14, 15),
+            _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12),
+            _mm_setr_epi8(3, 2, 1, 0, 4, 5, 6, 7, 11, 10, 9, 8, 15, 14, 13, 12),
+        };
+        byteIndex = ShuffleBytesInBlocks_SSSE3(outBytes, bytes, numBytes, blockMasks, 3);
+    }
+#endif
+    if (outBytes != bytes)
+    {
+        memcpy(outBytes + byteIndex, bytes + byteIndex, numBytes - byteIndex);
+    }
+    for (; byteIndex < numBytes; byteIndex += sizeof(Vertex_PCU))
+    {
+        Vertex_PCU& vertex = *reinterpret_cast<Vertex_PCU*>(outBytes + byteIndex);
+        Reverse4BytesInPlace(&vertex.m_position.x);
+        Reverse4BytesInPlace(&vertex.m_position.y);
+        Reverse4BytesInPlace(&vertex.m_position.z);
+        Reverse4BytesInPlace(&vertex.m_uvTexCoords.x);
+        Reverse4BytesInPlace(&vertex.m_uvTexCoords.y);
+    }
+}
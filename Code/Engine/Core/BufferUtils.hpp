@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <cstdint>
+struct Vertex_PCU;
 enum class BufferEndianMode
 {
     Native = 0,
@@ -11,4 +13,15 @@ bool IsPlatformLittleEndian();
 BufferEndianMode GetPlatformNativeEndian();
 void Reverse2BytesInPlace(void* ptrTo16BitWord);
 void Reverse4BytesInPlace(void* ptrTo32BitDword);
-void Reverse8BytesInPlace(void* ptrTo64BitQword);
\ No newline at end of file
+void Reverse8BytesInPlace(void* ptrTo64BitQword);
+
+// Whole-array versions for bulk parsing/writing, copying and swapping in one pass (out may equal in for in-place).
+// Use SSSE3 byte shuffles when the CPU has them.
+void CopyWithReversedBytes(void* out_words, void const* words, size_t numWords, size_t bytesPerWord); // bytesPerWord is 2, 4 or 8
+void CopyWithReversedBytes(Vertex_PCU* out_vertices, void const* vertices, size_t numVertices); // swaps the floats, leaves each Rgba8 alone
+
+// Compact encodings shared by BufferWriter/BufferParser and BitWriter/BitReader
+uint64_t ZigZagEncode(int64_t value); // small magnitudes of either sign become small unsigned values: 0,-1,1,-2 -> 0,1,2,3
+int64_t ZigZagDecode(uint64_t encoded);
+unsigned int QuantizeFloat(float value, float minValue, float maxValue, int numBits); // clamps to the range, numBits 1-32
+float DequantizeFloat(unsigned int quantized, float minValue, float maxValue, int numBits);
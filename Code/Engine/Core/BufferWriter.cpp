@@ -1,5 +1,6 @@
 #include "Engine/Core/BufferWriter.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/Vertex_PCU.hpp"
 BufferWriter::BufferWriter(std::vector<unsigned char>& buffer, BufferEndianMode mode)
     : m_buffer(buffer)
     , m_mode(mode)
@@ -28,123 +29,143 @@ void BufferWriter::AppendChar(char c)
 
 void BufferWriter::AppendUShort(unsigned short ushort)
 {
-    unsigned short* addressOfShort = &ushort;
-    unsigned char* addressOfShortAsByteArray = reinterpret_cast<unsigned char*>(addressOfShort);
-    if (m_isOppositeEndiannessFromNative)
-    {
-        Reverse2BytesInPlace(addressOfShortAsByteArray);
-    }
-    AppendByte(addressOfShortAsByteArray[0]);
-    AppendByte(addressOfShortAsByteArray[1]);
+    AppendWords(&ushort, 1, sizeof(ushort));
 }
 
 void BufferWriter::AppendShort(short s)
 {
-    short* addressOfShort = &s;
-    unsigned char* addressOfShortAsByteArray = reinterpret_cast<unsigned char*>(addressOfShort);
-    if (m_isOppositeEndiannessFromNative)
-    {
-        Reverse2BytesInPlace(addressOfShortAsByteArray);
-    }
-    AppendByte(addressOfShortAsByteArray[0]);
-    AppendByte(addressOfShortAsByteArray[1]);
+    AppendWords(&s, 1, sizeof(s));
 }
 
 void BufferWriter::AppendUInt(unsigned int uint)
 {
-    unsigned int* addressOfUInt = &uint;
-    unsigned char* addressOfUIntAsByteArray = reinterpret_cast<unsigned char*>(addressOfUInt);
-    if (m_isOppositeEndiannessFromNative)
-    {
-        Reverse4BytesInPlace(addressOfUIntAsByteArray);
-    }
-    AppendByte(addressOfUIntAsByteArray[0]);
-    AppendByte(addressOfUIntAsByteArray[1]);
-    AppendByte(addressOfUIntAsByteArray[2]);
-    AppendByte(addressOfUIntAsByteArray[3]);
+    AppendWords(&uint, 1, sizeof(uint));
 }
 
 void BufferWriter::AppendInt(int i)
 {
-    int* addressOfInt = &i;
-    unsigned char* addressOfIntAsByteArray = reinterpret_cast<unsigned char*>(addressOfInt);
-    if (m_isOppositeEndiannessFromNative)
-    {
-        Reverse4BytesInPlace(addressOfIntAsByteArray);
-    }
-    AppendByte(addressOfIntAsByteArray[0]);
-    AppendByte(addressOfIntAsByteArray[1]);
-    AppendByte(addressOfIntAsByteArray[2]);
-    AppendByte(addressOfIntAsByteArray[3]);
+    AppendWords(&i, 1, sizeof(i));
 }
 
 void BufferWriter::AppendUInt64(uint64_t ui64)
 {
-    uint64_t* addressOfUInt64 = &ui64;
-    unsigned char* addressOfUInt64AsByteArray = reinterpret_cast<unsigned char*>(addressOfUInt64);
-    if (m_isOppositeEndiannessFromNative)
-    {
-        Reverse8BytesInPlace(addressOfUInt64AsByteArray);
-    }
-    AppendByte( addressOfUInt64AsByteArray[0]);
-    AppendByte( addressOfUInt64AsByteArray[1]);
-    AppendByte( addressOfUInt64AsByteArray[2]);
-    AppendByte( addressOfUInt64AsByteArray[3]);
-    AppendByte( addressOfUInt64AsByteArray[4]);
-    AppendByte( addressOfUInt64AsByteArray[5]);
-    AppendByte( addressOfUInt64AsByteArray[6]);
-    AppendByte( addressOfUInt64AsByteArray[7]);
+    AppendWords(&ui64, 1, sizeof(ui64));
 }
 
 void BufferWriter::AppendInt64(int64_t i64)
 {
-    int64_t* addressOfInt64 = &i64;
-    unsigned char* addressOfInt64AsByteArray = reinterpret_cast<unsigned char*>(addressOfInt64);
-    if (m_isOppositeEndiannessFromNative)
+    AppendWords(&i64, 1, sizeof(i64));
+}
+
+void BufferWriter::AppendFloat(float f)
+{
+    AppendWords(&f, 1, sizeof(f));
+}
+
+void BufferWriter::AppendDouble(double d)
+{
+    AppendWords(&d, 1, sizeof(d));
+}
+
+void BufferWriter::AppendArray(unsigned char const* elements, size_t count)
+{
+    AppendWords(elements, count, 1);
+}
+
+void BufferWriter::AppendArray(char const* elements, size_t count)
+{
+    AppendWords(elements, count, 1);
+}
+
+void BufferWriter::AppendArray(unsigned short const* elements, size_t count)
+{
+    AppendWords(elements, count, sizeof(unsigned short));
+}
+
+void BufferWriter::AppendArray(short const* elements, size_t count)
+{
+    AppendWords(elements, count, sizeof(short));
+}
+
+void BufferWriter::AppendArray(unsigned int const* elements, size_t count)
+{
+    AppendWords(elements, count, sizeof(unsigned int));
+}
+
+void BufferWriter::AppendArray(int const* elements, size_t count)
+{
+    AppendWords(elements, count, sizeof(int));
+}
+
+void BufferWriter::AppendArray(uint64_t const* elements, size_t count)
+{
+    AppendWords(elements, count, sizeof(uint64_t));
+}
+
+void BufferWriter::AppendArray(int64_t const* elements, size_t count)
+{
+    AppendWords(elements, count, sizeof(int64_t));
+}
+
+void BufferWriter::AppendArray(float const* elements, size_t count)
+{
+    AppendWords(elements, count, sizeof(float));
+}
+
+void BufferWriter::AppendArray(double const* elements, size_t count)
+{
+    AppendWords(elements, count, sizeof(double));
+}
+
+void BufferWriter::AppendArray(Vec2 const* elements, size_t count)
+{
+    AppendWords(elements, count * 2, sizeof(float));
+}
+
+void BufferWriter::AppendArray(Vec3 const* elements, size_t count)
+{
+    AppendWords(elements, count * 3, sizeof(float));
+}
+
+void BufferWriter::AppendArray(Vertex_PCU const* elements, size_t count)
+{
+    if (!m_isOppositeEndiannessFromNative || count == 0)
     {
-        Reverse8BytesInPlace(addressOfInt64AsByteArray);
+        AppendWords(elements, count * sizeof(Vertex_PCU), 1);
+        return;
     }
-    AppendByte(addressOfInt64AsByteArray[0]);
-    AppendByte(addressOfInt64AsByteArray[1]);
-    AppendByte(addressOfInt64AsByteArray[2]);
-    AppendByte(addressOfInt64AsByteArray[3]);
-    AppendByte(addressOfInt64AsByteArray[4]);
-    AppendByte(addressOfInt64AsByteArray[5]);
-    AppendByte(addressOfInt64AsByteArray[6]);
-    AppendByte(addressOfInt64AsByteArray[7]);
+    size_t writePosition = m_buffer.size();
+    m_buffer.resize(writePosition + count * sizeof(Vertex_PCU));
+    CopyWithReversedBytes(reinterpret_cast<Vertex_PCU*>(&m_buffer[writePosition]), elements, count);
 }
 
-void BufferWriter::AppendFloat(float f)
+void BufferWriter::AppendVarUInt(uint64_t value)
 {
-    float* addressOfFloat = &f;
-    unsigned char* addressOfFloatAsByteArray = reinterpret_cast<unsigned char*> (addressOfFloat);
-    if (m_isOppositeEndiannessFromNative)
+    unsigned char encoded[10];
+    size_t numBytes = 0;
+    while (value >= 0x80)
     {
-        Reverse4BytesInPlace(addressOfFloatAsByteArray);
+        encoded[numBytes++] = (unsigned char)(value | 0x80);
+        value >>= 7;
     }
-    AppendByte(addressOfFloatAsByteArray[0]);
-    AppendByte(addressOfFloatAsByteArray[1]);
-    AppendByte(addressOfFloatAsByteArray[2]);
-    AppendByte(addressOfFloatAsByteArray[3]);
+    encoded[numBytes++] = (unsigned char)value;
+    m_buffer.insert(m_buffer.end(), encoded, encoded + numBytes);
 }
 
-void BufferWriter::AppendDouble(double d)
+void BufferWriter::AppendVarInt(int64_t value)
 {
-    double* addressOfDouble = &d;
-    unsigned char* addressOfDoubleAsByteArray = reinterpret_cast<unsigned char*>(addressOfDouble);
-    if (m_isOppositeEndiannessFromNative)
+    AppendVarUInt(ZigZagEncode(value));
+}
+
+void BufferWriter::AppendDeltaVarIntArray(int const* values, size_t count)
+{
+    int64_t previousValue = 0;
+    for (size_t i = 0; i < count; ++i)
     {
-        Reverse8BytesInPlace(addressOfDoubleAsByteArray);
+        AppendVarInt((int64_t)values[i] - previousValue);
+        previousValue = values[i];
     }
-    AppendByte(addressOfDoubleAsByteArray[0]);
-    AppendByte(addressOfDoubleAsByteArray[1]);
-    AppendByte(addressOfDoubleAsByteArray[2]);
-    AppendByte(addressOfDoubleAsByteArray[3]);
-    AppendByte(addressOfDoubleAsByteArray[4]);
-    AppendByte(addressOfDoubleAsByteArray[5]);
-    AppendByte(addressOfDoubleAsByteArray[6]);
-    AppendByte(addressOfDoubleAsByteArray[7]);
-}                       
+}
 
 void BufferWriter::AppendVec2(Vec2 const& vec2)
 {
@@ -166,20 +187,13 @@ void BufferWriter::AppendAABB2(AABB2 const& box)
 
 void BufferWriter::AppendStringZeroTerminated(const std::string& str)
 {
-    for (char c : str)
-    {
-        AppendChar(c);
-    }
-    AppendByte(0);
+    AppendWords(str.c_str(), str.length() + 1, 1);
 }
 
 void BufferWriter::AppendStringLengthPreceded(const std::string& str)
 {
     AppendUInt(static_cast<unsigned int>(str.length()));
-    for (char c : str)
-    {
-        AppendChar(c);
-    }
+    AppendWords(str.data(), str.length(), 1);
 }
 
 void BufferWriter::UpdateUInt32AtPosition(size_t position, unsigned int value)
@@ -228,3 +242,18 @@ uint32_t BufferWriter::GetCurrentWritePosUInt() const
 {
     return (uint32_t)m_buffer.size(); 
 }
+
+void BufferWriter::AppendWords(void const* words, size_t numWords, size_t bytesPerWord)
+{
+    // Grow once and copy the whole run, swapping on the way if the buffer's endianness differs
+    unsigned char const* wordBytes = static_cast<unsigned char const*>(words);
+    size_t numBytes = numWords * bytesPerWord;
+    if (!m_isOppositeEndiannessFromNative || bytesPerWord == 1 || numBytes == 0)
+    {
+        m_buffer.insert(m_buffer.end(), wordBytes, wordBytes + numBytes);
+        return;
+    }
+    size_t writePosition = m_buffer.size();
+    m_buffer.resize(writePosition + numBytes);
+    CopyWithReversedBytes(&m_buffer[writePosition], words, numWords, bytesPerWord);
+}
@@ -6,6 +6,9 @@
 #include "Engine/Math/Vec2.hpp"
 #include "Engine/Math/Plane2.hpp"
 #include "Engine/Math/AABB2.hpp"
+#include "Engine/Math/Vec3.hpp"
+struct Vertex_PCU;
+
 class BufferWriter
 {
 public:
@@ -22,6 +25,26 @@ public:
     void AppendFloat(float f);
     void AppendDouble(double d);
 
+    // Bulk versions: the buffer grows once and the array is copied in one go, with SIMD byte swapping if needed
+    void AppendArray(unsigned char const* elements, size_t count);
+    void AppendArray(char const* elements, size_t count);
+    void AppendArray(unsigned short const* elements, size_t count);
+    void AppendArray(short const* elements, size_t count);
+    void AppendArray(unsigned int const* elements, size_t count);
+    void AppendArray(int const* elements, size_t count);
+    void AppendArray(uint64_t const* elements, size_t count);
+    void AppendArray(int64_t const* elements, size_t count);
+    void AppendArray(float const* elements, size_t count);
+    void AppendArray(double const* elements, size_t count);
+    void AppendArray(Vec2 const* elements, size_t count);
+    void AppendArray(Vec3 const* elements, size_t count);
+    void AppendArray(Vertex_PCU const* elements, size_t count);
+
+    // Variable-length encodings: LEB128 (7 bits per byte, high bit set while more bytes follow), zigzag for signed
+    void AppendVarUInt(uint64_t value);
+    void AppendVarInt(int64_t value);
+    void AppendDeltaVarIntArray(int const* values, size_t count); // each value as a zigzag varint of its difference from the one before
+
     void AppendVec2(Vec2 const& vec2);
     void AppendPlane2(Plane2 const& plane2);
     void AppendAABB2(AABB2 const& box);
@@ -35,6 +58,9 @@ public:
 
     size_t GetCurrentWritePosition() const;
     uint32_t GetCurrentWritePosUInt() const;
+private:
+    void AppendWords(void const* words, size_t numWords, size_t bytesPerWord);
+
 private:
     std::vector<unsigned char>& m_buffer; 
     BufferEndianMode m_mode;
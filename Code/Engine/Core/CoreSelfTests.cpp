@@ -0,0 +1,443 @@
+#include "CoreSelfTests.hpp"
+#include "Engine/Core/VertexUtils.hpp"
+#include "Engine/Core/JobSystem.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/SelfTestUtils.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Math/RandomNumberGenerator.hpp"
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+constexpr int SELF_TEST_NUM_PACKED_VERTEXES = 100000;
+constexpr int SELF_TEST_NUM_DAG_JOBS = 10000;
+constexpr int SELF_TEST_JOBS_PER_POOL_CYCLE = 256;
+
+// SelfTestJobPoolAllocations counts heap allocations through the global operator new below. Only threads that ran one
+// of its jobs (or the test itself) count, and only while it is measuring, so the rest of the game never does more than
+// read a thread_local and go on to malloc.
+static thread_local bool s_isAllocationCountingThread = false;
+static std::atomic<bool> s_isCountingAllocations = false;
+static std::atomic<int> s_numCountedAllocations = 0;
+
+void* operator new(size_t size)
+{
+	if (s_isAllocationCountingThread && s_isCountingAllocations.load(std::memory_order_relaxed))
+	{
+		s_numCountedAllocations.fetch_add(1, std::memory_order_relaxed);
+	}
+	void* memory = malloc(size > 0 ? size : 1);
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+// In double precision, since acos of a float dot product cannot resolve a few thousandths of a degree
+static double GetAngleDegreesBetween(Vec3 const& a, Vec3 const& b)
+{
+	double crossX = (double)a.y * b.z - (double)a.z * b.y;
+	double crossY = (double)a.z * b.x - (double)a.x * b.z;
+	double crossZ = (double)a.x * b.y - (double)a.y * b.x;
+	double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+	return atan2(sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ), dot) * (180.0 / 3.14159265358979323846);
+}
+
+// An orthonormal basis of random handedness. A share of the normals lie in an axis plane or along an axis, which land
+// on the edges and corners of the octahedral map.
+static Vertex_PCUTBN RollTangentSpaceVertex(RandomNumberGenerator& rng, Vec3 const& positionMins, Vec3 const& positionMaxs)
+{
+	Vertex_PCUTBN vert;
+	vert.m_position = rng.RollRandomVector3DInRange(positionMins, positionMaxs);
+	vert.m_uvTexCoords = Vec2(rng.RollRandomFloatInRange(-16.f, 16.f), rng.RollRandomFloatInRange(-16.f, 16.f));
+	vert.m_normal = RollSelfTestDirection3D(rng, true);
+	Vec3 side;
+	do
+	{
+		side = CrossProduct3D(vert.m_normal, RollSelfTestDirection3D(rng, true));
+	} while (side.GetLengthSquared() < 0.01f);
+	vert.m_tangent = side.GetNormalized();
+	vert.m_bitangent = CrossProduct3D(vert.m_normal, vert.m_tangent);
+	if (rng.RollRandomIntLessThan(2) == 0)
+	{
+		vert.m_bitangent = -vert.m_bitangent;
+	}
+	return vert;
+}
+
+static void CheckUnpackedVertex(int& numMismatches, char const* format, int vertIndex, Vertex_PCUTBN const& vert, Vertex_PCUTBN const& unpackedVert)
+{
+	double normalError = GetAngleDegreesBetween(unpackedVert.m_normal, vert.m_normal);
+	if (normalError > (double)MAX_PACKED_DIRECTION_ERROR_DEGREES)
+	{
+		ReportSelfTestMismatch(numMismatches, Stringf("%s normal error (degrees)", format).c_str(), vertIndex, (float)normalError, MAX_PACKED_DIRECTION_ERROR_DEGREES);
+	}
+	double tangentError = GetAngleDegreesBetween(unpackedVert.m_tangent, vert.m_tangent);
+	if (tangentError > (double)MAX_PACKED_DIRECTION_ERROR_DEGREES)
+	{
+		ReportSelfTestMismatch(numMismatches, Stringf("%s tangent error (degrees)", format).c_str(), vertIndex, (float)tangentError, MAX_PACKED_DIRECTION_ERROR_DEGREES);
+	}
+	if (DotProduct3D(unpackedVert.m_bitangent, vert.m_bitangent) <= 0.f)
+	{
+		ReportSelfTestMismatch(numMismatches, Stringf("%s bitangent sign", format).c_str(), vertIndex, DotProduct3D(unpackedVert.m_bitangent, vert.m_bitangent), 1.f);
+	}
+
+	// Below 2^-14 half floats go denormal, with a fixed step of 2^-24
+	float const uvs[2] = { vert.m_uvTexCoords.x, vert.m_uvTexCoords.y };
+	float const unpackedUVs[2] = { unpackedVert.m_uvTexCoords.x, unpackedVert.m_uvTexCoords.y };
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		float maxError = MaxFloat(fabsf(uvs[axis]) / 2048.f, 1.f / 33554432.f);
+		if (fabsf(unpackedUVs[axis] - uvs[axis]) > maxError)
+		{
+			ReportSelfTestMismatch(numMismatches, Stringf("%s UV error", format).c_str(), vertIndex, fabsf(unpackedUVs[axis] - uvs[axis]), maxError);
+		}
+	}
+}
+
+bool SelfTestVertexPacking(unsigned int seed)
+{
+	RandomNumberGenerator rng(seed);
+	int numMismatches = 0;
+
+	// The last trial's bounds are flat in z, which must come back exactly
+	for (int trial = 0; trial < 3; ++trial)
+	{
+		float halfSize = trial == 0 ? 1.f : 1000.f;
+		Vec3 positionMins(rng.RollRandomFloatInRange(-halfSize, 0.f), rng.RollRandomFloatInRange(-halfSize, 0.f), rng.RollRandomFloatInRange(-halfSize, 0.f));
+		Vec3 positionMaxs(rng.RollRandomFloatInRange(0.f, halfSize), rng.RollRandomFloatInRange(0.f, halfSize), rng.RollRandomFloatInRange(0.f, halfSize));
+		if (trial == 2)
+		{
+			positionMaxs.z = positionMins.z;
+		}
+		std::vector<Vertex_PCUTBN> verts;
+		verts.reserve(SELF_TEST_NUM_PACKED_VERTEXES);
+		for (int vertIndex = 0; vertIndex < SELF_TEST_NUM_PACKED_VERTEXES; ++vertIndex)
+		{
+			verts.push_back(RollTangentSpaceVertex(rng, positionMins, positionMaxs));
+		}
+
+		AABB3 bounds = GetVertexBounds3D(verts);
+		Vec3 dimensions = bounds.m_maxs - bounds.m_mins;
+		float const maxPositionErrors[3] = { dimensions.x / 131070.f, dimensions.y / 131070.f, dimensions.z / 131070.f };
+		float const maxPositionRounding = 4.f * FLT_EPSILON * MaxFloat(bounds.m_mins.GetLength(), bounds.m_maxs.GetLength());
+		for (int vertIndex = 0; vertIndex < (int)verts.size(); ++vertIndex)
+		{
+			Vertex_PCUTBN const& vert = verts[vertIndex];
+			Vertex_PCUTBN unpackedVert = UnpackVertex(PackVertex(vert));
+			if (unpackedVert.m_position != vert.m_position || unpackedVert.m_color != vert.m_color)
+			{
+				ReportSelfTestMismatch(numMismatches, "packed position or color changed", vertIndex, unpackedVert.m_position.x, vert.m_position.x);
+			}
+			CheckUnpackedVertex(numMismatches, "packed", vertIndex, vert, unpackedVert);
+
+			Vertex_PCUTBN dequantizedVert = DequantizeVertex(QuantizeVertex(vert, bounds), bounds);
+			float const positions[3] = { vert.m_position.x, vert.m_position.y, vert.m_position.z };
+			float const dequantizedPositions[3] = { dequantizedVert.m_position.x, dequantizedVert.m_position.y, dequantizedVert.m_position.z };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float positionError = fabsf(dequantizedPositions[axis] - positions[axis]);
+				if (positionError > maxPositionErrors[axis] + maxPositionRounding)
+				{
+					ReportSelfTestMismatch(numMismatches, "quantized position error", vertIndex, positionError, maxPositionErrors[axis] + maxPositionRounding);
+				}
+			}
+			CheckUnpackedVertex(numMismatches, "quantized", vertIndex, vert, dequantizedVert);
+		}
+	}
+
+	// Zero length directions come back as unit vectors rather than garbage
+	Vertex_PCUTBN zeroVert;
+	zeroVert.m_normal = Vec3();
+	zeroVert.m_tangent = Vec3();
+	Vertex_PCUTBN unpackedZeroVert = UnpackVertex(PackVertex(zeroVert));
+	if (fabsf(unpackedZeroVert.m_normal.GetLength() - 1.f) > 0.001f || fabsf(unpackedZeroVert.m_tangent.GetLength() - 1.f) > 0.001f)
+	{
+		ReportSelfTestMismatch(numMismatches, "zero normal unpacked length", 0, unpackedZeroVert.m_normal.GetLength(), 1.f);
+	}
+
+	if (numMismatches > 0)
+	{
+		DebuggerPrintf("SelfTestVertexPacking (seed %u): %d mismatches\n", seed, numMismatches);
+	}
+	return numMismatches == 0;
+}
+
+// Stamps when it started and when it finished from one counter, so a dependent that started before its prerequisite's
+// Execute() returned shows up afterwards as a start stamp below the prerequisite's finish stamp
+class SelfTestDAGJob : public Job
+{
+public:
+	virtual void Execute() override
+	{
+		m_startStamp = m_nextStamp->fetch_add(1, std::memory_order_relaxed);
+		// A little work, so jobs overlap and get stolen
+		unsigned int hash = (unsigned int)m_startStamp;
+		for (int round = 0; round < 64; ++round)
+		{
+			hash = hash * 1664525u + 1013904223u;
+		}
+		m_hash = hash;
+		m_finishStamp = m_nextStamp->fetch_add(1, std::memory_order_relaxed);
+	}
+public:
+	std::atomic<int>* m_nextStamp = nullptr;
+	int m_startStamp = -1;
+	int m_finishStamp = -1;
+	unsigned int m_hash = 0;
+};
+
+// Random prerequisites among the earlier jobs, mostly recent ones, a few from anywhere, plus every 250th job a hub that
+// dozens of later jobs wait on, well past the inline dependent slots. Repeats are allowed, as AddDependency allows them.
+static void MakeRandomJobDAG(RandomNumberGenerator& rng, int numJobs, std::vector<int>& out_firstPrerequisites, std::vector<int>& out_prerequisites)
+{
+	out_firstPrerequisites.assign(1, 0);
+	out_prerequisites.clear();
+	int hubIndex = -1;
+	for (int jobIndex = 0; jobIndex < numJobs; ++jobIndex)
+	{
+		int numPrerequisites = jobIndex > 0 ? rng.RollRandomIntInRange(0, 4) : 0;
+		for (int prerequisiteNumber = 0; prerequisiteNumber < numPrerequisites; ++prerequisiteNumber)
+		{
+			if (rng.RollRandomIntLessThan(4) == 0)
+			{
+				out_prerequisites.push_back(rng.RollRandomIntLessThan(jobIndex));
+			}
+			else
+			{
+				int numRecentJobs = jobIndex < 64 ? jobIndex : 64;
+				out_prerequisites.push_back(jobIndex - 1 - rng.RollRandomIntLessThan(numRecentJobs));
+			}
+		}
+		if (hubIndex >= 0 && rng.RollRandomIntLessThan(4) == 0)
+		{
+			out_prerequisites.push_back(hubIndex);
+		}
+		if (jobIndex % 250 == 0)
+		{
+			hubIndex = jobIndex;
+		}
+		out_firstPrerequisites.push_back((int)out_prerequisites.size());
+	}
+}
+
+bool SelfTestJobDAG(unsigned int seed)
+{
+	RandomNumberGenerator rng(seed);
+	int numMismatches = 0;
+	std::vector<int> firstPrerequisites;
+	std::vector<int> prerequisites;
+	MakeRandomJobDAG(rng, SELF_TEST_NUM_DAG_JOBS, firstPrerequisites, prerequisites);
+	std::vector<int> queueOrder(SELF_TEST_NUM_DAG_JOBS);
+	for (int jobIndex = 0; jobIndex < SELF_TEST_NUM_DAG_JOBS; ++jobIndex)
+	{
+		queueOrder[jobIndex] = jobIndex;
+	}
+
+	int const workerCounts[] = { 1, 4 };
+	for (int numWorkers : workerCounts)
+	{
+		// Declared before the job system, so they outlive anything it still holds on to
+		std::vector<SelfTestDAGJob> jobs(SELF_TEST_NUM_DAG_JOBS);
+		std::atomic<int> nextStamp = 0;
+		JobConfig jobConfig;
+		jobConfig.m_numWorkers = numWorkers;
+		jobConfig.m_numIOWorkers = 0;
+		JobSystem jobSystem(jobConfig);
+		jobSystem.Startup();
+
+		for (int jobIndex = 0; jobIndex < SELF_TEST_NUM_DAG_JOBS; ++jobIndex)
+		{
+			SelfTestDAGJob& job = jobs[jobIndex];
+			job.m_nextStamp = &nextStamp;
+			job.m_priority = (JobPriority)rng.RollRandomIntLessThan(NUM_COMPUTE_JOB_PRIORITIES);
+			for (int prerequisiteIndex = firstPrerequisites[jobIndex]; prerequisiteIndex < firstPrerequisites[jobIndex + 1]; ++prerequisiteIndex)
+			{
+				jobSystem.AddDependency(&job, &jobs[prerequisites[prerequisiteIndex]]);
+			}
+		}
+
+		// Queued in a random order, so jobs are often queued before their prerequisites and sometimes after they ran.
+		// Half go from this thread; the other half from a thread with no queues of its own, which then waits for them.
+		for (int orderIndex = SELF_TEST_NUM_DAG_JOBS - 1; orderIndex > 0; --orderIndex)
+		{
+			std::swap(queueOrder[orderIndex], queueOrder[rng.RollRandomIntLessThan(orderIndex + 1)]);
+		}
+		int numHelperQueuedJobs = SELF_TEST_NUM_DAG_JOBS / 2;
+		int numHelperUnfinishedJobs = 0;
+		std::thread helperThread([&]()
+			{
+				for (int orderIndex = 0; orderIndex < numHelperQueuedJobs; ++orderIndex)
+				{
+					jobSystem.QueueJob(&jobs[queueOrder[orderIndex]]);
+				}
+				for (int orderIndex = 0; orderIndex < numHelperQueuedJobs; ++orderIndex)
+				{
+					SelfTestDAGJob& job = jobs[queueOrder[orderIndex]];
+					jobSystem.WaitFor(&job);
+					if (!job.IsFinished() || job.m_finishStamp < 0)
+					{
+						++numHelperUnfinishedJobs;
+					}
+				}
+			});
+		for (int orderIndex = numHelperQueuedJobs; orderIndex < SELF_TEST_NUM_DAG_JOBS; ++orderIndex)
+		{
+			jobSystem.QueueJob(&jobs[queueOrder[orderIndex]]);
+		}
+		for (int orderIndex = SELF_TEST_NUM_DAG_JOBS - 1; orderIndex >= 0; --orderIndex)
+		{
+			jobSystem.WaitFor(&jobs[queueOrder[orderIndex]]);
+		}
+		helperThread.join();
+		// Only once the workers have stopped has every finished job also been pushed onto the completed list
+		jobSystem.Shutdown();
+		jobSystem.RetrieveAllCompletedJobs();
+
+		if (numHelperUnfinishedJobs > 0)
+		{
+			ReportSelfTestMismatch(numMismatches, "jobs unfinished after WaitFor on a non-worker thread", numWorkers, (float)numHelperUnfinishedJobs, 0.f);
+		}
+		for (int jobIndex = 0; jobIndex < SELF_TEST_NUM_DAG_JOBS; ++jobIndex)
+		{
+			SelfTestDAGJob const& job = jobs[jobIndex];
+			if (job.m_startStamp < 0 || job.m_finishStamp < 0)
+			{
+				ReportSelfTestMismatch(numMismatches, "job never ran (start stamp)", jobIndex, (float)job.m_startStamp, 0.f);
+				continue;
+			}
+			for (int prerequisiteIndex = firstPrerequisites[jobIndex]; prerequisiteIndex < firstPrerequisites[jobIndex + 1]; ++prerequisiteIndex)
+			{
+				SelfTestDAGJob const& prerequisite = jobs[prerequisites[prerequisiteIndex]];
+				if (prerequisite.m_finishStamp < 0 || prerequisite.m_finishStamp >= job.m_startStamp)
+				{
+					ReportSelfTestMismatch(numMismatches, "job started before its prerequisite finished (start vs prerequisite finish stamp)", jobIndex, (float)job.m_startStamp, (float)prerequisite.m_finishStamp);
+				}
+			}
+		}
+	}
+
+	if (numMismatches > 0)
+	{
+		DebuggerPrintf("SelfTestJobDAG (seed %u): %d mismatches\n", seed, numMismatches);
+	}
+	return numMismatches == 0;
+}
+
+class SelfTestPoolJob : public Job
+{
+public:
+	explicit SelfTestPoolJob(int input) : m_input(input) {}
+	virtual void Execute() override
+	{
+		s_isAllocationCountingThread = true;
+		m_output = m_input * 2 + 1;
+	}
+public:
+	int m_input = 0;
+	int m_output = 0;
+};
+
+// One frame's worth of pooled jobs: each depends on the one at half its index (two dependents apiece, inside the inline
+// slots), all are waited for and retrieved, and BeginFrame() hands them back to the pool
+static bool RunJobPoolCycle(JobSystem& jobSystem, SelfTestPoolJob** jobs)
+{
+	bool didAllRun = true;
+	for (int jobIndex = 0; jobIndex < SELF_TEST_JOBS_PER_POOL_CYCLE; ++jobIndex)
+	{
+		jobs[jobIndex] = jobSystem.CreateJob<SelfTestPoolJob>(jobIndex);
+		if (jobIndex > 0)
+		{
+			jobSystem.AddDependency(jobs[jobIndex], jobs[jobIndex / 2]);
+		}
+	}
+	for (int jobIndex = 0; jobIndex < SELF_TEST_JOBS_PER_POOL_CYCLE; ++jobIndex)
+	{
+		jobSystem.QueueJob(jobs[jobIndex]);
+	}
+	for (int jobIndex = 0; jobIndex < SELF_TEST_JOBS_PER_POOL_CYCLE; ++jobIndex)
+	{
+		jobSystem.WaitFor(jobs[jobIndex]);
+		jobSystem.RetrieveJob(jobs[jobIndex]);
+		didAllRun = didAllRun && jobs[jobIndex]->m_output == jobIndex * 2 + 1;
+	}
+	jobSystem.BeginFrame();
+	return didAllRun;
+}
+
+bool SelfTestJobPoolAllocations(unsigned int seed)
+{
+	RandomNumberGenerator rng(seed);
+	int numMismatches = 0;
+	JobConfig jobConfig;
+	jobConfig.m_numWorkers = rng.RollRandomIntInRange(1, 4);
+	jobConfig.m_numIOWorkers = 0;
+	JobSystem jobSystem(jobConfig);
+	jobSystem.Startup();
+	SelfTestPoolJob* jobs[SELF_TEST_JOBS_PER_POOL_CYCLE] = {};
+
+	// Warming up grows the pool, the work-stealing queues and each thread's dependent job list to what a cycle needs
+	s_isAllocationCountingThread = true;
+	for (int cycle = 0; cycle < 16; ++cycle)
+	{
+		RunJobPoolCycle(jobSystem, jobs);
+	}
+
+	s_numCountedAllocations.store(0);
+	s_isCountingAllocations.store(true);
+	int numCyclesWithMissingJobs = 0;
+	for (int cycle = 0; cycle < 200; ++cycle)
+	{
+		if (!RunJobPoolCycle(jobSystem, jobs))
+		{
+			++numCyclesWithMissingJobs;
+		}
+	}
+	s_isCountingAllocations.store(false);
+	s_isAllocationCountingThread = false;
+	int numAllocations = s_numCountedAllocations.load();
+	int numPooledJobsInUse = jobSystem.GetNumPooledJobsInUse();
+	jobSystem.Shutdown();
+
+	if (numAllocations != 0)
+	{
+		ReportSelfTestMismatch(numMismatches, "heap allocations over 200 steady state job cycles", jobConfig.m_numWorkers, (float)numAllocations, 0.f);
+	}
+	if (numCyclesWithMissingJobs != 0)
+	{
+		ReportSelfTestMismatch(numMismatches, "job cycles with wrong outputs", jobConfig.m_numWorkers, (float)numCyclesWithMissingJobs, 0.f);
+	}
+	if (numPooledJobsInUse != 0)
+	{
+		ReportSelfTestMismatch(numMismatches, "pooled jobs still in use after BeginFrame", jobConfig.m_numWorkers, (float)numPooledJobsInUse, 0.f);
+	}
+	if (numMismatches > 0)
+	{
+		DebuggerPrintf("SelfTestJobPoolAllocations (seed %u): %d mismatches\n", seed, numMismatches);
+	}
+	return numMismatches == 0;
+}
+
+bool Command_CoreSelfTest(EventArgs& args)
+{
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1);
+	ReportSelfTestResult("SelfTestVertexPacking", SelfTestVertexPacking(seed));
+	ReportSelfTestResult("SelfTestJobDAG", SelfTestJobDAG(seed));
+	ReportSelfTestResult("SelfTestJobPoolAllocations", SelfTestJobPoolAllocations(seed));
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "Engine/Core/EventSystem.hpp"
+
+// Checks of the core utilities against what they promise, over random cases generated from seed. Each returns true
+// when everything held and reports what failed with DebuggerPrintf.
+
+// PackVertex and QuantizeVertex round trips over random vertexes: normals and tangents within
+// MAX_PACKED_DIRECTION_ERROR_DEGREES, UVs and quantized positions within the bounds VertexUtils.hpp states, and the
+// bitangent sign kept
+bool SelfTestVertexPacking(unsigned int seed = 1);
+
+// A random 10,000 job DAG built with AddDependency, including hubs with dozens of dependents, queued in a random order
+// from this thread and from a thread that is neither a worker nor the main thread, which then WaitFors its half. Every
+// job must run once and only after all of its prerequisites' Execute() returned. Runs on its own 1 and 4 worker systems.
+bool SelfTestJobDAG(unsigned int seed = 1);
+
+// Pooled jobs created, queued with dependencies, waited for and retrieved frame after frame on its own job system: once
+// warmed up, 200 such frames must not allocate from the heap at all, counted by a global operator new on the threads
+// involved
+bool SelfTestJobPoolAllocations(unsigned int seed = 1);
+
+// "CoreSelfTest seed=N" in the dev console runs all of the above
+bool Command_CoreSelfTest(EventArgs& args);
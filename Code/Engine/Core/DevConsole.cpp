@@ -10,6 +10,9 @@
 #include "Engine/Input/InputSystem.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/CoreSelfTests.hpp"
+#include "Engine/Math/MathSelfTests.hpp"
+#include "Engine/Render/MeshSelfTests.hpp"
 Rgba8 const DevConsole::INFO_ERROR   = Rgba8::RED;
 Rgba8 const DevConsole::INFO_WARNING = Rgba8::YELLOW;
 Rgba8 const DevConsole::INFO_MAJOR   = Rgba8::GREEN;
@@ -48,6 +51,10 @@ void DevConsole::Startup()
 	g_theEventSystem->SubscribeEventCallbackFunction("MouseScroll",DevConsole::Event_MouseScroll);
 	g_theEventSystem->SubscribeEventCallbackFunction("Help",       DevConsole::Command_Help);
 	g_theEventSystem->SubscribeEventCallbackFunction("Clear",      DevConsole::Command_Clear);
+	g_theEventSystem->SubscribeEventCallbackFunction("CoreSelfTest", Command_CoreSelfTest);
+	g_theEventSystem->SubscribeEventCallbackFunction("MathSelfTest", Command_MathSelfTest);
+	g_theEventSystem->SubscribeEventCallbackFunction("Mat44Benchmark", Command_Mat44Benchmark);
+	g_theEventSystem->SubscribeEventCallbackFunction("MeshSelfTest", Command_MeshSelfTest);
 
 	m_insertionPointBlinkTimer = new Timer(0.5f);
 }
@@ -1,4 +1,5 @@
 #include "Engine/Core/EngineCommon.hpp"
 NamedStrings g_gameConfigBlackboard;
 EventSystem* g_theEventSystem = nullptr;
+JobSystem* g_theJobSystem = nullptr;
 UISystem* g_uiSystem = nullptr;
\ No newline at end of file
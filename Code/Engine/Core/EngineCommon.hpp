@@ -10,9 +10,11 @@
 #include "Engine/UI/UISystem.hpp"
 class InputSystem;
 class DevConsole;
+class JobSystem;
 extern UISystem* g_uiSystem;
 extern NamedStrings g_gameConfigBlackboard;
 extern DevConsole* g_theConsole;
 extern EventSystem* g_theEventSystem;
 extern InputSystem* g_theInput;
+extern JobSystem* g_theJobSystem; // optional; bulk vertex utilities run in parallel when the game sets this
 
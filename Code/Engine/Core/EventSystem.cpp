@@ -1,9 +1,40 @@
 #include "EventSystem.hpp"
 #include "Engine/Core/EngineCommon.hpp"
 #include "Engine/Core/DevConsole.hpp"
+#include <algorithm>
+
+static std::atomic<unsigned int> s_nextEventSystemID = 1;
+static thread_local unsigned int s_queuedEventBufferOwnerID = 0;
+static thread_local QueuedEventBuffer* s_queuedEventBuffer = nullptr;
+
+QueuedEventBuffer::QueuedEventBuffer(std::thread::id ownerThreadId, int capacity)
+	:m_ownerThreadId(ownerThreadId)
+	,m_events(capacity > 0 ? capacity : 1)
+{
+}
+
+bool QueuedEventBuffer::Push(EventID eventID, EventArgs const& args)
+{
+	// Only the owning thread writes m_tail and the counters, so plain loads and stores are enough for them
+	int64_t tail = m_tail.load(std::memory_order_relaxed);
+	int64_t head = m_head.load(std::memory_order_acquire);
+	if (tail - head >= (int64_t)m_events.size())
+	{
+		m_numDroppedEvents.store(m_numDroppedEvents.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return false;
+	}
+	QueuedEvent& queuedEvent = m_events[tail % (int64_t)m_events.size()];
+	queuedEvent.m_eventID = eventID;
+	queuedEvent.m_args = args;
+	m_tail.store(tail + 1, std::memory_order_release);
+	m_numQueuedEvents.store(m_numQueuedEvents.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	return true;
+}
+
 EventSystem::EventSystem(EventSystemConfig const& config)
+	:m_config(config)
 {
-	UNUSED(config);
+	m_eventSystemID = s_nextEventSystemID.fetch_add(1);
 }
 
 EventSystem::~EventSystem()
@@ -15,6 +46,14 @@ EventSystem::~EventSystem()
             delete subscription;
         }
     }
+	delete m_subscriberTable.load();
+	m_subscriberTable = nullptr;
+	ReclaimRetiredSubscribers();
+	for (size_t i = 0; i < m_queuedEventBuffers.size(); ++i)
+	{
+		delete m_queuedEventBuffers[i];
+	}
+	m_queuedEventBuffers.clear();
 }
 
 
@@ -32,24 +71,24 @@ void EventSystem::BeginFrame()
 
 void EventSystem::EndFrame()
 {
+	FlushQueuedEvents();
+	m_eventSystemMutex.lock();
+	ReclaimRetiredSubscribers();
+	m_eventSystemMutex.unlock();
 }
 
 
 void EventSystem::SubscribeEventCallbackFunction(std::string const& eventName, EventCallbackFunction functionPtr)
 {
-// 	auto found = m_subscriptionListByName.find(eventName);
-// 	if (found == m_subscriptionListByName.end())
-// 	{
 	m_eventSystemMutex.lock();
-	m_registeredCommands.push_back(eventName);
-	//}
-	EventSubscriptionFunction* newFunction = new EventSubscriptionFunction(functionPtr);
-	m_subscriptionListByName[eventName].push_back(newFunction);
+	AddSubscription(eventName, new EventSubscriptionFunction(functionPtr));
+	PublishSubscriberTable();
 	m_eventSystemMutex.unlock();
 }
 
 void EventSystem::UnsubscribeEventCallbackFunction(std::string const& eventName, EventCallbackFunction functionPtr)
 {
+	m_eventSystemMutex.lock();
 	auto found = m_subscriptionListByName.find(eventName);
 	if (found != m_subscriptionListByName.end())
 	{
@@ -58,92 +97,281 @@ void EventSystem::UnsubscribeEventCallbackFunction(std::string const& eventName,
 		for (auto it = subscribersForThisEventName.begin(); it != subscribersForThisEventName.end(); ++it)
 		{
 			EventSubscriptionFunction* subscribeFuntion = dynamic_cast<EventSubscriptionFunction*>(*it);
-			if (subscribeFuntion == new EventSubscriptionFunction(functionPtr))
-			{  
-				m_eventSystemMutex.lock();
+			if (subscribeFuntion && subscribeFuntion->m_functionPtr == functionPtr)
+			{
+				RetireSubscription(subscribeFuntion);
 				subscribersForThisEventName.erase(it);
-				m_eventSystemMutex.unlock();
+				PublishSubscriberTable();
 				break; 
 			}
 		}
 	}
+	m_eventSystemMutex.unlock();
 }
 
 void EventSystem::FireEvent(std::string const& eventName, EventArgs& args)
 {
-	//m_eventSystemMutex.lock();
-	auto found = m_subscriptionListByName.find(eventName);
-	if (found != m_subscriptionListByName.end())
+	FireEvent(MakeEventID(eventName.c_str()), args);
+}
+
+void EventSystem::FireEvent(std::string const& eventName)
+{
+	EventArgs args;
+	FireEvent(MakeEventID(eventName.c_str()), args);
+}
+
+void EventSystem::FireEvent(EventID eventID, EventArgs& args)
+{
+	// Announce the fire before loading the table, so a table retired after this point outlives it
+	m_numFiresInFlight.fetch_add(1);
+	EventSubscriberTable const* subscriberTable = m_subscriberTable.load();
+	EventSubscriberTable::Slot const* slot = subscriberTable ? subscriberTable->FindSlot(eventID) : nullptr;
+	if (slot)
 	{
-		SubscriptionList const& subscriberForThisEventName = found->second;
-		
-		for (int i = 0; i < (int)subscriberForThisEventName.size(); ++i)
+		for (int i = 0; i < slot->m_numSubscribers; ++i)
 		{
-			
-			EventSubscriptionBase* subscriber = subscriberForThisEventName[i];
-			
+			EventSubscriptionBase* subscriber = subscriberTable->m_subscribers[slot->m_firstSubscriberIndex + i];
 			if (subscriber->Fire(args))
 			{
-				return;
+				break;
 			}
 		}
 	}
+	m_numFiresInFlight.fetch_sub(1);
+}
 
-	found = m_subscriptionListByName.find(AllLowerCase(eventName));
-	if (found != m_subscriptionListByName.end())
+void EventSystem::FireEvent(EventID eventID)
+{
+	EventArgs args;
+	FireEvent(eventID, args);
+}
+
+void EventSystem::QueueEvent(std::string const& eventName, EventArgs const& args)
+{
+	QueueEvent(MakeEventID(eventName.c_str()), args);
+}
+
+void EventSystem::QueueEvent(EventID eventID, EventArgs const& args)
+{
+	GetQueuedEventBufferForCurrentThread()->Push(eventID, args);
+}
+
+void EventSystem::FlushQueuedEvents()
+{
+	// A subscriber (or a console command one runs) that flushes would otherwise block on m_flushMutex forever, and the
+	// events in flight are only handed back once the outer flush is done, so there is nothing for it to flush anyway
+	if (m_flushingThreadId.load(std::memory_order_relaxed) == std::this_thread::get_id())
 	{
-		SubscriptionList const& subscriberForThisEventName = found->second;
+		return;
+	}
+	m_flushMutex.lock();
+	m_flushingThreadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+	m_eventSystemMutex.lock();
+	m_buffersToFlush = m_queuedEventBuffers;
+	m_eventSystemMutex.unlock();
 
-		for (int i = 0; i < (int)subscriberForThisEventName.size(); ++i)
+	// Only events queued before this point are flushed, anything a subscriber queues waits for the next flush
+	m_flushEndIndexes.clear();
+	m_eventsToFlush.clear();
+	for (int bufferIndex = 0; bufferIndex < (int)m_buffersToFlush.size(); ++bufferIndex)
+	{
+		QueuedEventBuffer* buffer = m_buffersToFlush[bufferIndex];
+		int64_t head = buffer->m_head.load(std::memory_order_relaxed);
+		int64_t tail = buffer->m_tail.load(std::memory_order_acquire);
+		m_flushEndIndexes.push_back(tail);
+		for (int64_t eventIndex = head; eventIndex < tail; ++eventIndex)
+		{
+			EventID eventID = buffer->m_events[eventIndex % (int64_t)buffer->m_events.size()].m_eventID;
+			m_eventsToFlush.push_back(QueuedEventRef{ eventID, bufferIndex, eventIndex });
+		}
+	}
+	std::sort(m_eventsToFlush.begin(), m_eventsToFlush.end(), [](QueuedEventRef const& a, QueuedEventRef const& b)
 		{
+			if (a.m_eventID != b.m_eventID)
+			{
+				return a.m_eventID < b.m_eventID;
+			}
+			if (a.m_bufferIndex != b.m_bufferIndex)
+			{
+				return a.m_bufferIndex < b.m_bufferIndex;
+			}
+			return a.m_eventIndex < b.m_eventIndex;
+		});
 
-			EventSubscriptionBase* subscriber = subscriberForThisEventName[i];
+	m_numFiresInFlight.fetch_add(1);
+	EventSubscriberTable const* subscriberTable = m_subscriberTable.load();
+	size_t groupBegin = 0;
+	while (groupBegin < m_eventsToFlush.size())
+	{
+		EventID eventID = m_eventsToFlush[groupBegin].m_eventID;
+		size_t groupEnd = groupBegin + 1;
+		while (groupEnd < m_eventsToFlush.size() && m_eventsToFlush[groupEnd].m_eventID == eventID)
+		{
+			++groupEnd;
+		}
 
-			if (subscriber->Fire(args))
+		EventSubscriberTable::Slot const* slot = subscriberTable ? subscriberTable->FindSlot(eventID) : nullptr;
+		for (size_t refIndex = groupBegin; slot && refIndex < groupEnd; ++refIndex)
+		{
+			QueuedEventRef const& eventRef = m_eventsToFlush[refIndex];
+			QueuedEventBuffer* buffer = m_buffersToFlush[eventRef.m_bufferIndex];
+			EventArgs& args = buffer->m_events[eventRef.m_eventIndex % (int64_t)buffer->m_events.size()].m_args;
+			for (int i = 0; i < slot->m_numSubscribers; ++i)
 			{
-				return;
+				if (subscriberTable->m_subscribers[slot->m_firstSubscriberIndex + i]->Fire(args))
+				{
+					break;
+				}
 			}
 		}
+		groupBegin = groupEnd;
+	}
+	m_numFiresInFlight.fetch_sub(1);
+
+	// Hand the slots back to their owners only after their args are no longer referenced
+	for (int bufferIndex = 0; bufferIndex < (int)m_buffersToFlush.size(); ++bufferIndex)
+	{
+		m_buffersToFlush[bufferIndex]->m_head.store(m_flushEndIndexes[bufferIndex], std::memory_order_release);
 	}
-	//m_eventSystemMutex.unlock();
+	m_numFlushedEvents.fetch_add((int64_t)m_eventsToFlush.size(), std::memory_order_relaxed);
+	m_flushingThreadId.store(std::thread::id(), std::memory_order_relaxed);
+	m_flushMutex.unlock();
 }
 
-void EventSystem::FireEvent(std::string const& eventName)
+EventQueueStats EventSystem::GetEventQueueStats() const
 {
-	//m_eventSystemMutex.lock();
-	EventArgs args;
-	auto found = m_subscriptionListByName.find(eventName);
-	if (found != m_subscriptionListByName.end())
+	EventQueueStats stats;
+	m_eventSystemMutex.lock();
+	for (size_t i = 0; i < m_queuedEventBuffers.size(); ++i)
+	{
+		stats.m_numQueuedEvents += m_queuedEventBuffers[i]->m_numQueuedEvents.load(std::memory_order_relaxed);
+		stats.m_numDroppedEvents += m_queuedEventBuffers[i]->m_numDroppedEvents.load(std::memory_order_relaxed);
+	}
+	m_eventSystemMutex.unlock();
+	stats.m_numFlushedEvents = m_numFlushedEvents.load(std::memory_order_relaxed);
+	return stats;
+}
+
+QueuedEventBuffer* EventSystem::GetQueuedEventBufferForCurrentThread()
+{
+	if (s_queuedEventBufferOwnerID == m_eventSystemID)
+	{
+		return s_queuedEventBuffer;
+	}
+
+	// First event this thread queues here; a thread that moved between event systems may already have a buffer
+	std::thread::id threadId = std::this_thread::get_id();
+	QueuedEventBuffer* buffer = nullptr;
+	m_eventSystemMutex.lock();
+	for (size_t i = 0; i < m_queuedEventBuffers.size() && buffer == nullptr; ++i)
 	{
-		SubscriptionList const& subscriberForThisEventName = found->second;
-			
-		for (int i = 0; i < (int)subscriberForThisEventName.size(); ++i)
+		if (m_queuedEventBuffers[i]->m_ownerThreadId == threadId)
 		{
-		
-			EventSubscriptionBase* subscriber = subscriberForThisEventName[i];
-			if (subscriber->Fire(args))
-			{
-				return;
-			}
+			buffer = m_queuedEventBuffers[i];
 		}
 	}
-	found = m_subscriptionListByName.find(AllLowerCase(eventName));
-	if (found != m_subscriptionListByName.end())
+	if (buffer == nullptr)
 	{
-		SubscriptionList const& subscriberForThisEventName = found->second;
+		buffer = new QueuedEventBuffer(threadId, m_config.m_queuedEventCapacityPerThread);
+		m_queuedEventBuffers.push_back(buffer);
+	}
+	m_eventSystemMutex.unlock();
+
+	s_queuedEventBufferOwnerID = m_eventSystemID;
+	s_queuedEventBuffer = buffer;
+	return buffer;
+}
 
-		for (int i = 0; i < (int)subscriberForThisEventName.size(); ++i)
+void EventSystem::AddSubscription(std::string const& eventName, EventSubscriptionBase* subscription)
+{
+	// Fires only carry the hash, so two names sharing one would silently receive each other's events
+	HashedCaseInsensitiveString hashedEventName(eventName);
+	EventID eventID = hashedEventName.GetHash();
+	for (auto const& pair : m_subscriptionListByName)
+	{
+		if (pair.first.GetHash() == eventID && pair.first != hashedEventName)
 		{
+			ERROR_AND_DIE(Stringf("Event names \"%s\" and \"%s\" hash to the same event ID, rename one of them", pair.first.c_str(), eventName.c_str()));
+		}
+	}
+	m_registeredCommands.push_back(eventName);
+	m_subscriptionListByName[hashedEventName].push_back(subscription);
+}
 
-			EventSubscriptionBase*  subscriber = subscriberForThisEventName[i];
+void EventSystem::RetireSubscription(EventSubscriptionBase* subscription)
+{
+	m_retiredSubscriptions.push_back(subscription);
+}
 
-			if (subscriber->Fire(args))
-			{
-				return;
-			}
+void EventSystem::PublishSubscriberTable()
+{
+	EventSubscriberTable* newTable = new EventSubscriberTable();
+	int numSlots = 16;
+	while (numSlots < (int)m_subscriptionListByName.size() * 2)
+	{
+		numSlots *= 2;
+	}
+	newTable->m_slots.resize(numSlots);
+	for (auto const& pair : m_subscriptionListByName)
+	{
+		SubscriptionList const& subscriptions = pair.second;
+		if (subscriptions.empty())
+		{
+			continue;
 		}
+		EventID eventID = pair.first.GetHash();
+		int slotIndex = (int)(eventID & (unsigned int)(numSlots - 1));
+		while (newTable->m_slots[slotIndex].m_numSubscribers != 0)
+		{
+			slotIndex = (slotIndex + 1) & (numSlots - 1);
+		}
+		EventSubscriberTable::Slot& slot = newTable->m_slots[slotIndex];
+		slot.m_eventID = eventID;
+		slot.m_firstSubscriberIndex = (int)newTable->m_subscribers.size();
+		slot.m_numSubscribers = (int)subscriptions.size();
+		newTable->m_subscribers.insert(newTable->m_subscribers.end(), subscriptions.begin(), subscriptions.end());
+	}
+
+	EventSubscriberTable const* oldTable = m_subscriberTable.exchange(newTable);
+	if (oldTable)
+	{
+		m_retiredSubscriberTables.push_back(oldTable);
 	}
-	//m_eventSystemMutex.unlock();
+	ReclaimRetiredSubscribers();
+}
+
+void EventSystem::ReclaimRetiredSubscribers()
+{
+	// A fire that starts after this check loads the current table, which is never in the retired list
+	if (m_numFiresInFlight.load() != 0)
+	{
+		return;
+	}
+	for (size_t i = 0; i < m_retiredSubscriberTables.size(); ++i)
+	{
+		delete m_retiredSubscriberTables[i];
+	}
+	m_retiredSubscriberTables.clear();
+	for (size_t i = 0; i < m_retiredSubscriptions.size(); ++i)
+	{
+		delete m_retiredSubscriptions[i];
+	}
+	m_retiredSubscriptions.clear();
+}
+
+EventSubscriberTable::Slot const* EventSubscriberTable::FindSlot(EventID eventID) const
+{
+	int slotMask = (int)m_slots.size() - 1;
+	int slotIndex = (int)(eventID & (unsigned int)slotMask);
+	while (m_slots[slotIndex].m_numSubscribers != 0)
+	{
+		if (m_slots[slotIndex].m_eventID == eventID)
+		{
+			return &m_slots[slotIndex];
+		}
+		slotIndex = (slotIndex + 1) & slotMask;
+	}
+	return nullptr;
 }
 
 std::vector <std::string> const EventSystem::GetAllRegisteredCommands() const
@@ -172,6 +400,26 @@ void FireEvent(std::string const& eventName)
 	g_theEventSystem->FireEvent(eventName);
 }
 
+void FireEvent(EventID eventID, EventArgs& args)
+{
+	g_theEventSystem->FireEvent(eventID, args);
+}
+
+void FireEvent(EventID eventID)
+{
+	g_theEventSystem->FireEvent(eventID);
+}
+
+void QueueEvent(std::string const& eventName, EventArgs const& args)
+{
+	g_theEventSystem->QueueEvent(eventName, args);
+}
+
+void QueueEvent(EventID eventID, EventArgs const& args)
+{
+	g_theEventSystem->QueueEvent(eventID, args);
+}
+
 EventRecipient::~EventRecipient()
 {
 	g_theEventSystem->UnsubscribeAllEventCallbackObjectMethods(this);
@@ -3,16 +3,27 @@
 #include "Engine/Core/NamedStrings.hpp"
 #include "Engine/Core/NamedProperties.hpp"
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstdint>
 //typedef NamedStrings EventArgs;
 typedef NamedProperties EventArgs;
 typedef bool (*EventCallbackFunction)(EventArgs& args);
 
+// Case-insensitive hash of an event name, the same one HashedCaseInsensitiveString uses. Hot paths compute it once,
+// e.g. constexpr EventID EVENT_KEY_PRESSED = MakeEventID("KeyPressed"), and fire by ID.
+typedef unsigned int EventID;
+constexpr EventID MakeEventID(char const* eventName)
+{
+	return HashedCaseInsensitiveString::GenerateCaseInsensitiveHash(eventName);
+}
+
 
 
 
 struct EventSystemConfig
 {
-
+	int m_queuedEventCapacityPerThread = 4096; // QueueEvent drops (and counts) events past this until the next flush
 };
 
 struct EventSubscriptionBase
@@ -69,6 +80,63 @@ struct EventSubscriptionMemberMethod : public EventSubscriptionBase
 
 typedef std::vector<EventSubscriptionBase*> SubscriptionList;
 
+// Immutable snapshot of every subscription, rebuilt whenever a subscription changes. FireEvent only ever reads a
+// published snapshot, so firing takes no lock and never allocates.
+struct EventSubscriberTable
+{
+	struct Slot
+	{
+		EventID m_eventID = 0;
+		int m_firstSubscriberIndex = 0;
+		int m_numSubscribers = 0; // 0 marks an empty slot
+	};
+	Slot const* FindSlot(EventID eventID) const;
+
+	std::vector<Slot> m_slots; // open addressing, power of two size
+	std::vector<EventSubscriptionBase*> m_subscribers;
+};
+
+struct QueuedEvent
+{
+	EventID m_eventID = 0;
+	EventArgs m_args;
+};
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4324) // structure was padded due to alignment specifier - keeping m_head and m_tail apart is the point
+#endif
+// Single producer (the thread that owns it), single consumer (whoever flushes) ring of queued events.
+// Slots and their args are reused frame to frame.
+class QueuedEventBuffer
+{
+	friend class EventSystem;
+public:
+	QueuedEventBuffer(std::thread::id ownerThreadId, int capacity);
+	bool Push(EventID eventID, EventArgs const& args); // false when full
+private:
+	std::thread::id m_ownerThreadId;
+	std::vector<QueuedEvent> m_events;
+	alignas(64) std::atomic<int64_t> m_head = 0; // next event to flush, written by the flusher
+	alignas(64) std::atomic<int64_t> m_tail = 0; // next free slot, written by the owner
+	std::atomic<int64_t> m_numQueuedEvents = 0;
+	std::atomic<int64_t> m_numDroppedEvents = 0;
+};
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+struct EventQueueStats
+{
+	int64_t m_numQueuedEvents = 0;
+	int64_t m_numFlushedEvents = 0;
+	int64_t m_numDroppedEvents = 0;
+};
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4324) // structure was padded due to alignment specifier - m_numFiresInFlight gets its own cache line
+#endif
 class EventSystem
 {
 public:
@@ -98,23 +166,70 @@ public:
 
 	void FireEvent(std::string const& eventName, EventArgs& args);
 	void FireEvent(std::string const& eventName);
+	void FireEvent(EventID eventID, EventArgs& args);
+	void FireEvent(EventID eventID);
+
+	// Deferred firing: any thread may queue without locking, and the subscribers run on the thread that calls
+	// EndFrame() (or FlushQueuedEvents()). A flush groups events by ID, so each event type is looked up once per
+	// flush; events of the same type keep the order they were queued in per thread. A subscriber flushing again from
+	// inside a flush does nothing; whatever it would have flushed waits for the next flush.
+	void QueueEvent(std::string const& eventName, EventArgs const& args);
+	void QueueEvent(EventID eventID, EventArgs const& args);
+	void FlushQueuedEvents();
+	EventQueueStats GetEventQueueStats() const;
+
 	std::vector <std::string> const GetAllRegisteredCommands() const;
 	
+protected:
+	// Callers of these hold m_eventSystemMutex
+	void AddSubscription(std::string const& eventName, EventSubscriptionBase* subscription);
+	void RetireSubscription(EventSubscriptionBase* subscription);
+	void PublishSubscriberTable();
+	void ReclaimRetiredSubscribers();
+	QueuedEventBuffer* GetQueuedEventBufferForCurrentThread();
+
 protected:
 	EventSystemConfig m_config;
+	unsigned int m_eventSystemID = 0; // lets threads cache their queued event buffer without trusting a stale pointer
 	std::map<HashedCaseInsensitiveString, SubscriptionList> m_subscriptionListByName;
 	std::vector<std::string> m_registeredCommands;
-	mutable std::mutex m_eventSystemMutex;
+	mutable std::mutex m_eventSystemMutex; // serializes subscription changes, firing never takes it
+
+	std::atomic<EventSubscriberTable const*> m_subscriberTable = nullptr;
+	alignas(64) std::atomic<int> m_numFiresInFlight = 0;
+
+	// Replaced tables and removed subscriptions may still be in use by a fire in flight on another thread,
+	// so they are only deleted once no fire is running
+	std::vector<EventSubscriberTable const*> m_retiredSubscriberTables;
+	std::vector<EventSubscriptionBase*> m_retiredSubscriptions;
+
+	std::vector<QueuedEventBuffer*> m_queuedEventBuffers; // one per queuing thread, guarded by m_eventSystemMutex
+	std::mutex m_flushMutex;
+	std::atomic<std::thread::id> m_flushingThreadId; // holder of m_flushMutex, so it can spot its own nested flush
+	std::atomic<int64_t> m_numFlushedEvents = 0;
+
+	// Flush scratch, guarded by m_flushMutex; keeps its capacity so flushing doesn't allocate
+	struct QueuedEventRef
+	{
+		EventID m_eventID;
+		int m_bufferIndex;
+		int64_t m_eventIndex;
+	};
+	std::vector<QueuedEventBuffer*> m_buffersToFlush;
+	std::vector<int64_t> m_flushEndIndexes;
+	std::vector<QueuedEventRef> m_eventsToFlush;
 };
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
 
 template<typename T_ObjectType>
 void EventSystem::SubscribeEventCallbackObjectMethod(std::string const& eventName, T_ObjectType* objectPtr, bool (T_ObjectType ::* methodPtr) (EventArgs& args))
 {
     m_eventSystemMutex.lock();
 
-    m_registeredCommands.push_back(eventName);
-    EventSubscriptionBase* subscription = new EventSubscriptionMemberMethod<T_ObjectType>(objectPtr, methodPtr);
-    m_subscriptionListByName[eventName].push_back(subscription);
+    AddSubscription(eventName, new EventSubscriptionMemberMethod<T_ObjectType>(objectPtr, methodPtr));
+    PublishSubscriberTable();
 
     m_eventSystemMutex.unlock();
 
@@ -135,7 +250,7 @@ void EventSystem::UnsubscribeEventCallbackObjectMethod(std::string const& eventN
         {
             if ((*it)->IsForObject(objectPtr))
             {
-                delete* it;
+                RetireSubscription(*it);
                 it = subscribers.erase(it);
             }
             else
@@ -144,6 +259,7 @@ void EventSystem::UnsubscribeEventCallbackObjectMethod(std::string const& eventN
             }
         }
     }
+    PublishSubscriberTable();
 
     m_eventSystemMutex.unlock();
 }
@@ -163,7 +279,7 @@ void EventSystem::UnsubscribeAllEventCallbackObjectMethods(T_ObjectType* objectP
             {
                 if ((*it)->IsForObject(objectPtr))
                 {
-                    delete* it;
+                    RetireSubscription(*it);
                     it = subscribers.erase(it);
                 }
                 else
@@ -173,6 +289,7 @@ void EventSystem::UnsubscribeAllEventCallbackObjectMethods(T_ObjectType* objectP
             }
         }
     }
+    PublishSubscriberTable();
     m_eventSystemMutex.unlock();
 }
 
@@ -191,7 +308,7 @@ void EventSystem::ReplaceEventCallbackObjectMethod(std::string const& eventName,
         {
             if ((*it)->IsForObject(objectPtr))
             {
-                delete* it;
+                RetireSubscription(*it);
                 *it = new EventSubscriptionMemberMethod<T_ObjectType>(objectPtr, methodPtr);
                 replaced = true;
                 break;
@@ -205,10 +322,9 @@ void EventSystem::ReplaceEventCallbackObjectMethod(std::string const& eventName,
     }
     else
     {
-        m_registeredCommands.push_back(eventName);
-        EventSubscriptionBase* subscription = new EventSubscriptionMemberMethod<T_ObjectType>(objectPtr, methodPtr);
-        m_subscriptionListByName[eventName].push_back(subscription);
+        AddSubscription(eventName, new EventSubscriptionMemberMethod<T_ObjectType>(objectPtr, methodPtr));
     }
+    PublishSubscriberTable();
 
     m_eventSystemMutex.unlock();
 }
@@ -217,6 +333,10 @@ void SubscribeEventCallbackFunction(std::string const& eventName, EventCallbackF
 void UnsubscribeEventCallbackFunction(std::string const& eventName, EventCallbackFunction functionPtr);
 void FireEvent(std::string const& eventName, EventArgs& args);
 void FireEvent(std::string const& eventName);
+void FireEvent(EventID eventID, EventArgs& args);
+void FireEvent(EventID eventID);
+void QueueEvent(std::string const& eventName, EventArgs const& args);
+void QueueEvent(EventID eventID, EventArgs const& args);
 
 class EventRecipient
 {
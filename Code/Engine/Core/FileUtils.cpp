@@ -1,6 +1,37 @@
 #include "Engine/Core/FileUtils.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/JobSystem.hpp"
+#include <filesystem>
+
+class FileReadJob : public Job
+{
+public:
+	FileReadJob(std::vector<uint8_t>& outBuffer, std::string const& filename)
+		:m_outBuffer(outBuffer), m_filename(filename)
+	{
+		m_priority = JobPriority::BLOCKING_IO;
+	}
+	virtual void Execute() override
+	{
+		// FileReadToBuffer dies on a missing file, one missing asset out of hundreds shouldn't take the game down
+		if (!IsFileExists(m_filename))
+		{
+			m_outBuffer.clear();
+			ERROR_RECOVERABLE(Stringf("Failed to Read the file located in %s", m_filename.c_str()));
+			return;
+		}
+		if (FileReadToBuffer(m_outBuffer, m_filename) == -1)
+		{
+			m_outBuffer.clear();
+		}
+	}
+public:
+	std::vector<uint8_t>& m_outBuffer;
+	std::string m_filename;
+};
+
 int FileReadToBuffer(std::vector<uint8_t>& outBuffer, std::string const& filename)
 {
 	FILE* file;
@@ -83,3 +114,30 @@ bool IsFileExists(std::string const& fileName)
 	fclose(file);
 	return true;
 }
+
+bool GetFileSizeAndModifiedTime(std::string const& fileName, uint64_t& out_fileSize, int64_t& out_modifiedTime)
+{
+	std::error_code error;
+	std::filesystem::path filePath(fileName);
+	out_fileSize = (uint64_t)std::filesystem::file_size(filePath, error);
+	if (error)
+	{
+		return false;
+	}
+	out_modifiedTime = (int64_t)std::filesystem::last_write_time(filePath, error).time_since_epoch().count();
+	return !error;
+}
+
+void FileReadToBufferAsync(std::vector<uint8_t>& outBuffer, std::string const& filename, Job* continuation, JobSystem* jobSystem)
+{
+	if (jobSystem == nullptr)
+	{
+		jobSystem = g_theJobSystem;
+	}
+	GUARANTEE_OR_DIE(jobSystem != nullptr, "FileReadToBufferAsync needs a job system");
+	GUARANTEE_OR_DIE(continuation != nullptr, "FileReadToBufferAsync needs a continuation to hand the data to");
+
+	FileReadJob* readJob = jobSystem->CreateJob<FileReadJob>(outBuffer, filename);
+	jobSystem->AddDependency(continuation, readJob);
+	jobSystem->QueueFireAndForgetJob(readJob);
+}
@@ -1,7 +1,15 @@
 #pragma once
 #include <vector>
 #include <string>
+class Job;
+class JobSystem;
 int FileReadToBuffer(std::vector<uint8_t>& outBuffer, std::string const& filename);
 int FileReadToString(std::string& outString, std::string const& filename);
 bool FileWriteToBuffer(std::vector<uint8_t> const& outBuffer, std::string const& filename);
-bool IsFileExists(std::string const& fileName);
\ No newline at end of file
+bool IsFileExists(std::string const& fileName);
+bool GetFileSizeAndModifiedTime(std::string const& fileName, uint64_t& out_fileSize, int64_t& out_modifiedTime); // modified time only compares with itself
+
+// Reads the file on the job system's IO workers, so no compute worker is parked on the disk. The read becomes a
+// dependency of continuation, which must not be queued yet: issue every read it needs, then queue it, and it runs
+// on a compute worker once they have all landed. outBuffer must outlive the read and is left empty on failure.
+void FileReadToBufferAsync(std::vector<uint8_t>& outBuffer, std::string const& filename, Job* continuation, JobSystem* jobSystem = nullptr);
\ No newline at end of file
@@ -1,22 +1,186 @@
 #include "Engine/Core/HashedCaseInsensitiveString.hpp"
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <shared_mutex>
+#include <vector>
+
+struct InternedString
+{
+    std::string m_string;
+    unsigned int m_caseInsensitiveHash = 0;
+    unsigned int m_id = 0; // shared by every casing
+    InternedString const* m_caseInsensitiveString = nullptr; // the first casing interned, this one if it was first
+    InternedString* m_nextInBucket = nullptr;
+};
+
+class StringInternPool
+{
+public:
+    StringInternPool();
+    InternedString const* Intern(char const* text, unsigned int caseInsensitiveHash);
+    StringInternPoolStats GetStats() const;
+private:
+    InternedString* FindExact(char const* text, unsigned int caseInsensitiveHash) const;
+    void GrowBuckets();
+private:
+    std::vector<InternedString*> m_buckets; // chained by case-insensitive hash, so every casing shares a bucket
+    std::deque<InternedString> m_strings; // deque so entries never move
+    int m_numCaseInsensitiveStrings = 0;
+    size_t m_numCharacterBytes = 0;
+    mutable std::shared_mutex m_mutex;
+    std::atomic<uint64_t> m_numLookups = 0;
+    std::atomic<uint64_t> m_numHits = 0;
+};
+
+StringInternPool::StringInternPool()
+{
+    m_buckets.resize(1024, nullptr);
+}
+
+InternedString const* StringInternPool::Intern(char const* text, unsigned int caseInsensitiveHash)
+{
+    m_numLookups.fetch_add(1, std::memory_order_relaxed);
+
+    // Almost every lookup is for a string that is already interned, and those only need the shared lock
+    m_mutex.lock_shared();
+    InternedString* internedString = FindExact(text, caseInsensitiveHash);
+    m_mutex.unlock_shared();
+    if (internedString)
+    {
+        m_numHits.fetch_add(1, std::memory_order_relaxed);
+        return internedString;
+    }
+
+    m_mutex.lock();
+    internedString = FindExact(text, caseInsensitiveHash); // another thread may have interned it meanwhile
+    if (internedString == nullptr)
+    {
+        InternedString const* caseInsensitiveString = nullptr;
+        size_t bucketIndex = caseInsensitiveHash & (m_buckets.size() - 1);
+        for (InternedString* scan = m_buckets[bucketIndex]; scan && caseInsensitiveString == nullptr; scan = scan->m_nextInBucket)
+        {
+            if (scan->m_caseInsensitiveHash == caseInsensitiveHash && _stricmp(scan->m_string.c_str(), text) == 0)
+            {
+                caseInsensitiveString = scan->m_caseInsensitiveString;
+            }
+        }
+
+        m_strings.emplace_back();
+        internedString = &m_strings.back();
+        internedString->m_string = text;
+        internedString->m_caseInsensitiveHash = caseInsensitiveHash;
+        if (caseInsensitiveString)
+        {
+            internedString->m_caseInsensitiveString = caseInsensitiveString;
+            internedString->m_id = caseInsensitiveString->m_id;
+        }
+        else
+        {
+            internedString->m_caseInsensitiveString = internedString;
+            internedString->m_id = (unsigned int)++m_numCaseInsensitiveStrings; // 0 is the empty string
+        }
+        internedString->m_nextInBucket = m_buckets[bucketIndex];
+        m_buckets[bucketIndex] = internedString;
+        m_numCharacterBytes += internedString->m_string.capacity() + 1;
+
+        if (m_strings.size() > m_buckets.size())
+        {
+            GrowBuckets();
+        }
+    }
+    m_mutex.unlock();
+    return internedString;
+}
+
+StringInternPoolStats StringInternPool::GetStats() const
+{
+    StringInternPoolStats stats;
+    m_mutex.lock_shared();
+    stats.m_numStrings = (int)m_strings.size();
+    stats.m_numCaseInsensitiveStrings = m_numCaseInsensitiveStrings;
+    stats.m_numBytesUsed = m_strings.size() * sizeof(InternedString) + m_numCharacterBytes + m_buckets.size() * sizeof(InternedString*);
+    m_mutex.unlock_shared();
+    stats.m_numLookups = m_numLookups.load(std::memory_order_relaxed);
+    stats.m_numHits = m_numHits.load(std::memory_order_relaxed);
+    return stats;
+}
+
+InternedString* StringInternPool::FindExact(char const* text, unsigned int caseInsensitiveHash) const
+{
+    size_t bucketIndex = caseInsensitiveHash & (m_buckets.size() - 1);
+    for (InternedString* scan = m_buckets[bucketIndex]; scan; scan = scan->m_nextInBucket)
+    {
+        if (scan->m_caseInsensitiveHash == caseInsensitiveHash && strcmp(scan->m_string.c_str(), text) == 0)
+        {
+            return scan;
+        }
+    }
+    return nullptr;
+}
+
+void StringInternPool::GrowBuckets()
+{
+    // Caller holds the exclusive lock
+    std::vector<InternedString*> newBuckets(m_buckets.size() * 2, nullptr);
+    for (size_t i = 0; i < m_strings.size(); ++i)
+    {
+        InternedString& internedString = m_strings[i];
+        size_t bucketIndex = internedString.m_caseInsensitiveHash & (newBuckets.size() - 1);
+        internedString.m_nextInBucket = newBuckets[bucketIndex];
+        newBuckets[bucketIndex] = &internedString;
+    }
+    m_buckets.swap(newBuckets);
+}
+
+static StringInternPool& GetStringInternPool()
+{
+    // Built on first use, so hashed strings in other translation units' statics can intern safely
+    static StringInternPool s_stringInternPool;
+    return s_stringInternPool;
+}
+
+// Pooled strings are never freed, so each thread can remember recent ones without any locking
+constexpr unsigned int NUM_THREAD_INTERN_CACHE_SLOTS = 256;
+static thread_local InternedString const* s_threadInternCache[NUM_THREAD_INTERN_CACHE_SLOTS] = {};
+
+static InternedString const* InternString(char const* text, unsigned int caseInsensitiveHash)
+{
+    if (text == nullptr || text[0] == '\0')
+    {
+        return nullptr;
+    }
+    InternedString const*& cachedString = s_threadInternCache[caseInsensitiveHash & (NUM_THREAD_INTERN_CACHE_SLOTS - 1)];
+    if (cachedString && cachedString->m_caseInsensitiveHash == caseInsensitiveHash && strcmp(cachedString->m_string.c_str(), text) == 0)
+    {
+        return cachedString;
+    }
+    cachedString = GetStringInternPool().Intern(text, caseInsensitiveHash);
+    return cachedString;
+}
+
+static InternedString const* GetCaseInsensitiveString(InternedString const* internedString)
+{
+    return internedString ? internedString->m_caseInsensitiveString : nullptr;
+}
 
 HashedCaseInsensitiveString::HashedCaseInsensitiveString(HashedCaseInsensitiveString const& copyFrom)
-    :m_castInsensitiveHash(copyFrom.m_castInsensitiveHash)
-    , m_orginalString(copyFrom.m_orginalString)
+    :m_internedString(copyFrom.m_internedString)
+    , m_castInsensitiveHash(copyFrom.m_castInsensitiveHash)
 {
 
 }
 
 HashedCaseInsensitiveString::HashedCaseInsensitiveString(char const* text)
-    :m_orginalString(text)
 {
     m_castInsensitiveHash = GenerateCaseInsensitiveHash(text);
+    m_internedString = InternString(text, m_castInsensitiveHash);
 }
 
 HashedCaseInsensitiveString::HashedCaseInsensitiveString(std::string const& text)
-    :m_orginalString(text)
 {
     m_castInsensitiveHash = GenerateCaseInsensitiveHash(text.c_str());
+    m_internedString = InternString(text.c_str(), m_castInsensitiveHash);
 }
 
 unsigned int HashedCaseInsensitiveString::GetHash() const
@@ -24,32 +188,30 @@ unsigned int HashedCaseInsensitiveString::GetHash() const
     return m_castInsensitiveHash;
 }
 
+unsigned int HashedCaseInsensitiveString::GetInternedID() const
+{
+    return m_internedString ? m_internedString->m_id : 0;
+}
+
 std::string const& HashedCaseInsensitiveString::GetOriginalString() const
 {
-    return m_orginalString;
+    static std::string const s_emptyString;
+    return m_internedString ? m_internedString->m_string : s_emptyString;
 }
 
 char const* HashedCaseInsensitiveString::c_str() const
 {
-    return m_orginalString.c_str();
+    return m_internedString ? m_internedString->m_string.c_str() : "";
 }
 
 bool HashedCaseInsensitiveString::operator==(HashedCaseInsensitiveString const& rsh) const
 {
-    if (m_castInsensitiveHash != rsh.m_castInsensitiveHash)
-    {
-        return false;
-    }
-    return _stricmp(m_orginalString.c_str(), rsh.m_orginalString.c_str()) == 0;
+    return GetCaseInsensitiveString(m_internedString) == GetCaseInsensitiveString(rsh.m_internedString);
 }
 
 bool HashedCaseInsensitiveString::operator!=(HashedCaseInsensitiveString const& rsh) const
 {
-    if (m_castInsensitiveHash != rsh.m_castInsensitiveHash)
-    {
-        return true;
-    }
-    return _stricmp(m_orginalString.c_str(), rsh.m_orginalString.c_str()) != 0;
+    return GetCaseInsensitiveString(m_internedString) != GetCaseInsensitiveString(rsh.m_internedString);
 }
 
 bool HashedCaseInsensitiveString::operator==(char const* text) const
@@ -59,7 +221,7 @@ bool HashedCaseInsensitiveString::operator==(char const* text) const
     {
         return false;
     }
-    return _stricmp(m_orginalString.c_str(),text) == 0;
+    return _stricmp(c_str(),text) == 0;
 }
 
 bool HashedCaseInsensitiveString::operator!=(char const* text) const
@@ -69,7 +231,7 @@ bool HashedCaseInsensitiveString::operator!=(char const* text) const
     {
         return true;
     }
-    return _stricmp(m_orginalString.c_str(), text) != 0;
+    return _stricmp(c_str(), text) != 0;
 }
 
 bool HashedCaseInsensitiveString::operator==(std::string const& text) const
@@ -79,7 +241,7 @@ bool HashedCaseInsensitiveString::operator==(std::string const& text) const
     {
         return false;
     }
-    return _stricmp(m_orginalString.c_str(), text.c_str()) == 0;
+    return _stricmp(c_str(), text.c_str()) == 0;
 }
 
 bool HashedCaseInsensitiveString::operator!=(std::string const& text) const
@@ -89,7 +251,7 @@ bool HashedCaseInsensitiveString::operator!=(std::string const& text) const
     {
         return true;
     }
-    return _stricmp(m_orginalString.c_str(), text.c_str()) != 0;
+    return _stricmp(c_str(), text.c_str()) != 0;
 }
 
 bool HashedCaseInsensitiveString::operator>(HashedCaseInsensitiveString const& rsh) const
@@ -103,7 +265,7 @@ bool HashedCaseInsensitiveString::operator>(HashedCaseInsensitiveString const& r
         return false;
     }
 
-    return _stricmp(m_orginalString.c_str(), rsh.m_orginalString.c_str()) < 0;
+    return GetInternedID() > rsh.GetInternedID();
 }
 
 bool HashedCaseInsensitiveString::operator<(HashedCaseInsensitiveString const& rsh) const
@@ -117,29 +279,28 @@ bool HashedCaseInsensitiveString::operator<(HashedCaseInsensitiveString const& r
         return false;
     }
 
-    return _stricmp(m_orginalString.c_str(), rsh.m_orginalString.c_str()) > 0;
+    return GetInternedID() < rsh.GetInternedID();
+}
+
+void HashedCaseInsensitiveString::operator=(HashedCaseInsensitiveString const& copyFrom)
+{
+    m_internedString = copyFrom.m_internedString;
+    m_castInsensitiveHash = copyFrom.m_castInsensitiveHash;
 }
 
 void HashedCaseInsensitiveString::operator=(char const* text)
 {
-    m_orginalString = text;
     m_castInsensitiveHash = GenerateCaseInsensitiveHash(text);
+    m_internedString = InternString(text, m_castInsensitiveHash);
 }
 
 void HashedCaseInsensitiveString::operator=(std::string const& text)
 {
-    m_orginalString = text;
     m_castInsensitiveHash = GenerateCaseInsensitiveHash(text.c_str());
+    m_internedString = InternString(text.c_str(), m_castInsensitiveHash);
 }
 
-unsigned int HashedCaseInsensitiveString::GenerateCaseInsensitiveHash(char const* text) 
+StringInternPoolStats HashedCaseInsensitiveString::GetInternPoolStats()
 {
-    unsigned int hash = 0;//32 bits
-    for (char const* scan = text; *scan != '\0'; ++ scan)
-    {
-        //hash &= 0b0000111'11111111'11111111'11111111;
-        hash *= 31; // Any prime number, can be large
-        hash += (unsigned int)tolower(*scan);
-    }
-    return hash;
-}
\ No newline at end of file
+    return GetStringInternPool().GetStats();
+}
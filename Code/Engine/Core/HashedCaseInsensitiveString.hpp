@@ -1,5 +1,20 @@
 #pragma once
 #include <string>
+#include <cstdint>
+struct InternedString;
+
+struct StringInternPoolStats
+{
+    int m_numStrings = 0;        // distinct spellings interned
+    int m_numCaseInsensitiveStrings = 0;
+    size_t m_numBytesUsed = 0;   // entries, their characters and the bucket array
+    uint64_t m_numLookups = 0;   // lookups that missed the per-thread cache and went to the shared pool
+    uint64_t m_numHits = 0;      // of those, the ones that found the string already interned
+};
+
+// Every distinct spelling is stored once in a global, thread-safe intern pool and never freed. The object itself is
+// just the case-insensitive hash and a pointer to the pooled string, so copies are free and comparing two of them
+// is an integer and a pointer compare.
 class HashedCaseInsensitiveString
 {
 public:
@@ -9,6 +24,7 @@ public:
     HashedCaseInsensitiveString(std::string const& text);
 
     unsigned int GetHash() const;
+    unsigned int GetInternedID() const; // stable for the life of the program, shared by every casing of the string
     std::string const& GetOriginalString() const;
     char const* c_str() const;
 
@@ -21,12 +37,28 @@ public:
     bool operator > (HashedCaseInsensitiveString const& rsh) const;
     bool operator < (HashedCaseInsensitiveString const& rsh) const;
 
+    void operator= (HashedCaseInsensitiveString const& copyFrom);
     void operator= (char const* text);
     void operator= (std::string const& text);
 
-    static unsigned int GenerateCaseInsensitiveHash(char const* text);
+    // constexpr so literals can be hashed at compile time, e.g. for EventIDs or switch-free key lookups
+    static constexpr unsigned int GenerateCaseInsensitiveHash(char const* text);
+    static StringInternPoolStats GetInternPoolStats();
 
 private:
-    std::string m_orginalString;
+    InternedString const* m_internedString = nullptr; // nullptr is the empty string
     unsigned int m_castInsensitiveHash = 0;
-};
\ No newline at end of file
+};
+
+constexpr unsigned int HashedCaseInsensitiveString::GenerateCaseInsensitiveHash(char const* text)
+{
+    unsigned int hash = 0;//32 bits
+    for (char const* scan = text; *scan != '\0'; ++scan)
+    {
+        // ASCII-only lower casing, so the hash is the same at compile time, at runtime and on every platform
+        char lowerCase = (*scan >= 'A' && *scan <= 'Z') ? (char)(*scan - 'A' + 'a') : *scan;
+        hash *= 31; // Any prime number, can be large
+        hash += (unsigned int)lowerCase;
+    }
+    return hash;
+}
@@ -1,5 +1,121 @@
 #include "Engine/Core/JobSystem.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
+
+static thread_local JobWorkerThread* s_currentWorkerThread = nullptr;
+static thread_local unsigned int s_helperThreadStealSeed = 0x2545F491u;
+static thread_local std::vector<Job*> s_dependentJobsToSchedule; // keeps its capacity, so completing jobs never allocates
+
+bool Job::IsFinished() const
+{
+	return m_isFinished.load(std::memory_order_acquire);
+}
+
+void JobList::PushBack(Job* job)
+{
+	job->m_nextJob = nullptr;
+	if (m_tail)
+	{
+		m_tail->m_nextJob = job;
+	}
+	else
+	{
+		m_head = job;
+	}
+	m_tail = job;
+}
+
+Job* JobList::PopFront()
+{
+	if (m_head == nullptr)
+	{
+		return nullptr;
+	}
+	return Remove(m_head, nullptr);
+}
+
+Job* JobList::Remove(Job* job, Job* previousJob)
+{
+	if (previousJob)
+	{
+		previousJob->m_nextJob = job->m_nextJob;
+	}
+	else
+	{
+		m_head = job->m_nextJob;
+	}
+	if (m_tail == job)
+	{
+		m_tail = previousJob;
+	}
+	job->m_nextJob = nullptr;
+	return job;
+}
+
+bool JobList::IsEmpty() const
+{
+	return m_head == nullptr;
+}
+
+JobPool::~JobPool()
+{
+	if (m_numSlotsInUse > 0)
+	{
+		ERROR_RECOVERABLE("Job pool destroyed while pooled jobs were still alive");
+	}
+	for (size_t i = 0; i < m_blocks.size(); ++i)
+	{
+		delete[] m_blocks[i];
+	}
+	m_blocks.clear();
+}
+
+void* JobPool::AllocateSlot()
+{
+	m_mutex.lock();
+	if (m_firstFreeSlot == nullptr)
+	{
+		Slot* block = new Slot[JOB_POOL_SLOTS_PER_BLOCK];
+		for (int slotIndex = 0; slotIndex < JOB_POOL_SLOTS_PER_BLOCK - 1; ++slotIndex)
+		{
+			block[slotIndex].m_nextFreeSlot = &block[slotIndex + 1];
+		}
+		block[JOB_POOL_SLOTS_PER_BLOCK - 1].m_nextFreeSlot = nullptr;
+		m_blocks.push_back(block);
+		m_firstFreeSlot = block;
+	}
+	Slot* slot = m_firstFreeSlot;
+	m_firstFreeSlot = slot->m_nextFreeSlot;
+	++m_numSlotsInUse;
+	m_mutex.unlock();
+	return slot;
+}
+
+void JobPool::FreeSlot(void* slot)
+{
+	Slot* freedSlot = static_cast<Slot*>(slot);
+	m_mutex.lock();
+	freedSlot->m_nextFreeSlot = m_firstFreeSlot;
+	m_firstFreeSlot = freedSlot;
+	--m_numSlotsInUse;
+	m_mutex.unlock();
+}
+
+int JobPool::GetNumSlotsInUse() const
+{
+	m_mutex.lock();
+	int numSlotsInUse = m_numSlotsInUse;
+	m_mutex.unlock();
+	return numSlotsInUse;
+}
+
+int JobPool::GetNumSlots() const
+{
+	m_mutex.lock();
+	int numSlots = (int)m_blocks.size() * JOB_POOL_SLOTS_PER_BLOCK;
+	m_mutex.unlock();
+	return numSlots;
+}
+
 JobSystem::JobSystem(JobConfig const& jobConfig)
 	:m_config(jobConfig)
 {
@@ -8,21 +124,42 @@ JobSystem::JobSystem(JobConfig const& jobConfig)
 
 JobSystem::~JobSystem()
 {
-
+	while (Job* retrievedJob = m_retrievedPooledJobs.PopFront())
+	{
+		RecycleJob(retrievedJob);
+	}
+	for (int priorityIndex = 0; priorityIndex < NUM_COMPUTE_JOB_PRIORITIES; ++priorityIndex)
+	{
+		delete m_mainThreadQueues[priorityIndex];
+		m_mainThreadQueues[priorityIndex] = nullptr;
+	}
 }
 
 void JobSystem::Startup()
 {
+	m_mainThreadId = std::this_thread::get_id();
+	for (int priorityIndex = 0; priorityIndex < NUM_COMPUTE_JOB_PRIORITIES; ++priorityIndex)
+	{
+		m_mainThreadQueues[priorityIndex] = new WorkStealingQueue();
+	}
+
 	int numWorkers = m_config.m_numWorkers;
 	if (numWorkers < 0)
 	{
 		numWorkers = std::thread::hardware_concurrency();
 	}
-	CreateWorkers(numWorkers);
+	CreateWorkers(numWorkers, m_config.m_numIOWorkers);
 }
 
 void JobSystem::BeginFrame()
 {
+	// Pooled jobs handed out by RetrieveJob() last frame are done being looked at by now
+	m_completedJobsMutex.lock();
+	while (Job* retrievedJob = m_retrievedPooledJobs.PopFront())
+	{
+		RecycleJob(retrievedJob);
+	}
+	m_completedJobsMutex.unlock();
 }
 
 void JobSystem::EndFrame()
@@ -35,61 +172,191 @@ void JobSystem::Shutdown()
 	DestoryWorkers();
 }
 
-void JobSystem::CreateWorkers(int numWorkers)
+int JobSystem::GetNumPooledJobsInUse() const
 {
+	return m_jobPool.GetNumSlotsInUse();
+}
+
+void JobSystem::CreateWorkers(int numWorkers, int numIOWorkers)
+{
+	// DestoryWorkers() leaves the system quitting; a fresh set of workers starts it up again
+	m_isQuitting = false;
+	// Every worker has to exist before any thread starts, since idle workers walk m_workers looking for victims
 	for (int i = 0; i < numWorkers; ++i)
 	{
 		m_workers.push_back(new JobWorkerThread(i, this));
 	}
+	for (int i = 0; i < numIOWorkers; ++i)
+	{
+		m_ioWorkers.push_back(new JobWorkerThread(numWorkers + i, this, true));
+	}
+	for (int i = 0; i < numWorkers; ++i)
+	{
+		m_workers[i]->StartThread();
+	}
+	for (int i = 0; i < numIOWorkers; ++i)
+	{
+		m_ioWorkers[i]->StartThread();
+	}
 }
 
 void JobSystem::DestoryWorkers()
 {
+	// Running workers steal from every other worker's queues, so no worker may be deleted until all of them have stopped
+	m_isQuitting = true;
+	for (size_t i = 0; i < m_workers.size(); ++i)
+	{
+		m_workers[i]->JoinThread();
+	}
+	for (size_t i = 0; i < m_ioWorkers.size(); ++i)
+	{
+		m_ioWorkers[i]->JoinThread();
+	}
 	for (size_t i = 0; i < m_workers.size(); ++i)
 	{
 		delete m_workers[i];
 		m_workers[i] = nullptr;
 	}
+	m_workers.clear();
+	for (size_t i = 0; i < m_ioWorkers.size(); ++i)
+	{
+		delete m_ioWorkers[i];
+		m_ioWorkers[i] = nullptr;
+	}
+	m_ioWorkers.clear();
+}
+
+void JobSystem::AddDependency(Job* job, Job* prerequisite)
+{
+	GUARANTEE_OR_DIE(job->m_status != JobStatus::QUEUING && job->m_status != JobStatus::EXECUTING && job->m_status != JobStatus::WAITING_FOR_DEPENDENCIES, "Dependencies must be added before the job is queued");
+
+	while (prerequisite->m_dependentJobsLock.exchange(true, std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+	}
+	if (!prerequisite->m_areDependentJobsReleased)
+	{
+		// Prerequisites that already finished are simply ignored
+		job->m_numPendingDependencies.fetch_add(1, std::memory_order_relaxed);
+		if (prerequisite->m_numDependentJobs < NUM_INLINE_DEPENDENT_JOBS)
+		{
+			prerequisite->m_dependentJobs[prerequisite->m_numDependentJobs] = job;
+		}
+		else
+		{
+			prerequisite->m_extraDependentJobs.push_back(job);
+		}
+		++prerequisite->m_numDependentJobs;
+	}
+	prerequisite->m_dependentJobsLock.store(false, std::memory_order_release);
 }
 
 void JobSystem::QueueJob(Job* jobToQueue)
 {
-	m_queuedJobsMutex.lock();
-	m_queuedJobs.push_back(jobToQueue);
-	jobToQueue->m_status = JobStatus::QUEUING;
-	m_queuedJobsMutex.unlock();
+	jobToQueue->m_isFinished.store(false, std::memory_order_relaxed);
+	jobToQueue->m_areDependentJobsReleased = false;
+	jobToQueue->m_status = JobStatus::WAITING_FOR_DEPENDENCIES;
+	if (jobToQueue->m_numPendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		ScheduleRunnableJob(jobToQueue);
+	}
+}
+
+void JobSystem::QueueFireAndForgetJob(Job* pooledJob)
+{
+	GUARANTEE_OR_DIE(pooledJob->m_isPooled, "Only jobs made by CreateJob can be fire and forget, nothing else would free them");
+	pooledJob->m_isRetrievable = false;
+	QueueJob(pooledJob);
+}
+
+void JobSystem::WhenAll(Job* const* prerequisites, int numPrerequisites, Job* continuation)
+{
+	for (int i = 0; i < numPrerequisites; ++i)
+	{
+		AddDependency(continuation, prerequisites[i]);
+	}
+	QueueJob(continuation);
+}
+
+void JobSystem::WaitFor(Job* jobToWaitFor)
+{
+	while (!jobToWaitFor->IsFinished())
+	{
+		Job* jobToHelpWith = ClaimJobForCurrentThread();
+		if (jobToHelpWith)
+		{
+			ExecuteJob(jobToHelpWith);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
 }
 
 void JobSystem::CompleteJob(Job* jobToComplete)
 {
-	m_executingJobsMutex.lock();
-	auto it = std::find(m_executingJobs.begin(), m_executingJobs.end(), jobToComplete);
-	if (it != m_executingJobs.end())
+	if (jobToComplete->m_status != JobStatus::EXECUTING)
 	{
-		m_executingJobs.erase(it);
-		m_completedJobs.push_back(jobToComplete);
-		jobToComplete->m_status = JobStatus::COMPLETED;
+		ERROR_RECOVERABLE("Can't complete a job that is not executing");
+		return;
 	}
-	else
+
+	std::vector<Job*>& dependentJobs = s_dependentJobsToSchedule;
+	dependentJobs.clear();
+	TakeDependentJobs(jobToComplete, dependentJobs);
+	if (!jobToComplete->m_isRetrievable)
 	{
-		ERROR_RECOVERABLE("Can't find a job in the executing list to remove");
+		// Internal jobs may be destroyed by their waiter as soon as they are finished (ParallelFor's live on its stack),
+		// so publishing m_isFinished is the last touch; anything needed afterwards is copied out first
+		bool isPooled = jobToComplete->m_isPooled;
+		jobToComplete->m_status = JobStatus::RETRIEVED;
+		jobToComplete->m_isFinished.store(true, std::memory_order_release);
+		ScheduleDependentJobs(dependentJobs);
+		if (isPooled)
+		{
+			// Fire-and-forget: nobody holds a pointer to it, and its dependents were already handed off
+			RecycleJob(jobToComplete);
+		}
+		return;
 	}
 
-	m_executingJobsMutex.unlock();
+	jobToComplete->m_status = JobStatus::COMPLETED;
+	jobToComplete->m_isFinished.store(true, std::memory_order_release);
+	ScheduleDependentJobs(dependentJobs);
+
+	// Pushing onto the completed stack must be the last touch, the job may be retrieved and deleted right after
+	Job* head = m_completedJobsStack.load(std::memory_order_relaxed);
+	do
+	{
+		jobToComplete->m_nextJob = head;
+	} while (!m_completedJobsStack.compare_exchange_weak(head, jobToComplete, std::memory_order_release, std::memory_order_relaxed));
 }
 
 void JobSystem::RetrieveJob(Job* jobToRetrieve)
 {
 	m_completedJobsMutex.lock();
-	for (auto it = m_completedJobs.begin(); it != m_completedJobs.end(); ++it)
+	while (true)
 	{
-		if (*it == jobToRetrieve)
+		GatherCompletedJobs();
+		Job* previousJob = nullptr;
+		for (Job* completedJob = m_completedJobs.m_head; completedJob; completedJob = completedJob->m_nextJob)
 		{
-			m_completedJobs.erase(it);
-			jobToRetrieve->m_status = JobStatus::RETRIEVED;
-			m_completedJobsMutex.unlock();
-			return;
+			if (completedJob == jobToRetrieve)
+			{
+				m_completedJobs.Remove(jobToRetrieve, previousJob);
+				MarkJobRetrieved(jobToRetrieve);
+				m_completedJobsMutex.unlock();
+				return;
+			}
+			previousJob = completedJob;
 		}
+		if (!jobToRetrieve->IsFinished())
+		{
+			break;
+		}
+		// Finished jobs are pushed onto the completed stack right after m_isFinished is set
+		std::this_thread::yield();
 	}
 	m_completedJobsMutex.unlock();
 	ERROR_RECOVERABLE("Can't find a job in the complete list to retrieve");
@@ -100,91 +367,384 @@ void JobSystem::RetrieveJob(Job* jobToRetrieve)
 Job* JobSystem::RetrieveJob()
 {
 	m_completedJobsMutex.lock();
-	if (!m_completedJobs.empty())
+	GatherCompletedJobs();
+	Job* retrievedJob = m_completedJobs.PopFront();
+	if (retrievedJob)
 	{
-		Job* jobToComplete = m_completedJobs.front();
-		jobToComplete->m_status = JobStatus::RETRIEVED;
-		m_completedJobs.pop_front();
-		m_completedJobsMutex.unlock();
-		return jobToComplete;
+		MarkJobRetrieved(retrievedJob);
 	}
 	m_completedJobsMutex.unlock();
-	return nullptr;
+	return retrievedJob;
 }
 
 void JobSystem::RetrieveAllCompletedJobs()
 {
 	m_completedJobsMutex.lock();
-	while (!m_completedJobs.empty())
+	GatherCompletedJobs();
+	while (Job* retrievedJob = m_completedJobs.PopFront())
 	{
-		Job* jobToComplete = m_completedJobs.front();
-		jobToComplete->m_status = JobStatus::RETRIEVED;
-		m_completedJobs.pop_front();
+		// Nobody gets a pointer back from here, so pooled jobs can go straight back to the pool
+		retrievedJob->m_status = JobStatus::RETRIEVED;
+		if (retrievedJob->m_isPooled)
+		{
+			RecycleJob(retrievedJob);
+		}
 	}
 	m_completedJobsMutex.unlock();
 }
 
 Job* JobSystem::ClaimJob(JobWorkerThread* owner)
 {
-	m_queuedJobsMutex.lock();
-	for (auto it = m_queuedJobs.begin(); it != m_queuedJobs.end(); ++it)
+	Job* jobToClaim = nullptr;
+	if (owner->m_isIOWorker)
+	{
+		jobToClaim = ClaimIOJob();
+	}
+	else
+	{
+		jobToClaim = ClaimComputeJob(owner->m_queues, owner->m_stealSeed, owner->m_jobFlag);
+	}
+	if (jobToClaim)
+	{
+		jobToClaim->m_status = JobStatus::EXECUTING;
+	}
+	return jobToClaim;
+}
+
+bool JobSystem::IsQuitting() const
+{
+	return m_isQuitting;
+}
+
+void JobSystem::SetJobWokerThreadJobFlag(int workerId, uint8_t jobFlag)
+{
+	m_workers[workerId]->m_jobFlag = jobFlag;
+}
+
+int JobSystem::GetNumWorkers() const
+{
+	return (int)m_workers.size();
+}
+
+int JobSystem::GetNumIOWorkers() const
+{
+	return (int)m_ioWorkers.size();
+}
+
+WorkStealingQueue* const* JobSystem::GetQueuesForCurrentThread() const
+{
+	if (s_currentWorkerThread && s_currentWorkerThread->m_system == this && !s_currentWorkerThread->m_isIOWorker)
+	{
+		return s_currentWorkerThread->m_queues;
+	}
+	if (m_mainThreadQueues[0] && std::this_thread::get_id() == m_mainThreadId)
+	{
+		return m_mainThreadQueues;
+	}
+	return nullptr;
+}
+
+Job* JobSystem::ClaimComputeJob(WorkStealingQueue* const* ownQueues, unsigned int& stealSeed, uint8_t jobFlag)
+{
+	Job* jobToClaim = nullptr;
+	if (jobFlag == 0)
+	{
+		// Strict priority order: any frame-critical job anywhere beats a normal job in our own queue
+		for (int priorityIndex = 0; priorityIndex < NUM_COMPUTE_JOB_PRIORITIES && jobToClaim == nullptr; ++priorityIndex)
+		{
+			JobPriority priority = (JobPriority)priorityIndex;
+			if (priority == JobPriority::FRAME_CRITICAL && m_numQueuedFrameCriticalJobs.load(std::memory_order_relaxed) <= 0)
+			{
+				continue;
+			}
+			WorkStealingQueue* ownQueue = ownQueues ? ownQueues[priorityIndex] : nullptr;
+			if (ownQueue)
+			{
+				jobToClaim = ownQueue->Pop();
+			}
+			if (jobToClaim == nullptr)
+			{
+				jobToClaim = StealJob(ownQueue, priority, stealSeed);
+			}
+		}
+		if (jobToClaim && jobToClaim->m_priority == JobPriority::FRAME_CRITICAL)
+		{
+			m_numQueuedFrameCriticalJobs.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+	if (jobToClaim == nullptr)
+	{
+		jobToClaim = ClaimSharedJob(jobFlag);
+	}
+	return jobToClaim;
+}
+
+Job* JobSystem::StealJob(WorkStealingQueue const* thiefQueue, JobPriority priority, unsigned int& stealSeed)
+{
+	// Victims are every other worker plus the main thread queue, starting from a random one so thieves spread out
+	int numVictims = (int)m_workers.size() + 1;
+	stealSeed ^= stealSeed << 13;
+	stealSeed ^= stealSeed >> 17;
+	stealSeed ^= stealSeed << 5;
+	int startIndex = (int)(stealSeed % (unsigned int)numVictims);
+
+	for (int i = 0; i < numVictims; ++i)
 	{
-		Job* jobToClaim = *it;
-		if (jobToClaim->m_jobFlag == owner->m_jobFlag)
+		int victimIndex = (startIndex + i) % numVictims;
+		WorkStealingQueue* victimQueue = nullptr;
+		if (victimIndex == (int)m_workers.size())
+		{
+			victimQueue = m_mainThreadQueues[(int)priority];
+		}
+		else
 		{
+			victimQueue = m_workers[victimIndex]->m_queues[(int)priority];
+		}
+
+		if (victimQueue && victimQueue != thiefQueue && !victimQueue->IsEmpty())
+		{
+			Job* stolenJob = victimQueue->Steal();
+			if (stolenJob)
 			{
-				m_executingJobs.push_back(jobToClaim);
-				jobToClaim->m_status = JobStatus::EXECUTING;
+				return stolenJob;
 			}
-			m_queuedJobs.erase(it);
-			m_queuedJobsMutex.unlock();
-			return jobToClaim;
 		}
 	}
-	m_queuedJobsMutex.unlock();
 	return nullptr;
+}
 
+Job* JobSystem::ClaimSharedJob(uint8_t jobFlag)
+{
+	if (m_numSharedQueuedJobs.load(std::memory_order_relaxed) == 0)
+	{
+		return nullptr;
+	}
+
+	m_sharedQueuedJobsMutex.lock();
+	for (int priorityIndex = 0; priorityIndex < NUM_COMPUTE_JOB_PRIORITIES; ++priorityIndex)
+	{
+		JobList& sharedQueuedJobs = m_sharedQueuedJobs[priorityIndex];
+		Job* previousJob = nullptr;
+		for (Job* jobToClaim = sharedQueuedJobs.m_head; jobToClaim; jobToClaim = jobToClaim->m_nextJob)
+		{
+			if (jobToClaim->m_jobFlag == jobFlag)
+			{
+				sharedQueuedJobs.Remove(jobToClaim, previousJob);
+				--m_numSharedQueuedJobs;
+				m_sharedQueuedJobsMutex.unlock();
+				return jobToClaim;
+			}
+			previousJob = jobToClaim;
+		}
+	}
+	m_sharedQueuedJobsMutex.unlock();
+	return nullptr;
 }
 
-bool JobSystem::IsQuitting() const
+Job* JobSystem::ClaimIOJob()
 {
-	return m_isQuitting;
+	if (m_numQueuedIOJobs.load(std::memory_order_relaxed) == 0)
+	{
+		return nullptr;
+	}
+
+	Job* jobToClaim = nullptr;
+	m_queuedIOJobsMutex.lock();
+	jobToClaim = m_queuedIOJobs.PopFront();
+	if (jobToClaim)
+	{
+		--m_numQueuedIOJobs;
+	}
+	m_queuedIOJobsMutex.unlock();
+	return jobToClaim;
 }
 
-void JobSystem::SetJobWokerThreadJobFlag(int workerId, uint8_t jobFlag)
+Job* JobSystem::ClaimJobForCurrentThread()
 {
-	m_workers[workerId]->m_jobFlag = jobFlag;
+	if (s_currentWorkerThread && s_currentWorkerThread->m_system == this)
+	{
+		return ClaimJob(s_currentWorkerThread);
+	}
+
+	// Helper threads never pick up BLOCKING_IO jobs, those belong to the IO workers
+	Job* jobToClaim = ClaimComputeJob(GetQueuesForCurrentThread(), s_helperThreadStealSeed, 0);
+	if (jobToClaim)
+	{
+		jobToClaim->m_status = JobStatus::EXECUTING;
+	}
+	return jobToClaim;
 }
 
-JobWorkerThread::JobWorkerThread(int id, JobSystem* system)
-	:m_id(id), m_system(system)
+void JobSystem::ScheduleRunnableJob(Job* runnableJob)
 {
-	m_thread = new std::thread(&JobWorkerThread::ThreadMain, this);
+	// Re-arm the counter for the next time this job is queued; nothing else touches it until then
+	runnableJob->m_numPendingDependencies.store(1, std::memory_order_relaxed);
+	runnableJob->m_status = JobStatus::QUEUING;
+
+	JobPriority priority = runnableJob->m_priority;
+	if (priority == JobPriority::BLOCKING_IO && !m_ioWorkers.empty())
+	{
+		m_queuedIOJobsMutex.lock();
+		m_queuedIOJobs.PushBack(runnableJob);
+		++m_numQueuedIOJobs;
+		m_queuedIOJobsMutex.unlock();
+		return;
+	}
+	if (priority == JobPriority::BLOCKING_IO)
+	{
+		// Without IO workers the least intrusive place left for blocking work is the background lane
+		priority = JobPriority::BACKGROUND;
+	}
+
+	WorkStealingQueue* const* queues = GetQueuesForCurrentThread();
+	if (queues && runnableJob->m_jobFlag == 0)
+	{
+		if (priority == JobPriority::FRAME_CRITICAL)
+		{
+			m_numQueuedFrameCriticalJobs.fetch_add(1, std::memory_order_relaxed);
+		}
+		queues[(int)priority]->Push(runnableJob);
+		return;
+	}
+
+	m_sharedQueuedJobsMutex.lock();
+	m_sharedQueuedJobs[(int)priority].PushBack(runnableJob);
+	++m_numSharedQueuedJobs;
+	m_sharedQueuedJobsMutex.unlock();
 }
 
-JobWorkerThread::~JobWorkerThread()
+void JobSystem::ExecuteJob(Job* jobToExecute)
 {
- 	if (m_thread && m_thread->joinable()) 
+	jobToExecute->Execute();
+	CompleteJob(jobToExecute);
+}
+
+void JobSystem::TakeDependentJobs(Job* finishedJob, std::vector<Job*>& out_dependentJobs)
+{
+	while (finishedJob->m_dependentJobsLock.exchange(true, std::memory_order_acquire))
 	{
- 		m_thread->join();
- 	}
+		std::this_thread::yield();
+	}
+	finishedJob->m_areDependentJobsReleased = true;
+	int numInlineDependentJobs = finishedJob->m_numDependentJobs < NUM_INLINE_DEPENDENT_JOBS ? finishedJob->m_numDependentJobs : NUM_INLINE_DEPENDENT_JOBS;
+	out_dependentJobs.insert(out_dependentJobs.end(), finishedJob->m_dependentJobs, finishedJob->m_dependentJobs + numInlineDependentJobs);
+	out_dependentJobs.insert(out_dependentJobs.end(), finishedJob->m_extraDependentJobs.begin(), finishedJob->m_extraDependentJobs.end());
+	finishedJob->m_numDependentJobs = 0;
+	finishedJob->m_extraDependentJobs.clear();
+	finishedJob->m_dependentJobsLock.store(false, std::memory_order_release);
+}
+
+void JobSystem::ScheduleDependentJobs(std::vector<Job*> const& dependentJobs)
+{
+	for (size_t i = 0; i < dependentJobs.size(); ++i)
+	{
+		Job* dependentJob = dependentJobs[i];
+		if (dependentJob->m_numPendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			ScheduleRunnableJob(dependentJob);
+		}
+	}
+}
+
+void JobSystem::GatherCompletedJobs()
+{
+	// Caller holds m_completedJobsMutex. The stack is newest-first, so reverse it to keep completion order.
+	Job* completedJob = m_completedJobsStack.exchange(nullptr, std::memory_order_acquire);
+	Job* oldestFirst = nullptr;
+	while (completedJob)
+	{
+		Job* nextJob = completedJob->m_nextJob;
+		completedJob->m_nextJob = oldestFirst;
+		oldestFirst = completedJob;
+		completedJob = nextJob;
+	}
+	while (oldestFirst)
+	{
+		Job* nextJob = oldestFirst->m_nextJob;
+		m_completedJobs.PushBack(oldestFirst);
+		oldestFirst = nextJob;
+	}
+}
+
+void JobSystem::MarkJobRetrieved(Job* retrievedJob)
+{
+	// Caller holds m_completedJobsMutex
+	retrievedJob->m_status = JobStatus::RETRIEVED;
+	if (retrievedJob->m_isPooled)
+	{
+		m_retrievedPooledJobs.PushBack(retrievedJob);
+	}
+}
+
+void JobSystem::RecycleJob(Job* jobToRecycle)
+{
+	void* slot = dynamic_cast<void*>(jobToRecycle); // the most derived object is what sits at the start of the slot
+	jobToRecycle->~Job();
+	m_jobPool.FreeSlot(slot);
+}
+
+JobWorkerThread::JobWorkerThread(int id, JobSystem* system, bool isIOWorker)
+	:m_id(id), m_isIOWorker(isIOWorker), m_system(system)
+{
+	m_stealSeed = 0x9E3779B9u * (unsigned int)(id + 1);
+	if (!m_isIOWorker)
+	{
+		for (int priorityIndex = 0; priorityIndex < NUM_COMPUTE_JOB_PRIORITIES; ++priorityIndex)
+		{
+			m_queues[priorityIndex] = new WorkStealingQueue();
+		}
+	}
+}
+
+JobWorkerThread::~JobWorkerThread()
+{
+	JoinThread();
    delete m_thread;
    m_thread = nullptr;
+   for (int priorityIndex = 0; priorityIndex < NUM_COMPUTE_JOB_PRIORITIES; ++priorityIndex)
+   {
+	   delete m_queues[priorityIndex];
+	   m_queues[priorityIndex] = nullptr;
+   }
+}
+
+void JobWorkerThread::JoinThread()
+{
+	if (m_thread && m_thread->joinable())
+	{
+		m_thread->join();
+	}
+}
+
+void JobWorkerThread::StartThread()
+{
+	m_thread = new std::thread(&JobWorkerThread::ThreadMain, this);
 }
 
 void JobWorkerThread::ThreadMain()
 {
+	s_currentWorkerThread = this;
+	// Sized up front, so even the first job a worker completes hands its dependents on without allocating
+	s_dependentJobsToSchedule.reserve(NUM_INLINE_DEPENDENT_JOBS);
+	int numIdleSpins = 0;
 	while (!m_system->m_isQuitting)
 	{
 		Job* jobToExcute = m_system->ClaimJob(this);
 		if (jobToExcute&& !m_system->m_isQuitting)
 		{
-			jobToExcute->Execute();
-			m_system->CompleteJob(jobToExcute);
+			numIdleSpins = 0;
+			m_system->ExecuteJob(jobToExcute);
+		}
+		else if (numIdleSpins < 64)
+		{
+			// Short jobs tend to arrive in bursts, so yield a few times before paying for a real sleep
+			++numIdleSpins;
+			std::this_thread::yield();
 		}
 		else
 		{
 			std::this_thread::sleep_for(std::chrono::microseconds(100));
 		}
 	}
+	s_currentWorkerThread = nullptr;
 }
@@ -1,43 +1,123 @@
 #pragma once
 #include <vector>
 #include <thread>
-#include <deque>
 #include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Engine/Core/WorkStealingQueue.hpp"
 struct JobConfig
 {
 	int m_numWorkers = -1; //If negative number, create one per hardware core.
+	int m_numIOWorkers = 1; //Dedicated threads for BLOCKING_IO jobs, so blocking calls never park a compute worker.
 };
+enum class JobPriority
+{
+	FRAME_CRITICAL,	// someone is waiting on it this frame; claimed before anything else
+	NORMAL,
+	BACKGROUND,		// asset streaming, precomputation; only runs when nothing more urgent is queued
+	BLOCKING_IO,	// may block on disk/network; only ever runs on the IO workers
+	COUNT
+};
+constexpr int NUM_COMPUTE_JOB_PRIORITIES = (int)JobPriority::BLOCKING_IO;
+constexpr int NUM_INLINE_DEPENDENT_JOBS = 4;
+constexpr size_t JOB_POOL_SLOT_SIZE = 256;
+constexpr int JOB_POOL_SLOTS_PER_BLOCK = 1024;
 enum class JobStatus
 {
 	NEW,
 	QUEUING,
 	EXECUTING,
+	WAITING_FOR_DEPENDENCIES,
 	COMPLETED,
 	RETRIEVED
 };
 class Job
 {
+	friend class JobSystem;
+	friend struct JobList;
 public:
 	Job() {}
 	virtual ~Job(){}
 	virtual void Execute() = 0;
+	bool IsFinished() const; // true once Execute() has returned, even before the job is retrieved
 public:
 	std::atomic<JobStatus> m_status = JobStatus::NEW;
 	uint8_t m_jobFlag = 0;
+	JobPriority m_priority = JobPriority::NORMAL;
+private:
+	Job* m_nextJob = nullptr; // intrusive link for whichever job list or stack the job currently sits in
+	bool m_isPooled = false; // created by JobSystem::CreateJob, so the system recycles it after retrieval
+
+	// Starts at 1 for the QueueJob() call itself, plus 1 per unfinished prerequisite; the job runs when it reaches 0
+	std::atomic<int> m_numPendingDependencies = 1;
+	std::atomic<bool> m_isFinished = false;
+	bool m_isRetrievable = true; // internal jobs skip the completed list and are done once m_isFinished is set
+	bool m_areDependentJobsReleased = false; // guarded by m_dependentJobsLock
+	std::atomic<bool> m_dependentJobsLock = false;
+	// Jobs waiting on this one, guarded by m_dependentJobsLock. Only fan-outs wider than the inline slots allocate.
+	int m_numDependentJobs = 0;
+	Job* m_dependentJobs[NUM_INLINE_DEPENDENT_JOBS] = {};
+	std::vector<Job*> m_extraDependentJobs;
+};
+
+// FIFO threaded through Job::m_nextJob, so queuing a job never allocates. Not thread safe; owners lock around it.
+struct JobList
+{
+	void PushBack(Job* job);
+	Job* PopFront();
+	Job* Remove(Job* job, Job* previousJob); // previousJob is the job before it, nullptr for the front
+	bool IsEmpty() const;
+
+	Job* m_head = nullptr;
+	Job* m_tail = nullptr;
+};
+
+// Fixed-size slots carved out of 1024-slot blocks. Blocks are only ever added, so once the pool has grown to the
+// peak number of jobs alive at once, creating and recycling jobs no longer touches the heap.
+class JobPool
+{
+public:
+	JobPool() {}
+	~JobPool();
+	JobPool(JobPool const& copy) = delete;
+
+	void* AllocateSlot();
+	void FreeSlot(void* slot);
+	int GetNumSlotsInUse() const;
+	int GetNumSlots() const;
+private:
+	union Slot
+	{
+		Slot* m_nextFreeSlot;
+		alignas(std::max_align_t) unsigned char m_bytes[JOB_POOL_SLOT_SIZE];
+	};
+
+	std::vector<Slot*> m_blocks;
+	Slot* m_firstFreeSlot = nullptr;
+	int m_numSlotsInUse = 0;
+	mutable std::mutex m_mutex;
 };
 class JobSystem;
 class JobWorkerThread
 {
 	friend class JobSystem;
 public:
-	JobWorkerThread(int id, JobSystem* system);
+	JobWorkerThread(int id, JobSystem* system, bool isIOWorker = false);
 	~JobWorkerThread();
+	void StartThread();
+	void JoinThread(); // returns once ThreadMain has exited; the system must already be quitting
 	void ThreadMain();
 private:
 	int m_id = -1;
 	uint8_t m_jobFlag = 0;
+	bool m_isIOWorker = false;
+	unsigned int m_stealSeed = 0;
 	JobSystem* m_system = nullptr;
 	std::thread* m_thread = nullptr;
+	WorkStealingQueue* m_queues[NUM_COMPUTE_JOB_PRIORITIES] = {};
 };
 
 class JobSystem
@@ -50,9 +130,21 @@ public:
 	void BeginFrame();
 	void EndFrame();
 	void Shutdown();
-	void CreateWorkers(int numWorkers);
+
+	// Constructs a job in the system's job pool instead of on the heap. Pooled jobs are recycled automatically:
+	// RetrieveAllCompletedJobs() recycles them on the spot, and a pooled job handed back by RetrieveJob() stays valid
+	// until the next BeginFrame(). Never delete a pooled job yourself.
+	template<typename T_Job, typename... T_Args>
+	T_Job* CreateJob(T_Args&&... args);
+	int GetNumPooledJobsInUse() const;
+
+	void CreateWorkers(int numWorkers, int numIOWorkers = 0);
 	void DestoryWorkers();
+	void AddDependency(Job* job, Job* prerequisite); // call before queuing job; job runs after prerequisite's Execute() returns
 	void QueueJob(Job* jobToQueue);
+	void QueueFireAndForgetJob(Job* pooledJob); // nobody retrieves it; it goes back to the pool the moment it finishes
+	void WhenAll(Job* const* prerequisites, int numPrerequisites, Job* continuation); // queues continuation to run after all of them
+	void WaitFor(Job* jobToWaitFor); // executes other queued jobs on this thread until jobToWaitFor is finished
 	void CompleteJob(Job* jobToComplete);
 	void RetrieveJob(Job* jobToRetrieve);
 	Job* RetrieveJob();
@@ -60,16 +152,185 @@ public:
 	Job* ClaimJob(JobWorkerThread* owner);
 	bool IsQuitting() const;
 	void SetJobWokerThreadJobFlag(int workerId, uint8_t jobFlag);
+	int GetNumWorkers() const;
+	int GetNumIOWorkers() const;
+
+	// Calls function(index) for every index in [begin, end). Chunks of grainSize indexes are claimed dynamically by
+	// the workers and the calling thread, so uneven work still balances. Does not allocate.
+	template<typename T_Function>
+	void ParallelFor(int begin, int end, int grainSize, T_Function const& function);
+
+	// Folds elementFunction(index) over [begin, end) with combineFunction. Partial results are combined in chunk order,
+	// so the result only depends on grainSize and never on the number of workers.
+	template<typename T_Value, typename T_ElementFunction, typename T_CombineFunction>
+	T_Value ParallelReduce(int begin, int end, int grainSize, T_Value const& identity, T_ElementFunction const& elementFunction, T_CombineFunction const& combineFunction);
+protected:
+	WorkStealingQueue* const* GetQueuesForCurrentThread() const;
+	Job* ClaimComputeJob(WorkStealingQueue* const* ownQueues, unsigned int& stealSeed, uint8_t jobFlag);
+	Job* StealJob(WorkStealingQueue const* thiefQueue, JobPriority priority, unsigned int& stealSeed);
+	Job* ClaimSharedJob(uint8_t jobFlag);
+	Job* ClaimIOJob();
+	Job* ClaimJobForCurrentThread();
+	void ScheduleRunnableJob(Job* runnableJob);
+	void ExecuteJob(Job* jobToExecute);
+	void TakeDependentJobs(Job* finishedJob, std::vector<Job*>& out_dependentJobs);
+	void ScheduleDependentJobs(std::vector<Job*> const& dependentJobs);
+	void GatherCompletedJobs();
+	void MarkJobRetrieved(Job* retrievedJob);
+	void RecycleJob(Job* jobToRecycle);
 protected:
 	std::vector<JobWorkerThread*> m_workers;
+	std::vector<JobWorkerThread*> m_ioWorkers;
 	JobConfig m_config;
 	std::atomic<bool> m_isQuitting = false;
 
-	std::deque<Job*> m_queuedJobs;
-	std::deque<Job*> m_executingJobs;
-	std::deque<Job*> m_completedJobs;
+	// Jobs queued from the thread that called Startup(); workers steal from it like any other worker queue
+	std::thread::id m_mainThreadId;
+	WorkStealingQueue* m_mainThreadQueues[NUM_COMPUTE_JOB_PRIORITIES] = {};
 
-	mutable std::mutex m_queuedJobsMutex;
-	mutable std::mutex m_executingJobsMutex;
+	// Lets idle workers skip scanning every victim for frame-critical work when there is none
+	std::atomic<int> m_numQueuedFrameCriticalJobs = 0;
+
+	// Jobs with a non-zero job flag, or queued from threads that own no work-stealing queue
+	JobList m_sharedQueuedJobs[NUM_COMPUTE_JOB_PRIORITIES];
+	std::atomic<int> m_numSharedQueuedJobs = 0;
+	mutable std::mutex m_sharedQueuedJobsMutex;
+
+	JobList m_queuedIOJobs;
+	std::atomic<int> m_numQueuedIOJobs = 0;
+	mutable std::mutex m_queuedIOJobsMutex;
+
+	// Workers push onto the lock-free stack; RetrieveJob moves them into the ordered list
+	std::atomic<Job*> m_completedJobsStack = nullptr;
+	JobList m_completedJobs;
+	JobList m_retrievedPooledJobs; // recycled at the next BeginFrame(), guarded by m_completedJobsMutex
 	mutable std::mutex m_completedJobsMutex;
-};
\ No newline at end of file
+
+	JobPool m_jobPool;
+};
+
+template<typename T_Job, typename... T_Args>
+T_Job* JobSystem::CreateJob(T_Args&&... args)
+{
+	static_assert(std::is_base_of<Job, T_Job>::value, "CreateJob only makes jobs");
+	static_assert(sizeof(T_Job) <= JOB_POOL_SLOT_SIZE, "Job is too big for a job pool slot");
+	static_assert(alignof(T_Job) <= alignof(std::max_align_t), "Job is over-aligned for a job pool slot");
+
+	T_Job* job = new (m_jobPool.AllocateSlot()) T_Job(std::forward<T_Args>(args)...);
+	job->m_isPooled = true;
+	return job;
+}
+
+constexpr int MAX_PARALLEL_HELPER_JOBS = 64;
+
+template<typename T_Function>
+class ParallelForJob : public Job
+{
+public:
+	virtual void Execute() override
+	{
+		while (true)
+		{
+			int chunkIndex = m_nextChunkIndex->fetch_add(1, std::memory_order_relaxed);
+			if (chunkIndex >= m_numChunks)
+			{
+				return;
+			}
+			int chunkBegin = m_begin + chunkIndex * m_grainSize;
+			int chunkEnd = chunkBegin + m_grainSize < m_end ? chunkBegin + m_grainSize : m_end;
+			for (int index = chunkBegin; index < chunkEnd; ++index)
+			{
+				(*m_function)(index);
+			}
+		}
+	}
+public:
+	T_Function const* m_function = nullptr;
+	std::atomic<int>* m_nextChunkIndex = nullptr;
+	int m_numChunks = 0;
+	int m_begin = 0;
+	int m_end = 0;
+	int m_grainSize = 1;
+};
+
+template<typename T_Function>
+void JobSystem::ParallelFor(int begin, int end, int grainSize, T_Function const& function)
+{
+	if (grainSize < 1)
+	{
+		grainSize = 1;
+	}
+	int numChunks = end > begin ? (end - begin + grainSize - 1) / grainSize : 0;
+	int numHelperJobs = numChunks - 1;
+	if (numHelperJobs > (int)m_workers.size())
+	{
+		numHelperJobs = (int)m_workers.size();
+	}
+	if (numHelperJobs > MAX_PARALLEL_HELPER_JOBS)
+	{
+		numHelperJobs = MAX_PARALLEL_HELPER_JOBS;
+	}
+	if (numHelperJobs <= 0)
+	{
+		for (int index = begin; index < end; ++index)
+		{
+			function(index);
+		}
+		return;
+	}
+
+	std::atomic<int> nextChunkIndex = 0;
+	ParallelForJob<T_Function> helperJobs[MAX_PARALLEL_HELPER_JOBS + 1];
+	for (int i = 0; i <= numHelperJobs; ++i)
+	{
+		ParallelForJob<T_Function>& helperJob = helperJobs[i];
+		helperJob.m_function = &function;
+		helperJob.m_nextChunkIndex = &nextChunkIndex;
+		helperJob.m_numChunks = numChunks;
+		helperJob.m_begin = begin;
+		helperJob.m_end = end;
+		helperJob.m_grainSize = grainSize;
+		helperJob.m_isRetrievable = false;
+		helperJob.m_priority = JobPriority::FRAME_CRITICAL; // the calling thread is blocked until they are done
+	}
+	for (int i = 0; i < numHelperJobs; ++i)
+	{
+		QueueJob(&helperJobs[i]);
+	}
+
+	// The calling thread takes chunks too, then helps out until every helper has finished
+	helperJobs[numHelperJobs].Execute();
+	for (int i = 0; i < numHelperJobs; ++i)
+	{
+		WaitFor(&helperJobs[i]);
+	}
+}
+
+template<typename T_Value, typename T_ElementFunction, typename T_CombineFunction>
+T_Value JobSystem::ParallelReduce(int begin, int end, int grainSize, T_Value const& identity, T_ElementFunction const& elementFunction, T_CombineFunction const& combineFunction)
+{
+	if (grainSize < 1)
+	{
+		grainSize = 1;
+	}
+	int numChunks = end > begin ? (end - begin + grainSize - 1) / grainSize : 0;
+	std::vector<T_Value> chunkResults(numChunks, identity);
+	ParallelFor(0, numChunks, 1, [&](int chunkIndex)
+		{
+			int chunkBegin = begin + chunkIndex * grainSize;
+			int chunkEnd = chunkBegin + grainSize < end ? chunkBegin + grainSize : end;
+			T_Value chunkResult = identity;
+			for (int index = chunkBegin; index < chunkEnd; ++index)
+			{
+				chunkResult = combineFunction(chunkResult, elementFunction(index));
+			}
+			chunkResults[chunkIndex] = chunkResult;
+		});
+
+	T_Value result = identity;
+	for (int chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
+	{
+		result = combineFunction(result, chunkResults[chunkIndex]);
+	}
+	return result;
+}
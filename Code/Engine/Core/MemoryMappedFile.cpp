@@ -0,0 +1,183 @@
+#include "Engine/Core/MemoryMappedFile.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN		// Always #define this before #including <windows.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint64_t GetMappingOffsetGranularity()
+{
+#if defined(_WIN32)
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return (uint64_t)systemInfo.dwAllocationGranularity;
+#else
+    return (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+bool MemoryMappedFile::Open(std::string const& filePath, bool mapWholeFile)
+{
+    Close();
+#if defined(_WIN32)
+    HANDLE fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize))
+    {
+        CloseHandle(fileHandle);
+        return false;
+    }
+    m_fileHandle = fileHandle;
+    m_fileSize = (uint64_t)fileSize.QuadPart;
+
+    // Windows refuses to map an empty file, and there is nothing to read from one anyway
+    if (m_fileSize > 0)
+    {
+        m_mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mappingHandle == nullptr)
+        {
+            Close();
+            return false;
+        }
+    }
+#else
+    int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        return false;
+    }
+    struct stat fileStats;
+    if (fstat(fileDescriptor, &fileStats) != 0)
+    {
+        close(fileDescriptor);
+        return false;
+    }
+    m_fileDescriptor = fileDescriptor;
+    m_fileSize = (uint64_t)fileStats.st_size;
+#endif
+
+    if (mapWholeFile && m_fileSize > 0)
+    {
+        if ((uint64_t)(size_t)m_fileSize != m_fileSize)
+        {
+            ERROR_RECOVERABLE(Stringf("%s is too big to map at once, open it for streaming instead", filePath.c_str()));
+            Close();
+            return false;
+        }
+        m_wholeFileData = MapView(0, (size_t)m_fileSize);
+        if (m_wholeFileData == nullptr)
+        {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void MemoryMappedFile::Close()
+{
+    UnmapView();
+    m_wholeFileData = nullptr;
+    m_fileSize = 0;
+#if defined(_WIN32)
+    if (m_mappingHandle)
+    {
+        CloseHandle(m_mappingHandle);
+        m_mappingHandle = nullptr;
+    }
+    if (m_fileHandle)
+    {
+        CloseHandle(m_fileHandle);
+        m_fileHandle = nullptr;
+    }
+#else
+    if (m_fileDescriptor >= 0)
+    {
+        close(m_fileDescriptor);
+        m_fileDescriptor = -1;
+    }
+#endif
+}
+
+bool MemoryMappedFile::IsOpen() const
+{
+#if defined(_WIN32)
+    return m_fileHandle != nullptr;
+#else
+    return m_fileDescriptor >= 0;
+#endif
+}
+
+uint64_t MemoryMappedFile::GetFileSize() const
+{
+    return m_fileSize;
+}
+
+unsigned char const* MemoryMappedFile::GetData() const
+{
+    return m_wholeFileData;
+}
+
+unsigned char const* MemoryMappedFile::MapView(uint64_t fileOffset, size_t numBytes)
+{
+    if (!IsOpen() || numBytes == 0 || fileOffset + numBytes > m_fileSize)
+    {
+        ERROR_RECOVERABLE("Tried to map a view outside of the file");
+        return nullptr;
+    }
+    UnmapView();
+    m_wholeFileData = nullptr;
+
+    // Views have to start on the OS granularity, so map a little extra in front and skip over it
+    static uint64_t const s_offsetGranularity = GetMappingOffsetGranularity();
+    uint64_t alignedOffset = fileOffset - (fileOffset % s_offsetGranularity);
+    size_t leadingBytes = (size_t)(fileOffset - alignedOffset);
+    size_t viewSize = leadingBytes + numBytes;
+#if defined(_WIN32)
+    void* viewBase = MapViewOfFile(m_mappingHandle, FILE_MAP_READ, (DWORD)(alignedOffset >> 32), (DWORD)(alignedOffset & 0xFFFFFFFFull), viewSize);
+    if (viewBase == nullptr)
+    {
+        return nullptr;
+    }
+#else
+    void* viewBase = mmap(nullptr, viewSize, PROT_READ, MAP_PRIVATE, m_fileDescriptor, (off_t)alignedOffset);
+    if (viewBase == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    madvise(viewBase, viewSize, MADV_SEQUENTIAL);
+#endif
+    m_viewBase = viewBase;
+    m_viewSize = viewSize;
+    return static_cast<unsigned char const*>(viewBase) + leadingBytes;
+}
+
+void MemoryMappedFile::UnmapView()
+{
+    if (m_viewBase == nullptr)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(m_viewBase);
+#else
+    munmap(m_viewBase, m_viewSize);
+#endif
+    m_viewBase = nullptr;
+    m_viewSize = 0;
+}
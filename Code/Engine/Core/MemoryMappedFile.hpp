@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+// Read-only memory mapping of a file, so parsers can read straight out of the OS page cache with no copy.
+// Either maps the whole file up front, or maps one view (window) at a time for files too big to map at once.
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile() = default;
+    ~MemoryMappedFile();
+    MemoryMappedFile(MemoryMappedFile const& copy) = delete;
+    void operator=(MemoryMappedFile const& copy) = delete;
+
+    bool Open(std::string const& filePath, bool mapWholeFile = true);
+    void Close();
+    bool IsOpen() const;
+    uint64_t GetFileSize() const;
+    unsigned char const* GetData() const; // the whole file, or nullptr unless opened with mapWholeFile
+
+    // Replaces the current view with one covering [fileOffset, fileOffset + numBytes). The pointer stays valid until
+    // the next MapView() or Close().
+    unsigned char const* MapView(uint64_t fileOffset, size_t numBytes);
+
+private:
+    void UnmapView();
+
+private:
+    uint64_t m_fileSize = 0;
+    unsigned char const* m_wholeFileData = nullptr;
+    void* m_viewBase = nullptr; // what the OS handed back, aligned down from the requested offset
+    size_t m_viewSize = 0;
+#if defined(_WIN32)
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#else
+    int m_fileDescriptor = -1;
+#endif
+};
@@ -1,19 +1,81 @@
 #include "Engine/Core/NamedProperties.hpp"
 #include "Engine/Core/EventSystem.hpp"
 
-std::map<HashedCaseInsensitiveString, TypePropertyBase*> const NamedProperties::GetProperties() const
+NamedProperty::NamedProperty(HashedCaseInsensitiveString const& name, NamedPropertyType const* type, void const* value)
+    :m_name(name)
+    ,m_type(type)
 {
-    return m_properties;
+    m_type->m_copyConstruct(m_value, value);
 }
 
-NamedProperties::~NamedProperties()
+NamedProperty::NamedProperty(NamedProperty const& copy)
+    :m_name(copy.m_name)
+    ,m_type(copy.m_type)
+{
+    m_type->m_copyConstruct(m_value, copy.m_value);
+}
+
+NamedProperty::NamedProperty(NamedProperty&& moveFrom)
+    :m_name(moveFrom.m_name)
+    ,m_type(moveFrom.m_type)
+{
+    m_type->m_moveConstruct(m_value, moveFrom.m_value);
+}
+
+NamedProperty::~NamedProperty()
+{
+    m_type->m_destroy(m_value);
+}
+
+std::string const& NamedProperty::GetName() const
+{
+    return m_name.GetOriginalString();
+}
+
+std::string const NamedProperty::GetValueAsString() const
+{
+    return m_type->m_toString(m_value);
+}
+
+NamedProperties::NamedProperties(NamedProperties const& copy)
+{
+    *this = copy;
+}
+
+NamedProperties& NamedProperties::operator=(NamedProperties const& copy)
 {
-    for (auto iter : m_properties) 
+    if (this == &copy)
     {
-        delete iter.second;
+        return *this;
     }
+    Clear();
+    ReserveProperties(copy.m_numProperties);
+    NamedProperty* properties = GetPropertyArray();
+    NamedProperty const* copyProperties = copy.GetPropertyArray();
+    for (int i = 0; i < copy.m_numProperties; ++i)
+    {
+        new (&properties[i]) NamedProperty(copyProperties[i]);
+    }
+    m_numProperties = copy.m_numProperties;
+    return *this;
+}
 
-    m_properties.clear();
+std::map<HashedCaseInsensitiveString, std::string> const NamedProperties::GetProperties() const
+{
+    std::map<HashedCaseInsensitiveString, std::string> properties;
+    NamedProperty const* propertyArray = GetPropertyArray();
+    for (int i = 0; i < m_numProperties; ++i)
+    {
+        properties[propertyArray[i].m_name] = propertyArray[i].GetValueAsString();
+    }
+    return properties;
+}
+
+NamedProperties::~NamedProperties()
+{
+    Clear();
+    ::operator delete(m_heapProperties);
+    m_heapProperties = nullptr;
 }
 
 
@@ -36,3 +98,100 @@ void NamedProperties::SetValue(std::string const& keyName, char const* value)
 {
     SetValue<std::string>(keyName, value);
 }
+
+int NamedProperties::GetNumProperties() const
+{
+    return m_numProperties;
+}
+
+NamedProperty const& NamedProperties::GetPropertyAtIndex(int index) const
+{
+    return GetPropertyArray()[index];
+}
+
+void NamedProperties::Clear()
+{
+    // Keeps the capacity, so refilling the same args every frame doesn't allocate
+    NamedProperty* properties = GetPropertyArray();
+    for (int i = 0; i < m_numProperties; ++i)
+    {
+        properties[i].~NamedProperty();
+    }
+    m_numProperties = 0;
+}
+
+NamedProperty* NamedProperties::GetPropertyArray()
+{
+    return m_heapProperties ? m_heapProperties : std::launder(reinterpret_cast<NamedProperty*>(m_inlineProperties));
+}
+
+NamedProperty const* NamedProperties::GetPropertyArray() const
+{
+    return m_heapProperties ? m_heapProperties : std::launder(reinterpret_cast<NamedProperty const*>(m_inlineProperties));
+}
+
+int NamedProperties::FindProperty(unsigned int keyHash, char const* keyName, int& out_insertIndex) const
+{
+    // Binary search for the first property with this hash, then walk the (almost always single) hash matches
+    NamedProperty const* properties = GetPropertyArray();
+    int low = 0;
+    int high = m_numProperties;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (properties[middle].m_name.GetHash() < keyHash)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    int index = low;
+    for (; index < m_numProperties && properties[index].m_name.GetHash() == keyHash; ++index)
+    {
+        if (_stricmp(properties[index].m_name.c_str(), keyName) == 0)
+        {
+            return index;
+        }
+    }
+    out_insertIndex = index;
+    return -1;
+}
+
+void NamedProperties::InsertProperty(int index, std::string const& keyName, NamedPropertyType const* type, void const* value)
+{
+    ReserveProperties(m_numProperties + 1);
+    NamedProperty* properties = GetPropertyArray();
+    for (int i = m_numProperties; i > index; --i)
+    {
+        new (&properties[i]) NamedProperty(std::move(properties[i - 1]));
+        properties[i - 1].~NamedProperty();
+    }
+    new (&properties[index]) NamedProperty(HashedCaseInsensitiveString(keyName), type, value);
+    ++m_numProperties;
+}
+
+void NamedProperties::ReserveProperties(int capacity)
+{
+    if (capacity <= m_propertyCapacity)
+    {
+        return;
+    }
+    int newCapacity = m_propertyCapacity * 2;
+    while (newCapacity < capacity)
+    {
+        newCapacity *= 2;
+    }
+    NamedProperty* oldProperties = GetPropertyArray();
+    NamedProperty* newProperties = static_cast<NamedProperty*>(::operator new(sizeof(NamedProperty) * newCapacity));
+    for (int i = 0; i < m_numProperties; ++i)
+    {
+        new (&newProperties[i]) NamedProperty(std::move(oldProperties[i]));
+        oldProperties[i].~NamedProperty();
+    }
+    ::operator delete(m_heapProperties);
+    m_heapProperties = newProperties;
+    m_propertyCapacity = newCapacity;
+}
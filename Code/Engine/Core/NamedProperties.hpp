@@ -1,52 +1,124 @@
 #pragma once
 #include "Engine/Core/StringUtils.hpp"
 #include <map>
+#include <new>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Core/HashedCaseInsensitiveString.hpp"
 #include "Engine/Core/XmlUtils.hpp"
-class TypePropertyBase
+
+constexpr size_t NAMED_PROPERTY_INLINE_VALUE_SIZE = 32; // fits a std::string, so event args never allocate for values
+constexpr int NUM_INLINE_NAMED_PROPERTIES = 4;
+
+// Per-type operations for a stored value. There is exactly one per type, so its address doubles as the type ID
+// and a type check is a pointer compare instead of a dynamic_cast.
+struct NamedPropertyType
 {
-public:
-    virtual ~TypePropertyBase() = default;
-    virtual std::string const GetAsString() const = 0;
-    virtual TypePropertyBase* Clone() const = 0;
+    void (*m_copyConstruct)(void* destination, void const* source);
+    void (*m_moveConstruct)(void* destination, void* source);
+    void (*m_destroy)(void* value);
+    std::string const (*m_toString)(void const* value);
 };
 
+// Values up to NAMED_PROPERTY_INLINE_VALUE_SIZE live inside the property, bigger ones are boxed on the heap
 template<typename T>
-class TypeProperty : public TypePropertyBase
+struct NamedPropertyOps
 {
-    friend class NamedProperties;
-private:
-    TypeProperty(T const& initializeValue)
-        :m_data(initializeValue)
-    {
+    static constexpr bool IS_INLINE = sizeof(T) <= NAMED_PROPERTY_INLINE_VALUE_SIZE && alignof(T) <= alignof(std::max_align_t);
 
+    static T* GetValue(void* storage)
+    {
+        if constexpr (IS_INLINE)
+        {
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
+        else
+        {
+            return *reinterpret_cast<T**>(storage);
+        }
     }
-    virtual std::string const GetAsString() const override
-    { 
-        return ToString(m_data); 
+    static T const* GetValue(void const* storage)
+    {
+        return GetValue(const_cast<void*>(storage));
     }
-
-    virtual TypeProperty<T>* Clone() const override 
+    static void CopyConstruct(void* destination, void const* source)
+    {
+        if constexpr (IS_INLINE)
+        {
+            new (destination) T(*GetValue(source));
+        }
+        else
+        {
+            *reinterpret_cast<T**>(destination) = new T(*GetValue(source));
+        }
+    }
+    static void MoveConstruct(void* destination, void* source)
+    {
+        if constexpr (IS_INLINE)
+        {
+            new (destination) T(std::move(*GetValue(source)));
+        }
+        else
+        {
+            *reinterpret_cast<T**>(destination) = *reinterpret_cast<T**>(source);
+            *reinterpret_cast<T**>(source) = nullptr;
+        }
+    }
+    static void Destroy(void* value)
     {
-        return new TypeProperty<T>(m_data);
+        if constexpr (IS_INLINE)
+        {
+            GetValue(value)->~T();
+        }
+        else
+        {
+            delete GetValue(value);
+        }
+    }
+    static std::string const ConvertToString(void const* value)
+    {
+        return ToString(*GetValue(value));
     }
+};
+
+template<typename T>
+inline constexpr NamedPropertyType NAMED_PROPERTY_TYPE =
+{
+    &NamedPropertyOps<T>::CopyConstruct,
+    &NamedPropertyOps<T>::MoveConstruct,
+    &NamedPropertyOps<T>::Destroy,
+    &NamedPropertyOps<T>::ConvertToString
+};
+
+class NamedProperty
+{
+    friend class NamedProperties;
+public:
+    NamedProperty(HashedCaseInsensitiveString const& name, NamedPropertyType const* type, void const* value);
+    NamedProperty(NamedProperty const& copy);
+    NamedProperty(NamedProperty&& moveFrom);
+    ~NamedProperty();
+    void operator=(NamedProperty const& copy) = delete;
+
+    std::string const& GetName() const;
+    std::string const GetValueAsString() const;
 private:
-    T m_data;
+    HashedCaseInsensitiveString m_name;
+    NamedPropertyType const* m_type = nullptr;
+    alignas(std::max_align_t) unsigned char m_value[NAMED_PROPERTY_INLINE_VALUE_SIZE];
 };
 
+// Flat property bag: properties sit in an array sorted by key hash, the first few inside the object itself,
+// so small event args are built, copied and read without touching the heap.
 class NamedProperties
 {
 public:
     NamedProperties() = default;
-    NamedProperties(NamedProperties const& copy)
-    {
-        for (auto& pair : copy.m_properties) 
-        {
-            m_properties[pair.first] = pair.second->Clone();
-        }
-    }
-    std::map<HashedCaseInsensitiveString, TypePropertyBase*> const GetProperties() const;
+    NamedProperties(NamedProperties const& copy);
+    NamedProperties& operator=(NamedProperties const& copy);
+    std::map<HashedCaseInsensitiveString, std::string> const GetProperties() const; // values as strings
     ~NamedProperties();
     void PopulateFromXmlElementAttributes(XmlElement const& element);
     template<typename T>
@@ -56,74 +128,66 @@ public:
 
     void SetValue(std::string const& keyName, char const* value);
     std::string GetValue(std::string const& keyNameString, char const* val) const;
-private:
-    std::map<HashedCaseInsensitiveString, TypePropertyBase*> m_properties;
 
+    int GetNumProperties() const;
+    NamedProperty const& GetPropertyAtIndex(int index) const;
+    void Clear();
+private:
+    NamedProperty* GetPropertyArray();
+    NamedProperty const* GetPropertyArray() const;
+    int FindProperty(unsigned int keyHash, char const* keyName, int& out_insertIndex) const;
+    void InsertProperty(int index, std::string const& keyName, NamedPropertyType const* type, void const* value);
+    void ReserveProperties(int capacity);
+private:
+    int m_numProperties = 0;
+    int m_propertyCapacity = NUM_INLINE_NAMED_PROPERTIES;
+    NamedProperty* m_heapProperties = nullptr; // only once there are more than NUM_INLINE_NAMED_PROPERTIES
+    alignas(NamedProperty) unsigned char m_inlineProperties[sizeof(NamedProperty) * NUM_INLINE_NAMED_PROPERTIES];
 };
 
 template<typename T>
 void NamedProperties::SetValue(std::string const& keyName, T const& value)
 {
-    //HashedCaseInsensitiveString keyName(keyNameString);
-    auto found = m_properties.find(keyName);
-    if (found == m_properties.end()) // the value doesn't exit yet; 
+    int insertIndex = 0;
+    int foundIndex = FindProperty(HashedCaseInsensitiveString::GenerateCaseInsensitiveHash(keyName.c_str()), keyName.c_str(), insertIndex);
+    if (foundIndex < 0) // the value doesn't exist yet
     {
-        HashedCaseInsensitiveString hashKey(keyName);
-        m_properties[hashKey] = new TypeProperty<T>(value);
+        InsertProperty(insertIndex, keyName, &NAMED_PROPERTY_TYPE<T>, &value);
+        return;
     }
-    else //Already Exit
+
+    NamedProperty& property = GetPropertyArray()[foundIndex];
+    if (property.m_type == &NAMED_PROPERTY_TYPE<T>)
     {
-        
-        TypeProperty<T>* asSameType = dynamic_cast<TypeProperty<T>*> (found->second);
-        if (found->first.GetOriginalString().compare(keyName) == 0)
-        {
-            if (asSameType != nullptr)
-            {
-                asSameType->m_data = value;
-            }
-            else
-            {
-                delete found->second;
-                m_properties[keyName] = new TypeProperty<T>(value);
-            }
-        }
-        else
-        {
-            HashedCaseInsensitiveString hashKey(keyName);
-            m_properties[hashKey] = new TypeProperty<T>(value);
-        }
+        *NamedPropertyOps<T>::GetValue(property.m_value) = value;
+    }
+    else
+    {
+        property.m_type->m_destroy(property.m_value);
+        property.m_type = &NAMED_PROPERTY_TYPE<T>;
+        property.m_type->m_copyConstruct(property.m_value, &value);
     }
 }
 
 template<typename T>
 T NamedProperties::GetValue(std::string const& keyNameString, T const& defaultValue) const
 {
-    HashedCaseInsensitiveString keyName(keyNameString);
-    auto found = m_properties.find(keyName);
-    if (found == m_properties.end())
+    int insertIndex = 0;
+    int foundIndex = FindProperty(HashedCaseInsensitiveString::GenerateCaseInsensitiveHash(keyNameString.c_str()), keyNameString.c_str(), insertIndex);
+    if (foundIndex < 0)
     {
         return defaultValue;
     }
-    else
-    {
 
-        TypeProperty<T>* asTypeCastPtr = dynamic_cast<TypeProperty<T>*> (found->second);
-        if (asTypeCastPtr != nullptr)
-        {
-            return asTypeCastPtr->m_data;
-        }
-        else
-        {
-            TypeProperty<std::string>* asStringPtr = dynamic_cast<TypeProperty<std::string>*>(found->second);
-            if (asStringPtr == nullptr)
-            {
-                ERROR_RECOVERABLE(Stringf("Asked for NamedProperty failed"));
-                return defaultValue;
-            }
-            else
-            {
-                return StringToValue(asStringPtr->m_data, defaultValue);
-            }
-        }
+    NamedProperty const& property = GetPropertyArray()[foundIndex];
+    if (property.m_type == &NAMED_PROPERTY_TYPE<T>)
+    {
+        return *NamedPropertyOps<T>::GetValue(property.m_value);
+    }
+    if (property.m_type == &NAMED_PROPERTY_TYPE<std::string>)
+    {
+        return StringToValue(*NamedPropertyOps<std::string>::GetValue(property.m_value), defaultValue);
     }
+    ERROR_RECOVERABLE(Stringf("Asked for NamedProperty failed"));
+    return defaultValue;
 }
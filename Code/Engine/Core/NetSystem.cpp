@@ -321,7 +321,7 @@ void NetSystem::Send(std::string const& data, EventArgs& args)
 	for (auto property : properties)
 	{
 		m_sendQueue.push_back(' ');
-		std::string propertyString = property.first.GetOriginalString()+'='+ property.second->GetAsString();
+		std::string propertyString = property.first.GetOriginalString()+'='+ property.second;
 		for (char c: propertyString)
 		{
 			m_sendQueue.push_back(c);
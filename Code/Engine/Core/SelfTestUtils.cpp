@@ -0,0 +1,44 @@
+#include "Engine/Core/SelfTestUtils.hpp"
+#include "Engine/Math/RandomNumberGenerator.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/StringUtils.hpp"
+
+Vec3 RollSelfTestDirection3D(RandomNumberGenerator& rng, bool includeAxisPlanes)
+{
+	Vec3 direction;
+	do
+	{
+		direction = rng.RollRandomVector3DInRange(Vec3(-1.f, -1.f, -1.f), Vec3(1.f, 1.f, 1.f));
+		int axisCase = includeAxisPlanes ? rng.RollRandomIntLessThan(6) : -1;
+		if (axisCase == 0)
+		{
+			direction.z = 0.f;
+		}
+		else if (axisCase == 1)
+		{
+			direction.x = 0.f;
+			direction.y = -0.f;
+		}
+	} while (direction.GetLengthSquared() < 0.01f);
+	return direction.GetNormalized();
+}
+
+void ReportSelfTestMismatch(int& numMismatches, char const* what, int caseIndex, float fastValue, float referenceValue)
+{
+	if (numMismatches < SELF_TEST_MAX_REPORTED_MISMATCHES)
+	{
+		DebuggerPrintf("Self test mismatch: %s case %d, got %.9g, expected %.9g\n", what, caseIndex, fastValue, referenceValue);
+	}
+	++numMismatches;
+}
+
+void ReportSelfTestResult(char const* testName, bool didPass)
+{
+	if (g_theConsole)
+	{
+		g_theConsole->AddLine(didPass ? DevConsole::INFO_MAJOR : DevConsole::INFO_ERROR, Stringf("%s: %s", testName, didPass ? "passed" : "FAILED (see debugger output)"));
+	}
+	DebuggerPrintf("%s: %s\n", testName, didPass ? "passed" : "FAILED");
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "Engine/Math/Vec3.hpp"
+
+// Helpers shared by the self tests the dev console runs
+class RandomNumberGenerator;
+
+constexpr int SELF_TEST_MAX_REPORTED_MISMATCHES = 8;
+
+// A random unit direction. With includeAxisPlanes, a share of them lie in an axis plane or along an axis, where slab
+// tests divide by zero.
+Vec3 RollSelfTestDirection3D(RandomNumberGenerator& rng, bool includeAxisPlanes = false);
+
+// Prints the first SELF_TEST_MAX_REPORTED_MISMATCHES mismatches with DebuggerPrintf and counts them all
+void ReportSelfTestMismatch(int& numMismatches, char const* what, int caseIndex, float fastValue, float referenceValue);
+
+// One line per test in the dev console (when there is one) and the debugger output
+void ReportSelfTestResult(char const* testName, bool didPass);
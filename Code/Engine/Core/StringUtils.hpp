@@ -9,7 +9,6 @@ struct Vec3;
 struct Rgba8;
 struct IntVec2;
 struct EulerAngles;
-class TypePropertyBase;
 Strings SplitStringOnDelimiter(std::string const& originalString, char delimiterToSplitOn = ',', bool removeEmpty = false);
 int SplitStringOnDelimiter(Strings & out_splitString, std::string const& originalString, std::string const& delimiterToSplitOn);
 Strings SplitStringOnDelimiter(std::string const& originalString, std::string const& delimiterToSplitOn, bool removeEmpty);
@@ -2,6 +2,21 @@
 #include "VertexUtils.hpp"
 #include "Engine/Math/MathUtils.hpp"
 #include "EngineCommon.hpp"
+#include "Engine/Core/JobSystem.hpp"
+#include <cfloat>
+#include <memory>
+constexpr int PARALLEL_VERTEX_TRANSFORM_MIN_VERTS = 32768; // below this the job overhead outweighs the transform itself
+constexpr int PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE = 8192;
+constexpr int PARALLEL_TANGENT_SPACE_MIN_TRIANGLES = 16384;
+constexpr int PARALLEL_TANGENT_SPACE_MIN_WORKERS = 3; // the parallel gather does about twice the work of the serial scatter
+constexpr int TANGENT_SPACE_TRIANGLES_PER_BLOCK = 4096;
+constexpr int TANGENT_SPACE_SERIAL_BATCH_SIZE = 64;
+constexpr int TANGENT_SPACE_VERTS_PER_BLOCK = 8192;
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VERTEX_UTILS_HAS_SSE_PATH // SSE2 is part of the x64 baseline, so no runtime check is needed
+#include <immintrin.h>
+#endif
 void TransformVertexArrayXY3D(int numVerts, Vertex_PCU* verts, float uniformScaleXY, float rotationDegreesAboutZ, Vec2 const& translationXY)
 {
 	for (int vertIndex = 0; vertIndex < numVerts; ++vertIndex)
@@ -687,86 +702,247 @@ void AddVertsForArrow3D(std::vector<Vertex_PCU>& verts, Vec3 const& startPos, Ve
 	AddVertsForCone3D(verts, startPos + 0.8f * (endPos - startPos), endPos, radius*1.5f, color, uvMins, uvMaxs, numSlices);
 }
 
-struct TriangleInVertexUtils
+// Plain floats so big arrays of these are not zeroed first and SIMD lanes can be stored straight in
+struct TangentSpaceFace
 {
-	TriangleInVertexUtils(){}
-	unsigned int m_vertexIndexes[3] = {0,0,0};
+	float m_normal[3];
+	float m_tangent[3];
+	float m_bitangent[3];
+	bool m_hasTangent; // false when the UVs are degenerate
 };
 
-void CalculateTangentSpaceBasisVectors(std::vector<Vertex_PCUTBN>& verts, std::vector<unsigned int>& indexes, bool computeNormals , bool computeTangents)
+// The same arithmetic in the same order as the SSE path below, so both give bitwise identical results
+static void CalculateTangentSpaceFace(TangentSpaceFace& out_face, std::vector<Vertex_PCUTBN> const& verts, unsigned int const* triangleIndexes)
 {
-	std::vector<TriangleInVertexUtils> triangles;
-	triangles.reserve(indexes.size() / 3);
-	for (int i = 0; i < (int)indexes.size(); i += 3) 
-	{
-		TriangleInVertexUtils triangle;
-		triangle.m_vertexIndexes[0] = indexes[i];
-		triangle.m_vertexIndexes[1] = indexes[i + 1];
-		triangle.m_vertexIndexes[2] = indexes[i + 2];
-		triangles.push_back(triangle);
-	}
+	Vertex_PCUTBN const& vert0 = verts[triangleIndexes[0]];
+	Vertex_PCUTBN const& vert1 = verts[triangleIndexes[1]];
+	Vertex_PCUTBN const& vert2 = verts[triangleIndexes[2]];
+	Vec3 e0 = vert1.m_position - vert0.m_position;
+	Vec3 e1 = vert2.m_position - vert0.m_position;
+	Vec3 normal = CrossProduct3D(e0, e1).GetNormalized();
+
+	float deltaU0 = vert1.m_uvTexCoords.x - vert0.m_uvTexCoords.x;
+	float deltaU1 = vert2.m_uvTexCoords.x - vert0.m_uvTexCoords.x;
+	float deltaV0 = vert1.m_uvTexCoords.y - vert0.m_uvTexCoords.y;
+	float deltaV1 = vert2.m_uvTexCoords.y - vert0.m_uvTexCoords.y;
+	float r = 1.f / ((deltaV1 * deltaU0) - (deltaU1 * deltaV0));
+	Vec3 tangent = (r * ((deltaV1 * e0) - (deltaV0 * e1))).GetNormalized();
+	Vec3 bitangent = (r * ((deltaU0 * e1) - (deltaU1 * e0))).GetNormalized();
+
+	out_face.m_normal[0] = normal.x;
+	out_face.m_normal[1] = normal.y;
+	out_face.m_normal[2] = normal.z;
+	out_face.m_tangent[0] = tangent.x;
+	out_face.m_tangent[1] = tangent.y;
+	out_face.m_tangent[2] = tangent.z;
+	out_face.m_bitangent[0] = bitangent.x;
+	out_face.m_bitangent[1] = bitangent.y;
+	out_face.m_bitangent[2] = bitangent.z;
+	out_face.m_hasTangent = fabsf(r) >= FLT_EPSILON && fabsf(r) <= FLT_MAX;
+}
 
-	for (auto& triangle : triangles)
-	{
-		Vec3 p0 = verts[triangle.m_vertexIndexes[0]].m_position;
-		Vec3 p1 = verts[triangle.m_vertexIndexes[1]].m_position;
-		Vec3 p2 = verts[triangle.m_vertexIndexes[2]].m_position;
-		Vec3 e0 = p1 - p0;
-		Vec3 e1 = p2 - p0;
+#if defined(VERTEX_UTILS_HAS_SSE_PATH)
+static inline void NormalizeVec3_SSE(__m128& x, __m128& y, __m128& z)
+{
+	__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+	__m128 scale = _mm_div_ps(_mm_set1_ps(1.f), length);
+	__m128 isNonZero = _mm_cmpgt_ps(length, _mm_setzero_ps());
+	x = _mm_or_ps(_mm_and_ps(isNonZero, _mm_mul_ps(x, scale)), _mm_andnot_ps(isNonZero, x));
+	y = _mm_or_ps(_mm_and_ps(isNonZero, _mm_mul_ps(y, scale)), _mm_andnot_ps(isNonZero, y));
+	z = _mm_or_ps(_mm_and_ps(isNonZero, _mm_mul_ps(z, scale)), _mm_andnot_ps(isNonZero, z));
+}
 
-		if (computeNormals) 
+// Four triangles per iteration: the AoS vertexes are gathered into SoA registers, one lane per triangle
+static void CalculateTangentSpaceFaces4_SSE(TangentSpaceFace* out_faces, std::vector<Vertex_PCUTBN> const& verts, unsigned int const* indexes)
+{
+	alignas(16) float components[3][5][4]; // corner, position xyz and uv, lane
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		for (int corner = 0; corner < 3; ++corner)
 		{
-			Vec3 faceNormal = CrossProduct3D(e0, e1).GetNormalized();
-			verts[triangle.m_vertexIndexes[0]].m_normal += faceNormal;
-			verts[triangle.m_vertexIndexes[1]].m_normal += faceNormal;
-			verts[triangle.m_vertexIndexes[2]].m_normal += faceNormal;
+			Vertex_PCUTBN const& vert = verts[indexes[lane * 3 + corner]];
+			components[corner][0][lane] = vert.m_position.x;
+			components[corner][1][lane] = vert.m_position.y;
+			components[corner][2][lane] = vert.m_position.z;
+			components[corner][3][lane] = vert.m_uvTexCoords.x;
+			components[corner][4][lane] = vert.m_uvTexCoords.y;
 		}
+	}
 
-		if (computeTangents) 
+	__m128 p0x = _mm_load_ps(components[0][0]);
+	__m128 p0y = _mm_load_ps(components[0][1]);
+	__m128 p0z = _mm_load_ps(components[0][2]);
+	__m128 e0x = _mm_sub_ps(_mm_load_ps(components[1][0]), p0x);
+	__m128 e0y = _mm_sub_ps(_mm_load_ps(components[1][1]), p0y);
+	__m128 e0z = _mm_sub_ps(_mm_load_ps(components[1][2]), p0z);
+	__m128 e1x = _mm_sub_ps(_mm_load_ps(components[2][0]), p0x);
+	__m128 e1y = _mm_sub_ps(_mm_load_ps(components[2][1]), p0y);
+	__m128 e1z = _mm_sub_ps(_mm_load_ps(components[2][2]), p0z);
+
+	__m128 normalX = _mm_sub_ps(_mm_mul_ps(e0y, e1z), _mm_mul_ps(e1y, e0z));
+	__m128 normalY = _mm_sub_ps(_mm_mul_ps(e0z, e1x), _mm_mul_ps(e1z, e0x));
+	__m128 normalZ = _mm_sub_ps(_mm_mul_ps(e0x, e1y), _mm_mul_ps(e1x, e0y));
+	NormalizeVec3_SSE(normalX, normalY, normalZ);
+
+	__m128 u0 = _mm_load_ps(components[0][3]);
+	__m128 v0 = _mm_load_ps(components[0][4]);
+	__m128 deltaU0 = _mm_sub_ps(_mm_load_ps(components[1][3]), u0);
+	__m128 deltaU1 = _mm_sub_ps(_mm_load_ps(components[2][3]), u0);
+	__m128 deltaV0 = _mm_sub_ps(_mm_load_ps(components[1][4]), v0);
+	__m128 deltaV1 = _mm_sub_ps(_mm_load_ps(components[2][4]), v0);
+	__m128 r = _mm_div_ps(_mm_set1_ps(1.f), _mm_sub_ps(_mm_mul_ps(deltaV1, deltaU0), _mm_mul_ps(deltaU1, deltaV0)));
+	__m128 absR = _mm_andnot_ps(_mm_set1_ps(-0.f), r);
+	int hasTangentMask = _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(absR, _mm_set1_ps(FLT_EPSILON)), _mm_cmple_ps(absR, _mm_set1_ps(FLT_MAX))));
+
+	__m128 tangentX = _mm_mul_ps(r, _mm_sub_ps(_mm_mul_ps(deltaV1, e0x), _mm_mul_ps(deltaV0, e1x)));
+	__m128 tangentY = _mm_mul_ps(r, _mm_sub_ps(_mm_mul_ps(deltaV1, e0y), _mm_mul_ps(deltaV0, e1y)));
+	__m128 tangentZ = _mm_mul_ps(r, _mm_sub_ps(_mm_mul_ps(deltaV1, e0z), _mm_mul_ps(deltaV0, e1z)));
+	NormalizeVec3_SSE(tangentX, tangentY, tangentZ);
+	__m128 bitangentX = _mm_mul_ps(r, _mm_sub_ps(_mm_mul_ps(deltaU0, e1x), _mm_mul_ps(deltaU1, e0x)));
+	__m128 bitangentY = _mm_mul_ps(r, _mm_sub_ps(_mm_mul_ps(deltaU0, e1y), _mm_mul_ps(deltaU1, e0y)));
+	__m128 bitangentZ = _mm_mul_ps(r, _mm_sub_ps(_mm_mul_ps(deltaU0, e1z), _mm_mul_ps(deltaU1, e0z)));
+	NormalizeVec3_SSE(bitangentX, bitangentY, bitangentZ);
+
+	alignas(16) float lanes[9][4];
+	_mm_store_ps(lanes[0], normalX);
+	_mm_store_ps(lanes[1], normalY);
+	_mm_store_ps(lanes[2], normalZ);
+	_mm_store_ps(lanes[3], tangentX);
+	_mm_store_ps(lanes[4], tangentY);
+	_mm_store_ps(lanes[5], tangentZ);
+	_mm_store_ps(lanes[6], bitangentX);
+	_mm_store_ps(lanes[7], bitangentY);
+	_mm_store_ps(lanes[8], bitangentZ);
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		TangentSpaceFace& face = out_faces[lane];
+		for (int axis = 0; axis < 3; ++axis)
 		{
-			float u0 = verts[triangle.m_vertexIndexes[0]].m_uvTexCoords.x;
-			float u1 = verts[triangle.m_vertexIndexes[1]].m_uvTexCoords.x;
-			float u2 = verts[triangle.m_vertexIndexes[2]].m_uvTexCoords.x;
-			float v0 = verts[triangle.m_vertexIndexes[0]].m_uvTexCoords.y;
-			float v1 = verts[triangle.m_vertexIndexes[1]].m_uvTexCoords.y;
-			float v2 = verts[triangle.m_vertexIndexes[2]].m_uvTexCoords.y;
-			float deltaU0 = u1 - u0;
-			float deltaU1 = u2 - u0;
-			float deltaV0 = v1 - v0;
-			float deltaV1 = v2 - v0;
-			float r = 1.f / ((deltaV1 * deltaU0) - (deltaU1 * deltaV0));
-			if (fabs(r) < FLT_EPSILON)
-			{
-				continue;
-			}
-			Vec3 sharedTangent = r * ((deltaV1 * e0) - (deltaV0 * e1));
-			sharedTangent.Normalize();
-			Vec3 sharedBitangent = r * ((deltaU0 * e1) - (deltaU1 * e0));
-			sharedBitangent.Normalize();
-			verts[triangle.m_vertexIndexes[0]].m_tangent += sharedTangent;
-			verts[triangle.m_vertexIndexes[1]].m_tangent += sharedTangent;
-			verts[triangle.m_vertexIndexes[2]].m_tangent += sharedTangent;
-			verts[triangle.m_vertexIndexes[0]].m_bitangent += sharedBitangent;
-			verts[triangle.m_vertexIndexes[1]].m_bitangent += sharedBitangent;
-			verts[triangle.m_vertexIndexes[2]].m_bitangent += sharedBitangent;
+			face.m_normal[axis] = lanes[axis][lane];
+			face.m_tangent[axis] = lanes[3 + axis][lane];
+			face.m_bitangent[axis] = lanes[6 + axis][lane];
 		}
+		face.m_hasTangent = (hasTangentMask & (1 << lane)) != 0;
+	}
+}
+#endif
+
+static void CalculateTangentSpaceFacesInRange(TangentSpaceFace* out_faces, std::vector<Vertex_PCUTBN> const& verts, unsigned int const* indexes, int numTriangles)
+{
+	int triangleIndex = 0;
+#if defined(VERTEX_UTILS_HAS_SSE_PATH)
+	for (; triangleIndex + 4 <= numTriangles; triangleIndex += 4)
+	{
+		CalculateTangentSpaceFaces4_SSE(&out_faces[triangleIndex], verts, &indexes[triangleIndex * 3]);
+	}
+#endif
+	for (; triangleIndex < numTriangles; ++triangleIndex)
+	{
+		CalculateTangentSpaceFace(out_faces[triangleIndex], verts, &indexes[triangleIndex * 3]);
+	}
+}
+
+// Component by component, exactly what Vec3::operator+= does
+static inline void AccumulateTangentSpaceFace(Vertex_PCUTBN& vert, TangentSpaceFace const& face, bool computeNormals, bool computeTangents)
+{
+	if (computeNormals)
+	{
+		vert.m_normal.x += face.m_normal[0];
+		vert.m_normal.y += face.m_normal[1];
+		vert.m_normal.z += face.m_normal[2];
 	}
+	if (computeTangents && face.m_hasTangent)
+	{
+		vert.m_tangent.x += face.m_tangent[0];
+		vert.m_tangent.y += face.m_tangent[1];
+		vert.m_tangent.z += face.m_tangent[2];
+		vert.m_bitangent.x += face.m_bitangent[0];
+		vert.m_bitangent.y += face.m_bitangent[1];
+		vert.m_bitangent.z += face.m_bitangent[2];
+	}
+}
 
-	for (auto& vert : verts) 
+static void FinishTangentSpaceVertex(Vertex_PCUTBN& vert, bool computeNormals, bool computeTangents)
+{
+	if (computeNormals)
 	{
-		if (computeNormals) 
+		vert.m_normal.Normalize();
+	}
+	if (computeTangents)
+	{
+		vert.m_tangent.Normalize();
+		vert.m_bitangent.Normalize();
+		vert.m_normal.Normalize();
+		vert.m_tangent = (vert.m_tangent - vert.m_normal * DotProduct3D(vert.m_normal, vert.m_tangent)).GetNormalized();
+		vert.m_bitangent = CrossProduct3D(vert.m_normal, vert.m_tangent).GetNormalized();
+	}
+}
+
+// Every vertex sums its faces in triangle order on both paths, so the result is bitwise the same whether it runs
+// serially or on any number of workers
+void CalculateTangentSpaceBasisVectors(std::vector<Vertex_PCUTBN>& verts, std::vector<unsigned int>& indexes, bool computeNormals , bool computeTangents, JobSystem* jobSystem)
+{
+	int numTriangles = (int)(indexes.size() / 3);
+	int numVerts = (int)verts.size();
+
+	if (!jobSystem || jobSystem->GetNumWorkers() < PARALLEL_TANGENT_SPACE_MIN_WORKERS || numTriangles < PARALLEL_TANGENT_SPACE_MIN_TRIANGLES)
+	{
+		// Faces are scattered into their vertexes a small batch at a time, straight from the cache
+		TangentSpaceFace faces[TANGENT_SPACE_SERIAL_BATCH_SIZE];
+		for (int firstTriangle = 0; firstTriangle < numTriangles; firstTriangle += TANGENT_SPACE_SERIAL_BATCH_SIZE)
 		{
-			vert.m_normal.Normalize();
+			int numBatchTriangles = numTriangles - firstTriangle < TANGENT_SPACE_SERIAL_BATCH_SIZE ? numTriangles - firstTriangle : TANGENT_SPACE_SERIAL_BATCH_SIZE;
+			CalculateTangentSpaceFacesInRange(faces, verts, &indexes[firstTriangle * 3], numBatchTriangles);
+			for (int triangleIndex = 0; triangleIndex < numBatchTriangles; ++triangleIndex)
+			{
+				unsigned int const* triangleIndexes = &indexes[(firstTriangle + triangleIndex) * 3];
+				AccumulateTangentSpaceFace(verts[triangleIndexes[0]], faces[triangleIndex], computeNormals, computeTangents);
+				AccumulateTangentSpaceFace(verts[triangleIndexes[1]], faces[triangleIndex], computeNormals, computeTangents);
+				AccumulateTangentSpaceFace(verts[triangleIndexes[2]], faces[triangleIndex], computeNormals, computeTangents);
+			}
 		}
-		if (computeTangents)
+		for (Vertex_PCUTBN& vert : verts)
 		{
-			vert.m_tangent.Normalize();
-			vert.m_bitangent.Normalize();
-			vert.m_normal.Normalize();
-			vert.m_tangent = (vert.m_tangent - vert.m_normal * DotProduct3D(vert.m_normal, vert.m_tangent)).GetNormalized();
-			vert.m_bitangent = CrossProduct3D(vert.m_normal, vert.m_tangent).GetNormalized();
+			FinishTangentSpaceVertex(vert, computeNormals, computeTangents);
 		}
+		return;
+	}
+
+	// In parallel the scatter would race, so faces are stored and each vertex gathers the triangles that touch it
+	std::unique_ptr<TangentSpaceFace[]> faces(new TangentSpaceFace[numTriangles]);
+	int numFaceBlocks = (numTriangles + TANGENT_SPACE_TRIANGLES_PER_BLOCK - 1) / TANGENT_SPACE_TRIANGLES_PER_BLOCK;
+	jobSystem->ParallelFor(0, numFaceBlocks, 1, [&](int blockIndex)
+		{
+			int firstTriangle = blockIndex * TANGENT_SPACE_TRIANGLES_PER_BLOCK;
+			int numBlockTriangles = numTriangles - firstTriangle < TANGENT_SPACE_TRIANGLES_PER_BLOCK ? numTriangles - firstTriangle : TANGENT_SPACE_TRIANGLES_PER_BLOCK;
+			CalculateTangentSpaceFacesInRange(&faces[firstTriangle], verts, &indexes[firstTriangle * 3], numBlockTriangles);
+		});
+
+	std::vector<unsigned int> firstCorners(numVerts + 1, 0);
+	for (int cornerIndex = 0; cornerIndex < numTriangles * 3; ++cornerIndex)
+	{
+		++firstCorners[indexes[cornerIndex] + 1];
+	}
+	for (int vertIndex = 0; vertIndex < numVerts; ++vertIndex)
+	{
+		firstCorners[vertIndex + 1] += firstCorners[vertIndex];
+	}
+	std::vector<unsigned int> cornerTriangles(numTriangles * 3);
+	std::vector<unsigned int> nextCorners(firstCorners.begin(), firstCorners.end() - 1);
+	for (int cornerIndex = 0; cornerIndex < numTriangles * 3; ++cornerIndex)
+	{
+		cornerTriangles[nextCorners[indexes[cornerIndex]]++] = (unsigned int)(cornerIndex / 3);
 	}
+
+	jobSystem->ParallelFor(0, numVerts, TANGENT_SPACE_VERTS_PER_BLOCK, [&](int vertIndex)
+		{
+			Vertex_PCUTBN& vert = verts[vertIndex];
+			for (unsigned int cornerIndex = firstCorners[vertIndex]; cornerIndex < firstCorners[vertIndex + 1]; ++cornerIndex)
+			{
+				AccumulateTangentSpaceFace(vert, faces[cornerTriangles[cornerIndex]], computeNormals, computeTangents);
+			}
+			FinishTangentSpaceVertex(vert, computeNormals, computeTangents);
+		});
 }
 
 void AddVertsForHexgonXY3D(std::vector<Vertex_PCU>& verts, std::vector<unsigned int>& indexes, Vec2 const& centerPos, float inradius, float thickness, Rgba8 const& color, bool isFilled, Rgba8 const& filledColor)
@@ -946,31 +1122,66 @@ void AddVertsForConvexLine2D(std::vector<Vertex_PCU>& verts, ConvexPoly2 const&
 
 void TransformVertexArray3D(std::vector<Vertex_PCU>& verts, Mat44 const& tranform)
 {
-	for (int vertIndex = 0; vertIndex < (int)verts.size(); ++vertIndex)
+	auto transformRange = [&](int firstVert, int numRangeVerts)
+		{
+			Vec3* positions = &verts[firstVert].m_position;
+			tranform.TransformPositions3D(positions, sizeof(Vertex_PCU), positions, sizeof(Vertex_PCU), numRangeVerts);
+		};
+	int numVerts = (int)verts.size();
+	if (g_theJobSystem && numVerts >= PARALLEL_VERTEX_TRANSFORM_MIN_VERTS)
 	{
-		Vec3& pos = verts[vertIndex].m_position;
-		pos = tranform.TransformPosition3D(pos);
+		int numChunks = (numVerts + PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE - 1) / PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE;
+		g_theJobSystem->ParallelFor(0, numChunks, 1, [&](int chunkIndex)
+			{
+				int firstVert = chunkIndex * PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE;
+				transformRange(firstVert, numVerts - firstVert < PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE ? numVerts - firstVert : PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE);
+			});
+		return;
+	}
+	if (numVerts > 0)
+	{
+		transformRange(0, numVerts);
 	}
-
 }
 
 void TransformVertexArray3D(std::vector<Vertex_PCUTBN>& verts, Mat44 const& tranform)
 {
-	for (int vertIndex = 0; vertIndex < (int)verts.size(); ++vertIndex)
+	// Rotation and uniform scale keep normals perpendicular to the surface; anything else needs the inverse transpose
+	Mat44 normalTransform = tranform.IsConformal3D() ? tranform : tranform.GetInverseTranspose3D();
+	auto transformRange = [&](int firstVert, int numRangeVerts)
+		{
+			Vec3* positions = &verts[firstVert].m_position;
+			Vec3* normals = &verts[firstVert].m_normal;
+			tranform.TransformPositions3D(positions, sizeof(Vertex_PCUTBN), positions, sizeof(Vertex_PCUTBN), numRangeVerts);
+			normalTransform.TransformVectorQuantities3D(normals, sizeof(Vertex_PCUTBN), normals, sizeof(Vertex_PCUTBN), numRangeVerts);
+			for (int vertIndex = firstVert; vertIndex < firstVert + numRangeVerts; ++vertIndex)
+			{
+				verts[vertIndex].m_normal.Normalize();
+			}
+		};
+	int numVerts = (int)verts.size();
+	if (g_theJobSystem && numVerts >= PARALLEL_VERTEX_TRANSFORM_MIN_VERTS)
 	{
-		Vec3& pos = verts[vertIndex].m_position;
-		pos = tranform.TransformPosition3D(pos);
-		Vec3& normal = verts[vertIndex].m_normal;
-		normal = tranform.TransformVectorQuantity3D(normal).GetNormalized();
+		int numChunks = (numVerts + PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE - 1) / PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE;
+		g_theJobSystem->ParallelFor(0, numChunks, 1, [&](int chunkIndex)
+			{
+				int firstVert = chunkIndex * PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE;
+				transformRange(firstVert, numVerts - firstVert < PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE ? numVerts - firstVert : PARALLEL_VERTEX_TRANSFORM_GRAIN_SIZE);
+			});
+		return;
+	}
+	if (numVerts > 0)
+	{
+		transformRange(0, numVerts);
 	}
 }
 
 void TransformVertexArrayInRange3D(int startIndex, int endIndex, std::vector<Vertex_PCU>& verts, Mat44 const& tranform)
 {
-	for (int vertIndex = startIndex; vertIndex < endIndex; ++vertIndex)
+	if (endIndex > startIndex)
 	{
-		Vec3& pos = verts[vertIndex].m_position;
-		pos = tranform.TransformPosition3D(pos);
+		Vec3* positions = &verts[startIndex].m_position;
+		tranform.TransformPositions3D(positions, sizeof(Vertex_PCU), positions, sizeof(Vertex_PCU), endIndex - startIndex);
 	}
 }
 
@@ -1002,4 +1213,142 @@ AABB2 GetVertexBounds2D(std::vector<Vertex_PCU> const& verts)
 	return AABB2(minX, minY,maxX,maxY);
 }
 
+AABB3 GetVertexBounds3D(std::vector<Vertex_PCUTBN> const& verts)
+{
+	if (verts.empty())
+	{
+		return AABB3(Vec3(), Vec3());
+	}
+	Vec3 mins = verts[0].m_position;
+	Vec3 maxs = verts[0].m_position;
+	for (int i = 1; i < (int)verts.size(); ++i)
+	{
+		Vec3 const& position = verts[i].m_position;
+		mins = Vec3(MinFloat(mins.x, position.x), MinFloat(mins.y, position.y), MinFloat(mins.z, position.z));
+		maxs = Vec3(MaxFloat(maxs.x, position.x), MaxFloat(maxs.y, position.y), MaxFloat(maxs.z, position.z));
+	}
+	return AABB3(mins, maxs);
+}
+
+static void PackDirection(short* out_packed, Vec3 const& direction)
+{
+	Vec2 octahedral = EncodeOctahedral(direction);
+	out_packed[0] = PackSignedNormalizedShort(octahedral.x);
+	out_packed[1] = PackSignedNormalizedShort(octahedral.y);
+}
+
+static Vec3 const UnpackDirection(short const* packed)
+{
+	return DecodeOctahedral(Vec2(UnpackSignedNormalizedShort(packed[0]), UnpackSignedNormalizedShort(packed[1])));
+}
+
+static short PackBitangentSign(Vertex_PCUTBN const& vert)
+{
+	return DotProduct3D(CrossProduct3D(vert.m_normal, vert.m_tangent), vert.m_bitangent) < 0.f ? -32767 : 32767;
+}
+
+static unsigned short QuantizePositionAxis(float value, float minValue, float maxValue)
+{
+	if (maxValue <= minValue)
+	{
+		return 0;
+	}
+	return (unsigned short)roundf(GetClampedZeroToOne((value - minValue) / (maxValue - minValue)) * 65535.f);
+}
+
+static float DequantizePositionAxis(unsigned short quantizedValue, float minValue, float maxValue)
+{
+	return minValue + ((float)quantizedValue / 65535.f) * (maxValue - minValue);
+}
+
+Vertex_PCUTBNPacked PackVertex(Vertex_PCUTBN const& vert)
+{
+	Vertex_PCUTBNPacked packedVert;
+	packedVert.m_position = vert.m_position;
+	packedVert.m_color = vert.m_color;
+	packedVert.m_uvTexCoords[0] = FloatToHalf(vert.m_uvTexCoords.x);
+	packedVert.m_uvTexCoords[1] = FloatToHalf(vert.m_uvTexCoords.y);
+	PackDirection(packedVert.m_normal, vert.m_normal);
+	PackDirection(packedVert.m_tangent, vert.m_tangent);
+	packedVert.m_bitangentSign = PackBitangentSign(vert);
+	return packedVert;
+}
+
+Vertex_PCUTBN UnpackVertex(Vertex_PCUTBNPacked const& packedVert)
+{
+	Vertex_PCUTBN vert;
+	vert.m_position = packedVert.m_position;
+	vert.m_color = packedVert.m_color;
+	vert.m_uvTexCoords = Vec2(HalfToFloat(packedVert.m_uvTexCoords[0]), HalfToFloat(packedVert.m_uvTexCoords[1]));
+	vert.m_normal = UnpackDirection(packedVert.m_normal);
+	vert.m_tangent = UnpackDirection(packedVert.m_tangent);
+	vert.m_bitangent = CrossProduct3D(vert.m_normal, vert.m_tangent) * UnpackSignedNormalizedShort(packedVert.m_bitangentSign);
+	return vert;
+}
+
+Vertex_PCUTBNQuantized QuantizeVertex(Vertex_PCUTBN const& vert, AABB3 const& bounds)
+{
+	Vertex_PCUTBNQuantized quantizedVert;
+	quantizedVert.m_position[0] = QuantizePositionAxis(vert.m_position.x, bounds.m_mins.x, bounds.m_maxs.x);
+	quantizedVert.m_position[1] = QuantizePositionAxis(vert.m_position.y, bounds.m_mins.y, bounds.m_maxs.y);
+	quantizedVert.m_position[2] = QuantizePositionAxis(vert.m_position.z, bounds.m_mins.z, bounds.m_maxs.z);
+	quantizedVert.m_bitangentSign = PackBitangentSign(vert);
+	quantizedVert.m_color = vert.m_color;
+	quantizedVert.m_uvTexCoords[0] = FloatToHalf(vert.m_uvTexCoords.x);
+	quantizedVert.m_uvTexCoords[1] = FloatToHalf(vert.m_uvTexCoords.y);
+	PackDirection(quantizedVert.m_normal, vert.m_normal);
+	PackDirection(quantizedVert.m_tangent, vert.m_tangent);
+	return quantizedVert;
+}
+
+Vertex_PCUTBN DequantizeVertex(Vertex_PCUTBNQuantized const& quantizedVert, AABB3 const& bounds)
+{
+	Vertex_PCUTBN vert;
+	vert.m_position.x = DequantizePositionAxis(quantizedVert.m_position[0], bounds.m_mins.x, bounds.m_maxs.x);
+	vert.m_position.y = DequantizePositionAxis(quantizedVert.m_position[1], bounds.m_mins.y, bounds.m_maxs.y);
+	vert.m_position.z = DequantizePositionAxis(quantizedVert.m_position[2], bounds.m_mins.z, bounds.m_maxs.z);
+	vert.m_color = quantizedVert.m_color;
+	vert.m_uvTexCoords = Vec2(HalfToFloat(quantizedVert.m_uvTexCoords[0]), HalfToFloat(quantizedVert.m_uvTexCoords[1]));
+	vert.m_normal = UnpackDirection(quantizedVert.m_normal);
+	vert.m_tangent = UnpackDirection(quantizedVert.m_tangent);
+	vert.m_bitangent = CrossProduct3D(vert.m_normal, vert.m_tangent) * UnpackSignedNormalizedShort(quantizedVert.m_bitangentSign);
+	return vert;
+}
+
+void PackVertexArray(std::vector<Vertex_PCUTBNPacked>& out_packedVerts, std::vector<Vertex_PCUTBN> const& verts)
+{
+	out_packedVerts.resize(verts.size());
+	for (int vertIndex = 0; vertIndex < (int)verts.size(); ++vertIndex)
+	{
+		out_packedVerts[vertIndex] = PackVertex(verts[vertIndex]);
+	}
+}
 
+void UnpackVertexArray(std::vector<Vertex_PCUTBN>& out_verts, std::vector<Vertex_PCUTBNPacked> const& packedVerts)
+{
+	out_verts.resize(packedVerts.size());
+	for (int vertIndex = 0; vertIndex < (int)packedVerts.size(); ++vertIndex)
+	{
+		out_verts[vertIndex] = UnpackVertex(packedVerts[vertIndex]);
+	}
+}
+
+AABB3 QuantizeVertexArray(std::vector<Vertex_PCUTBNQuantized>& out_quantizedVerts, std::vector<Vertex_PCUTBN> const& verts)
+{
+	AABB3 bounds = GetVertexBounds3D(verts);
+	out_quantizedVerts.resize(verts.size());
+	for (int vertIndex = 0; vertIndex < (int)verts.size(); ++vertIndex)
+	{
+		out_quantizedVerts[vertIndex] = QuantizeVertex(verts[vertIndex], bounds);
+	}
+	return bounds;
+}
+
+void DequantizeVertexArray(std::vector<Vertex_PCUTBN>& out_verts, std::vector<Vertex_PCUTBNQuantized> const& quantizedVerts, AABB3 const& bounds)
+{
+	out_verts.resize(quantizedVerts.size());
+	for (int vertIndex = 0; vertIndex < (int)quantizedVerts.size(); ++vertIndex)
+	{
+		out_verts[vertIndex] = DequantizeVertex(quantizedVerts[vertIndex], bounds);
+	}
+}
@@ -7,6 +7,7 @@
 #include "Engine/Math/AABB3.hpp"
 #include "Engine/Math/Mat44.hpp"
 #include "Engine/Math/Convex.hpp"
+#include "Engine/Core/EngineCommon.hpp"
 #include <vector>
 enum CubePoints
 {
@@ -55,12 +56,29 @@ void TransformVertexArray3D(std::vector<Vertex_PCU>& verts, Mat44 const& tranfor
 void TransformVertexArray3D(std::vector<Vertex_PCUTBN>& verts, Mat44 const& tranform);
 void TransformVertexArrayInRange3D(int startIndex, int endIndex, std::vector<Vertex_PCU>& verts, Mat44 const& tranform);
 AABB2 GetVertexBounds2D(std::vector<Vertex_PCU> const& verts);
+AABB3 GetVertexBounds3D(std::vector<Vertex_PCUTBN> const& verts);
 void AddVertsForCylinder3D(std::vector<Vertex_PCU>& verts, Vec3 const& start, Vec3 const& end, float radius, Rgba8 const& color = Rgba8::WHITE, Vec2 const& uvMins = Vec2(0.f, 0.f), Vec2 const& uvMaxs = Vec2(1.f, 1.f), int numSlices = 8);
 void AddVertsForCone3D(std::vector<Vertex_PCU>& verts, Vec3 const& start, Vec3 const& end, float radius, Rgba8 const& color = Rgba8::WHITE, Vec2 const& uvMins = Vec2(0.f, 0.f), Vec2 const& uvMaxs = Vec2(1.f, 1.f), int numSlices = 8);
 void AddVertsForArrow3D(std::vector<Vertex_PCU>& verts, Vec3 const& startPos, Vec3 const& endPos, float radius, Rgba8 const& color = Rgba8::WHITE, Vec2 const& uvMins = Vec2(0.f, 0.f), Vec2 const& uvMaxs = Vec2(1.f, 1.f), int numSlices = 8);
-void CalculateTangentSpaceBasisVectors(std::vector<Vertex_PCUTBN>& verts, std::vector<unsigned int>& indexes, bool computeNormals = true, bool computeTangents = true);
+// Big meshes are done on jobSystem when it has enough workers; the result is bitwise the same either way
+void CalculateTangentSpaceBasisVectors(std::vector<Vertex_PCUTBN>& verts, std::vector<unsigned int>& indexes, bool computeNormals = true, bool computeTangents = true, JobSystem* jobSystem = g_theJobSystem);
 void AddVertsForHexgonXY3D(std::vector<Vertex_PCU>& verts, std::vector<unsigned int>& indexes, Vec2 const& centerPos, float inradius, float thickness, Rgba8 const& color, bool isFilled = false, Rgba8 const& filledColor = Rgba8(0,0,0,255));
 void AddVertsForHexgonXY3D(std::vector<Vertex_PCU>& verts, Vec2 const& centerPos, float inradius, float thickness, Rgba8 const& color, bool isFilled = false, Rgba8 const& filledColor = Rgba8(0,0,0,255), float height = 0.f);
 void AddVertsForConvex2D(std::vector<Vertex_PCU>& verts, ConvexPoly2 const& convexPoly, Rgba8 const& fillColor, bool isDrawingLine = false, Rgba8 const& lineColor = Rgba8(0, 0, 0, 255), float lineThickness = 0.5f);
 void AddVertsForConvexLine2D(std::vector<Vertex_PCU>& verts, ConvexPoly2 const& convexPoly, Rgba8 const lineColor, float lineThickness);
-void AddVertsForConvex2D(std::vector<Vertex_PCU>& verts, ConvexHull2 const& convexHull, Rgba8 const& fillColor, bool isDrawingLine = false, Rgba8 const& lineColor = Rgba8(0, 0, 0, 255), float lineThickness = 0.5f);
\ No newline at end of file
+void AddVertsForConvex2D(std::vector<Vertex_PCU>& verts, ConvexHull2 const& convexHull, Rgba8 const& fillColor, bool isDrawingLine = false, Rgba8 const& lineColor = Rgba8(0, 0, 0, 255), float lineThickness = 0.5f);
+
+// Packed and quantized Vertex_PCUTBN. Round trip errors, checked by SelfTestVertexPacking ("CoreSelfTest" in the dev console):
+// normals and tangents within MAX_PACKED_DIRECTION_ERROR_DEGREES, UVs within |uv| / 2048 (half floats keep 11 significant
+// bits, down to 2^-14), quantized positions within bounds dimensions / 131070 per axis (plus float rounding). Bitangents come back as sign * cross(normal,
+// tangent), so they match only for orthonormal bases like CalculateTangentSpaceBasisVectors() makes; zero length normals
+// and tangents come back as unit vectors.
+constexpr float MAX_PACKED_DIRECTION_ERROR_DEGREES = 0.005f;
+Vertex_PCUTBNPacked PackVertex(Vertex_PCUTBN const& vert);
+Vertex_PCUTBN UnpackVertex(Vertex_PCUTBNPacked const& packedVert);
+Vertex_PCUTBNQuantized QuantizeVertex(Vertex_PCUTBN const& vert, AABB3 const& bounds);
+Vertex_PCUTBN DequantizeVertex(Vertex_PCUTBNQuantized const& quantizedVert, AABB3 const& bounds);
+void PackVertexArray(std::vector<Vertex_PCUTBNPacked>& out_packedVerts, std::vector<Vertex_PCUTBN> const& verts);
+void UnpackVertexArray(std::vector<Vertex_PCUTBN>& out_verts, std::vector<Vertex_PCUTBNPacked> const& packedVerts);
+AABB3 QuantizeVertexArray(std::vector<Vertex_PCUTBNQuantized>& out_quantizedVerts, std::vector<Vertex_PCUTBN> const& verts); // returns the bounds to dequantize with
+void DequantizeVertexArray(std::vector<Vertex_PCUTBN>& out_verts, std::vector<Vertex_PCUTBNQuantized> const& quantizedVerts, AABB3 const& bounds);
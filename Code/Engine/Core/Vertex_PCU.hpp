@@ -35,6 +35,31 @@ struct Vertex_PCUTBN
 	Vec3 m_normal;
 };
 
+// Vertex_PCUTBN in 32 bytes instead of 60: octahedral normal and tangent as snorm16 pairs, the bitangent as just its
+// handedness (rebuilt as sign * cross(normal, tangent)) and half float UVs. See PackVertex() in VertexUtils.
+struct Vertex_PCUTBNPacked
+{
+	Vec3 m_position;
+	Rgba8 m_color;
+	unsigned short m_uvTexCoords[2] = {};
+	short m_normal[2] = {};
+	short m_tangent[2] = {};
+	short m_bitangentSign = 32767; // snorm16, so it reads as +-1 on the GPU
+	unsigned short m_unused = 0;
+};
+
+// As Vertex_PCUTBNPacked but in 24 bytes, with the position quantized to 16 bits per axis inside the mesh bounds.
+// The bitangent sign fills out the position to four shorts. See QuantizeVertex() in VertexUtils.
+struct Vertex_PCUTBNQuantized
+{
+	unsigned short m_position[3] = {};
+	short m_bitangentSign = 32767;
+	Rgba8 m_color;
+	unsigned short m_uvTexCoords[2] = {};
+	short m_normal[2] = {};
+	short m_tangent[2] = {};
+};
+
 struct Vertex_PCU
 {
 public:
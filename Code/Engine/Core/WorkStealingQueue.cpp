@@ -0,0 +1,130 @@
+#include "Engine/Core/WorkStealingQueue.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+WorkStealingQueue::RingBuffer::RingBuffer(int64_t capacity)
+	:m_capacity(capacity)
+	,m_mask(capacity - 1)
+{
+	m_slots = new std::atomic<Job*>[capacity];
+}
+
+WorkStealingQueue::RingBuffer::~RingBuffer()
+{
+	delete[] m_slots;
+	m_slots = nullptr;
+}
+
+Job* WorkStealingQueue::RingBuffer::Get(int64_t index) const
+{
+	return m_slots[index & m_mask].load(std::memory_order_relaxed);
+}
+
+void WorkStealingQueue::RingBuffer::Put(int64_t index, Job* job)
+{
+	m_slots[index & m_mask].store(job, std::memory_order_relaxed);
+}
+
+WorkStealingQueue::RingBuffer* WorkStealingQueue::RingBuffer::Grow(int64_t bottom, int64_t top) const
+{
+	RingBuffer* grownBuffer = new RingBuffer(m_capacity * 2);
+	for (int64_t index = top; index < bottom; ++index)
+	{
+		grownBuffer->Put(index, Get(index));
+	}
+	return grownBuffer;
+}
+
+WorkStealingQueue::WorkStealingQueue(int64_t initialCapacity)
+{
+	GUARANTEE_OR_DIE(initialCapacity > 0 && (initialCapacity & (initialCapacity - 1)) == 0, "Work stealing queue capacity must be a power of two");
+	m_buffer.store(new RingBuffer(initialCapacity), std::memory_order_relaxed);
+}
+
+WorkStealingQueue::~WorkStealingQueue()
+{
+	delete m_buffer.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < m_retiredBuffers.size(); ++i)
+	{
+		delete m_retiredBuffers[i];
+	}
+	m_retiredBuffers.clear();
+}
+
+void WorkStealingQueue::Push(Job* job)
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	int64_t top = m_top.load(std::memory_order_acquire);
+	RingBuffer* buffer = m_buffer.load(std::memory_order_relaxed);
+
+	if (bottom - top > buffer->m_capacity - 1)
+	{
+		m_retiredBuffers.push_back(buffer);
+		buffer = buffer->Grow(bottom, top);
+		m_buffer.store(buffer, std::memory_order_release);
+	}
+
+	buffer->Put(bottom, job);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_bottom.store(bottom + 1, std::memory_order_relaxed);
+}
+
+Job* WorkStealingQueue::Pop()
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	RingBuffer* buffer = m_buffer.load(std::memory_order_relaxed);
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		// Queue was already empty, restore bottom
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = buffer->Get(bottom);
+	if (top == bottom)
+	{
+		// Last job in the queue, race against the stealers for it
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			job = nullptr;
+		}
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* WorkStealingQueue::Steal()
+{
+	int64_t top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+	{
+		return nullptr;
+	}
+
+	RingBuffer* buffer = m_buffer.load(std::memory_order_acquire);
+	Job* job = buffer->Get(top);
+	if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		// Lost the race against the owner or another stealer
+		return nullptr;
+	}
+	return job;
+}
+
+bool WorkStealingQueue::IsEmpty() const
+{
+	return GetApproximateSize() <= 0;
+}
+
+int64_t WorkStealingQueue::GetApproximateSize() const
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	int64_t top = m_top.load(std::memory_order_relaxed);
+	return bottom - top;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <cstdint>
+class Job;
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4324) // structure was padded due to alignment specifier - the padding is what keeps the ends apart
+#endif
+
+// Chase-Lev work-stealing deque. The owning thread pushes and pops at the bottom (LIFO),
+// any other thread may steal from the top (FIFO). Push/Pop/Steal are lock-free.
+class WorkStealingQueue
+{
+public:
+	explicit WorkStealingQueue(int64_t initialCapacity = 1024); // capacity must be a power of two
+	~WorkStealingQueue();
+	WorkStealingQueue(WorkStealingQueue const& copy) = delete;
+
+	void Push(Job* job);	// owner thread only
+	Job* Pop();				// owner thread only
+	Job* Steal();			// any thread
+	bool IsEmpty() const;
+	int64_t GetApproximateSize() const;
+
+private:
+	struct RingBuffer
+	{
+		explicit RingBuffer(int64_t capacity);
+		~RingBuffer();
+		Job* Get(int64_t index) const;
+		void Put(int64_t index, Job* job);
+		RingBuffer* Grow(int64_t bottom, int64_t top) const;
+
+		int64_t m_capacity = 0;
+		int64_t m_mask = 0;
+		std::atomic<Job*>* m_slots = nullptr;
+	};
+
+	// Each on its own cache line, so thieves bumping m_top don't keep invalidating the owner's m_bottom
+	alignas(64) std::atomic<int64_t> m_top = 0;
+	alignas(64) std::atomic<int64_t> m_bottom = 0;
+	alignas(64) std::atomic<RingBuffer*> m_buffer = nullptr;
+	std::vector<RingBuffer*> m_retiredBuffers; // stealers may still read an old buffer, so it lives until the queue dies
+};
+
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
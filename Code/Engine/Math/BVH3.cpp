@@ -0,0 +1,666 @@
+#include "BVH3.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include <algorithm>
+
+// Node bounds are grown by this much (relative to the coordinates) over the shapes' bounds, so rounding in the shapes'
+// own raycast and overlap functions can never put a hit just outside a node that gets culled
+constexpr float BVH3_BOUNDS_PADDING_FRACTION = 1e-5f;
+
+// Stands in for 1/0 in the slab test, so a ray lying in a slab's plane gets a huge t instead of 0 * inf = NaN
+constexpr float BVH3_HUGE_INVERSE_DIRECTION = 1e30f;
+
+int BVH3::AddAABB3(AABB3 const& box)
+{
+	BVH3Shape shape;
+	shape.m_type = BVH3ShapeType::AABB3;
+	shape.m_box = box;
+	return AddShape(shape);
+}
+
+int BVH3::AddOBB3(OBB3 const& orientedBox)
+{
+	BVH3Shape shape;
+	shape.m_type = BVH3ShapeType::OBB3;
+	shape.m_orientedBox = orientedBox;
+	return AddShape(shape);
+}
+
+int BVH3::AddSphere(Vec3 const& center, float radius)
+{
+	BVH3Shape shape;
+	shape.m_type = BVH3ShapeType::SPHERE;
+	shape.m_center = center;
+	shape.m_radius = radius;
+	return AddShape(shape);
+}
+
+int BVH3::AddZCylinder(Vec2 const& centerXY, FloatRange const& minMaxZ, float radius)
+{
+	BVH3Shape shape;
+	shape.m_type = BVH3ShapeType::Z_CYLINDER;
+	shape.m_center = Vec3(centerXY.x, centerXY.y, 0.f);
+	shape.m_radius = radius;
+	shape.m_minMaxZ = minMaxZ;
+	return AddShape(shape);
+}
+
+void BVH3::SetAABB3(int shapeId, AABB3 const& box)
+{
+	m_shapes[shapeId].m_box = box;
+	MarkShapeMoved(shapeId);
+}
+
+void BVH3::SetOBB3(int shapeId, OBB3 const& orientedBox)
+{
+	m_shapes[shapeId].m_orientedBox = orientedBox;
+	MarkShapeMoved(shapeId);
+}
+
+void BVH3::SetSphere(int shapeId, Vec3 const& center, float radius)
+{
+	m_shapes[shapeId].m_center = center;
+	m_shapes[shapeId].m_radius = radius;
+	MarkShapeMoved(shapeId);
+}
+
+void BVH3::SetZCylinder(int shapeId, Vec2 const& centerXY, FloatRange const& minMaxZ, float radius)
+{
+	m_shapes[shapeId].m_center = Vec3(centerXY.x, centerXY.y, 0.f);
+	m_shapes[shapeId].m_radius = radius;
+	m_shapes[shapeId].m_minMaxZ = minMaxZ;
+	MarkShapeMoved(shapeId);
+}
+
+void BVH3::Clear()
+{
+	m_shapes.clear();
+	m_nodes.clear();
+	m_shapeOrder.clear();
+	m_shapeLeaves.clear();
+	m_nodeParents.clear();
+	m_isNodeMoved.clear();
+	m_hasMovedShapes = false;
+}
+
+int BVH3::AddShape(BVH3Shape const& shape)
+{
+	m_shapes.push_back(shape);
+	m_shapeLeaves.push_back(-1);
+	return (int)m_shapes.size() - 1;
+}
+
+void BVH3::MarkShapeMoved(int shapeId)
+{
+	int leafIndex = m_shapeLeaves[shapeId];
+	if (leafIndex >= 0)
+	{
+		m_isNodeMoved[leafIndex] = 1;
+		m_hasMovedShapes = true;
+	}
+}
+
+AABB3 const BVH3::GetShapeBounds(int shapeId) const
+{
+	BVH3Shape const& shape = m_shapes[shapeId];
+	switch (shape.m_type)
+	{
+	case BVH3ShapeType::AABB3:
+		return shape.m_box;
+	case BVH3ShapeType::OBB3:
+	{
+		OBB3 const& orientedBox = shape.m_orientedBox;
+		Vec3 const& i = orientedBox.m_iBasisNormal;
+		Vec3 const& j = orientedBox.m_jBasisNormal;
+		Vec3 const& k = orientedBox.m_kBasisNormal;
+		Vec3 const& half = orientedBox.m_halfDimensions;
+		Vec3 extents(fabsf(i.x) * half.x + fabsf(j.x) * half.y + fabsf(k.x) * half.z,
+			fabsf(i.y) * half.x + fabsf(j.y) * half.y + fabsf(k.y) * half.z,
+			fabsf(i.z) * half.x + fabsf(j.z) * half.y + fabsf(k.z) * half.z);
+		return AABB3(orientedBox.m_center - extents, orientedBox.m_center + extents);
+	}
+	case BVH3ShapeType::SPHERE:
+	{
+		Vec3 extents(shape.m_radius, shape.m_radius, shape.m_radius);
+		return AABB3(shape.m_center - extents, shape.m_center + extents);
+	}
+	case BVH3ShapeType::Z_CYLINDER:
+		return AABB3(shape.m_center.x - shape.m_radius, shape.m_center.y - shape.m_radius, shape.m_minMaxZ.m_min,
+			shape.m_center.x + shape.m_radius, shape.m_center.y + shape.m_radius, shape.m_minMaxZ.m_max);
+	default:
+		ERROR_AND_DIE("Unknown BVH3 shape type");
+	}
+}
+
+static float GetSurfaceArea(float const* mins, float const* maxs)
+{
+	float dimX = maxs[0] - mins[0];
+	float dimY = maxs[1] - mins[1];
+	float dimZ = maxs[2] - mins[2];
+	return 2.f * (dimX * dimY + dimY * dimZ + dimZ * dimX);
+}
+
+static void GrowBounds(float* mins, float* maxs, AABB3 const& bounds)
+{
+	mins[0] = bounds.m_mins.x < mins[0] ? bounds.m_mins.x : mins[0];
+	mins[1] = bounds.m_mins.y < mins[1] ? bounds.m_mins.y : mins[1];
+	mins[2] = bounds.m_mins.z < mins[2] ? bounds.m_mins.z : mins[2];
+	maxs[0] = bounds.m_maxs.x > maxs[0] ? bounds.m_maxs.x : maxs[0];
+	maxs[1] = bounds.m_maxs.y > maxs[1] ? bounds.m_maxs.y : maxs[1];
+	maxs[2] = bounds.m_maxs.z > maxs[2] ? bounds.m_maxs.z : maxs[2];
+}
+
+static void PadBounds(float* mins, float* maxs)
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float magnitude = fabsf(mins[axis]) > fabsf(maxs[axis]) ? fabsf(mins[axis]) : fabsf(maxs[axis]);
+		float padding = BVH3_BOUNDS_PADDING_FRACTION * (magnitude + (maxs[axis] - mins[axis]) + 1.f);
+		mins[axis] -= padding;
+		maxs[axis] += padding;
+	}
+}
+
+static void ResetBounds(float* mins, float* maxs)
+{
+	mins[0] = mins[1] = mins[2] = FLT_MAX;
+	maxs[0] = maxs[1] = maxs[2] = -FLT_MAX;
+}
+
+void BVH3::SetNodeBoundsFromShapes(BVH3Node& node) const
+{
+	ResetBounds(node.m_mins, node.m_maxs);
+	for (int orderIndex = node.m_firstChildOrShape; orderIndex < node.m_firstChildOrShape + node.m_numShapes; ++orderIndex)
+	{
+		GrowBounds(node.m_mins, node.m_maxs, GetShapeBounds(m_shapeOrder[orderIndex]));
+	}
+	PadBounds(node.m_mins, node.m_maxs);
+}
+
+void BVH3::Build()
+{
+	int numShapes = (int)m_shapes.size();
+	m_nodes.clear();
+	m_nodeParents.clear();
+	m_shapeOrder.resize(numShapes);
+	m_hasMovedShapes = false;
+	if (numShapes == 0)
+	{
+		m_isNodeMoved.clear();
+		return;
+	}
+
+	std::vector<AABB3> shapeBounds(numShapes);
+	std::vector<Vec3> shapeCentroids(numShapes);
+	for (int shapeId = 0; shapeId < numShapes; ++shapeId)
+	{
+		m_shapeOrder[shapeId] = shapeId;
+		shapeBounds[shapeId] = GetShapeBounds(shapeId);
+		shapeCentroids[shapeId] = (shapeBounds[shapeId].m_mins + shapeBounds[shapeId].m_maxs) * 0.5f;
+	}
+
+	m_nodes.reserve(2 * numShapes);
+	m_nodeParents.reserve(2 * numShapes);
+	m_nodes.push_back(BVH3Node());
+	m_nodeParents.push_back(-1);
+	BuildNode(0, 0, numShapes, 0, shapeBounds, shapeCentroids);
+
+	m_isNodeMoved.assign(m_nodes.size(), 0);
+	for (int nodeIndex = 0; nodeIndex < (int)m_nodes.size(); ++nodeIndex)
+	{
+		BVH3Node const& node = m_nodes[nodeIndex];
+		for (int orderIndex = node.m_firstChildOrShape; node.m_numShapes > 0 && orderIndex < node.m_firstChildOrShape + node.m_numShapes; ++orderIndex)
+		{
+			m_shapeLeaves[m_shapeOrder[orderIndex]] = nodeIndex;
+		}
+	}
+}
+
+// Binned SAH: centroids are dropped into BVH3_NUM_SAH_BINS bins along each axis and the split between bins with the
+// lowest (shapes x surface area) on both sides wins, unless keeping the node as a leaf is cheaper still
+void BVH3::BuildNode(int nodeIndex, int firstShape, int numShapes, int depth, std::vector<AABB3> const& shapeBounds, std::vector<Vec3> const& shapeCentroids)
+{
+	float mins[3];
+	float maxs[3];
+	float centroidMins[3];
+	float centroidMaxs[3];
+	ResetBounds(mins, maxs);
+	ResetBounds(centroidMins, centroidMaxs);
+	for (int orderIndex = firstShape; orderIndex < firstShape + numShapes; ++orderIndex)
+	{
+		int shapeId = m_shapeOrder[orderIndex];
+		GrowBounds(mins, maxs, shapeBounds[shapeId]);
+		GrowBounds(centroidMins, centroidMaxs, AABB3(shapeCentroids[shapeId], shapeCentroids[shapeId]));
+	}
+	float nodeArea = GetSurfaceArea(mins, maxs);
+	PadBounds(mins, maxs);
+	BVH3Node& node = m_nodes[nodeIndex];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		node.m_mins[axis] = mins[axis];
+		node.m_maxs[axis] = maxs[axis];
+	}
+	node.m_firstChildOrShape = firstShape;
+	node.m_numShapes = numShapes;
+	if (numShapes <= BVH3_MAX_SHAPES_PER_LEAF || depth >= BVH3_MAX_DEPTH)
+	{
+		return;
+	}
+
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float extent = centroidMaxs[axis] - centroidMins[axis];
+		if (extent <= 0.f)
+		{
+			continue;
+		}
+		float binsPerUnit = (float)BVH3_NUM_SAH_BINS / extent;
+		int binCounts[BVH3_NUM_SAH_BINS] = {};
+		float binMins[BVH3_NUM_SAH_BINS][3];
+		float binMaxs[BVH3_NUM_SAH_BINS][3];
+		for (int binIndex = 0; binIndex < BVH3_NUM_SAH_BINS; ++binIndex)
+		{
+			ResetBounds(binMins[binIndex], binMaxs[binIndex]);
+		}
+		for (int orderIndex = firstShape; orderIndex < firstShape + numShapes; ++orderIndex)
+		{
+			int shapeId = m_shapeOrder[orderIndex];
+			float centroid[3] = { shapeCentroids[shapeId].x, shapeCentroids[shapeId].y, shapeCentroids[shapeId].z };
+			int binIndex = (int)((centroid[axis] - centroidMins[axis]) * binsPerUnit);
+			binIndex = binIndex < BVH3_NUM_SAH_BINS ? binIndex : BVH3_NUM_SAH_BINS - 1;
+			++binCounts[binIndex];
+			GrowBounds(binMins[binIndex], binMaxs[binIndex], shapeBounds[shapeId]);
+		}
+
+		// Sweep from the right to get the cost of every right side, then from the left to finish each split's cost
+		float rightCosts[BVH3_NUM_SAH_BINS];
+		float sweepMins[3];
+		float sweepMaxs[3];
+		ResetBounds(sweepMins, sweepMaxs);
+		int sweepCount = 0;
+		for (int binIndex = BVH3_NUM_SAH_BINS - 1; binIndex > 0; --binIndex)
+		{
+			sweepCount += binCounts[binIndex];
+			if (binCounts[binIndex] > 0)
+			{
+				GrowBounds(sweepMins, sweepMaxs, AABB3(binMins[binIndex][0], binMins[binIndex][1], binMins[binIndex][2], binMaxs[binIndex][0], binMaxs[binIndex][1], binMaxs[binIndex][2]));
+			}
+			rightCosts[binIndex] = sweepCount > 0 ? sweepCount * GetSurfaceArea(sweepMins, sweepMaxs) : 0.f;
+		}
+		ResetBounds(sweepMins, sweepMaxs);
+		sweepCount = 0;
+		for (int split = 1; split < BVH3_NUM_SAH_BINS; ++split)
+		{
+			sweepCount += binCounts[split - 1];
+			if (binCounts[split - 1] > 0)
+			{
+				GrowBounds(sweepMins, sweepMaxs, AABB3(binMins[split - 1][0], binMins[split - 1][1], binMins[split - 1][2], binMaxs[split - 1][0], binMaxs[split - 1][1], binMaxs[split - 1][2]));
+			}
+			if (sweepCount == 0 || sweepCount == numShapes)
+			{
+				continue;
+			}
+			float cost = sweepCount * GetSurfaceArea(sweepMins, sweepMaxs) + rightCosts[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	int numLeftShapes = 0;
+	if (bestAxis >= 0)
+	{
+		if (bestCost >= numShapes * nodeArea && numShapes <= 2 * BVH3_MAX_SHAPES_PER_LEAF)
+		{
+			return;
+		}
+		float binsPerUnit = (float)BVH3_NUM_SAH_BINS / (centroidMaxs[bestAxis] - centroidMins[bestAxis]);
+		float centroidMin = centroidMins[bestAxis];
+		int axis = bestAxis;
+		int* middle = std::partition(&m_shapeOrder[firstShape], &m_shapeOrder[firstShape] + numShapes, [&](int shapeId)
+			{
+				float centroid[3] = { shapeCentroids[shapeId].x, shapeCentroids[shapeId].y, shapeCentroids[shapeId].z };
+				int binIndex = (int)((centroid[axis] - centroidMin) * binsPerUnit);
+				return binIndex < bestSplit;
+			});
+		numLeftShapes = (int)(middle - &m_shapeOrder[firstShape]);
+	}
+	if (numLeftShapes == 0 || numLeftShapes == numShapes)
+	{
+		// Every centroid in one place: any split is as good as another
+		numLeftShapes = numShapes / 2;
+	}
+
+	int leftChild = (int)m_nodes.size();
+	m_nodes.push_back(BVH3Node());
+	m_nodes.push_back(BVH3Node());
+	m_nodeParents.push_back(nodeIndex);
+	m_nodeParents.push_back(nodeIndex);
+	m_nodes[nodeIndex].m_firstChildOrShape = leftChild;
+	m_nodes[nodeIndex].m_numShapes = 0;
+	BuildNode(leftChild, firstShape, numLeftShapes, depth + 1, shapeBounds, shapeCentroids);
+	BuildNode(leftChild + 1, firstShape + numLeftShapes, numShapes - numLeftShapes, depth + 1, shapeBounds, shapeCentroids);
+}
+
+void BVH3::Refit()
+{
+	GUARANTEE_OR_DIE(IsUpToDate(), "BVH3 has shapes added since its last Build()");
+	if (!m_hasMovedShapes)
+	{
+		return;
+	}
+	// Children always come after their parent, so one backwards pass refits bottom up
+	for (int nodeIndex = (int)m_nodes.size() - 1; nodeIndex >= 0; --nodeIndex)
+	{
+		if (!m_isNodeMoved[nodeIndex])
+		{
+			continue;
+		}
+		m_isNodeMoved[nodeIndex] = 0;
+		BVH3Node& node = m_nodes[nodeIndex];
+		if (node.m_numShapes > 0)
+		{
+			SetNodeBoundsFromShapes(node);
+		}
+		else
+		{
+			BVH3Node const& left = m_nodes[node.m_firstChildOrShape];
+			BVH3Node const& right = m_nodes[node.m_firstChildOrShape + 1];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				node.m_mins[axis] = left.m_mins[axis] < right.m_mins[axis] ? left.m_mins[axis] : right.m_mins[axis];
+				node.m_maxs[axis] = left.m_maxs[axis] > right.m_maxs[axis] ? left.m_maxs[axis] : right.m_maxs[axis];
+			}
+		}
+		if (m_nodeParents[nodeIndex] >= 0)
+		{
+			m_isNodeMoved[m_nodeParents[nodeIndex]] = 1;
+		}
+	}
+	m_hasMovedShapes = false;
+}
+
+RaycastResult3D BVH3::RaycastShape(int shapeId, Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength) const
+{
+	BVH3Shape const& shape = m_shapes[shapeId];
+	switch (shape.m_type)
+	{
+	case BVH3ShapeType::AABB3:
+		return RaycastVsAABB3D(rayStart, rayForwardNormal, rayLength, shape.m_box);
+	case BVH3ShapeType::OBB3:
+		return RaycastVsOBB3D(rayStart, rayForwardNormal, rayLength, shape.m_orientedBox);
+	case BVH3ShapeType::SPHERE:
+		return RaycastVsSphere3D(rayStart, rayForwardNormal, rayLength, shape.m_center, shape.m_radius);
+	case BVH3ShapeType::Z_CYLINDER:
+		return RaycastVsCylinderZ3D(rayStart, rayForwardNormal, rayLength, Vec2(shape.m_center.x, shape.m_center.y), shape.m_minMaxZ, shape.m_radius);
+	default:
+		ERROR_AND_DIE("Unknown BVH3 shape type");
+	}
+}
+
+bool BVH3::DoesShapeOverlapSphere(int shapeId, Vec3 const& sphereCenter, float sphereRadius) const
+{
+	BVH3Shape const& shape = m_shapes[shapeId];
+	switch (shape.m_type)
+	{
+	case BVH3ShapeType::AABB3:
+		return DoSpheresAndAABB3DOverlap(sphereCenter, sphereRadius, shape.m_box);
+	case BVH3ShapeType::OBB3:
+		return DoSphereAndOBB3DOverlap(sphereCenter, sphereRadius, shape.m_orientedBox);
+	case BVH3ShapeType::SPHERE:
+		return DoSpheresOverLap(sphereCenter, sphereRadius, shape.m_center, shape.m_radius);
+	case BVH3ShapeType::Z_CYLINDER:
+		return DoZCylinderAndSphereOverlap3D(Vec2(shape.m_center.x, shape.m_center.y), shape.m_radius, shape.m_minMaxZ, sphereCenter, sphereRadius);
+	default:
+		ERROR_AND_DIE("Unknown BVH3 shape type");
+	}
+}
+
+bool BVH3::DoesShapeOverlapAABB3(int shapeId, AABB3 const& box) const
+{
+	BVH3Shape const& shape = m_shapes[shapeId];
+	switch (shape.m_type)
+	{
+	case BVH3ShapeType::AABB3:
+		return DoAABBsOverlap3D(shape.m_box, box);
+	case BVH3ShapeType::OBB3:
+		return DoAABB3AndOBB3DOverlap(box, shape.m_orientedBox);
+	case BVH3ShapeType::SPHERE:
+		return DoSpheresAndAABB3DOverlap(shape.m_center, shape.m_radius, box);
+	case BVH3ShapeType::Z_CYLINDER:
+		return DoZCylinderAndAABBOverlap3D(Vec2(shape.m_center.x, shape.m_center.y), shape.m_radius, shape.m_minMaxZ, box);
+	default:
+		ERROR_AND_DIE("Unknown BVH3 shape type");
+	}
+}
+
+// Slab test of the ray against a node; out_tNear is where the ray enters it, in distance along the ray
+static bool DoesRayHitNode(BVH3Node const& node, float const* rayStart, float const* inverseDirection, float maxDist, float& out_tNear)
+{
+	float tNear = 0.f;
+	float tFar = maxDist;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float tMin = (node.m_mins[axis] - rayStart[axis]) * inverseDirection[axis];
+		float tMax = (node.m_maxs[axis] - rayStart[axis]) * inverseDirection[axis];
+		if (tMin > tMax)
+		{
+			float swap = tMin;
+			tMin = tMax;
+			tMax = swap;
+		}
+		tNear = tMin > tNear ? tMin : tNear;
+		tFar = tMax < tFar ? tMax : tFar;
+	}
+	out_tNear = tNear;
+	return tNear <= tFar;
+}
+
+RaycastResult3D BVH3::Raycast(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength, int* out_shapeId) const
+{
+	GUARANTEE_OR_DIE(IsUpToDate(), "BVH3 has shapes added since its last Build()");
+	RaycastResult3D nearestResult;
+	nearestResult.m_rayStartPos = rayStart;
+	nearestResult.m_rayFwdNormal = rayForwardNormal;
+	nearestResult.m_rayMaxLength = rayLength;
+	int nearestShapeId = -1;
+	if (!m_nodes.empty())
+	{
+		float start[3] = { rayStart.x, rayStart.y, rayStart.z };
+		float direction[3] = { rayForwardNormal.x, rayForwardNormal.y, rayForwardNormal.z };
+		float inverseDirection[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			inverseDirection[axis] = direction[axis] != 0.f ? 1.f / direction[axis] : (signbit(direction[axis]) ? -BVH3_HUGE_INVERSE_DIRECTION : BVH3_HUGE_INVERSE_DIRECTION);
+		}
+
+		// A shape at the same distance as the nearest so far can still win with a lower id, so only nodes entered
+		// strictly beyond it are culled
+		float nearestDist = rayLength;
+		int stack[BVH3_MAX_DEPTH + 2];
+		int stackSize = 0;
+		float rootNear = 0.f;
+		if (DoesRayHitNode(m_nodes[0], start, inverseDirection, rayLength, rootNear))
+		{
+			stack[stackSize++] = 0;
+		}
+		while (stackSize > 0)
+		{
+			BVH3Node const& node = m_nodes[stack[--stackSize]];
+			if (node.m_numShapes > 0)
+			{
+				for (int orderIndex = node.m_firstChildOrShape; orderIndex < node.m_firstChildOrShape + node.m_numShapes; ++orderIndex)
+				{
+					int shapeId = m_shapeOrder[orderIndex];
+					RaycastResult3D result = RaycastShape(shapeId, rayStart, rayForwardNormal, rayLength);
+					if (result.m_didImpact && (nearestShapeId < 0 || result.m_impactDist < nearestResult.m_impactDist || (result.m_impactDist == nearestResult.m_impactDist && shapeId < nearestShapeId)))
+					{
+						nearestResult = result;
+						nearestShapeId = shapeId;
+						nearestDist = result.m_impactDist < rayLength ? result.m_impactDist : rayLength;
+					}
+				}
+				continue;
+			}
+
+			// Visit the nearer child first so the far one is more likely to be culled by the time it is popped
+			int leftIndex = node.m_firstChildOrShape;
+			float leftNear = 0.f;
+			float rightNear = 0.f;
+			bool hitsLeft = DoesRayHitNode(m_nodes[leftIndex], start, inverseDirection, rayLength, leftNear) && leftNear <= nearestDist;
+			bool hitsRight = DoesRayHitNode(m_nodes[leftIndex + 1], start, inverseDirection, rayLength, rightNear) && rightNear <= nearestDist;
+			if (hitsLeft && hitsRight)
+			{
+				bool isLeftNearer = leftNear <= rightNear;
+				stack[stackSize++] = isLeftNearer ? leftIndex + 1 : leftIndex;
+				stack[stackSize++] = isLeftNearer ? leftIndex : leftIndex + 1;
+			}
+			else if (hitsLeft)
+			{
+				stack[stackSize++] = leftIndex;
+			}
+			else if (hitsRight)
+			{
+				stack[stackSize++] = leftIndex + 1;
+			}
+		}
+	}
+	if (out_shapeId)
+	{
+		*out_shapeId = nearestShapeId;
+	}
+	return nearestResult;
+}
+
+void BVH3::OverlapSphere(Vec3 const& sphereCenter, float sphereRadius, std::vector<int>& out_shapeIds) const
+{
+	GUARANTEE_OR_DIE(IsUpToDate(), "BVH3 has shapes added since its last Build()");
+	out_shapeIds.clear();
+	if (m_nodes.empty())
+	{
+		return;
+	}
+	float center[3] = { sphereCenter.x, sphereCenter.y, sphereCenter.z };
+	float radiusSquared = sphereRadius * sphereRadius;
+	int stack[BVH3_MAX_DEPTH + 2];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		BVH3Node const& node = m_nodes[stack[--stackSize]];
+		float distanceSquared = 0.f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float outside = center[axis] < node.m_mins[axis] ? node.m_mins[axis] - center[axis] : (center[axis] > node.m_maxs[axis] ? center[axis] - node.m_maxs[axis] : 0.f);
+			distanceSquared += outside * outside;
+		}
+		if (distanceSquared > radiusSquared)
+		{
+			continue;
+		}
+		if (node.m_numShapes == 0)
+		{
+			stack[stackSize++] = node.m_firstChildOrShape + 1;
+			stack[stackSize++] = node.m_firstChildOrShape;
+			continue;
+		}
+		for (int orderIndex = node.m_firstChildOrShape; orderIndex < node.m_firstChildOrShape + node.m_numShapes; ++orderIndex)
+		{
+			if (DoesShapeOverlapSphere(m_shapeOrder[orderIndex], sphereCenter, sphereRadius))
+			{
+				out_shapeIds.push_back(m_shapeOrder[orderIndex]);
+			}
+		}
+	}
+	std::sort(out_shapeIds.begin(), out_shapeIds.end());
+}
+
+void BVH3::OverlapAABB3(AABB3 const& box, std::vector<int>& out_shapeIds) const
+{
+	GUARANTEE_OR_DIE(IsUpToDate(), "BVH3 has shapes added since its last Build()");
+	out_shapeIds.clear();
+	if (m_nodes.empty())
+	{
+		return;
+	}
+	float mins[3] = { box.m_mins.x, box.m_mins.y, box.m_mins.z };
+	float maxs[3] = { box.m_maxs.x, box.m_maxs.y, box.m_maxs.z };
+	int stack[BVH3_MAX_DEPTH + 2];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		BVH3Node const& node = m_nodes[stack[--stackSize]];
+		if (node.m_maxs[0] < mins[0] || node.m_mins[0] > maxs[0] || node.m_maxs[1] < mins[1] || node.m_mins[1] > maxs[1] || node.m_maxs[2] < mins[2] || node.m_mins[2] > maxs[2])
+		{
+			continue;
+		}
+		if (node.m_numShapes == 0)
+		{
+			stack[stackSize++] = node.m_firstChildOrShape + 1;
+			stack[stackSize++] = node.m_firstChildOrShape;
+			continue;
+		}
+		for (int orderIndex = node.m_firstChildOrShape; orderIndex < node.m_firstChildOrShape + node.m_numShapes; ++orderIndex)
+		{
+			if (DoesShapeOverlapAABB3(m_shapeOrder[orderIndex], box))
+			{
+				out_shapeIds.push_back(m_shapeOrder[orderIndex]);
+			}
+		}
+	}
+	std::sort(out_shapeIds.begin(), out_shapeIds.end());
+}
+
+RaycastResult3D BVH3::RaycastAllShapes(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength, int* out_shapeId) const
+{
+	RaycastResult3D nearestResult;
+	nearestResult.m_rayStartPos = rayStart;
+	nearestResult.m_rayFwdNormal = rayForwardNormal;
+	nearestResult.m_rayMaxLength = rayLength;
+	int nearestShapeId = -1;
+	for (int shapeId = 0; shapeId < (int)m_shapes.size(); ++shapeId)
+	{
+		RaycastResult3D result = RaycastShape(shapeId, rayStart, rayForwardNormal, rayLength);
+		if (result.m_didImpact && (nearestShapeId < 0 || result.m_impactDist < nearestResult.m_impactDist))
+		{
+			nearestResult = result;
+			nearestShapeId = shapeId;
+		}
+	}
+	if (out_shapeId)
+	{
+		*out_shapeId = nearestShapeId;
+	}
+	return nearestResult;
+}
+
+void BVH3::OverlapSphereAllShapes(Vec3 const& sphereCenter, float sphereRadius, std::vector<int>& out_shapeIds) const
+{
+	out_shapeIds.clear();
+	for (int shapeId = 0; shapeId < (int)m_shapes.size(); ++shapeId)
+	{
+		if (DoesShapeOverlapSphere(shapeId, sphereCenter, sphereRadius))
+		{
+			out_shapeIds.push_back(shapeId);
+		}
+	}
+}
+
+void BVH3::OverlapAABB3AllShapes(AABB3 const& box, std::vector<int>& out_shapeIds) const
+{
+	out_shapeIds.clear();
+	for (int shapeId = 0; shapeId < (int)m_shapes.size(); ++shapeId)
+	{
+		if (DoesShapeOverlapAABB3(shapeId, box))
+		{
+			out_shapeIds.push_back(shapeId);
+		}
+	}
+}
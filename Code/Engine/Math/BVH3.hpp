@@ -0,0 +1,98 @@
+#pragma once
+#include "Engine/Math/AABB3.hpp"
+#include "Engine/Math/OBB3.hpp"
+#include "Engine/Math/FloatRange.hpp"
+#include "Engine/Math/RaycastUtils.hpp"
+#include <vector>
+
+// Bounding volume hierarchy over a mix of the 3D shapes RaycastUtils and MathUtils know about, so raycasts and overlap
+// queries only test the shapes near them instead of every shape in the scene.
+// Add shapes, call Build() once (binned surface area heuristic), then move shapes with the Set functions and Refit(),
+// which only touches the nodes above moved shapes. Refitting loosens the tree as shapes drift; Build() again when they
+// have moved far from where they were built. Shapes added after Build() are not in the tree until the next Build(), so
+// querying or refitting before then is an error.
+
+enum class BVH3ShapeType
+{
+	AABB3,
+	OBB3,
+	SPHERE,
+	Z_CYLINDER,
+	COUNT
+};
+
+struct BVH3Shape
+{
+	BVH3ShapeType m_type = BVH3ShapeType::AABB3;
+	AABB3 m_box; // AABB3
+	OBB3 m_orientedBox; // OBB3
+	Vec3 m_center; // SPHERE, and the xy center of a Z_CYLINDER
+	float m_radius = 0.f; // SPHERE and Z_CYLINDER
+	FloatRange m_minMaxZ; // Z_CYLINDER
+};
+
+// 32 bytes, two to a cache line. Children are allocated in pairs, so an interior node only stores its first child
+struct BVH3Node
+{
+	float m_mins[3];
+	int m_firstChildOrShape = 0; // interior: the left child, right is the next node; leaf: first entry in m_shapeOrder
+	float m_maxs[3];
+	int m_numShapes = 0; // 0 for interior nodes
+};
+
+constexpr int BVH3_MAX_SHAPES_PER_LEAF = 4;
+constexpr int BVH3_NUM_SAH_BINS = 16;
+constexpr int BVH3_MAX_DEPTH = 48;
+
+class BVH3
+{
+public:
+	// Each returns the shape's id, which stays the same through Build() and Refit()
+	int AddAABB3(AABB3 const& box);
+	int AddOBB3(OBB3 const& orientedBox);
+	int AddSphere(Vec3 const& center, float radius);
+	int AddZCylinder(Vec2 const& centerXY, FloatRange const& minMaxZ, float radius);
+	void SetAABB3(int shapeId, AABB3 const& box);
+	void SetOBB3(int shapeId, OBB3 const& orientedBox);
+	void SetSphere(int shapeId, Vec3 const& center, float radius);
+	void SetZCylinder(int shapeId, Vec2 const& centerXY, FloatRange const& minMaxZ, float radius);
+	void Clear();
+
+	void Build();
+	void Refit();
+	bool IsUpToDate() const { return m_shapeOrder.size() == m_shapes.size(); } // every shape is in the tree
+
+	// Nearest impact among all shapes, exactly as the shape's own RaycastVs* function reports it (the lowest id on ties)
+	RaycastResult3D Raycast(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength, int* out_shapeId = nullptr) const;
+	// Ids of every shape overlapping the query, in increasing order
+	void OverlapSphere(Vec3 const& sphereCenter, float sphereRadius, std::vector<int>& out_shapeIds) const;
+	void OverlapAABB3(AABB3 const& box, std::vector<int>& out_shapeIds) const;
+
+	int GetNumShapes() const { return (int)m_shapes.size(); }
+	BVH3Shape const& GetShape(int shapeId) const { return m_shapes[shapeId]; }
+	int GetNumNodes() const { return (int)m_nodes.size(); }
+	AABB3 const GetShapeBounds(int shapeId) const;
+
+	// Brute force versions of the queries, looping over every shape; for checking the tree and for tiny scenes
+	RaycastResult3D RaycastAllShapes(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength, int* out_shapeId = nullptr) const;
+	void OverlapSphereAllShapes(Vec3 const& sphereCenter, float sphereRadius, std::vector<int>& out_shapeIds) const;
+	void OverlapAABB3AllShapes(AABB3 const& box, std::vector<int>& out_shapeIds) const;
+
+private:
+	int AddShape(BVH3Shape const& shape);
+	void MarkShapeMoved(int shapeId);
+	void BuildNode(int nodeIndex, int firstShape, int numShapes, int depth, std::vector<AABB3> const& shapeBounds, std::vector<Vec3> const& shapeCentroids);
+	void SetNodeBoundsFromShapes(BVH3Node& node) const;
+	RaycastResult3D RaycastShape(int shapeId, Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength) const;
+	bool DoesShapeOverlapSphere(int shapeId, Vec3 const& sphereCenter, float sphereRadius) const;
+	bool DoesShapeOverlapAABB3(int shapeId, AABB3 const& box) const;
+
+private:
+	std::vector<BVH3Shape> m_shapes;
+	std::vector<BVH3Node> m_nodes;
+	std::vector<int> m_shapeOrder; // shape ids in leaf order
+	std::vector<int> m_shapeLeaves; // leaf node of each shape id, -1 until built
+	std::vector<int> m_nodeParents;
+	std::vector<unsigned char> m_isNodeMoved;
+	bool m_hasMovedShapes = false;
+};
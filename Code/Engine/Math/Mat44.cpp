@@ -3,6 +3,258 @@
 #include "Engine/Math/MathUtils.hpp"
 #include <cstring>
 #include "Engine/Core/EngineCommon.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MAT44_HAS_SIMD_PATH
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MAT44_AVX2_FUNCTION
+#else
+#define MAT44_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+constexpr int MAT44_AVX2_BATCH_SIZE = 2;
+
+#if defined(MAT44_HAS_SIMD_PATH)
+static bool IsAVX2Supported()
+{
+#if defined(_MSC_VER)
+	int cpuInfo[4] = {};
+	__cpuid(cpuInfo, 1);
+	bool isAVXEnabledByOS = (cpuInfo[2] & (1 << 27)) != 0 && (cpuInfo[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+	if (!isAVXEnabledByOS)
+	{
+		return false;
+	}
+	__cpuidex(cpuInfo, 7, 0);
+	return (cpuInfo[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// SSE2 is part of the x64 baseline, so only AVX2 needs checking
+static Mat44SimdLevel GetSupportedMat44SimdLevel()
+{
+	return IsAVX2Supported() ? Mat44SimdLevel::AVX2 : Mat44SimdLevel::SSE2;
+}
+#else
+static Mat44SimdLevel GetSupportedMat44SimdLevel()
+{
+	return Mat44SimdLevel::SCALAR;
+}
+#endif
+
+// Zero (SCALAR) until dynamic initialization, so Mat44s built by other static initializers are still correct
+static Mat44SimdLevel s_supportedMat44SimdLevel = GetSupportedMat44SimdLevel();
+static Mat44SimdLevel s_mat44SimdLevel = s_supportedMat44SimdLevel;
+
+static Mat44SimdLevel GetClampedMat44SimdLevel(Mat44SimdLevel simdLevel)
+{
+	return (int)simdLevel < (int)s_supportedMat44SimdLevel ? simdLevel : s_supportedMat44SimdLevel;
+}
+
+Mat44SimdLevel GetMat44SimdLevel()
+{
+	return s_mat44SimdLevel;
+}
+
+void SetMat44SimdLevel(Mat44SimdLevel simdLevel)
+{
+	s_mat44SimdLevel = GetClampedMat44SimdLevel(simdLevel);
+}
+
+#if defined(MAT44_HAS_SIMD_PATH)
+#define MAT44_SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define MAT44_SWIZZLE(vec, x, y, z, w) _mm_shuffle_ps(vec, vec, MAT44_SHUFFLE_MASK(x, y, z, w))
+
+// Each column of the result is the left matrix's columns weighted by one column of the right, summed in the same order
+// as the scalar code so the results are bitwise identical
+static void MultiplyMatrices_SSE2(float* out_values, float const* left, float const* right)
+{
+	__m128 leftI = _mm_loadu_ps(left);
+	__m128 leftJ = _mm_loadu_ps(left + 4);
+	__m128 leftK = _mm_loadu_ps(left + 8);
+	__m128 leftT = _mm_loadu_ps(left + 12);
+	__m128 columns[4];
+	for (int columnIndex = 0; columnIndex < 4; ++columnIndex)
+	{
+		__m128 rightColumn = _mm_loadu_ps(right + columnIndex * 4);
+		__m128 column = _mm_add_ps(_mm_mul_ps(leftI, MAT44_SWIZZLE(rightColumn, 0, 0, 0, 0)), _mm_mul_ps(leftJ, MAT44_SWIZZLE(rightColumn, 1, 1, 1, 1)));
+		column = _mm_add_ps(column, _mm_mul_ps(leftK, MAT44_SWIZZLE(rightColumn, 2, 2, 2, 2)));
+		columns[columnIndex] = _mm_add_ps(column, _mm_mul_ps(leftT, MAT44_SWIZZLE(rightColumn, 3, 3, 3, 3)));
+	}
+	for (int columnIndex = 0; columnIndex < 4; ++columnIndex)
+	{
+		_mm_storeu_ps(out_values + columnIndex * 4, columns[columnIndex]);
+	}
+}
+
+// 2x2 matrix helpers for the block inverse, each matrix held as (m00, m01, m10, m11)
+static inline __m128 Multiply2x2_SSE2(__m128 a, __m128 b)
+{
+	return _mm_add_ps(_mm_mul_ps(a, MAT44_SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(MAT44_SWIZZLE(a, 1, 0, 3, 2), MAT44_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+static inline __m128 AdjugateMultiply2x2_SSE2(__m128 a, __m128 b) // adj(a) * b
+{
+	return _mm_sub_ps(_mm_mul_ps(MAT44_SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(MAT44_SWIZZLE(a, 1, 1, 2, 2), MAT44_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+static inline __m128 MultiplyAdjugate2x2_SSE2(__m128 a, __m128 b) // a * adj(b)
+{
+	return _mm_sub_ps(_mm_mul_ps(a, MAT44_SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(MAT44_SWIZZLE(a, 1, 0, 3, 2), MAT44_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// Block matrix inverse after Eric Zhang's "Fast 4x4 matrix inverse with SSE SIMD": split into 2x2 blocks A B / C D
+// and build the inverse from their adjugates and determinants. Works on the raw layout, since inverse(transpose(M))
+// is transpose(inverse(M)).
+static float InvertMatrix_SSE2(float* out_values, float const* values)
+{
+	__m128 row0 = _mm_loadu_ps(values);
+	__m128 row1 = _mm_loadu_ps(values + 4);
+	__m128 row2 = _mm_loadu_ps(values + 8);
+	__m128 row3 = _mm_loadu_ps(values + 12);
+	__m128 blockA = _mm_movelh_ps(row0, row1);
+	__m128 blockB = _mm_movehl_ps(row1, row0);
+	__m128 blockC = _mm_movelh_ps(row2, row3);
+	__m128 blockD = _mm_movehl_ps(row3, row2);
+
+	// (|A|, |B|, |C|, |D|)
+	__m128 blockDeterminants = _mm_sub_ps(
+		_mm_mul_ps(_mm_shuffle_ps(row0, row2, MAT44_SHUFFLE_MASK(0, 2, 0, 2)), _mm_shuffle_ps(row1, row3, MAT44_SHUFFLE_MASK(1, 3, 1, 3))),
+		_mm_mul_ps(_mm_shuffle_ps(row0, row2, MAT44_SHUFFLE_MASK(1, 3, 1, 3)), _mm_shuffle_ps(row1, row3, MAT44_SHUFFLE_MASK(0, 2, 0, 2))));
+	__m128 determinantA = MAT44_SWIZZLE(blockDeterminants, 0, 0, 0, 0);
+	__m128 determinantB = MAT44_SWIZZLE(blockDeterminants, 1, 1, 1, 1);
+	__m128 determinantC = MAT44_SWIZZLE(blockDeterminants, 2, 2, 2, 2);
+	__m128 determinantD = MAT44_SWIZZLE(blockDeterminants, 3, 3, 3, 3);
+
+	__m128 adjDTimesC = AdjugateMultiply2x2_SSE2(blockD, blockC);
+	__m128 adjATimesB = AdjugateMultiply2x2_SSE2(blockA, blockB);
+	__m128 adjX = _mm_sub_ps(_mm_mul_ps(determinantD, blockA), Multiply2x2_SSE2(blockB, adjDTimesC));
+	__m128 adjW = _mm_sub_ps(_mm_mul_ps(determinantA, blockD), Multiply2x2_SSE2(blockC, adjATimesB));
+	__m128 adjY = _mm_sub_ps(_mm_mul_ps(determinantB, blockC), MultiplyAdjugate2x2_SSE2(blockD, adjATimesB));
+	__m128 adjZ = _mm_sub_ps(_mm_mul_ps(determinantC, blockB), MultiplyAdjugate2x2_SSE2(blockA, adjDTimesC));
+
+	// |M| = |A||D| + |B||C| - trace(adj(A)B adj(D)C)
+	__m128 trace = _mm_mul_ps(adjATimesB, MAT44_SWIZZLE(adjDTimesC, 0, 2, 1, 3));
+	trace = _mm_add_ps(trace, MAT44_SWIZZLE(trace, 2, 3, 0, 1));
+	trace = _mm_add_ps(trace, MAT44_SWIZZLE(trace, 1, 0, 3, 2));
+	__m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(determinantA, determinantD), _mm_mul_ps(determinantB, determinantC)), trace);
+
+	__m128 signedReciprocal = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), determinant);
+	adjX = _mm_mul_ps(adjX, signedReciprocal);
+	adjY = _mm_mul_ps(adjY, signedReciprocal);
+	adjZ = _mm_mul_ps(adjZ, signedReciprocal);
+	adjW = _mm_mul_ps(adjW, signedReciprocal);
+
+	_mm_storeu_ps(out_values, _mm_shuffle_ps(adjX, adjY, MAT44_SHUFFLE_MASK(3, 1, 3, 1)));
+	_mm_storeu_ps(out_values + 4, _mm_shuffle_ps(adjX, adjY, MAT44_SHUFFLE_MASK(2, 0, 2, 0)));
+	_mm_storeu_ps(out_values + 8, _mm_shuffle_ps(adjZ, adjW, MAT44_SHUFFLE_MASK(3, 1, 3, 1)));
+	_mm_storeu_ps(out_values + 12, _mm_shuffle_ps(adjZ, adjW, MAT44_SHUFFLE_MASK(2, 0, 2, 0)));
+	return _mm_cvtss_f32(determinant);
+}
+
+// One element per iteration: the columns weighted by its x, y, z (and 1 for positions) in the scalar code's order
+static void TransformElements_SSE2(float const* values, unsigned char const* in, size_t inStride, unsigned char* out, size_t outStride, size_t numElements, bool isPosition)
+{
+	__m128 columnI = _mm_loadu_ps(values);
+	__m128 columnJ = _mm_loadu_ps(values + 4);
+	__m128 columnK = _mm_loadu_ps(values + 8);
+	__m128 columnT = isPosition ? _mm_loadu_ps(values + 12) : _mm_setzero_ps();
+	for (size_t elementIndex = 0; elementIndex < numElements; ++elementIndex)
+	{
+		float const* element = reinterpret_cast<float const*>(in + elementIndex * inStride);
+		__m128 result = _mm_add_ps(_mm_mul_ps(columnI, _mm_set1_ps(element[0])), _mm_mul_ps(columnJ, _mm_set1_ps(element[1])));
+		result = _mm_add_ps(result, _mm_mul_ps(columnK, _mm_set1_ps(element[2])));
+		if (isPosition)
+		{
+			result = _mm_add_ps(result, columnT);
+		}
+		float* outElement = reinterpret_cast<float*>(out + elementIndex * outStride);
+		_mm_storel_pi(reinterpret_cast<__m64*>(outElement), result);
+		_mm_store_ss(outElement + 2, _mm_movehl_ps(result, result));
+	}
+}
+
+// Cross products of the i, j, k bases (j x k, k x i, i x j) and the determinant, in the scalar code's order. The w
+// lanes cancel to zero
+static __m128 GetCofactorBases3D_SSE2(float const* values, __m128* out_cofactors)
+{
+	__m128 iBasis = _mm_loadu_ps(values);
+	__m128 jBasis = _mm_loadu_ps(values + 4);
+	__m128 kBasis = _mm_loadu_ps(values + 8);
+	__m128 bases[3] = { iBasis, jBasis, kBasis };
+	for (int cofactorIndex = 0; cofactorIndex < 3; ++cofactorIndex)
+	{
+		__m128 a = bases[(cofactorIndex + 1) % 3];
+		__m128 b = bases[(cofactorIndex + 2) % 3];
+		out_cofactors[cofactorIndex] = _mm_sub_ps(_mm_mul_ps(MAT44_SWIZZLE(a, 1, 2, 0, 3), MAT44_SWIZZLE(b, 2, 0, 1, 3)), _mm_mul_ps(MAT44_SWIZZLE(a, 2, 0, 1, 3), MAT44_SWIZZLE(b, 1, 2, 0, 3)));
+	}
+	__m128 products = _mm_mul_ps(iBasis, out_cofactors[0]);
+	__m128 determinant = _mm_add_ss(_mm_add_ss(products, MAT44_SWIZZLE(products, 1, 1, 1, 1)), MAT44_SWIZZLE(products, 2, 2, 2, 2));
+	return MAT44_SWIZZLE(determinant, 0, 0, 0, 0);
+}
+
+static void InvertAffineMatrix_SSE2(float* out_values, float const* values)
+{
+	__m128 cofactors[3];
+	__m128 reciprocal = _mm_div_ps(_mm_set1_ps(1.f), GetCofactorBases3D_SSE2(values, cofactors));
+	__m128 columnI = _mm_mul_ps(cofactors[0], reciprocal);
+	__m128 columnJ = _mm_mul_ps(cofactors[1], reciprocal);
+	__m128 columnK = _mm_mul_ps(cofactors[2], reciprocal);
+	__m128 columnW = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(columnI, columnJ, columnK, columnW);
+	__m128 translation = _mm_loadu_ps(values + 12);
+	__m128 columnT = _mm_add_ps(_mm_mul_ps(columnI, MAT44_SWIZZLE(translation, 0, 0, 0, 0)), _mm_mul_ps(columnJ, MAT44_SWIZZLE(translation, 1, 1, 1, 1)));
+	columnT = _mm_add_ps(columnT, _mm_mul_ps(columnK, MAT44_SWIZZLE(translation, 2, 2, 2, 2)));
+	__m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	columnT = _mm_or_ps(_mm_and_ps(_mm_xor_ps(columnT, _mm_set1_ps(-0.f)), xyzMask), _mm_setr_ps(0.f, 0.f, 0.f, 1.f));
+	_mm_storeu_ps(out_values, columnI);
+	_mm_storeu_ps(out_values + 4, columnJ);
+	_mm_storeu_ps(out_values + 8, columnK);
+	_mm_storeu_ps(out_values + 12, columnT);
+}
+
+// Two elements per iteration, one per 128-bit lane, with the same per-element arithmetic as the SSE2 path. Batches of
+// eight elements transposed into SoA registers (by _mm256_i32gather_ps or through the stack) measured slower than SSE2
+// for AoS vertex arrays, since every element has to be transposed in and out again
+MAT44_AVX2_FUNCTION static size_t TransformElements_AVX2(float const* values, unsigned char const* in, size_t inStride, unsigned char* out, size_t outStride, size_t numElements, bool isPosition)
+{
+	__m256 columnI = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(values));
+	__m256 columnJ = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(values + 4));
+	__m256 columnK = _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(values + 8));
+	__m256 columnT = isPosition ? _mm256_broadcast_ps(reinterpret_cast<__m128 const*>(values + 12)) : _mm256_setzero_ps();
+
+	size_t elementIndex = 0;
+	for (; elementIndex + MAT44_AVX2_BATCH_SIZE <= numElements; elementIndex += MAT44_AVX2_BATCH_SIZE)
+	{
+		float const* element0 = reinterpret_cast<float const*>(in + elementIndex * inStride);
+		float const* element1 = reinterpret_cast<float const*>(in + (elementIndex + 1) * inStride);
+		__m256 x = _mm256_blend_ps(_mm256_broadcast_ss(element0), _mm256_broadcast_ss(element1), 0xF0);
+		__m256 y = _mm256_blend_ps(_mm256_broadcast_ss(element0 + 1), _mm256_broadcast_ss(element1 + 1), 0xF0);
+		__m256 z = _mm256_blend_ps(_mm256_broadcast_ss(element0 + 2), _mm256_broadcast_ss(element1 + 2), 0xF0);
+		__m256 result = _mm256_add_ps(_mm256_mul_ps(columnI, x), _mm256_mul_ps(columnJ, y));
+		result = _mm256_add_ps(result, _mm256_mul_ps(columnK, z));
+		if (isPosition)
+		{
+			result = _mm256_add_ps(result, columnT);
+		}
+		__m128 result0 = _mm256_castps256_ps128(result);
+		__m128 result1 = _mm256_extractf128_ps(result, 1);
+		float* outElement0 = reinterpret_cast<float*>(out + elementIndex * outStride);
+		float* outElement1 = reinterpret_cast<float*>(out + (elementIndex + 1) * outStride);
+		_mm_storel_pi(reinterpret_cast<__m64*>(outElement0), result0);
+		_mm_store_ss(outElement0 + 2, _mm_movehl_ps(result0, result0));
+		_mm_storel_pi(reinterpret_cast<__m64*>(outElement1), result1);
+		_mm_store_ss(outElement1 + 2, _mm_movehl_ps(result1, result1));
+	}
+	_mm256_zeroupper();
+	return elementIndex;
+}
+#endif
 Mat44::Mat44() 
 	:m_values{0.f}
 {
@@ -186,6 +438,64 @@ Vec4 const Mat44::TransformHomogeneous3D(Vec4 const& homogeneousPoint3D) const
 		        m_values[Iw] * homogeneousPoint3D.x + m_values[Jw] * homogeneousPoint3D.y + m_values[Kw] * homogeneousPoint3D.z + m_values[Tw] * homogeneousPoint3D.w);
 }
 
+void Mat44::TransformPositions3D(Vec3 const* positions, size_t inStride, Vec3* out_positions, size_t outStride, size_t numPositions) const
+{
+	TransformPositions3DAtSimdLevel(s_mat44SimdLevel, *this, positions, inStride, out_positions, outStride, numPositions);
+}
+
+void Mat44::TransformPositions3DAtSimdLevel(Mat44SimdLevel simdLevel, Mat44 const& matrix, Vec3 const* positions, size_t inStride, Vec3* out_positions, size_t outStride, size_t numPositions)
+{
+	simdLevel = GetClampedMat44SimdLevel(simdLevel);
+	unsigned char const* in = reinterpret_cast<unsigned char const*>(positions);
+	unsigned char* out = reinterpret_cast<unsigned char*>(out_positions);
+	size_t positionIndex = 0;
+#if defined(MAT44_HAS_SIMD_PATH)
+	if (simdLevel == Mat44SimdLevel::AVX2 && numPositions >= MAT44_AVX2_BATCH_SIZE)
+	{
+		positionIndex = TransformElements_AVX2(matrix.m_values, in, inStride, out, outStride, numPositions, true);
+	}
+	if (simdLevel != Mat44SimdLevel::SCALAR)
+	{
+		TransformElements_SSE2(matrix.m_values, in + positionIndex * inStride, inStride, out + positionIndex * outStride, outStride, numPositions - positionIndex, true);
+		return;
+	}
+#endif
+	for (; positionIndex < numPositions; ++positionIndex)
+	{
+		Vec3 const& position = *reinterpret_cast<Vec3 const*>(in + positionIndex * inStride);
+		*reinterpret_cast<Vec3*>(out + positionIndex * outStride) = matrix.TransformPosition3D(position);
+	}
+}
+
+void Mat44::TransformVectorQuantities3D(Vec3 const* vectorQuantities, size_t inStride, Vec3* out_vectorQuantities, size_t outStride, size_t numVectorQuantities) const
+{
+	TransformVectorQuantities3DAtSimdLevel(s_mat44SimdLevel, *this, vectorQuantities, inStride, out_vectorQuantities, outStride, numVectorQuantities);
+}
+
+void Mat44::TransformVectorQuantities3DAtSimdLevel(Mat44SimdLevel simdLevel, Mat44 const& matrix, Vec3 const* vectorQuantities, size_t inStride, Vec3* out_vectorQuantities, size_t outStride, size_t numVectorQuantities)
+{
+	simdLevel = GetClampedMat44SimdLevel(simdLevel);
+	unsigned char const* in = reinterpret_cast<unsigned char const*>(vectorQuantities);
+	unsigned char* out = reinterpret_cast<unsigned char*>(out_vectorQuantities);
+	size_t vectorIndex = 0;
+#if defined(MAT44_HAS_SIMD_PATH)
+	if (simdLevel == Mat44SimdLevel::AVX2 && numVectorQuantities >= MAT44_AVX2_BATCH_SIZE)
+	{
+		vectorIndex = TransformElements_AVX2(matrix.m_values, in, inStride, out, outStride, numVectorQuantities, false);
+	}
+	if (simdLevel != Mat44SimdLevel::SCALAR)
+	{
+		TransformElements_SSE2(matrix.m_values, in + vectorIndex * inStride, inStride, out + vectorIndex * outStride, outStride, numVectorQuantities - vectorIndex, false);
+		return;
+	}
+#endif
+	for (; vectorIndex < numVectorQuantities; ++vectorIndex)
+	{
+		Vec3 const& vectorQuantity = *reinterpret_cast<Vec3 const*>(in + vectorIndex * inStride);
+		*reinterpret_cast<Vec3*>(out + vectorIndex * outStride) = matrix.TransformVectorQuantity3D(vectorQuantity);
+	}
+}
+
 float* Mat44::GetAsFloatArray()
 {
 	return m_values;
@@ -277,6 +587,168 @@ Mat44 const Mat44::GetOrthonormalInverse() const
 	return resultMatrix;
 }
 
+Mat44 const Mat44::GetInverse(float* out_determinant) const
+{
+	return GetInverseAtSimdLevel(s_mat44SimdLevel, *this, out_determinant);
+}
+
+Mat44 const Mat44::GetInverseAtSimdLevel(Mat44SimdLevel simdLevel, Mat44 const& matrix, float* out_determinant)
+{
+	simdLevel = GetClampedMat44SimdLevel(simdLevel);
+	Mat44 inverse;
+	float determinant = 0.f;
+#if defined(MAT44_HAS_SIMD_PATH)
+	if (simdLevel != Mat44SimdLevel::SCALAR)
+	{
+		determinant = InvertMatrix_SSE2(inverse.m_values, matrix.m_values);
+		if (out_determinant)
+		{
+			*out_determinant = determinant;
+		}
+		return inverse;
+	}
+#endif
+	// Laplace expansion by 2x2 minors of the first two and last two rows of the raw layout; like the SSE path it does not
+	// care whether that layout is rows or columns
+	float const* m = matrix.m_values;
+	float s0 = m[0] * m[5] - m[4] * m[1];
+	float s1 = m[0] * m[6] - m[4] * m[2];
+	float s2 = m[0] * m[7] - m[4] * m[3];
+	float s3 = m[1] * m[6] - m[5] * m[2];
+	float s4 = m[1] * m[7] - m[5] * m[3];
+	float s5 = m[2] * m[7] - m[6] * m[3];
+	float c5 = m[10] * m[15] - m[14] * m[11];
+	float c4 = m[9] * m[15] - m[13] * m[11];
+	float c3 = m[9] * m[14] - m[13] * m[10];
+	float c2 = m[8] * m[15] - m[12] * m[11];
+	float c1 = m[8] * m[14] - m[12] * m[10];
+	float c0 = m[8] * m[13] - m[12] * m[9];
+	determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	float reciprocal = 1.f / determinant;
+
+	float* inv = inverse.m_values;
+	inv[0] = (m[5] * c5 - m[6] * c4 + m[7] * c3) * reciprocal;
+	inv[1] = (-m[1] * c5 + m[2] * c4 - m[3] * c3) * reciprocal;
+	inv[2] = (m[13] * s5 - m[14] * s4 + m[15] * s3) * reciprocal;
+	inv[3] = (-m[9] * s5 + m[10] * s4 - m[11] * s3) * reciprocal;
+	inv[4] = (-m[4] * c5 + m[6] * c2 - m[7] * c1) * reciprocal;
+	inv[5] = (m[0] * c5 - m[2] * c2 + m[3] * c1) * reciprocal;
+	inv[6] = (-m[12] * s5 + m[14] * s2 - m[15] * s1) * reciprocal;
+	inv[7] = (m[8] * s5 - m[10] * s2 + m[11] * s1) * reciprocal;
+	inv[8] = (m[4] * c4 - m[5] * c2 + m[7] * c0) * reciprocal;
+	inv[9] = (-m[0] * c4 + m[1] * c2 - m[3] * c0) * reciprocal;
+	inv[10] = (m[12] * s4 - m[13] * s2 + m[15] * s0) * reciprocal;
+	inv[11] = (-m[8] * s4 + m[9] * s2 - m[11] * s0) * reciprocal;
+	inv[12] = (-m[4] * c3 + m[5] * c1 - m[6] * c0) * reciprocal;
+	inv[13] = (m[0] * c3 - m[1] * c1 + m[2] * c0) * reciprocal;
+	inv[14] = (-m[12] * s3 + m[13] * s1 - m[14] * s0) * reciprocal;
+	inv[15] = (m[8] * s3 - m[9] * s1 + m[10] * s0) * reciprocal;
+	if (out_determinant)
+	{
+		*out_determinant = determinant;
+	}
+	return inverse;
+}
+
+// The inverse of the 3x3 part is the cofactor matrix transposed over the determinant, and the cofactors of a matrix
+// with bases i, j, k are just j x k, k x i and i x j
+static float GetCofactorBases3D(float const* m, float* out_cofactors)
+{
+	out_cofactors[0] = m[Mat44::Jy] * m[Mat44::Kz] - m[Mat44::Jz] * m[Mat44::Ky];
+	out_cofactors[1] = m[Mat44::Jz] * m[Mat44::Kx] - m[Mat44::Jx] * m[Mat44::Kz];
+	out_cofactors[2] = m[Mat44::Jx] * m[Mat44::Ky] - m[Mat44::Jy] * m[Mat44::Kx];
+	out_cofactors[3] = m[Mat44::Ky] * m[Mat44::Iz] - m[Mat44::Kz] * m[Mat44::Iy];
+	out_cofactors[4] = m[Mat44::Kz] * m[Mat44::Ix] - m[Mat44::Kx] * m[Mat44::Iz];
+	out_cofactors[5] = m[Mat44::Kx] * m[Mat44::Iy] - m[Mat44::Ky] * m[Mat44::Ix];
+	out_cofactors[6] = m[Mat44::Iy] * m[Mat44::Jz] - m[Mat44::Iz] * m[Mat44::Jy];
+	out_cofactors[7] = m[Mat44::Iz] * m[Mat44::Jx] - m[Mat44::Ix] * m[Mat44::Jz];
+	out_cofactors[8] = m[Mat44::Ix] * m[Mat44::Jy] - m[Mat44::Iy] * m[Mat44::Jx];
+	return m[Mat44::Ix] * out_cofactors[0] + m[Mat44::Iy] * out_cofactors[1] + m[Mat44::Iz] * out_cofactors[2];
+}
+
+Mat44 const Mat44::GetAffineInverse() const
+{
+	return GetAffineInverseAtSimdLevel(s_mat44SimdLevel, *this);
+}
+
+Mat44 const Mat44::GetAffineInverseAtSimdLevel(Mat44SimdLevel simdLevel, Mat44 const& matrix)
+{
+	simdLevel = GetClampedMat44SimdLevel(simdLevel);
+#if defined(MAT44_HAS_SIMD_PATH)
+	if (simdLevel != Mat44SimdLevel::SCALAR)
+	{
+		Mat44 inverse;
+		InvertAffineMatrix_SSE2(inverse.m_values, matrix.m_values);
+		return inverse;
+	}
+#endif
+	float cofactors[9];
+	float reciprocal = 1.f / GetCofactorBases3D(matrix.m_values, cofactors);
+	Mat44 inverse;
+	inverse.m_values[Ix] = cofactors[0] * reciprocal;
+	inverse.m_values[Iy] = cofactors[3] * reciprocal;
+	inverse.m_values[Iz] = cofactors[6] * reciprocal;
+	inverse.m_values[Jx] = cofactors[1] * reciprocal;
+	inverse.m_values[Jy] = cofactors[4] * reciprocal;
+	inverse.m_values[Jz] = cofactors[7] * reciprocal;
+	inverse.m_values[Kx] = cofactors[2] * reciprocal;
+	inverse.m_values[Ky] = cofactors[5] * reciprocal;
+	inverse.m_values[Kz] = cofactors[8] * reciprocal;
+	inverse.m_values[Tx] = -(inverse.m_values[Ix] * matrix.m_values[Tx] + inverse.m_values[Jx] * matrix.m_values[Ty] + inverse.m_values[Kx] * matrix.m_values[Tz]);
+	inverse.m_values[Ty] = -(inverse.m_values[Iy] * matrix.m_values[Tx] + inverse.m_values[Jy] * matrix.m_values[Ty] + inverse.m_values[Ky] * matrix.m_values[Tz]);
+	inverse.m_values[Tz] = -(inverse.m_values[Iz] * matrix.m_values[Tx] + inverse.m_values[Jz] * matrix.m_values[Ty] + inverse.m_values[Kz] * matrix.m_values[Tz]);
+	return inverse;
+}
+
+Mat44 const Mat44::GetInverseTranspose3D() const
+{
+	return GetInverseTranspose3DAtSimdLevel(s_mat44SimdLevel, *this);
+}
+
+Mat44 const Mat44::GetInverseTranspose3DAtSimdLevel(Mat44SimdLevel simdLevel, Mat44 const& matrix)
+{
+	simdLevel = GetClampedMat44SimdLevel(simdLevel);
+#if defined(MAT44_HAS_SIMD_PATH)
+	if (simdLevel != Mat44SimdLevel::SCALAR)
+	{
+		__m128 cofactors[3];
+		__m128 reciprocal = _mm_div_ps(_mm_set1_ps(1.f), GetCofactorBases3D_SSE2(matrix.m_values, cofactors));
+		__m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+		Mat44 inverseTranspose;
+		_mm_storeu_ps(inverseTranspose.m_values, _mm_and_ps(_mm_mul_ps(cofactors[0], reciprocal), xyzMask));
+		_mm_storeu_ps(inverseTranspose.m_values + 4, _mm_and_ps(_mm_mul_ps(cofactors[1], reciprocal), xyzMask));
+		_mm_storeu_ps(inverseTranspose.m_values + 8, _mm_and_ps(_mm_mul_ps(cofactors[2], reciprocal), xyzMask));
+		return inverseTranspose;
+	}
+#endif
+	float cofactors[9];
+	float reciprocal = 1.f / GetCofactorBases3D(matrix.m_values, cofactors);
+	Mat44 inverseTranspose;
+	inverseTranspose.m_values[Ix] = cofactors[0] * reciprocal;
+	inverseTranspose.m_values[Iy] = cofactors[1] * reciprocal;
+	inverseTranspose.m_values[Iz] = cofactors[2] * reciprocal;
+	inverseTranspose.m_values[Jx] = cofactors[3] * reciprocal;
+	inverseTranspose.m_values[Jy] = cofactors[4] * reciprocal;
+	inverseTranspose.m_values[Jz] = cofactors[5] * reciprocal;
+	inverseTranspose.m_values[Kx] = cofactors[6] * reciprocal;
+	inverseTranspose.m_values[Ky] = cofactors[7] * reciprocal;
+	inverseTranspose.m_values[Kz] = cofactors[8] * reciprocal;
+	return inverseTranspose;
+}
+
+bool Mat44::IsConformal3D(float tolerance) const
+{
+	float iLengthSquared = m_values[Ix] * m_values[Ix] + m_values[Iy] * m_values[Iy] + m_values[Iz] * m_values[Iz];
+	float jLengthSquared = m_values[Jx] * m_values[Jx] + m_values[Jy] * m_values[Jy] + m_values[Jz] * m_values[Jz];
+	float kLengthSquared = m_values[Kx] * m_values[Kx] + m_values[Ky] * m_values[Ky] + m_values[Kz] * m_values[Kz];
+	float ij = m_values[Ix] * m_values[Jx] + m_values[Iy] * m_values[Jy] + m_values[Iz] * m_values[Jz];
+	float jk = m_values[Jx] * m_values[Kx] + m_values[Jy] * m_values[Ky] + m_values[Jz] * m_values[Kz];
+	float ki = m_values[Kx] * m_values[Ix] + m_values[Ky] * m_values[Iy] + m_values[Kz] * m_values[Iz];
+	float allowed = tolerance * iLengthSquared;
+	return AbsFloat(jLengthSquared - iLengthSquared) <= allowed && AbsFloat(kLengthSquared - iLengthSquared) <= allowed
+		&& AbsFloat(ij) <= allowed && AbsFloat(jk) <= allowed && AbsFloat(ki) <= allowed;
+}
+
 void Mat44::SetTranslation2D(Vec2 const& translationXY)
 {
 	m_values[Tx] = translationXY.x;
@@ -379,6 +851,13 @@ void Mat44::SetIJKT4D(Vec4 const& iBasis4D, Vec4 const& jBasis4D, Vec4 const& kB
 
 void Mat44::Append(Mat44 const& appendThis)
 {
+#if defined(MAT44_HAS_SIMD_PATH)
+	if (s_mat44SimdLevel != Mat44SimdLevel::SCALAR)
+	{
+		MultiplyMatrices_SSE2(m_values, m_values, appendThis.m_values); // reads both fully before writing, so no copy is needed
+		return;
+	}
+#endif
 	Mat44 copyOfThis = *this; // Make a copy of my old values, so we don't pollute them as we go
 	float const* left = &copyOfThis.m_values[0]; // column-notation nickname for the prior matrix, for brevity
 	float const* right = &appendThis.m_values[0]; // column-notation nickname for the new matrix, for brevity
@@ -460,6 +939,21 @@ void Mat44::AppendScaleNonUniform3D(Vec3 const& nonUniformScaleXYZ)
 
 void Mat44::Transpose()
 {
+#if defined(MAT44_HAS_SIMD_PATH)
+	if (s_mat44SimdLevel != Mat44SimdLevel::SCALAR)
+	{
+		__m128 columnI = _mm_loadu_ps(&m_values[Ix]);
+		__m128 columnJ = _mm_loadu_ps(&m_values[Jx]);
+		__m128 columnK = _mm_loadu_ps(&m_values[Kx]);
+		__m128 columnT = _mm_loadu_ps(&m_values[Tx]);
+		_MM_TRANSPOSE4_PS(columnI, columnJ, columnK, columnT);
+		_mm_storeu_ps(&m_values[Ix], columnI);
+		_mm_storeu_ps(&m_values[Jx], columnJ);
+		_mm_storeu_ps(&m_values[Kx], columnK);
+		_mm_storeu_ps(&m_values[Tx], columnT);
+		return;
+	}
+#endif
 	Mat44 old(*this);
 	m_values[Ix] = old.m_values[Ix];
 	m_values[Iy] = old.m_values[Jx];
@@ -2,6 +2,17 @@
 #include "Engine/Math/Vec2.hpp"
 #include "Engine/Math/Vec3.hpp"
 #include "Engine/Math/Vec4.hpp"
+#include <cstddef>
+
+// Which kernels Mat44 runs: the best the CPU supports is picked at startup, SCALAR can be forced to compare against
+enum class Mat44SimdLevel
+{
+	SCALAR,
+	SSE2,
+	AVX2,
+	COUNT
+};
+
 struct Mat44
 {
 	enum{
@@ -33,6 +44,11 @@ struct Mat44
 	Vec3 const TransformPosition3D(Vec3 const& positionXYZ) const; //assumes w=0
 	Vec4 const TransformHomogeneous3D(Vec4 const& homogeneousPoint3D) const; //w is provided
 
+	// Batched versions of the above, bitwise identical to calling them one at a time. Elements are read every inStride bytes
+	// and written every outStride bytes so they run straight over vertex arrays; out may be the same array as in.
+	void TransformPositions3D(Vec3 const* positions, size_t inStride, Vec3* out_positions, size_t outStride, size_t numPositions) const; //assumes w=1
+	void TransformVectorQuantities3D(Vec3 const* vectorQuantities, size_t inStride, Vec3* out_vectorQuantities, size_t outStride, size_t numVectorQuantities) const; //assumes w=0
+
 	float* GetAsFloatArray(); //non-const (mutable) version
 	float const* GetAsFloatArray() const; //const version, used only when Mat44 is const
 	Vec2 const GetIBasis2D() const;
@@ -47,6 +63,18 @@ struct Mat44
 	Vec4 const GetKBasis4D() const;
 	Vec4 const GetTranslation4D() const;
 	Mat44 const GetOrthonormalInverse() const; // Only works for orthonormal affine matrices
+	Mat44 const GetInverse(float* out_determinant = nullptr) const; // Any 4x4 matrix; a singular one (determinant 0) gives infinities or NaNs
+	Mat44 const GetAffineInverse() const; // Any rotation, scale, shear and translation; assumes the w row is 0,0,0,1
+	Mat44 const GetInverseTranspose3D() const; // For transforming normals by a matrix with non-uniform scale or shear; no translation
+	bool IsConformal3D(float tolerance = 1e-5f) const; // i, j, k orthogonal and the same length, so normals can use the matrix itself
+
+	// The batched transforms and inverses at a given SIMD level (clamped to what the CPU supports) instead of the one picked
+	// at startup, so the kernels can be compared side by side without changing the level every other thread is using
+	static void TransformPositions3DAtSimdLevel(Mat44SimdLevel simdLevel, Mat44 const& matrix, Vec3 const* positions, size_t inStride, Vec3* out_positions, size_t outStride, size_t numPositions);
+	static void TransformVectorQuantities3DAtSimdLevel(Mat44SimdLevel simdLevel, Mat44 const& matrix, Vec3 const* vectorQuantities, size_t inStride, Vec3* out_vectorQuantities, size_t outStride, size_t numVectorQuantities);
+	static Mat44 const GetInverseAtSimdLevel(Mat44SimdLevel simdLevel, Mat44 const& matrix, float* out_determinant = nullptr);
+	static Mat44 const GetAffineInverseAtSimdLevel(Mat44SimdLevel simdLevel, Mat44 const& matrix);
+	static Mat44 const GetInverseTranspose3DAtSimdLevel(Mat44SimdLevel simdLevel, Mat44 const& matrix);
 
 	void SetTranslation2D(Vec2 const& translationXY); //Sets translationZ=0, translationW=1
 	void SetTranslation3D(Vec3 const& translationXYZ); //Sets translationW=1
@@ -69,4 +97,7 @@ struct Mat44
 
 	void Transpose(); //swap columns with rows
 	void Orthonormalize_IFwd_JLeft_KUp(); // Forward is canonical, Up is secondary, Left tertiary
-};
\ No newline at end of file
+};
+
+Mat44SimdLevel GetMat44SimdLevel();
+void SetMat44SimdLevel(Mat44SimdLevel simdLevel); // clamped to what the CPU supports
@@ -0,0 +1,597 @@
+#include "MathSelfTests.hpp"
+#include "Engine/Math/RaycastUtils.hpp"
+#include "Engine/Math/BVH3.hpp"
+#include "Engine/Math/Mat44.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Math/RandomNumberGenerator.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/SelfTestUtils.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include "Engine/Core/DevConsole.hpp"
+#include "Engine/Core/StringUtils.hpp"
+#include "Engine/Core/Time.hpp"
+#include <cstring>
+
+static bool AreBitwiseEqual(float a, float b)
+{
+	return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+static float GetImpactDistOrNone(bool didImpact, float impactDist)
+{
+	return didImpact ? impactDist : RAYCAST_NO_IMPACT_DIST;
+}
+
+// Some coordinates land exactly on whole numbers, so rays start on, and run along, the faces of whole number boxes
+static float RollCoordinate(RandomNumberGenerator& rng, float minValue, float maxValue)
+{
+	float value = rng.RollRandomFloatInRange(minValue, maxValue);
+	return rng.RollRandomIntLessThan(8) == 0 ? (float)(int)value : value;
+}
+
+static Vec2 RollDirection2D(RandomNumberGenerator& rng)
+{
+	Vec2 direction;
+	do
+	{
+		direction = Vec2(rng.RollRandomFloatInRange(-1.f, 1.f), rng.RollRandomFloatInRange(-1.f, 1.f));
+		if (rng.RollRandomIntLessThan(5) == 0)
+		{
+			direction.y = 0.f;
+		}
+	} while (direction.GetLengthSquared() < 0.01f);
+	return direction.GetNormalized();
+}
+
+// Zero length rays, and rays that could reach the shape but stop short
+static float RollRayLength(RandomNumberGenerator& rng, float maxLength)
+{
+	return rng.RollRandomIntLessThan(16) == 0 ? 0.f : rng.RollRandomFloatInRange(0.f, maxLength);
+}
+
+// A ray that just touches the sphere: it passes the center at exactly the radius
+static void MakeGrazingRay(RandomNumberGenerator& rng, Vec3 const& sphereCenter, float sphereRadius, Vec3& out_rayStart, Vec3& out_rayForwardNormal)
+{
+	out_rayForwardNormal = RollSelfTestDirection3D(rng, true);
+	Vec3 side = CrossProduct3D(out_rayForwardNormal, Vec3(0.f, 0.f, 1.f));
+	if (side.GetLengthSquared() < 0.01f)
+	{
+		side = CrossProduct3D(out_rayForwardNormal, Vec3(1.f, 0.f, 0.f));
+	}
+	side = side.GetNormalized();
+	out_rayStart = sphereCenter + side * sphereRadius - out_rayForwardNormal * rng.RollRandomFloatInRange(0.5f, 5.f);
+}
+
+bool SelfTestBatchRaycasts(unsigned int seed)
+{
+	RandomNumberGenerator rng(seed);
+	int numMismatches = 0;
+
+	// Many rays against one shape
+	for (int trial = 0; trial < 100; ++trial)
+	{
+		int numRays = 1 + rng.RollRandomIntLessThan(503); // odd counts too, for the scalar tail after the last full group of four
+		AABB3 box(RollCoordinate(rng, -3.f, 0.f), RollCoordinate(rng, -3.f, 0.f), RollCoordinate(rng, -3.f, 0.f), RollCoordinate(rng, 0.f, 3.f), RollCoordinate(rng, 0.f, 3.f), RollCoordinate(rng, 0.f, 3.f));
+		Vec3 sphereCenter = rng.RollRandomVector3DInRange(Vec3(-2.f, -2.f, -2.f), Vec3(2.f, 2.f, 2.f));
+		float sphereRadius = rng.RollRandomFloatInRange(0.5f, 3.f);
+		Vec2 discCenter(rng.RollRandomFloatInRange(-2.f, 2.f), rng.RollRandomFloatInRange(-2.f, 2.f));
+		float discRadius = rng.RollRandomFloatInRange(0.5f, 3.f);
+
+		RaycastBatch3D rays;
+		RaycastBatch2D rays2D;
+		rays.Reserve(numRays);
+		rays2D.Reserve(numRays);
+		for (int rayIndex = 0; rayIndex < numRays; ++rayIndex)
+		{
+			Vec3 rayStart(RollCoordinate(rng, -6.f, 6.f), RollCoordinate(rng, -6.f, 6.f), RollCoordinate(rng, -6.f, 6.f));
+			Vec3 rayForwardNormal = RollSelfTestDirection3D(rng, true);
+			if (rng.RollRandomIntLessThan(8) == 0)
+			{
+				MakeGrazingRay(rng, sphereCenter, sphereRadius, rayStart, rayForwardNormal);
+			}
+			rays.AddRay(rayStart, rayForwardNormal, RollRayLength(rng, 15.f));
+			Vec2 rayStart2D(rng.RollRandomFloatInRange(-6.f, 6.f), rng.RollRandomFloatInRange(-6.f, 6.f));
+			rays2D.AddRay(rayStart2D, RollDirection2D(rng), RollRayLength(rng, 15.f));
+		}
+
+		std::vector<float> boxDists;
+		std::vector<float> sphereDists;
+		std::vector<float> discDists;
+		RaycastVsAABB3D(rays, box, boxDists);
+		RaycastVsSphere3D(rays, sphereCenter, sphereRadius, sphereDists);
+		RaycastVsDisc2D(rays2D, discCenter, discRadius, discDists);
+		for (int rayIndex = 0; rayIndex < numRays; ++rayIndex)
+		{
+			Vec3 rayStart(rays.m_startX[rayIndex], rays.m_startY[rayIndex], rays.m_startZ[rayIndex]);
+			Vec3 rayForwardNormal(rays.m_fwdNormalX[rayIndex], rays.m_fwdNormalY[rayIndex], rays.m_fwdNormalZ[rayIndex]);
+			float rayLength = rays.m_rayLength[rayIndex];
+			RaycastResult3D boxResult = RaycastVsAABB3D(rayStart, rayForwardNormal, rayLength, box);
+			RaycastResult3D sphereResult = RaycastVsSphere3D(rayStart, rayForwardNormal, rayLength, sphereCenter, sphereRadius);
+			RaycastResult2D discResult = RaycastVsDisc2D(Vec2(rays2D.m_startX[rayIndex], rays2D.m_startY[rayIndex]), Vec2(rays2D.m_fwdNormalX[rayIndex], rays2D.m_fwdNormalY[rayIndex]), rays2D.m_maxDist[rayIndex], discCenter, discRadius);
+
+			float boxDist = GetImpactDistOrNone(boxResult.m_didImpact, boxResult.m_impactDist);
+			float sphereDist = GetImpactDistOrNone(sphereResult.m_didImpact, sphereResult.m_impactDist);
+			float discDist = GetImpactDistOrNone(discResult.m_didImpact, discResult.m_impactDist);
+			if (!AreBitwiseEqual(boxDists[rayIndex], boxDist))
+			{
+				ReportSelfTestMismatch(numMismatches, "rays vs AABB3", trial, boxDists[rayIndex], boxDist);
+			}
+			if (!AreBitwiseEqual(sphereDists[rayIndex], sphereDist))
+			{
+				ReportSelfTestMismatch(numMismatches, "rays vs sphere", trial, sphereDists[rayIndex], sphereDist);
+			}
+			if (!AreBitwiseEqual(discDists[rayIndex], discDist))
+			{
+				ReportSelfTestMismatch(numMismatches, "rays vs disc", trial, discDists[rayIndex], discDist);
+			}
+		}
+	}
+
+	// One ray against many shapes, checked against the nearest of the single raycasts (the lowest index on ties)
+	for (int trial = 0; trial < 100; ++trial)
+	{
+		int numShapes = 1 + rng.RollRandomIntLessThan(203);
+		AABB3Batch boxes;
+		SphereBatch3D spheres;
+		DiscBatch2D discs;
+		for (int shapeIndex = 0; shapeIndex < numShapes; ++shapeIndex)
+		{
+			Vec3 corner(RollCoordinate(rng, -20.f, 20.f), RollCoordinate(rng, -20.f, 20.f), RollCoordinate(rng, -20.f, 20.f));
+			Vec3 size(RollCoordinate(rng, 0.1f, 3.f), RollCoordinate(rng, 0.1f, 3.f), RollCoordinate(rng, 0.1f, 3.f));
+			boxes.AddBox(AABB3(corner, corner + size));
+			spheres.AddSphere(corner, rng.RollRandomFloatInRange(0.2f, 2.f));
+			discs.AddDisc(Vec2(corner.x, corner.y), rng.RollRandomFloatInRange(0.2f, 2.f));
+		}
+
+		for (int rayIndex = 0; rayIndex < 40; ++rayIndex)
+		{
+			Vec3 rayStart(RollCoordinate(rng, -20.f, 20.f), RollCoordinate(rng, -20.f, 20.f), RollCoordinate(rng, -20.f, 20.f));
+			Vec3 rayForwardNormal = RollSelfTestDirection3D(rng, true);
+			int grazedSphere = rng.RollRandomIntLessThan(numShapes);
+			if (rng.RollRandomIntLessThan(8) == 0)
+			{
+				Vec3 sphereCenter(spheres.m_centerX[grazedSphere], spheres.m_centerY[grazedSphere], spheres.m_centerZ[grazedSphere]);
+				MakeGrazingRay(rng, sphereCenter, spheres.m_radius[grazedSphere], rayStart, rayForwardNormal);
+			}
+			float rayLength = RollRayLength(rng, 60.f);
+			Vec2 rayStart2D(rayStart.x, rayStart.y);
+			Vec2 rayForwardNormal2D = RollDirection2D(rng);
+
+			int nearestBox = -1;
+			int nearestSphere = -1;
+			int nearestDisc = -1;
+			RaycastResult3D boxResult = RaycastVsAABBs3D(rayStart, rayForwardNormal, rayLength, boxes, &nearestBox);
+			RaycastResult3D sphereResult = RaycastVsSpheres3D(rayStart, rayForwardNormal, rayLength, spheres, &nearestSphere);
+			RaycastResult2D discResult = RaycastVsDiscs2D(rayStart2D, rayForwardNormal2D, rayLength, discs, &nearestDisc);
+
+			int expectedBox = -1;
+			int expectedSphere = -1;
+			int expectedDisc = -1;
+			RaycastResult3D expectedBoxResult;
+			RaycastResult3D expectedSphereResult;
+			RaycastResult2D expectedDiscResult;
+			for (int shapeIndex = 0; shapeIndex < numShapes; ++shapeIndex)
+			{
+				AABB3 box(boxes.m_minsX[shapeIndex], boxes.m_minsY[shapeIndex], boxes.m_minsZ[shapeIndex], boxes.m_maxsX[shapeIndex], boxes.m_maxsY[shapeIndex], boxes.m_maxsZ[shapeIndex]);
+				RaycastResult3D result = RaycastVsAABB3D(rayStart, rayForwardNormal, rayLength, box);
+				if (result.m_didImpact && (expectedBox < 0 || result.m_impactDist < expectedBoxResult.m_impactDist))
+				{
+					expectedBox = shapeIndex;
+					expectedBoxResult = result;
+				}
+				Vec3 sphereCenter(spheres.m_centerX[shapeIndex], spheres.m_centerY[shapeIndex], spheres.m_centerZ[shapeIndex]);
+				result = RaycastVsSphere3D(rayStart, rayForwardNormal, rayLength, sphereCenter, spheres.m_radius[shapeIndex]);
+				if (result.m_didImpact && (expectedSphere < 0 || result.m_impactDist < expectedSphereResult.m_impactDist))
+				{
+					expectedSphere = shapeIndex;
+					expectedSphereResult = result;
+				}
+				RaycastResult2D result2D = RaycastVsDisc2D(rayStart2D, rayForwardNormal2D, rayLength, Vec2(discs.m_centerX[shapeIndex], discs.m_centerY[shapeIndex]), discs.m_radius[shapeIndex]);
+				if (result2D.m_didImpact && (expectedDisc < 0 || result2D.m_impactDist < expectedDiscResult.m_impactDist))
+				{
+					expectedDisc = shapeIndex;
+					expectedDiscResult = result2D;
+				}
+			}
+
+			if (nearestBox != expectedBox || boxResult.m_didImpact != expectedBoxResult.m_didImpact || !AreBitwiseEqual(boxResult.m_impactDist, expectedBoxResult.m_impactDist)
+				|| memcmp(&boxResult.m_impactNormal, &expectedBoxResult.m_impactNormal, sizeof(Vec3)) != 0)
+			{
+				ReportSelfTestMismatch(numMismatches, "ray vs AABB3s", trial, boxResult.m_impactDist, expectedBoxResult.m_impactDist);
+			}
+			if (nearestSphere != expectedSphere || sphereResult.m_didImpact != expectedSphereResult.m_didImpact || !AreBitwiseEqual(sphereResult.m_impactDist, expectedSphereResult.m_impactDist)
+				|| memcmp(&sphereResult.m_impactNormal, &expectedSphereResult.m_impactNormal, sizeof(Vec3)) != 0)
+			{
+				ReportSelfTestMismatch(numMismatches, "ray vs spheres", trial, sphereResult.m_impactDist, expectedSphereResult.m_impactDist);
+			}
+			if (nearestDisc != expectedDisc || discResult.m_didImpact != expectedDiscResult.m_didImpact || !AreBitwiseEqual(discResult.m_impactDist, expectedDiscResult.m_impactDist)
+				|| memcmp(&discResult.m_impactNormal, &expectedDiscResult.m_impactNormal, sizeof(Vec2)) != 0)
+			{
+				ReportSelfTestMismatch(numMismatches, "ray vs discs", trial, discResult.m_impactDist, expectedDiscResult.m_impactDist);
+			}
+		}
+	}
+
+	if (numMismatches > 0)
+	{
+		DebuggerPrintf("SelfTestBatchRaycasts (seed %u): %d mismatches\n", seed, numMismatches);
+	}
+	return numMismatches == 0;
+}
+
+static OBB3 RollOrientedBox(RandomNumberGenerator& rng, Vec3 const& center)
+{
+	Vec3 iBasis = RollSelfTestDirection3D(rng, true);
+	Vec3 kBasis;
+	do
+	{
+		kBasis = CrossProduct3D(iBasis, RollSelfTestDirection3D(rng, true));
+	} while (kBasis.GetLengthSquared() < 0.01f);
+	Vec3 jBasis = CrossProduct3D(kBasis.GetNormalized(), iBasis);
+	Vec3 halfDimensions(rng.RollRandomFloatInRange(0.1f, 2.f), rng.RollRandomFloatInRange(0.1f, 2.f), rng.RollRandomFloatInRange(0.1f, 2.f));
+	return OBB3(center, iBasis, jBasis, halfDimensions);
+}
+
+// Adds a random shape of a random type, or moves an existing shape keeping its type
+static void RollBVH3Shape(RandomNumberGenerator& rng, BVH3& bvh, int shapeIdToMove, float sceneHalfSize)
+{
+	BVH3ShapeType type = shapeIdToMove < 0 ? (BVH3ShapeType)rng.RollRandomIntLessThan((int)BVH3ShapeType::COUNT) : bvh.GetShape(shapeIdToMove).m_type;
+	Vec3 center = rng.RollRandomVector3DInRange(Vec3(-sceneHalfSize, -sceneHalfSize, -sceneHalfSize), Vec3(sceneHalfSize, sceneHalfSize, sceneHalfSize));
+	float radius = rng.RollRandomFloatInRange(0.1f, 2.f);
+	switch (type)
+	{
+	case BVH3ShapeType::AABB3:
+	{
+		Vec3 halfDimensions(rng.RollRandomFloatInRange(0.1f, 2.f), rng.RollRandomFloatInRange(0.1f, 2.f), rng.RollRandomFloatInRange(0.1f, 2.f));
+		AABB3 box(center - halfDimensions, center + halfDimensions);
+		if (shapeIdToMove < 0)
+		{
+			bvh.AddAABB3(box);
+		}
+		else
+		{
+			bvh.SetAABB3(shapeIdToMove, box);
+		}
+		break;
+	}
+	case BVH3ShapeType::OBB3:
+	{
+		OBB3 orientedBox = RollOrientedBox(rng, center);
+		if (shapeIdToMove < 0)
+		{
+			bvh.AddOBB3(orientedBox);
+		}
+		else
+		{
+			bvh.SetOBB3(shapeIdToMove, orientedBox);
+		}
+		break;
+	}
+	case BVH3ShapeType::SPHERE:
+		if (shapeIdToMove < 0)
+		{
+			bvh.AddSphere(center, radius);
+		}
+		else
+		{
+			bvh.SetSphere(shapeIdToMove, center, radius);
+		}
+		break;
+	case BVH3ShapeType::Z_CYLINDER:
+	{
+		float halfHeight = rng.RollRandomFloatInRange(0.1f, 2.f);
+		FloatRange minMaxZ(center.z - halfHeight, center.z + halfHeight);
+		if (shapeIdToMove < 0)
+		{
+			bvh.AddZCylinder(Vec2(center.x, center.y), minMaxZ, radius);
+		}
+		else
+		{
+			bvh.SetZCylinder(shapeIdToMove, Vec2(center.x, center.y), minMaxZ, radius);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+// Every query through the tree against the same query over all shapes: same ids, and the same impact bit for bit
+static void CompareBVH3WithAllShapes(RandomNumberGenerator& rng, BVH3 const& bvh, float sceneHalfSize, int numQueries, int sceneIndex, int& numMismatches)
+{
+	std::vector<int> treeShapeIds;
+	std::vector<int> allShapeIds;
+	for (int queryIndex = 0; queryIndex < numQueries; ++queryIndex)
+	{
+		float rayHalfSize = 1.2f * sceneHalfSize;
+		Vec3 rayStart = rng.RollRandomVector3DInRange(Vec3(-rayHalfSize, -rayHalfSize, -rayHalfSize), Vec3(rayHalfSize, rayHalfSize, rayHalfSize));
+		Vec3 rayForwardNormal = RollSelfTestDirection3D(rng, true);
+		float rayLength = RollRayLength(rng, 3.f * sceneHalfSize);
+		int treeShapeId = -1;
+		int allShapeId = -1;
+		RaycastResult3D treeResult = bvh.Raycast(rayStart, rayForwardNormal, rayLength, &treeShapeId);
+		RaycastResult3D allResult = bvh.RaycastAllShapes(rayStart, rayForwardNormal, rayLength, &allShapeId);
+		if (treeShapeId != allShapeId || treeResult.m_didImpact != allResult.m_didImpact || !AreBitwiseEqual(treeResult.m_impactDist, allResult.m_impactDist))
+		{
+			ReportSelfTestMismatch(numMismatches, "BVH3 raycast", sceneIndex, treeResult.m_impactDist, allResult.m_impactDist);
+		}
+
+		Vec3 queryCenter = rng.RollRandomVector3DInRange(Vec3(-sceneHalfSize, -sceneHalfSize, -sceneHalfSize), Vec3(sceneHalfSize, sceneHalfSize, sceneHalfSize));
+		float queryRadius = rng.RollRandomFloatInRange(0.f, 0.2f * sceneHalfSize);
+		bvh.OverlapSphere(queryCenter, queryRadius, treeShapeIds);
+		bvh.OverlapSphereAllShapes(queryCenter, queryRadius, allShapeIds);
+		if (treeShapeIds != allShapeIds)
+		{
+			ReportSelfTestMismatch(numMismatches, "BVH3 sphere overlap (shape counts)", sceneIndex, (float)treeShapeIds.size(), (float)allShapeIds.size());
+		}
+
+		Vec3 queryHalfDimensions = rng.RollRandomVector3DInRange(Vec3(), Vec3(0.2f * sceneHalfSize, 0.2f * sceneHalfSize, 0.2f * sceneHalfSize));
+		AABB3 queryBox(queryCenter - queryHalfDimensions, queryCenter + queryHalfDimensions);
+		bvh.OverlapAABB3(queryBox, treeShapeIds);
+		bvh.OverlapAABB3AllShapes(queryBox, allShapeIds);
+		if (treeShapeIds != allShapeIds)
+		{
+			ReportSelfTestMismatch(numMismatches, "BVH3 box overlap (shape counts)", sceneIndex, (float)treeShapeIds.size(), (float)allShapeIds.size());
+		}
+	}
+}
+
+bool SelfTestBVH3(unsigned int seed)
+{
+	RandomNumberGenerator rng(seed);
+	int numMismatches = 0;
+	for (int sceneIndex = 0; sceneIndex < 20; ++sceneIndex)
+	{
+		BVH3 bvh;
+		int numShapes = 1 + rng.RollRandomIntLessThan(1000);
+		float sceneHalfSize = rng.RollRandomFloatInRange(5.f, 100.f);
+		for (int shapeIndex = 0; shapeIndex < numShapes; ++shapeIndex)
+		{
+			RollBVH3Shape(rng, bvh, -1, sceneHalfSize);
+		}
+		bvh.Build();
+		CompareBVH3WithAllShapes(rng, bvh, sceneHalfSize, 100, sceneIndex, numMismatches);
+
+		// Refit after moving a fifth of the shapes, a few times over so the tree gets loose
+		for (int refitIndex = 0; refitIndex < 3; ++refitIndex)
+		{
+			for (int moveIndex = 0; moveIndex <= numShapes / 5; ++moveIndex)
+			{
+				RollBVH3Shape(rng, bvh, rng.RollRandomIntLessThan(numShapes), sceneHalfSize);
+			}
+			bvh.Refit();
+			CompareBVH3WithAllShapes(rng, bvh, sceneHalfSize, 100, sceneIndex, numMismatches);
+		}
+	}
+
+	// Every centroid in the same place, where no split separates anything
+	BVH3 stackedBVH;
+	for (int shapeIndex = 0; shapeIndex < 100; ++shapeIndex)
+	{
+		stackedBVH.AddSphere(Vec3(1.f, 1.f, 1.f), 1.f);
+	}
+	stackedBVH.Build();
+	CompareBVH3WithAllShapes(rng, stackedBVH, 3.f, 200, -1, numMismatches);
+
+	if (numMismatches > 0)
+	{
+		DebuggerPrintf("SelfTestBVH3 (seed %u): %d mismatches\n", seed, numMismatches);
+	}
+	return numMismatches == 0;
+}
+
+static char const* const MAT44_SIMD_LEVEL_NAMES[(int)Mat44SimdLevel::COUNT] = { "scalar", "SSE2", "AVX2" };
+
+// Rotation, non-uniform scale (negative too) and translation, so the w row is 0,0,0,1
+static Mat44 RollAffineMatrix(RandomNumberGenerator& rng)
+{
+	Mat44 matrix = Mat44::CreateTranslation3D(rng.RollRandomVector3DInRange(Vec3(-100.f, -100.f, -100.f), Vec3(100.f, 100.f, 100.f)));
+	matrix.AppendZRotation(rng.RollRandomFloatInRange(-180.f, 180.f));
+	matrix.AppendYRotation(rng.RollRandomFloatInRange(-180.f, 180.f));
+	matrix.AppendXRotation(rng.RollRandomFloatInRange(-180.f, 180.f));
+	Vec3 scale = rng.RollRandomVector3DInRange(Vec3(0.2f, 0.2f, 0.2f), Vec3(5.f, 5.f, 5.f));
+	if (rng.RollRandomIntLessThan(4) == 0)
+	{
+		scale.y = -scale.y;
+	}
+	matrix.AppendScaleNonUniform3D(scale);
+	return matrix;
+}
+
+// Any of: an affine matrix, a perspective projection, or a full 4x4 with a dominant diagonal so it is well conditioned
+static Mat44 RollMatrix(RandomNumberGenerator& rng)
+{
+	int matrixCase = rng.RollRandomIntLessThan(3);
+	if (matrixCase == 0)
+	{
+		return RollAffineMatrix(rng);
+	}
+	if (matrixCase == 1)
+	{
+		Mat44 matrix = Mat44::CreatePerspectiveProjection(rng.RollRandomFloatInRange(30.f, 120.f), rng.RollRandomFloatInRange(0.5f, 2.f), rng.RollRandomFloatInRange(0.01f, 1.f), rng.RollRandomFloatInRange(10.f, 1000.f));
+		matrix.Append(RollAffineMatrix(rng));
+		return matrix;
+	}
+	Mat44 matrix;
+	for (int valueIndex = 0; valueIndex < 16; ++valueIndex)
+	{
+		matrix.m_values[valueIndex] = rng.RollRandomFloatInRange(-1.f, 1.f) + ((valueIndex % 5 == 0) ? 4.f : 0.f);
+	}
+	return matrix;
+}
+
+static float GetLargestAbsValue(Mat44 const& matrix)
+{
+	float largestAbsValue = 0.f;
+	for (int valueIndex = 0; valueIndex < 16; ++valueIndex)
+	{
+		largestAbsValue = MaxFloat(largestAbsValue, AbsFloat(matrix.m_values[valueIndex]));
+	}
+	return largestAbsValue;
+}
+
+// The SIMD inverses round differently from the scalar ones, so they only have to agree to within rounding: some tens of
+// ulps of the largest value, times the condition number (estimated from the largest values of the matrix and its inverse)
+static float GetMat44InverseTolerance(Mat44 const& matrix, Mat44 const& referenceInverse)
+{
+	float largestInverseValue = GetLargestAbsValue(referenceInverse);
+	return 1e-5f * GetLargestAbsValue(matrix) * largestInverseValue * largestInverseValue;
+}
+
+static void CompareMat44Inverses(char const* what, int caseIndex, Mat44 const& inverse, Mat44 const& referenceInverse, float tolerance, int& numMismatches)
+{
+	for (int valueIndex = 0; valueIndex < 16; ++valueIndex)
+	{
+		if (!(AbsFloat(inverse.m_values[valueIndex] - referenceInverse.m_values[valueIndex]) <= tolerance))
+		{
+			ReportSelfTestMismatch(numMismatches, what, caseIndex, inverse.m_values[valueIndex], referenceInverse.m_values[valueIndex]);
+			return;
+		}
+	}
+}
+
+// Runs the batched transform at simdLevel over the packed elements, out of place and then in place, and checks both
+// against the scalar results bitwise
+static void CompareMat44Transforms(Mat44SimdLevel simdLevel, bool isPosition, Mat44 const& matrix, std::vector<float> const& elements, size_t stride, size_t numElements, std::vector<float> const& referenceResults, int caseIndex, int& numMismatches)
+{
+	std::vector<float> results(elements.size(), 0.f);
+	std::vector<float> inPlaceResults(elements);
+	Vec3 const* in = reinterpret_cast<Vec3 const*>(elements.data());
+	Vec3* out = reinterpret_cast<Vec3*>(results.data());
+	Vec3* inPlace = reinterpret_cast<Vec3*>(inPlaceResults.data());
+	if (isPosition)
+	{
+		Mat44::TransformPositions3DAtSimdLevel(simdLevel, matrix, in, stride, out, stride, numElements);
+		Mat44::TransformPositions3DAtSimdLevel(simdLevel, matrix, inPlace, stride, inPlace, stride, numElements);
+	}
+	else
+	{
+		Mat44::TransformVectorQuantities3DAtSimdLevel(simdLevel, matrix, in, stride, out, stride, numElements);
+		Mat44::TransformVectorQuantities3DAtSimdLevel(simdLevel, matrix, inPlace, stride, inPlace, stride, numElements);
+	}
+
+	size_t floatsPerStride = stride / sizeof(float);
+	for (size_t elementIndex = 0; elementIndex < numElements; ++elementIndex)
+	{
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			size_t floatIndex = elementIndex * floatsPerStride + axis;
+			if (!AreBitwiseEqual(results[floatIndex], referenceResults[floatIndex]))
+			{
+				ReportSelfTestMismatch(numMismatches, Stringf("Mat44 %s %s", MAT44_SIMD_LEVEL_NAMES[(int)simdLevel], isPosition ? "TransformPositions3D" : "TransformVectorQuantities3D").c_str(), caseIndex, results[floatIndex], referenceResults[floatIndex]);
+			}
+			if (!AreBitwiseEqual(inPlaceResults[floatIndex], referenceResults[floatIndex]))
+			{
+				ReportSelfTestMismatch(numMismatches, Stringf("Mat44 %s %s in place", MAT44_SIMD_LEVEL_NAMES[(int)simdLevel], isPosition ? "TransformPositions3D" : "TransformVectorQuantities3D").c_str(), caseIndex, inPlaceResults[floatIndex], referenceResults[floatIndex]);
+			}
+		}
+	}
+}
+
+bool SelfTestMat44Simd(unsigned int seed)
+{
+	RandomNumberGenerator rng(seed);
+	int numMismatches = 0;
+	for (int trial = 0; trial < 200; ++trial)
+	{
+		Mat44 matrix = RollMatrix(rng);
+		bool isAffine = matrix.m_values[Mat44::Iw] == 0.f && matrix.m_values[Mat44::Jw] == 0.f && matrix.m_values[Mat44::Kw] == 0.f && matrix.m_values[Mat44::Tw] == 1.f;
+
+		// Tightly packed, vertex sized and large strides; odd counts too, for the tails after the last full SIMD batch
+		static size_t const STRIDES[] = { sizeof(Vec3), 2 * sizeof(Vec3), 60 };
+		size_t stride = STRIDES[rng.RollRandomIntLessThan(3)];
+		size_t numElements = (size_t)rng.RollRandomIntInRange(1, 300);
+		std::vector<float> elements(numElements * stride / sizeof(float));
+		for (float& value : elements)
+		{
+			value = rng.RollRandomFloatInRange(-1000.f, 1000.f);
+		}
+
+		for (int positionCase = 0; positionCase < 2; ++positionCase)
+		{
+			bool isPosition = positionCase == 0;
+			std::vector<float> referenceResults(elements.size(), 0.f);
+			Vec3 const* in = reinterpret_cast<Vec3 const*>(elements.data());
+			Vec3* out = reinterpret_cast<Vec3*>(referenceResults.data());
+			if (isPosition)
+			{
+				Mat44::TransformPositions3DAtSimdLevel(Mat44SimdLevel::SCALAR, matrix, in, stride, out, stride, numElements);
+			}
+			else
+			{
+				Mat44::TransformVectorQuantities3DAtSimdLevel(Mat44SimdLevel::SCALAR, matrix, in, stride, out, stride, numElements);
+			}
+			CompareMat44Transforms(Mat44SimdLevel::SSE2, isPosition, matrix, elements, stride, numElements, referenceResults, trial, numMismatches);
+			CompareMat44Transforms(Mat44SimdLevel::AVX2, isPosition, matrix, elements, stride, numElements, referenceResults, trial, numMismatches);
+		}
+
+		float referenceDeterminant = 0.f;
+		Mat44 referenceInverse = Mat44::GetInverseAtSimdLevel(Mat44SimdLevel::SCALAR, matrix, &referenceDeterminant);
+		Mat44 referenceAffineInverse = Mat44::GetAffineInverseAtSimdLevel(Mat44SimdLevel::SCALAR, matrix);
+		Mat44 referenceInverseTranspose = Mat44::GetInverseTranspose3DAtSimdLevel(Mat44SimdLevel::SCALAR, matrix);
+		float inverseTolerance = GetMat44InverseTolerance(matrix, referenceInverse);
+		float determinantTolerance = 1e-5f * GetLargestAbsValue(matrix) * GetLargestAbsValue(referenceInverse) * AbsFloat(referenceDeterminant);
+		for (int levelIndex = (int)Mat44SimdLevel::SSE2; levelIndex < (int)Mat44SimdLevel::COUNT; ++levelIndex)
+		{
+			Mat44SimdLevel simdLevel = (Mat44SimdLevel)levelIndex;
+			float determinant = 0.f;
+			Mat44 inverse = Mat44::GetInverseAtSimdLevel(simdLevel, matrix, &determinant);
+			CompareMat44Inverses(Stringf("Mat44 %s GetInverse", MAT44_SIMD_LEVEL_NAMES[levelIndex]).c_str(), trial, inverse, referenceInverse, inverseTolerance, numMismatches);
+			if (!(AbsFloat(determinant - referenceDeterminant) <= determinantTolerance))
+			{
+				ReportSelfTestMismatch(numMismatches, Stringf("Mat44 %s GetInverse determinant", MAT44_SIMD_LEVEL_NAMES[levelIndex]).c_str(), trial, determinant, referenceDeterminant);
+			}
+			if (isAffine)
+			{
+				CompareMat44Inverses(Stringf("Mat44 %s GetAffineInverse", MAT44_SIMD_LEVEL_NAMES[levelIndex]).c_str(), trial, Mat44::GetAffineInverseAtSimdLevel(simdLevel, matrix), referenceAffineInverse, GetMat44InverseTolerance(matrix, referenceAffineInverse), numMismatches);
+			}
+			CompareMat44Inverses(Stringf("Mat44 %s GetInverseTranspose3D", MAT44_SIMD_LEVEL_NAMES[levelIndex]).c_str(), trial, Mat44::GetInverseTranspose3DAtSimdLevel(simdLevel, matrix), referenceInverseTranspose, GetMat44InverseTolerance(matrix, referenceInverseTranspose), numMismatches);
+		}
+	}
+
+	if (numMismatches > 0)
+	{
+		DebuggerPrintf("SelfTestMat44Simd (seed %u): %d mismatches\n", seed, numMismatches);
+	}
+	return numMismatches == 0;
+}
+
+bool Command_MathSelfTest(EventArgs& args)
+{
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1);
+	ReportSelfTestResult("SelfTestBatchRaycasts", SelfTestBatchRaycasts(seed));
+	ReportSelfTestResult("SelfTestBVH3", SelfTestBVH3(seed));
+	ReportSelfTestResult("SelfTestMat44Simd", SelfTestMat44Simd(seed));
+	return true;
+}
+
+bool Command_Mat44Benchmark(EventArgs& args)
+{
+	UNUSED(args);
+	static int const NUM_POSITIONS[] = { 1, 1000, 1000000 };
+	std::vector<Vec3> positions(1000000, Vec3(1.f, 2.f, 3.f));
+	Mat44 matrix = Mat44::CreatePerspectiveProjection(60.f, 1.5f, 0.1f, 100.f);
+	matrix.AppendZRotation(30.f);
+	for (int countIndex = 0; countIndex < 3; ++countIndex)
+	{
+		// About the same number of positions transformed whatever the batch size, so the small batches show their overhead
+		int numPositions = NUM_POSITIONS[countIndex];
+		int numRepeats = 4000000 / numPositions;
+		for (int levelIndex = 0; levelIndex < (int)Mat44SimdLevel::COUNT; ++levelIndex)
+		{
+			double startSeconds = GetCurrentTimeSeconds();
+			for (int repeatIndex = 0; repeatIndex < numRepeats; ++repeatIndex)
+			{
+				Mat44::TransformPositions3DAtSimdLevel((Mat44SimdLevel)levelIndex, matrix, positions.data(), sizeof(Vec3), positions.data(), sizeof(Vec3), (size_t)numPositions);
+			}
+			double nanosecondsPerPosition = 1e9 * (GetCurrentTimeSeconds() - startSeconds) / ((double)numRepeats * (double)numPositions);
+			std::string line = Stringf("Mat44 TransformPositions3D %s, %d positions: %.2f ns per position", MAT44_SIMD_LEVEL_NAMES[levelIndex], numPositions, nanosecondsPerPosition);
+			if (g_theConsole)
+			{
+				g_theConsole->AddLine(DevConsole::INFO_MINOR, line);
+			}
+			DebuggerPrintf("%s\n", line.c_str());
+		}
+	}
+	return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "Engine/Core/EventSystem.hpp"
+
+// Checks of the math fast paths against the simple versions they must agree with, over random cases generated from
+// seed. Each returns true when everything matched and reports the first few mismatches with DebuggerPrintf.
+
+// Batched SSE2 raycasts against the single RaycastVs* functions, bitwise, including rays starting on faces, rays
+// lying in a face's plane and zero length rays
+bool SelfTestBatchRaycasts(unsigned int seed = 1);
+
+// BVH3 raycasts and overlaps against the same queries over all shapes (ids, and impact distances bitwise), over random
+// mixed scenes right after Build() and after moving shapes and refitting
+bool SelfTestBVH3(unsigned int seed = 1);
+
+// Mat44's SSE2 and AVX2 kernels against the scalar ones over random affine, projection and full 4x4 matrices: the
+// batched transforms bitwise (any count and stride, and in place), and the inverses and determinant to within rounding.
+// Runs each level explicitly, never changes the level the rest of the engine uses.
+bool SelfTestMat44Simd(unsigned int seed = 1);
+
+// "MathSelfTest seed=N" in the dev console runs all of the above
+bool Command_MathSelfTest(EventArgs& args);
+
+// "Mat44Benchmark" in the dev console times Mat44::TransformPositions3D at each SIMD level over 1, 1k and 1M positions
+bool Command_Mat44Benchmark(EventArgs& args);
@@ -1,6 +1,7 @@
 #include "MathUtils.hpp"
 #include "Engine/Core/EngineCommon.hpp"
 #include <algorithm>
+#include <cstring>
 Mat44 GetBillboardMatrix(BillboardType billboardType, Mat44 const& targetMatrix, Vec3 const& billboardPosition, Vec2 const& billboardScale)
 {
 	Vec3 iBasis, jBasis, kBasis;
@@ -642,6 +643,74 @@ bool DoOBB3DAndPlane3DOverlap(OBB3 const& orientedBox, Plane3 const& plane)
 	return false;
 }
 
+bool DoSphereAndOBB3DOverlap(Vec3 const& sphereCenter, float sphereRadius, OBB3 const& orientedBox)
+{
+	Vec3 nearestPos = GetNearestPointOnOBB3D(sphereCenter, orientedBox);
+	return GetDistanceSquared3D(nearestPos, sphereCenter) <= sphereRadius * sphereRadius;
+}
+
+// Separating axis test: the boxes are apart if their projections are apart on one of the 3 world axes, the 3 box axes
+// or the 9 cross products of the two
+bool DoAABB3AndOBB3DOverlap(AABB3 const& box, OBB3 const& orientedBox)
+{
+	Vec3 boxHalfDimensions = (box.m_maxs - box.m_mins) * 0.5f;
+	Vec3 centerOffset = orientedBox.m_center - (box.m_mins + box.m_maxs) * 0.5f;
+	float boxHalves[3] = { boxHalfDimensions.x, boxHalfDimensions.y, boxHalfDimensions.z };
+	float orientedHalves[3] = { orientedBox.m_halfDimensions.x, orientedBox.m_halfDimensions.y, orientedBox.m_halfDimensions.z };
+	float offset[3] = { centerOffset.x, centerOffset.y, centerOffset.z };
+	Vec3 const* orientedAxes[3] = { &orientedBox.m_iBasisNormal, &orientedBox.m_jBasisNormal, &orientedBox.m_kBasisNormal };
+
+	// rotation[i][j] is world axis i dotted with box axis j; the epsilon keeps near-parallel edge pairs from producing
+	// a degenerate cross product axis that separates everything
+	float rotation[3][3];
+	float absRotation[3][3];
+	for (int j = 0; j < 3; ++j)
+	{
+		float components[3] = { orientedAxes[j]->x, orientedAxes[j]->y, orientedAxes[j]->z };
+		for (int i = 0; i < 3; ++i)
+		{
+			rotation[i][j] = components[i];
+			absRotation[i][j] = fabsf(components[i]) + 1e-6f;
+		}
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		float orientedRadius = orientedHalves[0] * absRotation[i][0] + orientedHalves[1] * absRotation[i][1] + orientedHalves[2] * absRotation[i][2];
+		if (fabsf(offset[i]) > boxHalves[i] + orientedRadius)
+		{
+			return false;
+		}
+	}
+	for (int j = 0; j < 3; ++j)
+	{
+		float boxRadius = boxHalves[0] * absRotation[0][j] + boxHalves[1] * absRotation[1][j] + boxHalves[2] * absRotation[2][j];
+		float distance = offset[0] * rotation[0][j] + offset[1] * rotation[1][j] + offset[2] * rotation[2][j];
+		if (fabsf(distance) > boxRadius + orientedHalves[j])
+		{
+			return false;
+		}
+	}
+	for (int i = 0; i < 3; ++i)
+	{
+		int i1 = (i + 1) % 3;
+		int i2 = (i + 2) % 3;
+		for (int j = 0; j < 3; ++j)
+		{
+			int j1 = (j + 1) % 3;
+			int j2 = (j + 2) % 3;
+			float boxRadius = boxHalves[i1] * absRotation[i2][j] + boxHalves[i2] * absRotation[i1][j];
+			float orientedRadius = orientedHalves[j1] * absRotation[i][j2] + orientedHalves[j2] * absRotation[i][j1];
+			float distance = offset[i2] * rotation[i1][j] - offset[i1] * rotation[i2][j];
+			if (fabsf(distance) > boxRadius + orientedRadius)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
 Vec2 const GetNearestPointOnDisc2D(Vec2 const& referencePosition, Vec2 const& discCenter, float discRaius)
 {
 	Vec2 displacement = referencePosition - discCenter;
@@ -1016,6 +1085,111 @@ unsigned char DenormalizeByte(float zeroToOne)
 	return (unsigned char)(zeroToOne *256.f);
 }
 
+short PackSignedNormalizedShort(float minusOneToOne)
+{
+	minusOneToOne = GetClamped(minusOneToOne, -1.f, 1.f);
+	return (short)roundf(minusOneToOne * 32767.f);
+}
+
+float UnpackSignedNormalizedShort(short packedValue)
+{
+	return MaxFloat((float)packedValue / 32767.f, -1.f);
+}
+
+unsigned short FloatToHalf(float value)
+{
+	// Bit twiddling after Fabian Giesen's float_to_half_fast3_rtne: the float unit does the rounding for denormals
+	constexpr unsigned int FLOAT_INFINITY = 255u << 23;
+	constexpr unsigned int HALF_OVERFLOW = (127u + 16u) << 23;
+	constexpr unsigned int SMALLEST_HALF_NORMAL = 113u << 23;
+	constexpr unsigned int DENORMAL_MAGIC = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+	unsigned int bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	unsigned int sign = bits & 0x80000000u;
+	bits ^= sign;
+
+	unsigned int half = 0;
+	if (bits >= HALF_OVERFLOW)
+	{
+		half = bits > FLOAT_INFINITY ? 0x7e00u : 0x7c00u;
+	}
+	else if (bits < SMALLEST_HALF_NORMAL)
+	{
+		float absValue = 0.f;
+		float magic = 0.f;
+		memcpy(&absValue, &bits, sizeof(absValue));
+		memcpy(&magic, &DENORMAL_MAGIC, sizeof(magic));
+		absValue += magic;
+		memcpy(&half, &absValue, sizeof(half));
+		half -= DENORMAL_MAGIC;
+	}
+	else
+	{
+		unsigned int mantissaOdd = (bits >> 13) & 1u;
+		bits += ((15u - 127u) << 23) + 0xfffu;
+		bits += mantissaOdd;
+		half = bits >> 13;
+	}
+	return (unsigned short)(half | (sign >> 16));
+}
+
+float HalfToFloat(unsigned short half)
+{
+	constexpr unsigned int SHIFTED_EXPONENT = 0x7c00u << 13;
+	constexpr unsigned int DENORMAL_MAGIC = 113u << 23;
+
+	unsigned int bits = ((unsigned int)half & 0x7fffu) << 13;
+	unsigned int exponent = bits & SHIFTED_EXPONENT;
+	bits += (127u - 15u) << 23;
+	float value = 0.f;
+	if (exponent == SHIFTED_EXPONENT)
+	{
+		bits += (128u - 16u) << 23; // infinity or NaN
+		memcpy(&value, &bits, sizeof(value));
+	}
+	else if (exponent == 0)
+	{
+		float magic = 0.f;
+		bits += 1u << 23;
+		memcpy(&value, &bits, sizeof(value));
+		memcpy(&magic, &DENORMAL_MAGIC, sizeof(magic));
+		value -= magic; // renormalizes denormals
+	}
+	else
+	{
+		memcpy(&value, &bits, sizeof(value));
+	}
+	return (half & 0x8000u) ? -value : value;
+}
+
+Vec2 const EncodeOctahedral(Vec3 const& unitVector)
+{
+	float sumAbs = fabsf(unitVector.x) + fabsf(unitVector.y) + fabsf(unitVector.z);
+	if (sumAbs == 0.f)
+	{
+		return Vec2(0.f, 0.f);
+	}
+	Vec2 octahedral(unitVector.x / sumAbs, unitVector.y / sumAbs);
+	if (unitVector.z < 0.f)
+	{
+		// Fold the lower half of the octahedron out over the corners of the square
+		float foldedX = (1.f - fabsf(octahedral.y)) * (octahedral.x >= 0.f ? 1.f : -1.f);
+		float foldedY = (1.f - fabsf(octahedral.x)) * (octahedral.y >= 0.f ? 1.f : -1.f);
+		octahedral = Vec2(foldedX, foldedY);
+	}
+	return octahedral;
+}
+
+Vec3 const DecodeOctahedral(Vec2 const& octahedral)
+{
+	Vec3 direction(octahedral.x, octahedral.y, 1.f - fabsf(octahedral.x) - fabsf(octahedral.y));
+	float fold = GetClamped(-direction.z, 0.f, 1.f);
+	direction.x += direction.x >= 0.f ? -fold : fold;
+	direction.y += direction.y >= 0.f ? -fold : fold;
+	return direction.GetNormalized();
+}
+
 float ComputeCubicBezier1D(float A, float B, float C, float D, float t)
 {
 	// First level of interpolation
@@ -103,6 +103,8 @@ bool DoZCylindersOverlap3D(Vec2 const& cylinder1CenterXY, float cylinder1Radius,
 bool DoZCylinderAndAABBOverlap3D(Vec2 const& cylinderCenterXY, float cylinderRadius, FloatRange cylinderMinMaxZ, AABB3 const& box);
 bool DoZCylinderAndSphereOverlap3D(Vec2 const& cylinderCenterXY, float cylinderRadius, FloatRange cylinderMinMaxZ, Vec3 const& sphereCenter, float sphereRadius);
 bool DoOBB3DAndPlane3DOverlap(OBB3 const& orientedBox, Plane3 const& plane);
+bool DoSphereAndOBB3DOverlap(Vec3 const& sphereCenter, float sphereRadius, OBB3 const& orientedBox);
+bool DoAABB3AndOBB3DOverlap(AABB3 const& box, OBB3 const& orientedBox);
 
 Vec2 const GetNearestPointOnDisc2D(Vec2 const& referencePos, Vec2 const& discCenter, float discRaius);
 Vec2 const GetNearestPointOnAABB2D(Vec2 const& referencePos, AABB2 const& box);
@@ -139,6 +141,17 @@ void TransformPositionXY3D(Vec3& positionToTransform, Vec2 const& iBasis, Vec2 c
 float NormalizeByte(unsigned char byteValue);
 unsigned char DenormalizeByte(float zeroToOne);
 
+// 16 bit formats for packed vertexes: snorm16 maps [-1,1] to [-32767,32767], half floats are IEEE binary16 rounded to nearest even
+short PackSignedNormalizedShort(float minusOneToOne);
+float UnpackSignedNormalizedShort(short packedValue);
+unsigned short FloatToHalf(float value);
+float HalfToFloat(unsigned short half);
+
+// Octahedral mapping of unit vectors onto [-1,1]^2 (Cigolle et al. 2014), so a direction fits in two numbers with
+// nearly uniform precision everywhere on the sphere
+Vec2 const EncodeOctahedral(Vec3 const& unitVector);
+Vec3 const DecodeOctahedral(Vec2 const& octahedral);
+
 float ComputeCubicBezier1D(float A, float B, float C, float D, float t);
 float ComputeQuinticBezier1D(float A, float B, float C, float D, float E, float F, float t);
 
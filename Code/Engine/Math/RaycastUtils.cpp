@@ -4,6 +4,11 @@
 #include "Engine/Core/DevConsole.hpp"
 #include "Engine/Core/EngineCommon.hpp"
 #include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RAYCAST_UTILS_HAS_SSE_PATH // SSE2 is part of the x64 baseline, so no runtime check is needed
+#include <immintrin.h>
+#endif
 RaycastResult2D RaycastVsDisc2D(Vec2 startPos, Vec2 ifwdNormal, float maxDist, Vec2 discCenter, float discRadius)
 {
 
@@ -544,3 +549,498 @@ RaycastResult3D RaycastVsPlane3D(Vec3 rayStart, Vec3 rayForwardNormal, float ray
 	}
 	return result;
 }
+
+void RaycastBatch2D::AddRay(Vec2 const& startPos, Vec2 const& fwdNormal, float maxDist)
+{
+	m_startX.push_back(startPos.x);
+	m_startY.push_back(startPos.y);
+	m_fwdNormalX.push_back(fwdNormal.x);
+	m_fwdNormalY.push_back(fwdNormal.y);
+	m_maxDist.push_back(maxDist);
+}
+
+void RaycastBatch2D::Reserve(int numRays)
+{
+	m_startX.reserve(numRays);
+	m_startY.reserve(numRays);
+	m_fwdNormalX.reserve(numRays);
+	m_fwdNormalY.reserve(numRays);
+	m_maxDist.reserve(numRays);
+}
+
+void RaycastBatch2D::Clear()
+{
+	m_startX.clear();
+	m_startY.clear();
+	m_fwdNormalX.clear();
+	m_fwdNormalY.clear();
+	m_maxDist.clear();
+}
+
+void RaycastBatch3D::AddRay(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength)
+{
+	m_startX.push_back(rayStart.x);
+	m_startY.push_back(rayStart.y);
+	m_startZ.push_back(rayStart.z);
+	m_fwdNormalX.push_back(rayForwardNormal.x);
+	m_fwdNormalY.push_back(rayForwardNormal.y);
+	m_fwdNormalZ.push_back(rayForwardNormal.z);
+	m_rayLength.push_back(rayLength);
+}
+
+void RaycastBatch3D::Reserve(int numRays)
+{
+	m_startX.reserve(numRays);
+	m_startY.reserve(numRays);
+	m_startZ.reserve(numRays);
+	m_fwdNormalX.reserve(numRays);
+	m_fwdNormalY.reserve(numRays);
+	m_fwdNormalZ.reserve(numRays);
+	m_rayLength.reserve(numRays);
+}
+
+void RaycastBatch3D::Clear()
+{
+	m_startX.clear();
+	m_startY.clear();
+	m_startZ.clear();
+	m_fwdNormalX.clear();
+	m_fwdNormalY.clear();
+	m_fwdNormalZ.clear();
+	m_rayLength.clear();
+}
+
+void DiscBatch2D::AddDisc(Vec2 const& discCenter, float discRadius)
+{
+	m_centerX.push_back(discCenter.x);
+	m_centerY.push_back(discCenter.y);
+	m_radius.push_back(discRadius);
+}
+
+void DiscBatch2D::Clear()
+{
+	m_centerX.clear();
+	m_centerY.clear();
+	m_radius.clear();
+}
+
+void AABB3Batch::AddBox(AABB3 const& box)
+{
+	m_minsX.push_back(box.m_mins.x);
+	m_minsY.push_back(box.m_mins.y);
+	m_minsZ.push_back(box.m_mins.z);
+	m_maxsX.push_back(box.m_maxs.x);
+	m_maxsY.push_back(box.m_maxs.y);
+	m_maxsZ.push_back(box.m_maxs.z);
+}
+
+void AABB3Batch::Clear()
+{
+	m_minsX.clear();
+	m_minsY.clear();
+	m_minsZ.clear();
+	m_maxsX.clear();
+	m_maxsY.clear();
+	m_maxsZ.clear();
+}
+
+void SphereBatch3D::AddSphere(Vec3 const& sphereCenter, float sphereRadius)
+{
+	m_centerX.push_back(sphereCenter.x);
+	m_centerY.push_back(sphereCenter.y);
+	m_centerZ.push_back(sphereCenter.z);
+	m_radius.push_back(sphereRadius);
+}
+
+void SphereBatch3D::Clear()
+{
+	m_centerX.clear();
+	m_centerY.clear();
+	m_centerZ.clear();
+	m_radius.clear();
+}
+
+#if defined(RAYCAST_UTILS_HAS_SSE_PATH)
+// The kernels below repeat the single raycasts' arithmetic operation for operation, and their comparisons with the same
+// predicates (a "return if a >= b" becomes a mask of !(a >= b)), so NaNs and infinities from axis-aligned rays land on
+// the same side too. Every argument is four lanes: four rays against one shape, or one ray against four shapes.
+
+static inline __m128 Select_SSE(__m128 mask, __m128 ifTrue, __m128 ifFalse)
+{
+	return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+}
+
+static __m128 RaycastVsDisc2D_SSE(__m128 startX, __m128 startY, __m128 fwdX, __m128 fwdY, __m128 maxDist, __m128 centerX, __m128 centerY, __m128 radius)
+{
+	__m128 startToCenterX = _mm_sub_ps(centerX, startX);
+	__m128 startToCenterY = _mm_sub_ps(centerY, startY);
+	__m128 negativeFwdY = _mm_xor_ps(fwdY, _mm_set1_ps(-0.f));
+	__m128 startToCenterJ = _mm_add_ps(_mm_mul_ps(startToCenterX, negativeFwdY), _mm_mul_ps(startToCenterY, fwdX));
+	__m128 isInStrip = _mm_and_ps(_mm_cmpnge_ps(startToCenterJ, radius), _mm_cmpnle_ps(startToCenterJ, _mm_xor_ps(radius, _mm_set1_ps(-0.f))));
+
+	__m128 radiusSquared = _mm_mul_ps(radius, radius);
+	__m128 a = _mm_sqrt_ps(_mm_sub_ps(radiusSquared, _mm_mul_ps(startToCenterJ, startToCenterJ)));
+	__m128 startToCenterI = _mm_add_ps(_mm_mul_ps(startToCenterX, fwdX), _mm_mul_ps(startToCenterY, fwdY));
+	__m128 impactDist = _mm_sub_ps(startToCenterI, a);
+
+	__m128 centerToStartX = _mm_sub_ps(startX, centerX);
+	__m128 centerToStartY = _mm_sub_ps(startY, centerY);
+	__m128 distanceSquared = _mm_add_ps(_mm_mul_ps(centerToStartX, centerToStartX), _mm_mul_ps(centerToStartY, centerToStartY));
+	__m128 isStartInside = _mm_cmpnge_ps(distanceSquared, radiusSquared);
+	__m128 isInRange = _mm_and_ps(_mm_cmplt_ps(impactDist, maxDist), _mm_cmpgt_ps(impactDist, _mm_setzero_ps()));
+
+	__m128 result = Select_SSE(isInRange, impactDist, _mm_set1_ps(RAYCAST_NO_IMPACT_DIST));
+	result = Select_SSE(isStartInside, _mm_setzero_ps(), result);
+	return Select_SSE(isInStrip, result, _mm_set1_ps(RAYCAST_NO_IMPACT_DIST));
+}
+
+// One axis of the slab test: the ray's t range across the slab, ordered the way RaycastVsAABB3D orders it
+static inline void GetSlabRange_SSE(__m128 start, __m128 fwd, __m128 rayLength, __m128 slabMin, __m128 slabMax, __m128& out_min, __m128& out_max)
+{
+	__m128 end = _mm_add_ps(start, _mm_mul_ps(fwd, rayLength));
+	__m128 oneOverRange = _mm_div_ps(_mm_set1_ps(1.f), _mm_sub_ps(end, start));
+	__m128 tMin = _mm_mul_ps(_mm_sub_ps(slabMin, start), oneOverRange);
+	__m128 tMax = _mm_mul_ps(_mm_sub_ps(slabMax, start), oneOverRange);
+	__m128 isOrdered = _mm_cmplt_ps(tMin, tMax);
+	out_min = Select_SSE(isOrdered, tMin, tMax);
+	out_max = Select_SSE(isOrdered, tMax, tMin);
+}
+
+// OverlappedFloatRange(), then the "== FloatRange()" check RaycastVsAABB3D follows it with
+static inline __m128 OverlapRanges_SSE(__m128 min1, __m128 max1, __m128 min2, __m128 max2, __m128& out_min, __m128& out_max)
+{
+	__m128 isOverlapping = _mm_andnot_ps(_mm_or_ps(_mm_cmpgt_ps(min2, max1), _mm_cmplt_ps(max2, min1)), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+	out_min = _mm_and_ps(isOverlapping, Select_SSE(_mm_cmpgt_ps(min1, min2), min1, min2));
+	out_max = _mm_and_ps(isOverlapping, Select_SSE(_mm_cmplt_ps(max1, max2), max1, max2));
+	return _mm_andnot_ps(_mm_and_ps(_mm_cmpeq_ps(out_min, _mm_setzero_ps()), _mm_cmpeq_ps(out_max, _mm_setzero_ps())), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+}
+
+static __m128 RaycastVsAABB3D_SSE(__m128 startX, __m128 startY, __m128 startZ, __m128 fwdX, __m128 fwdY, __m128 fwdZ, __m128 rayLength,
+	__m128 minsX, __m128 minsY, __m128 minsZ, __m128 maxsX, __m128 maxsY, __m128 maxsZ)
+{
+	__m128 isStartInside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(startX, minsX), _mm_cmplt_ps(startX, maxsX)), _mm_and_ps(_mm_cmpgt_ps(startY, minsY), _mm_cmplt_ps(startY, maxsY)));
+	isStartInside = _mm_and_ps(isStartInside, _mm_and_ps(_mm_cmpgt_ps(startZ, minsZ), _mm_cmplt_ps(startZ, maxsZ)));
+
+	__m128 minX, maxX, minY, maxY, minZ, maxZ, minXY, maxXY, minT, maxT;
+	GetSlabRange_SSE(startX, fwdX, rayLength, minsX, maxsX, minX, maxX);
+	GetSlabRange_SSE(startY, fwdY, rayLength, minsY, maxsY, minY, maxY);
+	GetSlabRange_SSE(startZ, fwdZ, rayLength, minsZ, maxsZ, minZ, maxZ);
+	__m128 isHit = OverlapRanges_SSE(minX, maxX, minY, maxY, minXY, maxXY);
+	isHit = _mm_and_ps(isHit, OverlapRanges_SSE(minXY, maxXY, minZ, maxZ, minT, maxT));
+	isHit = _mm_and_ps(isHit, _mm_and_ps(_mm_cmpge_ps(minT, _mm_setzero_ps()), _mm_cmple_ps(minT, _mm_set1_ps(1.f))));
+
+	__m128 impactX = _mm_sub_ps(_mm_add_ps(startX, _mm_mul_ps(_mm_mul_ps(fwdX, minT), rayLength)), startX);
+	__m128 impactY = _mm_sub_ps(_mm_add_ps(startY, _mm_mul_ps(_mm_mul_ps(fwdY, minT), rayLength)), startY);
+	__m128 impactZ = _mm_sub_ps(_mm_add_ps(startZ, _mm_mul_ps(_mm_mul_ps(fwdZ, minT), rayLength)), startZ);
+	__m128 impactDist = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(impactX, impactX), _mm_mul_ps(impactY, impactY)), _mm_mul_ps(impactZ, impactZ)));
+
+	__m128 result = Select_SSE(isHit, impactDist, _mm_set1_ps(RAYCAST_NO_IMPACT_DIST));
+	return Select_SSE(isStartInside, _mm_setzero_ps(), result);
+}
+
+static __m128 RaycastVsSphere3D_SSE(__m128 startX, __m128 startY, __m128 startZ, __m128 fwdX, __m128 fwdY, __m128 fwdZ, __m128 rayLength,
+	__m128 centerX, __m128 centerY, __m128 centerZ, __m128 radius)
+{
+	__m128 radiusSquared = _mm_mul_ps(radius, radius);
+	__m128 centerToStartX = _mm_sub_ps(startX, centerX);
+	__m128 centerToStartY = _mm_sub_ps(startY, centerY);
+	__m128 centerToStartZ = _mm_sub_ps(startZ, centerZ);
+	__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerToStartX, centerToStartX), _mm_mul_ps(centerToStartY, centerToStartY)), _mm_mul_ps(centerToStartZ, centerToStartZ));
+	__m128 isStartInside = _mm_cmpnge_ps(distanceSquared, radiusSquared);
+
+	__m128 startToCenterX = _mm_sub_ps(centerX, startX);
+	__m128 startToCenterY = _mm_sub_ps(centerY, startY);
+	__m128 startToCenterZ = _mm_sub_ps(centerZ, startZ);
+	__m128 startToCenterI = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fwdX, startToCenterX), _mm_mul_ps(fwdY, startToCenterY)), _mm_mul_ps(fwdZ, startToCenterZ));
+	__m128 isHit = _mm_cmpnge_ps(startToCenterI, _mm_add_ps(rayLength, radius));
+
+	__m128 offRayX = _mm_sub_ps(startToCenterX, _mm_mul_ps(fwdX, startToCenterI));
+	__m128 offRayY = _mm_sub_ps(startToCenterY, _mm_mul_ps(fwdY, startToCenterI));
+	__m128 offRayZ = _mm_sub_ps(startToCenterZ, _mm_mul_ps(fwdZ, startToCenterI));
+	__m128 distanceSquaredFromRay = _mm_add_ps(_mm_add_ps(_mm_mul_ps(offRayX, offRayX), _mm_mul_ps(offRayY, offRayY)), _mm_mul_ps(offRayZ, offRayZ));
+	isHit = _mm_and_ps(isHit, _mm_cmpnge_ps(distanceSquaredFromRay, radiusSquared));
+
+	__m128 impactDist = _mm_sub_ps(startToCenterI, _mm_sqrt_ps(_mm_sub_ps(radiusSquared, distanceSquaredFromRay)));
+	isHit = _mm_and_ps(isHit, _mm_and_ps(_mm_cmplt_ps(impactDist, rayLength), _mm_cmpgt_ps(impactDist, _mm_setzero_ps())));
+
+	__m128 result = Select_SSE(isHit, impactDist, _mm_set1_ps(RAYCAST_NO_IMPACT_DIST));
+	return Select_SSE(isStartInside, _mm_setzero_ps(), result);
+}
+
+// Four lanes from an array, padding the end of it with copies of its first element
+static inline __m128 LoadLanes_SSE(float const* values, int index, int count)
+{
+	if (index + 4 <= count)
+	{
+		return _mm_loadu_ps(values + index);
+	}
+	alignas(16) float lanes[4];
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		lanes[lane] = values[index + lane < count ? index + lane : 0];
+	}
+	return _mm_load_ps(lanes);
+}
+
+static inline void StoreLanes_SSE(float* out_values, int index, int count, __m128 lanes)
+{
+	if (index + 4 <= count)
+	{
+		_mm_storeu_ps(out_values + index, lanes);
+		return;
+	}
+	alignas(16) float values[4];
+	_mm_store_ps(values, lanes);
+	for (int lane = 0; index + lane < count; ++lane)
+	{
+		out_values[index + lane] = values[lane];
+	}
+}
+
+// Keeps the nearest impact each lane has seen; shapes are visited in order, so ties keep the lower index
+struct NearestImpact_SSE
+{
+	__m128 m_dist = _mm_set1_ps(RAYCAST_NO_IMPACT_DIST);
+	__m128i m_index = _mm_set1_epi32(-1);
+
+	void Update(__m128 impactDists, int firstIndex, int count)
+	{
+		__m128i indexes = _mm_add_epi32(_mm_set1_epi32(firstIndex), _mm_setr_epi32(0, 1, 2, 3));
+		__m128 isValid = _mm_castsi128_ps(_mm_cmplt_epi32(indexes, _mm_set1_epi32(count)));
+		__m128 isNearer = _mm_and_ps(isValid, _mm_cmplt_ps(impactDists, m_dist));
+		m_dist = Select_SSE(isNearer, impactDists, m_dist);
+		m_index = _mm_castps_si128(Select_SSE(isNearer, _mm_castsi128_ps(indexes), _mm_castsi128_ps(m_index)));
+	}
+
+	int GetNearestIndex() const
+	{
+		alignas(16) float dists[4];
+		alignas(16) int indexes[4];
+		_mm_store_ps(dists, m_dist);
+		_mm_store_si128(reinterpret_cast<__m128i*>(indexes), m_index);
+		int nearestLane = 0;
+		for (int lane = 1; lane < 4; ++lane)
+		{
+			if (indexes[lane] >= 0 && (indexes[nearestLane] < 0 || dists[lane] < dists[nearestLane] || (dists[lane] == dists[nearestLane] && indexes[lane] < indexes[nearestLane])))
+			{
+				nearestLane = lane;
+			}
+		}
+		return indexes[nearestLane];
+	}
+};
+#endif
+
+void RaycastVsDisc2D(RaycastBatch2D const& rays, Vec2 discCenter, float discRadius, std::vector<float>& out_impactDists)
+{
+	int numRays = rays.GetNumRays();
+	out_impactDists.resize(numRays);
+#if defined(RAYCAST_UTILS_HAS_SSE_PATH)
+	__m128 centerX = _mm_set1_ps(discCenter.x);
+	__m128 centerY = _mm_set1_ps(discCenter.y);
+	__m128 radius = _mm_set1_ps(discRadius);
+	for (int rayIndex = 0; rayIndex < numRays; rayIndex += 4)
+	{
+		__m128 impactDists = RaycastVsDisc2D_SSE(LoadLanes_SSE(rays.m_startX.data(), rayIndex, numRays), LoadLanes_SSE(rays.m_startY.data(), rayIndex, numRays),
+			LoadLanes_SSE(rays.m_fwdNormalX.data(), rayIndex, numRays), LoadLanes_SSE(rays.m_fwdNormalY.data(), rayIndex, numRays),
+			LoadLanes_SSE(rays.m_maxDist.data(), rayIndex, numRays), centerX, centerY, radius);
+		StoreLanes_SSE(out_impactDists.data(), rayIndex, numRays, impactDists);
+	}
+#else
+	for (int rayIndex = 0; rayIndex < numRays; ++rayIndex)
+	{
+		RaycastResult2D result = RaycastVsDisc2D(Vec2(rays.m_startX[rayIndex], rays.m_startY[rayIndex]), Vec2(rays.m_fwdNormalX[rayIndex], rays.m_fwdNormalY[rayIndex]), rays.m_maxDist[rayIndex], discCenter, discRadius);
+		out_impactDists[rayIndex] = result.m_didImpact ? result.m_impactDist : RAYCAST_NO_IMPACT_DIST;
+	}
+#endif
+}
+
+void RaycastVsAABB3D(RaycastBatch3D const& rays, AABB3 const& box, std::vector<float>& out_impactDists)
+{
+	int numRays = rays.GetNumRays();
+	out_impactDists.resize(numRays);
+#if defined(RAYCAST_UTILS_HAS_SSE_PATH)
+	__m128 minsX = _mm_set1_ps(box.m_mins.x);
+	__m128 minsY = _mm_set1_ps(box.m_mins.y);
+	__m128 minsZ = _mm_set1_ps(box.m_mins.z);
+	__m128 maxsX = _mm_set1_ps(box.m_maxs.x);
+	__m128 maxsY = _mm_set1_ps(box.m_maxs.y);
+	__m128 maxsZ = _mm_set1_ps(box.m_maxs.z);
+	for (int rayIndex = 0; rayIndex < numRays; rayIndex += 4)
+	{
+		__m128 impactDists = RaycastVsAABB3D_SSE(LoadLanes_SSE(rays.m_startX.data(), rayIndex, numRays), LoadLanes_SSE(rays.m_startY.data(), rayIndex, numRays),
+			LoadLanes_SSE(rays.m_startZ.data(), rayIndex, numRays), LoadLanes_SSE(rays.m_fwdNormalX.data(), rayIndex, numRays),
+			LoadLanes_SSE(rays.m_fwdNormalY.data(), rayIndex, numRays), LoadLanes_SSE(rays.m_fwdNormalZ.data(), rayIndex, numRays),
+			LoadLanes_SSE(rays.m_rayLength.data(), rayIndex, numRays), minsX, minsY, minsZ, maxsX, maxsY, maxsZ);
+		StoreLanes_SSE(out_impactDists.data(), rayIndex, numRays, impactDists);
+	}
+#else
+	for (int rayIndex = 0; rayIndex < numRays; ++rayIndex)
+	{
+		RaycastResult3D result = RaycastVsAABB3D(Vec3(rays.m_startX[rayIndex], rays.m_startY[rayIndex], rays.m_startZ[rayIndex]),
+			Vec3(rays.m_fwdNormalX[rayIndex], rays.m_fwdNormalY[rayIndex], rays.m_fwdNormalZ[rayIndex]), rays.m_rayLength[rayIndex], box);
+		out_impactDists[rayIndex] = result.m_didImpact ? result.m_impactDist : RAYCAST_NO_IMPACT_DIST;
+	}
+#endif
+}
+
+void RaycastVsSphere3D(RaycastBatch3D const& rays, Vec3 sphereCenter, float sphereRadius, std::vector<float>& out_impactDists)
+{
+	int numRays = rays.GetNumRays();
+	out_impactDists.resize(numRays);
+#if defined(RAYCAST_UTILS_HAS_SSE_PATH)
+	__m128 centerX = _mm_set1_ps(sphereCenter.x);
+	__m128 centerY = _mm_set1_ps(sphereCenter.y);
+	__m128 centerZ = _mm_set1_ps(sphereCenter.z);
+	__m128 radius = _mm_set1_ps(sphereRadius);
+	for (int rayIndex = 0; rayIndex < numRays; rayIndex += 4)
+	{
+		__m128 impactDists = RaycastVsSphere3D_SSE(LoadLanes_SSE(rays.m_startX.data(), rayIndex, numRays), LoadLanes_SSE(rays.m_startY.data(), rayIndex, numRays),
+			LoadLanes_SSE(rays.m_startZ.data(), rayIndex, numRays), LoadLanes_SSE(rays.m_fwdNormalX.data(), rayIndex, numRays),
+			LoadLanes_SSE(rays.m_fwdNormalY.data(), rayIndex, numRays), LoadLanes_SSE(rays.m_fwdNormalZ.data(), rayIndex, numRays),
+			LoadLanes_SSE(rays.m_rayLength.data(), rayIndex, numRays), centerX, centerY, centerZ, radius);
+		StoreLanes_SSE(out_impactDists.data(), rayIndex, numRays, impactDists);
+	}
+#else
+	for (int rayIndex = 0; rayIndex < numRays; ++rayIndex)
+	{
+		RaycastResult3D result = RaycastVsSphere3D(Vec3(rays.m_startX[rayIndex], rays.m_startY[rayIndex], rays.m_startZ[rayIndex]),
+			Vec3(rays.m_fwdNormalX[rayIndex], rays.m_fwdNormalY[rayIndex], rays.m_fwdNormalZ[rayIndex]), rays.m_rayLength[rayIndex], sphereCenter, sphereRadius);
+		out_impactDists[rayIndex] = result.m_didImpact ? result.m_impactDist : RAYCAST_NO_IMPACT_DIST;
+	}
+#endif
+}
+
+RaycastResult2D RaycastVsDiscs2D(Vec2 startPos, Vec2 fwdNormal, float maxDist, DiscBatch2D const& discs, int* out_discIndex)
+{
+	int numDiscs = discs.GetNumDiscs();
+	int nearestIndex = -1;
+#if defined(RAYCAST_UTILS_HAS_SSE_PATH)
+	__m128 startX = _mm_set1_ps(startPos.x);
+	__m128 startY = _mm_set1_ps(startPos.y);
+	__m128 fwdX = _mm_set1_ps(fwdNormal.x);
+	__m128 fwdY = _mm_set1_ps(fwdNormal.y);
+	__m128 maxDists = _mm_set1_ps(maxDist);
+	NearestImpact_SSE nearest;
+	for (int discIndex = 0; discIndex < numDiscs; discIndex += 4)
+	{
+		nearest.Update(RaycastVsDisc2D_SSE(startX, startY, fwdX, fwdY, maxDists, LoadLanes_SSE(discs.m_centerX.data(), discIndex, numDiscs),
+			LoadLanes_SSE(discs.m_centerY.data(), discIndex, numDiscs), LoadLanes_SSE(discs.m_radius.data(), discIndex, numDiscs)), discIndex, numDiscs);
+	}
+	nearestIndex = nearest.GetNearestIndex();
+#else
+	float nearestDist = RAYCAST_NO_IMPACT_DIST;
+	for (int discIndex = 0; discIndex < numDiscs; ++discIndex)
+	{
+		RaycastResult2D result = RaycastVsDisc2D(startPos, fwdNormal, maxDist, Vec2(discs.m_centerX[discIndex], discs.m_centerY[discIndex]), discs.m_radius[discIndex]);
+		if (result.m_didImpact && result.m_impactDist < nearestDist)
+		{
+			nearestDist = result.m_impactDist;
+			nearestIndex = discIndex;
+		}
+	}
+#endif
+	if (out_discIndex)
+	{
+		*out_discIndex = nearestIndex;
+	}
+	if (nearestIndex < 0)
+	{
+		return RaycastResult2D();
+	}
+	return RaycastVsDisc2D(startPos, fwdNormal, maxDist, Vec2(discs.m_centerX[nearestIndex], discs.m_centerY[nearestIndex]), discs.m_radius[nearestIndex]);
+}
+
+RaycastResult3D RaycastVsAABBs3D(Vec3 rayStart, Vec3 rayForwardNormal, float rayLength, AABB3Batch const& boxes, int* out_boxIndex)
+{
+	int numBoxes = boxes.GetNumBoxes();
+	int nearestIndex = -1;
+#if defined(RAYCAST_UTILS_HAS_SSE_PATH)
+	__m128 startX = _mm_set1_ps(rayStart.x);
+	__m128 startY = _mm_set1_ps(rayStart.y);
+	__m128 startZ = _mm_set1_ps(rayStart.z);
+	__m128 fwdX = _mm_set1_ps(rayForwardNormal.x);
+	__m128 fwdY = _mm_set1_ps(rayForwardNormal.y);
+	__m128 fwdZ = _mm_set1_ps(rayForwardNormal.z);
+	__m128 rayLengths = _mm_set1_ps(rayLength);
+	NearestImpact_SSE nearest;
+	for (int boxIndex = 0; boxIndex < numBoxes; boxIndex += 4)
+	{
+		nearest.Update(RaycastVsAABB3D_SSE(startX, startY, startZ, fwdX, fwdY, fwdZ, rayLengths,
+			LoadLanes_SSE(boxes.m_minsX.data(), boxIndex, numBoxes), LoadLanes_SSE(boxes.m_minsY.data(), boxIndex, numBoxes), LoadLanes_SSE(boxes.m_minsZ.data(), boxIndex, numBoxes),
+			LoadLanes_SSE(boxes.m_maxsX.data(), boxIndex, numBoxes), LoadLanes_SSE(boxes.m_maxsY.data(), boxIndex, numBoxes), LoadLanes_SSE(boxes.m_maxsZ.data(), boxIndex, numBoxes)), boxIndex, numBoxes);
+	}
+	nearestIndex = nearest.GetNearestIndex();
+#else
+	float nearestDist = RAYCAST_NO_IMPACT_DIST;
+	for (int boxIndex = 0; boxIndex < numBoxes; ++boxIndex)
+	{
+		AABB3 box(boxes.m_minsX[boxIndex], boxes.m_minsY[boxIndex], boxes.m_minsZ[boxIndex], boxes.m_maxsX[boxIndex], boxes.m_maxsY[boxIndex], boxes.m_maxsZ[boxIndex]);
+		RaycastResult3D result = RaycastVsAABB3D(rayStart, rayForwardNormal, rayLength, box);
+		if (result.m_didImpact && result.m_impactDist < nearestDist)
+		{
+			nearestDist = result.m_impactDist;
+			nearestIndex = boxIndex;
+		}
+	}
+#endif
+	if (out_boxIndex)
+	{
+		*out_boxIndex = nearestIndex;
+	}
+	if (nearestIndex < 0)
+	{
+		RaycastResult3D result;
+		result.m_rayFwdNormal = rayForwardNormal;
+		return result;
+	}
+	AABB3 nearestBox(boxes.m_minsX[nearestIndex], boxes.m_minsY[nearestIndex], boxes.m_minsZ[nearestIndex], boxes.m_maxsX[nearestIndex], boxes.m_maxsY[nearestIndex], boxes.m_maxsZ[nearestIndex]);
+	return RaycastVsAABB3D(rayStart, rayForwardNormal, rayLength, nearestBox);
+}
+
+RaycastResult3D RaycastVsSpheres3D(Vec3 rayStart, Vec3 rayForwardNormal, float rayLength, SphereBatch3D const& spheres, int* out_sphereIndex)
+{
+	int numSpheres = spheres.GetNumSpheres();
+	int nearestIndex = -1;
+#if defined(RAYCAST_UTILS_HAS_SSE_PATH)
+	__m128 startX = _mm_set1_ps(rayStart.x);
+	__m128 startY = _mm_set1_ps(rayStart.y);
+	__m128 startZ = _mm_set1_ps(rayStart.z);
+	__m128 fwdX = _mm_set1_ps(rayForwardNormal.x);
+	__m128 fwdY = _mm_set1_ps(rayForwardNormal.y);
+	__m128 fwdZ = _mm_set1_ps(rayForwardNormal.z);
+	__m128 rayLengths = _mm_set1_ps(rayLength);
+	NearestImpact_SSE nearest;
+	for (int sphereIndex = 0; sphereIndex < numSpheres; sphereIndex += 4)
+	{
+		nearest.Update(RaycastVsSphere3D_SSE(startX, startY, startZ, fwdX, fwdY, fwdZ, rayLengths, LoadLanes_SSE(spheres.m_centerX.data(), sphereIndex, numSpheres),
+			LoadLanes_SSE(spheres.m_centerY.data(), sphereIndex, numSpheres), LoadLanes_SSE(spheres.m_centerZ.data(), sphereIndex, numSpheres),
+			LoadLanes_SSE(spheres.m_radius.data(), sphereIndex, numSpheres)), sphereIndex, numSpheres);
+	}
+	nearestIndex = nearest.GetNearestIndex();
+#else
+	float nearestDist = RAYCAST_NO_IMPACT_DIST;
+	for (int sphereIndex = 0; sphereIndex < numSpheres; ++sphereIndex)
+	{
+		Vec3 center(spheres.m_centerX[sphereIndex], spheres.m_centerY[sphereIndex], spheres.m_centerZ[sphereIndex]);
+		RaycastResult3D result = RaycastVsSphere3D(rayStart, rayForwardNormal, rayLength, center, spheres.m_radius[sphereIndex]);
+		if (result.m_didImpact && result.m_impactDist < nearestDist)
+		{
+			nearestDist = result.m_impactDist;
+			nearestIndex = sphereIndex;
+		}
+	}
+#endif
+	if (out_sphereIndex)
+	{
+		*out_sphereIndex = nearestIndex;
+	}
+	if (nearestIndex < 0)
+	{
+		RaycastResult3D result;
+		result.m_rayFwdNormal = rayForwardNormal;
+		return result;
+	}
+	Vec3 nearestCenter(spheres.m_centerX[nearestIndex], spheres.m_centerY[nearestIndex], spheres.m_centerZ[nearestIndex]);
+	return RaycastVsSphere3D(rayStart, rayForwardNormal, rayLength, nearestCenter, spheres.m_radius[nearestIndex]);
+}
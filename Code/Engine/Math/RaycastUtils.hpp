@@ -7,6 +7,8 @@
 #include "Engine/Math/Plane3.hpp"
 #include "Engine/Math/Plane2.hpp"
 #include "Engine/Math/Convex.hpp"
+#include <cfloat>
+#include <vector>
 struct RaycastResult2D
 {
 	// Basic raycast result information (required)
@@ -42,4 +44,87 @@ RaycastResult3D RaycastVsAABB3D(Vec3 rayStart, Vec3 rayForwardNormal, float rayL
 RaycastResult3D RaycastVsSphere3D(Vec3 rayStart, Vec3 rayForwardNormal, float rayLength, Vec3 sphereCenter, float sphereRadius);
 RaycastResult3D RaycastVsCylinderZ3D(Vec3 rayStart, Vec3 rayForwardNormal, float rayLength, Vec2 const& centerXY, FloatRange const& minMaxZ, float radius);
 RaycastResult3D RaycastVsOBB3D(Vec3 rayStart, Vec3 rayForwardNormal, float rayLength, OBB3 const& orientedBox);
-RaycastResult3D RaycastVsPlane3D(Vec3 rayStart, Vec3 rayForwardNormal, float rayLength, Plane3 const& plane);
\ No newline at end of file
+RaycastResult3D RaycastVsPlane3D(Vec3 rayStart, Vec3 rayForwardNormal, float rayLength, Plane3 const& plane);
+
+// Batched raycasts, for when many rays hit one shape or one ray is tested against many shapes. Rays and shapes are stored
+// structure-of-arrays and tested four at a time with SSE2. The impact distances are bitwise identical to m_impactDist of
+// the single raycasts above; a ray that misses gets RAYCAST_NO_IMPACT_DIST so the nearest impact is just the smallest.
+constexpr float RAYCAST_NO_IMPACT_DIST = FLT_MAX;
+
+struct RaycastBatch2D
+{
+	std::vector<float> m_startX;
+	std::vector<float> m_startY;
+	std::vector<float> m_fwdNormalX;
+	std::vector<float> m_fwdNormalY;
+	std::vector<float> m_maxDist;
+
+	void AddRay(Vec2 const& startPos, Vec2 const& fwdNormal, float maxDist);
+	void Reserve(int numRays);
+	void Clear();
+	int GetNumRays() const { return (int)m_startX.size(); }
+};
+
+struct RaycastBatch3D
+{
+	std::vector<float> m_startX;
+	std::vector<float> m_startY;
+	std::vector<float> m_startZ;
+	std::vector<float> m_fwdNormalX;
+	std::vector<float> m_fwdNormalY;
+	std::vector<float> m_fwdNormalZ;
+	std::vector<float> m_rayLength;
+
+	void AddRay(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength);
+	void Reserve(int numRays);
+	void Clear();
+	int GetNumRays() const { return (int)m_startX.size(); }
+};
+
+struct DiscBatch2D
+{
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_radius;
+
+	void AddDisc(Vec2 const& discCenter, float discRadius);
+	void Clear();
+	int GetNumDiscs() const { return (int)m_centerX.size(); }
+};
+
+struct AABB3Batch
+{
+	std::vector<float> m_minsX;
+	std::vector<float> m_minsY;
+	std::vector<float> m_minsZ;
+	std::vector<float> m_maxsX;
+	std::vector<float> m_maxsY;
+	std::vector<float> m_maxsZ;
+
+	void AddBox(AABB3 const& box);
+	void Clear();
+	int GetNumBoxes() const { return (int)m_minsX.size(); }
+};
+
+struct SphereBatch3D
+{
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_radius;
+
+	void AddSphere(Vec3 const& sphereCenter, float sphereRadius);
+	void Clear();
+	int GetNumSpheres() const { return (int)m_centerX.size(); }
+};
+
+// Every ray in the batch against one shape; out_impactDists gets one distance per ray
+void RaycastVsDisc2D(RaycastBatch2D const& rays, Vec2 discCenter, float discRadius, std::vector<float>& out_impactDists);
+void RaycastVsAABB3D(RaycastBatch3D const& rays, AABB3 const& box, std::vector<float>& out_impactDists);
+void RaycastVsSphere3D(RaycastBatch3D const& rays, Vec3 sphereCenter, float sphereRadius, std::vector<float>& out_impactDists);
+
+// One ray against every shape in the batch; returns the nearest impact (the lowest index on ties) exactly as the single
+// raycast against that shape reports it, and which shape it was, or -1
+RaycastResult2D RaycastVsDiscs2D(Vec2 startPos, Vec2 fwdNormal, float maxDist, DiscBatch2D const& discs, int* out_discIndex = nullptr);
+RaycastResult3D RaycastVsAABBs3D(Vec3 rayStart, Vec3 rayForwardNormal, float rayLength, AABB3Batch const& boxes, int* out_boxIndex = nullptr);
+RaycastResult3D RaycastVsSpheres3D(Vec3 rayStart, Vec3 rayForwardNormal, float rayLength, SphereBatch3D const& spheres, int* out_sphereIndex = nullptr);
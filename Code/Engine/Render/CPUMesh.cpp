@@ -1,8 +1,101 @@
 #include "Engine/Render/CPUMesh.hpp"
 #include "Engine/Render/ObjLoader.hpp"
+#include "Engine/Render/MeshOptimizer.hpp"
+#include "Engine/Render/MeshSimplifier.hpp"
+#include "Engine/Render/Camera.hpp"
+#include "Engine/Math/MathUtils.hpp"
 #include "Engine/Core/VertexUtils.hpp"
+#include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/MemoryMappedFile.hpp"
+#include "Engine/Core/BufferParser.hpp"
+#include "Engine/Core/BufferWriter.hpp"
 #include <chrono>
+#include <cstring>
 #include "Game/EngineBuildPreferences.hpp"
+
+constexpr unsigned int MESH_CACHE_FOURCC = 'M' | ('S' << 8) | ('H' << 16) | ('C' << 24);
+constexpr unsigned int MESH_CACHE_VERSION = 4; // bump whenever the cache layout or the mesh building changes
+constexpr unsigned int MAX_MESH_CACHE_LODS = 32;
+
+// The cache is a straight memory image (this header, a MeshCacheLOD per LOD, the vertexes, the indexes, each LOD's
+// indexes, then the BVH nodes and triangle packs), so loading it is a handful of copies.
+// It is only ever read back on the machine type that wrote it; anything else just misses and rebuilds.
+struct MeshCacheHeader
+{
+	unsigned int m_fourCC = MESH_CACHE_FOURCC;
+	unsigned int m_version = MESH_CACHE_VERSION;
+	unsigned int m_vertexSize = (unsigned int)sizeof(Vertex_PCUTBN);
+	unsigned int m_endianCheck = 0x01020304;
+	uint64_t m_objFileSize = 0;
+	int64_t m_objModifiedTime = 0;
+	float m_transform[16] = {};
+	uint64_t m_numVertexes = 0;
+	uint64_t m_numIndexes = 0;
+	unsigned int m_hasLODs = 0; // LODs were asked for, even if the mesh could not be simplified into any
+	unsigned int m_numLODs = 0;
+	unsigned int m_hasBVH = 0;
+	unsigned int m_unused = 0;
+	uint64_t m_numBVHNodes = 0;
+	uint64_t m_numBVHPacks = 0;
+};
+
+struct MeshCacheLOD
+{
+	uint64_t m_numIndexes = 0;
+	float m_error = 0.f;
+	unsigned int m_unused = 0;
+};
+
+static void CalculateBoundingSphere(std::vector<Vertex_PCUTBN> const& vertexes, Vec3& out_center, float& out_radius)
+{
+	out_center = Vec3();
+	out_radius = 0.f;
+	if (vertexes.empty())
+	{
+		return;
+	}
+	Vec3 mins = vertexes[0].m_position;
+	Vec3 maxs = vertexes[0].m_position;
+	for (Vertex_PCUTBN const& vertex : vertexes)
+	{
+		mins.x = vertex.m_position.x < mins.x ? vertex.m_position.x : mins.x;
+		mins.y = vertex.m_position.y < mins.y ? vertex.m_position.y : mins.y;
+		mins.z = vertex.m_position.z < mins.z ? vertex.m_position.z : mins.z;
+		maxs.x = vertex.m_position.x > maxs.x ? vertex.m_position.x : maxs.x;
+		maxs.y = vertex.m_position.y > maxs.y ? vertex.m_position.y : maxs.y;
+		maxs.z = vertex.m_position.z > maxs.z ? vertex.m_position.z : maxs.z;
+	}
+	out_center = (mins + maxs) * 0.5f;
+	float radiusSquared = 0.f;
+	for (Vertex_PCUTBN const& vertex : vertexes)
+	{
+		float distanceSquared = GetDistanceSquared3D(vertex.m_position, out_center);
+		radiusSquared = distanceSquared > radiusSquared ? distanceSquared : radiusSquared;
+	}
+	out_radius = sqrtf(radiusSquared);
+}
+
+static bool AreTriangleIndexesInRange(std::vector<unsigned int> const& indexes, size_t numVertexes)
+{
+	if (indexes.size() % 3 != 0)
+	{
+		return false;
+	}
+	for (unsigned int index : indexes)
+	{
+		if (index >= numVertexes)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool MakeMeshCacheHeader(std::string const& objFilename, Mat44 const& transform, MeshCacheHeader& out_header)
+{
+	memcpy(out_header.m_transform, transform.m_values, sizeof(out_header.m_transform));
+	return GetFileSizeAndModifiedTime(objFilename, out_header.m_objFileSize, out_header.m_objModifiedTime);
+}
 CPUMesh::CPUMesh()
 {
 
@@ -19,12 +112,37 @@ CPUMesh::~CPUMesh()
 	m_vertexes.clear();
 }
 
-void CPUMesh::Load(std::string const& objFilename, Mat44 const& transform)
+bool CPUMesh::Load(std::string const& objFilename, Mat44 const& transform, bool useMeshCache, bool generateLODs, bool buildBVH)
 {
+	m_lods.clear();
+	m_bvh.Clear();
+	if (useMeshCache)
+	{
+#if !defined ENGINE_DISABLE_MESH_DEBUGTIME
+		auto cacheStartTime = std::chrono::high_resolution_clock::now();
+#endif
+		if (LoadFromMeshCache(objFilename, transform, generateLODs, buildBVH))
+		{
+#if !defined ENGINE_DISABLE_MESH_DEBUGTIME
+			auto cacheEndTime = std::chrono::high_resolution_clock::now();
+			auto cacheTime = std::chrono::duration_cast<std::chrono::microseconds>(cacheEndTime - cacheStartTime).count();
+			PrintTextToDebug(Stringf("Loaded mesh cache %s (%d vertexes, %d indexes) time: %.8fs\n", GetMeshCacheFilePath(objFilename).c_str(),
+				(int)m_vertexes.size(), (int)m_indexes.size(), (double)cacheTime / 1000000.0));
+#endif
+			return true;
+		}
+	}
+
 	bool outHasNormal = false;
 	bool outHasUV = false;
 
-	ObjLoader::Load(objFilename, m_vertexes, m_indexes, outHasNormal, outHasUV, transform);
+	if (!ObjLoader::Load(objFilename, m_vertexes, m_indexes, outHasNormal, outHasUV, transform))
+	{
+		// ObjLoader already reported why; a partial mesh must not be used, let alone cached as if it were the obj
+		m_vertexes.clear();
+		m_indexes.clear();
+		return false;
+	}
 #if !defined ENGINE_DISABLE_MESH_DEBUGTIME
 	auto calculateStartTime = std::chrono::high_resolution_clock::now();
 #endif
@@ -37,6 +155,21 @@ void CPUMesh::Load(std::string const& objFilename, Mat44 const& transform)
 
 	PrintTextToDebug(Stringf("Calculated tangent basis time: %.8fs\n", (double)calculateTime/1000000.0));
 #endif
+
+	if (generateLODs)
+	{
+		GenerateLODs();
+	}
+	if (buildBVH)
+	{
+		BuildBVH();
+	}
+
+	if (useMeshCache)
+	{
+		WriteMeshCache(objFilename, transform, generateLODs, buildBVH);
+	}
+	return true;
 }
 
 void CPUMesh::Duplicate(Mat44 const& transform)
@@ -48,6 +181,8 @@ void CPUMesh::Duplicate(Mat44 const& transform)
 	std::vector<unsigned int> newIndexs = originalIndexes;
 
 	TransformVertexArray3D(newVerts, transform);
+	m_lods.clear(); // they would only cover the original copy
+	m_bvh.Clear();
 
     m_vertexes.insert(m_vertexes.end(), newVerts.begin(), newVerts.end());
 	m_indexes.insert(m_indexes.end(), newIndexs.begin(), newIndexs.end());
@@ -55,3 +190,300 @@ void CPUMesh::Duplicate(Mat44 const& transform)
 	//m_vertexes.emplace_back(newVerts);
 	//m_indexes.emplace_back(newIndexs);
 }
+
+void CPUMesh::Optimize(bool reduceOverdraw)
+{
+#if !defined ENGINE_DISABLE_MESH_DEBUGTIME
+	auto optimizeStartTime = std::chrono::high_resolution_clock::now();
+	VertexCacheStats statsBefore = SimulateVertexCache(m_indexes, m_vertexes.size());
+#endif
+	OptimizeVertexCache(m_indexes, m_vertexes.size());
+	if (reduceOverdraw)
+	{
+		OptimizeOverdraw(m_indexes, m_vertexes);
+	}
+	if (m_lods.empty())
+	{
+		OptimizeVertexFetch(m_vertexes, m_indexes);
+	}
+	else
+	{
+		// LODs only use vertexes the full detail mesh uses, so renumbering all the index lists together keeps them valid
+		// while the fetch order still follows full detail
+		std::vector<unsigned int> allIndexes = m_indexes;
+		for (CPUMeshLOD& lod : m_lods)
+		{
+			OptimizeVertexCache(lod.m_indexes, m_vertexes.size());
+			allIndexes.insert(allIndexes.end(), lod.m_indexes.begin(), lod.m_indexes.end());
+		}
+		OptimizeVertexFetch(m_vertexes, allIndexes);
+		size_t nextIndex = 0;
+		memcpy(m_indexes.data(), allIndexes.data(), m_indexes.size() * sizeof(unsigned int));
+		nextIndex += m_indexes.size();
+		for (CPUMeshLOD& lod : m_lods)
+		{
+			memcpy(lod.m_indexes.data(), allIndexes.data() + nextIndex, lod.m_indexes.size() * sizeof(unsigned int));
+			nextIndex += lod.m_indexes.size();
+		}
+	}
+	if (m_bvh.IsBuilt())
+	{
+		m_bvh.Build(m_vertexes, m_indexes); // its triangle indexes and order no longer match
+	}
+#if !defined ENGINE_DISABLE_MESH_DEBUGTIME
+	auto optimizeEndTime = std::chrono::high_resolution_clock::now();
+	auto optimizeTime = std::chrono::duration_cast<std::chrono::microseconds>(optimizeEndTime - optimizeStartTime).count();
+	VertexCacheStats statsAfter = SimulateVertexCache(m_indexes, m_vertexes.size());
+	PrintTextToDebug(Stringf("Optimized mesh  ACMR: %.3f -> %.3f  ATVR: %.3f -> %.3f  time: %.8fs\n", statsBefore.m_acmr, statsAfter.m_acmr,
+		statsBefore.m_atvr, statsAfter.m_atvr, (double)optimizeTime / 1000000.0));
+#endif
+}
+
+void CPUMesh::GenerateLODs(int numLODs, float triangleRatioPerLOD)
+{
+#if !defined ENGINE_DISABLE_MESH_DEBUGTIME
+	auto lodStartTime = std::chrono::high_resolution_clock::now();
+#endif
+	m_lods.clear();
+	CalculateBoundingSphere(m_vertexes, m_boundsCenter, m_boundsRadius);
+
+	// Each LOD simplifies the one before rather than the full mesh, which is much faster for the coarse ones; its error
+	// is bounded by the sum of the errors along the chain
+	float totalError = 0.f;
+	for (int lodIndex = 0; lodIndex < numLODs; ++lodIndex)
+	{
+		std::vector<unsigned int> const& previousIndexes = m_lods.empty() ? m_indexes : m_lods.back().m_indexes;
+		size_t targetNumIndexes = (size_t)((float)(previousIndexes.size() / 3) * triangleRatioPerLOD) * 3;
+		CPUMeshLOD lod;
+		float error = SimplifyMesh(lod.m_indexes, m_vertexes, previousIndexes, targetNumIndexes);
+		if (lod.m_indexes.empty() || lod.m_indexes.size() >= previousIndexes.size())
+		{
+			break;
+		}
+		totalError += error;
+		lod.m_error = totalError;
+		OptimizeVertexCache(lod.m_indexes, m_vertexes.size());
+		m_lods.push_back(std::move(lod));
+	}
+#if !defined ENGINE_DISABLE_MESH_DEBUGTIME
+	auto lodEndTime = std::chrono::high_resolution_clock::now();
+	auto lodTime = std::chrono::duration_cast<std::chrono::microseconds>(lodEndTime - lodStartTime).count();
+	std::string lodSummary;
+	for (CPUMeshLOD const& lod : m_lods)
+	{
+		lodSummary += Stringf(" %d (error %.5f)", (int)lod.m_indexes.size() / 3, lod.m_error);
+	}
+	PrintTextToDebug(Stringf("Generated LODs, triangles: %d ->%s  time: %.8fs\n", (int)m_indexes.size() / 3, lodSummary.c_str(), (double)lodTime / 1000000.0));
+#endif
+}
+
+int CPUMesh::SelectLOD(Camera const& camera, Mat44 const& modelToWorld, float viewportHeightPixels, float maxErrorPixels) const
+{
+	if (m_lods.empty())
+	{
+		return 0;
+	}
+
+	float scale = modelToWorld.GetIBasis3D().GetLength();
+	float scaleJ = modelToWorld.GetJBasis3D().GetLength();
+	float scaleK = modelToWorld.GetKBasis3D().GetLength();
+	scale = scaleJ > scale ? scaleJ : scale;
+	scale = scaleK > scale ? scaleK : scale;
+
+	float pixelsPerUnit = 0.f;
+	if (camera.GetMode() == Camera::eMode_Perspective)
+	{
+		// Size of a world unit at the nearest point of the bounding sphere
+		Vec3 worldCenter = modelToWorld.TransformPosition3D(m_boundsCenter);
+		float distance = GetDistance3D(worldCenter, camera.GetCameraPosition()) - m_boundsRadius * scale;
+		if (distance <= 0.f)
+		{
+			return 0;
+		}
+		pixelsPerUnit = viewportHeightPixels / (2.f * distance * TanDegrees(camera.GetCameraFOV() * 0.5f));
+	}
+	else
+	{
+		float viewHeight = camera.GetOrthoTopRight().y - camera.GetOrthoBottomLeft().y;
+		if (viewHeight <= 0.f)
+		{
+			return 0;
+		}
+		pixelsPerUnit = viewportHeightPixels / viewHeight;
+	}
+
+	int selectedLOD = 0;
+	for (int lodIndex = 0; lodIndex < (int)m_lods.size(); ++lodIndex)
+	{
+		if (m_lods[lodIndex].m_error * scale * pixelsPerUnit > maxErrorPixels)
+		{
+			break;
+		}
+		selectedLOD = lodIndex + 1;
+	}
+	return selectedLOD;
+}
+
+std::vector<unsigned int> const& CPUMesh::GetLODIndexes(int lodIndex) const
+{
+	if (lodIndex <= 0 || m_lods.empty())
+	{
+		return m_indexes;
+	}
+	if (lodIndex > (int)m_lods.size())
+	{
+		return m_lods.back().m_indexes;
+	}
+	return m_lods[lodIndex - 1].m_indexes;
+}
+
+int CPUMesh::GetNumLODs() const
+{
+	return 1 + (int)m_lods.size();
+}
+
+void CPUMesh::BuildBVH()
+{
+#if !defined ENGINE_DISABLE_MESH_DEBUGTIME
+	auto bvhStartTime = std::chrono::high_resolution_clock::now();
+#endif
+	m_bvh.Build(m_vertexes, m_indexes);
+#if !defined ENGINE_DISABLE_MESH_DEBUGTIME
+	auto bvhEndTime = std::chrono::high_resolution_clock::now();
+	auto bvhTime = std::chrono::duration_cast<std::chrono::microseconds>(bvhEndTime - bvhStartTime).count();
+	PrintTextToDebug(Stringf("Built mesh BVH (%d triangles, %d nodes) time: %.8fs\n", (int)m_indexes.size() / 3, m_bvh.GetNumNodes(), (double)bvhTime / 1000000.0));
+#endif
+}
+
+MeshRaycastResult3D CPUMesh::Raycast(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength) const
+{
+	if (m_bvh.IsBuilt())
+	{
+		return m_bvh.Raycast(rayStart, rayForwardNormal, rayLength, m_vertexes, m_indexes);
+	}
+	return MeshBVH::RaycastAllTriangles(rayStart, rayForwardNormal, rayLength, m_vertexes, m_indexes);
+}
+
+std::string CPUMesh::GetMeshCacheFilePath(std::string const& objFilename)
+{
+	return objFilename + ".meshcache";
+}
+
+bool CPUMesh::LoadFromMeshCache(std::string const& objFilename, Mat44 const& transform, bool withLODs, bool withBVH)
+{
+	MeshCacheHeader expectedHeader;
+	if (!MakeMeshCacheHeader(objFilename, transform, expectedHeader))
+	{
+		return false;
+	}
+	expectedHeader.m_hasLODs = withLODs ? 1 : 0;
+	expectedHeader.m_hasBVH = withBVH ? 1 : 0;
+	MemoryMappedFile cacheFile;
+	if (!cacheFile.Open(GetMeshCacheFilePath(objFilename)) || cacheFile.GetFileSize() < sizeof(MeshCacheHeader))
+	{
+		return false;
+	}
+
+	BufferParser parser(cacheFile);
+	MeshCacheHeader header;
+	memcpy(&header, parser.ParseBytes(sizeof(header)), sizeof(header));
+	expectedHeader.m_numVertexes = header.m_numVertexes;
+	expectedHeader.m_numIndexes = header.m_numIndexes;
+	expectedHeader.m_numLODs = header.m_numLODs;
+	expectedHeader.m_numBVHNodes = header.m_numBVHNodes;
+	expectedHeader.m_numBVHPacks = header.m_numBVHPacks;
+	uint64_t lodTableSize = header.m_numLODs * sizeof(MeshCacheLOD);
+	if (memcmp(&header, &expectedHeader, sizeof(header)) != 0 || header.m_numLODs > MAX_MESH_CACHE_LODS || cacheFile.GetFileSize() < sizeof(header) + lodTableSize)
+	{
+		return false;
+	}
+
+	std::vector<MeshCacheLOD> lodTable(header.m_numLODs);
+	memcpy(lodTable.data(), parser.ParseBytes((size_t)lodTableSize), (size_t)lodTableSize);
+	uint64_t expectedFileSize = sizeof(header) + lodTableSize + header.m_numVertexes * sizeof(Vertex_PCUTBN) + header.m_numIndexes * sizeof(unsigned int);
+	for (MeshCacheLOD const& lod : lodTable)
+	{
+		expectedFileSize += lod.m_numIndexes * sizeof(unsigned int);
+	}
+	expectedFileSize += header.m_numBVHNodes * sizeof(MeshBVHNode) + header.m_numBVHPacks * sizeof(MeshBVHTrianglePack);
+	if (cacheFile.GetFileSize() != expectedFileSize)
+	{
+		return false;
+	}
+
+	m_vertexes.resize((size_t)header.m_numVertexes);
+	m_indexes.resize((size_t)header.m_numIndexes);
+	memcpy(static_cast<void*>(m_vertexes.data()), parser.ParseBytes(m_vertexes.size() * sizeof(Vertex_PCUTBN)), m_vertexes.size() * sizeof(Vertex_PCUTBN));
+	parser.ParseArray(m_indexes.data(), m_indexes.size());
+	m_lods.resize(lodTable.size());
+	for (size_t lodIndex = 0; lodIndex < lodTable.size(); ++lodIndex)
+	{
+		m_lods[lodIndex].m_error = lodTable[lodIndex].m_error;
+		m_lods[lodIndex].m_indexes.resize((size_t)lodTable[lodIndex].m_numIndexes);
+		parser.ParseArray(m_lods[lodIndex].m_indexes.data(), m_lods[lodIndex].m_indexes.size());
+	}
+	std::vector<MeshBVHNode> bvhNodes((size_t)header.m_numBVHNodes);
+	std::vector<MeshBVHTrianglePack> bvhPacks((size_t)header.m_numBVHPacks);
+	memcpy(bvhNodes.data(), parser.ParseBytes(bvhNodes.size() * sizeof(MeshBVHNode)), bvhNodes.size() * sizeof(MeshBVHNode));
+	memcpy(bvhPacks.data(), parser.ParseBytes(bvhPacks.size() * sizeof(MeshBVHTrianglePack)), bvhPacks.size() * sizeof(MeshBVHTrianglePack));
+
+	// The sizes add up, but a damaged or stale cache can still hold indexes off the end of what they index
+	bool isValid = AreTriangleIndexesInRange(m_indexes, m_vertexes.size());
+	for (size_t lodIndex = 0; lodIndex < m_lods.size() && isValid; ++lodIndex)
+	{
+		isValid = AreTriangleIndexesInRange(m_lods[lodIndex].m_indexes, m_vertexes.size());
+	}
+	if (!isValid || !m_bvh.SetNodesAndPacks(std::move(bvhNodes), std::move(bvhPacks), (int)(m_indexes.size() / 3)))
+	{
+		m_vertexes.clear();
+		m_indexes.clear();
+		m_lods.clear();
+		return false;
+	}
+	CalculateBoundingSphere(m_vertexes, m_boundsCenter, m_boundsRadius);
+	return true;
+}
+
+bool CPUMesh::WriteMeshCache(std::string const& objFilename, Mat44 const& transform, bool withLODs, bool withBVH) const
+{
+	MeshCacheHeader header;
+	if (!MakeMeshCacheHeader(objFilename, transform, header))
+	{
+		return false;
+	}
+	header.m_numVertexes = m_vertexes.size();
+	header.m_numIndexes = m_indexes.size();
+	header.m_hasLODs = withLODs ? 1 : 0;
+	header.m_numLODs = withLODs ? (unsigned int)m_lods.size() : 0;
+	header.m_hasBVH = withBVH ? 1 : 0;
+	header.m_numBVHNodes = withBVH ? m_bvh.GetNodes().size() : 0;
+	header.m_numBVHPacks = withBVH ? m_bvh.GetPacks().size() : 0;
+
+	std::vector<MeshCacheLOD> lodTable(header.m_numLODs);
+	size_t numLODIndexes = 0;
+	for (size_t lodIndex = 0; lodIndex < lodTable.size(); ++lodIndex)
+	{
+		lodTable[lodIndex].m_numIndexes = m_lods[lodIndex].m_indexes.size();
+		lodTable[lodIndex].m_error = m_lods[lodIndex].m_error;
+		numLODIndexes += m_lods[lodIndex].m_indexes.size();
+	}
+
+	std::vector<unsigned char> cacheBuffer;
+	cacheBuffer.reserve(sizeof(header) + lodTable.size() * sizeof(MeshCacheLOD) + m_vertexes.size() * sizeof(Vertex_PCUTBN) + (m_indexes.size() + numLODIndexes) * sizeof(unsigned int)
+		+ header.m_numBVHNodes * sizeof(MeshBVHNode) + header.m_numBVHPacks * sizeof(MeshBVHTrianglePack));
+	BufferWriter writer(cacheBuffer);
+	writer.AppendArray(reinterpret_cast<unsigned char const*>(&header), sizeof(header));
+	writer.AppendArray(reinterpret_cast<unsigned char const*>(lodTable.data()), lodTable.size() * sizeof(MeshCacheLOD));
+	writer.AppendArray(reinterpret_cast<unsigned char const*>(m_vertexes.data()), m_vertexes.size() * sizeof(Vertex_PCUTBN));
+	writer.AppendArray(m_indexes.data(), m_indexes.size());
+	for (size_t lodIndex = 0; lodIndex < lodTable.size(); ++lodIndex)
+	{
+		writer.AppendArray(m_lods[lodIndex].m_indexes.data(), m_lods[lodIndex].m_indexes.size());
+	}
+	if (withBVH)
+	{
+		writer.AppendArray(reinterpret_cast<unsigned char const*>(m_bvh.GetNodes().data()), m_bvh.GetNodes().size() * sizeof(MeshBVHNode));
+		writer.AppendArray(reinterpret_cast<unsigned char const*>(m_bvh.GetPacks().data()), m_bvh.GetPacks().size() * sizeof(MeshBVHTrianglePack));
+	}
+	return FileWriteToBuffer(cacheBuffer, GetMeshCacheFilePath(objFilename));
+}
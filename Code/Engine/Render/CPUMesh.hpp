@@ -3,6 +3,18 @@
 #include <string>
 #include "Engine/Core/Vertex_PCU.hpp"
 #include "Engine/Math/Mat44.hpp"
+#include "Engine/Render/MeshBVH.hpp"
+class Camera;
+
+constexpr int DEFAULT_NUM_MESH_LODS = 3;
+constexpr float DEFAULT_MESH_LOD_TRIANGLE_RATIO = 0.5f; // each LOD aims for this fraction of the one before's triangles
+
+struct CPUMeshLOD
+{
+	std::vector<unsigned int> m_indexes; // into the same m_vertexes as the full detail mesh
+	float m_error = 0.f; // how far the surface may be from the full detail one, in mesh units
+};
+
 class CPUMesh
 {
 public:
@@ -10,9 +22,38 @@ public:
 	CPUMesh(std::string const& objFilename, Mat44 const& transform);
 	virtual ~CPUMesh();
 
-	void Load(std::string const& objFilename, Mat44 const& transform);
+	// With useMeshCache the finished mesh (transformed, with tangents, its LODs if generateLODs and its BVH if buildBVH) is
+	// cached in a binary file next to the obj and reloaded straight from it while the obj's size and modified time and the
+	// transform stay the same. Returns false, leaving the mesh empty, if the obj could not be read.
+	bool Load(std::string const& objFilename, Mat44 const& transform, bool useMeshCache = true, bool generateLODs = false, bool buildBVH = false);
 	void Duplicate(Mat44 const& transform);
 
+	// Optional post-load pass: reorders triangles for the vertex cache (and to cut overdraw), then vertexes into the order
+	// they are fetched. Draws exactly the same mesh.
+	void Optimize(bool reduceOverdraw = true);
+
+	// Builds a chain of simplified index lists over the same vertexes, e.g. 50%, 25% and 12.5% of the triangles.
+	// Stops early once simplifying no longer removes triangles.
+	void GenerateLODs(int numLODs = DEFAULT_NUM_MESH_LODS, float triangleRatioPerLOD = DEFAULT_MESH_LOD_TRIANGLE_RATIO);
+	// Picks the coarsest LOD whose error projects to no more than maxErrorPixels on screen, 0 being full detail
+	int SelectLOD(Camera const& camera, Mat44 const& modelToWorld, float viewportHeightPixels, float maxErrorPixels = 1.f) const;
+	std::vector<unsigned int> const& GetLODIndexes(int lodIndex) const;
+	int GetNumLODs() const; // including full detail
+
+	// Triangle BVH over the full detail mesh for Raycast(). Optimize() rebuilds it; anything else that changes the
+	// vertexes or indexes needs to call this again.
+	void BuildBVH();
+	// Nearest hit on the full detail triangles, through the BVH if there is one and testing every triangle if not
+	MeshRaycastResult3D Raycast(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength) const;
+
+	static std::string GetMeshCacheFilePath(std::string const& objFilename);
+	bool LoadFromMeshCache(std::string const& objFilename, Mat44 const& transform, bool withLODs = false, bool withBVH = false);
+	bool WriteMeshCache(std::string const& objFilename, Mat44 const& transform, bool withLODs = false, bool withBVH = false) const;
+
 	std::vector<unsigned int> m_indexes;
 	std::vector<Vertex_PCUTBN> m_vertexes;
+	std::vector<CPUMeshLOD> m_lods; // coarser and coarser, not including the full detail m_indexes
+	MeshBVH m_bvh; // empty until BuildBVH()
+	Vec3 m_boundsCenter;
+	float m_boundsRadius = 0.f;
 };
\ No newline at end of file
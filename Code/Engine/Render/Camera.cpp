@@ -16,6 +16,7 @@ void Camera::SetOrthoView(Vec2 const& bottomLeft, Vec2 const& topRight, float ne
 	m_orthographicTopRight.y   = topRight.y;
 	m_orthographicNear = near;
 	m_orthographicFar  = far;
+	InvalidateProjectionMatrices();
 }
 
 void Camera::SetPerspectiveView(float aspect, float fov, float near, float far)
@@ -25,7 +26,7 @@ void Camera::SetPerspectiveView(float aspect, float fov, float near, float far)
 	m_perspectiveFOV = fov;
 	m_perspectiveNear = near;
 	m_perspectiveFar = far;
-
+	InvalidateProjectionMatrices();
 }
 
 void Camera::SetCameraCenter(Vec2 const& center)
@@ -36,6 +37,7 @@ void Camera::SetCameraCenter(Vec2 const& center)
 	m_orthographicTopRight.y = center.y + cameraHeight / 2;
 	m_orthographicBottomLeft.x = center.x - cameraWidth / 2;
 	m_orthographicBottomLeft.y = center.y - cameraHeight / 2;
+	InvalidateProjectionMatrices();
 } 
 
 
@@ -48,6 +50,7 @@ void Camera::SetNormalizedViewport(AABB2 const& normalizedViewport)
 void Camera::SetFOV(float fov)
 {
 	m_perspectiveFOV = fov;
+	InvalidateProjectionMatrices();
 }
 
 AABB2 Camera::GetDXNormalizedViewport() const
@@ -92,20 +95,32 @@ void Camera::Translate2D(Vec2 const& translation)
 {
 	m_orthographicBottomLeft += translation;
 	m_orthographicTopRight += translation;
+	InvalidateProjectionMatrices();
 }
 
 void Camera::SetTransform(Vec3 const& position, EulerAngles const& orientation)
 {
 	m_position = position;
 	m_orientation = orientation;
+	InvalidateViewMatrices();
 }
 
 Mat44 Camera::GetViewMatrix() const
 {
-	Mat44 viewMatrix = m_orientation.GetAsMatrix_IFwd_JLeft_KUp();
-	viewMatrix.SetTranslation3D(m_position);
-	viewMatrix = viewMatrix.GetOrthonormalInverse();
-	return viewMatrix;
+	if (!m_isViewMatrixValid)
+	{
+		m_cameraToWorldMatrix = m_orientation.GetAsMatrix_IFwd_JLeft_KUp();
+		m_cameraToWorldMatrix.SetTranslation3D(m_position);
+		m_viewMatrix = m_cameraToWorldMatrix.GetOrthonormalInverse();
+		m_isViewMatrixValid = true;
+	}
+	return m_viewMatrix;
+}
+
+Mat44 Camera::GetCameraToWorldMatrix() const
+{
+	GetViewMatrix();
+	return m_cameraToWorldMatrix;
 }
 
 Mat44 Camera::GetOrthographicMatrix() const
@@ -122,23 +137,57 @@ Mat44 Camera::GetPerspectiveMatrix() const
 
 Mat44 Camera::GetProjectionMatrix() const
 {
-	Mat44 projectionMatrix;
+	if (m_isProjectionMatrixValid)
+	{
+		return m_projectionMatrix;
+	}
 	if (m_mode == eMode_Orthographic)
 	{
-		projectionMatrix = GetOrthographicMatrix();
-		projectionMatrix.Append(GetRenderMatrix());
-		return projectionMatrix;
+		m_projectionMatrix = GetOrthographicMatrix();
 	}
 	else if (m_mode == eMode_Perspective)
 	{
-		projectionMatrix = GetPerspectiveMatrix();
-		projectionMatrix.Append(GetRenderMatrix());
-		return projectionMatrix;
+		m_projectionMatrix = GetPerspectiveMatrix();
 	}
 	else
 	{
 		ERROR_AND_DIE("The projection mode of the camera is wrong.");
 	}
+	m_projectionMatrix.Append(GetRenderMatrix());
+	m_isProjectionMatrixValid = true;
+	return m_projectionMatrix;
+}
+
+Mat44 Camera::GetInverseProjectionMatrix() const
+{
+	if (!m_isInverseProjectionMatrixValid)
+	{
+		m_inverseProjectionMatrix = GetProjectionMatrix().GetInverse();
+		m_isInverseProjectionMatrixValid = true;
+	}
+	return m_inverseProjectionMatrix;
+}
+
+Mat44 Camera::GetViewProjectionMatrix() const
+{
+	if (!m_isViewProjectionMatrixValid)
+	{
+		m_viewProjectionMatrix = GetProjectionMatrix();
+		m_viewProjectionMatrix.Append(GetViewMatrix());
+		m_isViewProjectionMatrixValid = true;
+	}
+	return m_viewProjectionMatrix;
+}
+
+Mat44 Camera::GetInverseViewProjectionMatrix() const
+{
+	if (!m_isInverseViewProjectionMatrixValid)
+	{
+		m_inverseViewProjectionMatrix = GetCameraToWorldMatrix();
+		m_inverseViewProjectionMatrix.Append(GetInverseProjectionMatrix());
+		m_isInverseViewProjectionMatrixValid = true;
+	}
+	return m_inverseViewProjectionMatrix;
 }
 
 void Camera::SetRenderBasis(Vec3 const& iBasis, Vec3 const& jBasis, Vec3 const& kBasis)
@@ -146,6 +195,7 @@ void Camera::SetRenderBasis(Vec3 const& iBasis, Vec3 const& jBasis, Vec3 const&
 	m_renderIBasis = iBasis;
 	m_renderJBasis = jBasis;
 	m_renderKBasis = kBasis;
+	InvalidateProjectionMatrices();
 }
 
 Mat44 Camera::GetRenderMatrix() const
@@ -170,19 +220,40 @@ float Camera::GetCameraFOV() const
 	return m_perspectiveFOV;
 }
 
+Camera::Mode Camera::GetMode() const
+{
+	return m_mode;
+}
+
 
+// The point under screenPos at the same depth as where the camera's forward ray crosses z=0
 Vec3 const Camera::GetPerspectiveWorldPos(Vec2 const& screenPos) const
 {
-	Vec3 iBasis, jBasis, kBasis;
-	m_orientation.GetAsVectors_IFwd_JLeft_KUp(iBasis, jBasis, kBasis);
-
+	Vec3 iBasis = GetCameraToWorldMatrix().GetIBasis3D();
 	float cameraToPlaneDistance = -m_position.z / iBasis.z;
-	Vec3 worldPos = m_position + iBasis * cameraToPlaneDistance;
-	float h = 2.f * cameraToPlaneDistance * TanDegrees(m_perspectiveFOV * 0.5f);
-	float w = h * m_perspectiveAspect;
+	Vec3 rayDirection = GetWorldPosFromScreen(screenPos, 1.f) - m_position;
+	return m_position + rayDirection * (cameraToPlaneDistance / DotProduct3D(rayDirection, iBasis));
+}
+
+Vec3 const Camera::GetWorldPosFromScreen(Vec2 const& screenPos, float clipDepth) const
+{
+	Vec4 clipPos(2.f * screenPos.x - 1.f, 2.f * screenPos.y - 1.f, clipDepth, 1.f);
+	Vec4 worldPos = GetInverseViewProjectionMatrix().TransformHomogeneous3D(clipPos);
+	float oneOverW = 1.f / worldPos.w;
+	return Vec3(worldPos.x * oneOverW, worldPos.y * oneOverW, worldPos.z * oneOverW);
+}
 
-	worldPos -= jBasis * (screenPos.x - 0.5f) * w;
-	worldPos += kBasis * (screenPos.y - 0.5f) * h;
+void Camera::InvalidateViewMatrices()
+{
+	m_isViewMatrixValid = false;
+	m_isViewProjectionMatrixValid = false;
+	m_isInverseViewProjectionMatrixValid = false;
+}
 
-	return worldPos;
+void Camera::InvalidateProjectionMatrices()
+{
+	m_isProjectionMatrixValid = false;
+	m_isInverseProjectionMatrixValid = false;
+	m_isViewProjectionMatrixValid = false;
+	m_isInverseViewProjectionMatrixValid = false;
 }
@@ -31,17 +31,27 @@ public:
 	void Translate2D(Vec2 const& translation);
 	void SetTransform(Vec3 const& position, EulerAngles const& orientation);
 	Mat44 GetViewMatrix() const;
+	Mat44 GetCameraToWorldMatrix() const; // inverse of the view matrix
 
 	Mat44 GetOrthographicMatrix() const;
 	Mat44 GetPerspectiveMatrix() const;
 	Mat44 GetProjectionMatrix() const;
+	Mat44 GetInverseProjectionMatrix() const;
+	Mat44 GetViewProjectionMatrix() const; // world to clip space
+	Mat44 GetInverseViewProjectionMatrix() const; // clip space to world
 
 	void SetRenderBasis(Vec3 const& iBasis, Vec3 const& jBasis, Vec3 const& kBasis);
 	Mat44 GetRenderMatrix() const;
 	EulerAngles GetCameraOrientation() const;
 	Vec3 GetCameraPosition() const;
 	float GetCameraFOV() const;
+	Mode GetMode() const;
 	Vec3 const GetPerspectiveWorldPos(Vec2 const& screenPos) const;
+	Vec3 const GetWorldPosFromScreen(Vec2 const& screenPos, float clipDepth) const; // screenPos in 0..1, clipDepth 0 at near and 1 at far
+private:
+	void InvalidateViewMatrices();
+	void InvalidateProjectionMatrices();
+
 private:
 	Mode m_mode = eMode_Orthographic;
 	Vec2 m_orthographicBottomLeft;
@@ -60,4 +70,18 @@ private:
 	Vec3 m_renderIBasis = Vec3(1.f, 0.f, 0.f);
 	Vec3 m_renderJBasis = Vec3(0.f, 1.f, 0.f);
 	Vec3 m_renderKBasis = Vec3(0.f, 0.f, 1.f);
+
+	// Matrices are built when first asked for and kept until SetTransform or a projection setting changes them, so
+	// per-frame picking and culling don't redo the trig and inverses
+	mutable Mat44 m_viewMatrix;
+	mutable Mat44 m_cameraToWorldMatrix;
+	mutable Mat44 m_projectionMatrix;
+	mutable Mat44 m_inverseProjectionMatrix;
+	mutable Mat44 m_viewProjectionMatrix;
+	mutable Mat44 m_inverseViewProjectionMatrix;
+	mutable bool m_isViewMatrixValid = false;
+	mutable bool m_isProjectionMatrixValid = false;
+	mutable bool m_isInverseProjectionMatrixValid = false;
+	mutable bool m_isViewProjectionMatrixValid = false;
+	mutable bool m_isInverseViewProjectionMatrixValid = false;
 };
\ No newline at end of file
@@ -0,0 +1,820 @@
+#include "Engine/Render/MeshBVH.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/JobSystem.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MESH_BVH_HAS_SSE_PATH // SSE2 is part of the x64 baseline, so no runtime check is needed
+#include <immintrin.h>
+#endif
+
+// Nodes this big are binned a chunk at a time on the job system, and everything below them is built as independent
+// subtrees, one job each. Fixed rather than derived from the number of workers, so the tree never depends on them.
+constexpr int MESH_BVH_PARALLEL_SUBTREE_TRIANGLES = 16384;
+constexpr int MESH_BVH_BIN_CHUNK_TRIANGLES = 16384;
+constexpr int MESH_BVH_PACK_LEAVES_PER_JOB = 1024;
+
+// Rays this close to the triangle's plane are treated as missing it
+constexpr float MESH_BVH_MIN_DETERMINANT = 1e-12f;
+
+// Node bounds are grown by this much (relative to the coordinates) over their triangles, so rounding in the triangle test
+// can never put a hit just outside a node that gets culled
+constexpr float MESH_BVH_BOUNDS_PADDING_FRACTION = 1e-5f;
+
+// Stands in for 1/0 in the slab test, so a ray lying in a slab's plane gets a huge t instead of 0 * inf = NaN
+constexpr float MESH_BVH_HUGE_INVERSE_DIRECTION = 1e30f;
+
+// Build-time bounds are padded to four floats so they grow with one SSE min and max; the fourth lane is unused.
+// The triangles themselves are partitioned, not indexes to them, so every pass over a node reads memory in order.
+struct alignas(16) MeshBVHBuildTriangle
+{
+	float m_mins[4];
+	float m_maxs[4];
+	float m_centroid[4];
+	int m_triangleIndex;
+	int m_unused[3];
+};
+
+struct alignas(16) MeshBVHRangeBounds
+{
+	float m_mins[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+	float m_maxs[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	float m_centroidMins[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+	float m_centroidMaxs[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+};
+
+struct alignas(16) MeshBVHBin
+{
+	float m_mins[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+	float m_maxs[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	int m_numTriangles = 0;
+	int m_unused[3] = {}; // explicit padding out to the alignment, as /W4 warns about implicit padding
+};
+
+struct MeshBVHBinning
+{
+	MeshBVHBin m_bins[3][MESH_BVH_NUM_SAH_BINS];
+};
+
+struct MeshBVHSubtree
+{
+	int m_nodeIndex = 0;
+	int m_firstTriangle = 0;
+	int m_numTriangles = 0;
+	int m_depth = 0;
+	std::vector<MeshBVHNode> m_nodes;
+};
+
+struct MeshBVHBuilder
+{
+	std::vector<MeshBVHBuildTriangle> m_triangles;
+	JobSystem* m_jobSystem = nullptr; // null when building everything on the calling thread
+};
+
+// All four lanes of 16 byte aligned bounds
+static void GrowBounds(float* mins, float* maxs, float const* otherMins, float const* otherMaxs)
+{
+#if defined MESH_BVH_HAS_SSE_PATH
+	_mm_store_ps(mins, _mm_min_ps(_mm_load_ps(otherMins), _mm_load_ps(mins)));
+	_mm_store_ps(maxs, _mm_max_ps(_mm_load_ps(otherMaxs), _mm_load_ps(maxs)));
+#else
+	for (int axis = 0; axis < 4; ++axis)
+	{
+		mins[axis] = otherMins[axis] < mins[axis] ? otherMins[axis] : mins[axis];
+		maxs[axis] = otherMaxs[axis] > maxs[axis] ? otherMaxs[axis] : maxs[axis];
+	}
+#endif
+}
+
+static float GetSurfaceArea(float const* mins, float const* maxs)
+{
+	float dimX = maxs[0] - mins[0];
+	float dimY = maxs[1] - mins[1];
+	float dimZ = maxs[2] - mins[2];
+	return 2.f * (dimX * dimY + dimY * dimZ + dimZ * dimX);
+}
+
+static int GetBinIndex(float centroid, float centroidMin, float binsPerUnit)
+{
+	int binIndex = (int)((centroid - centroidMin) * binsPerUnit);
+	return binIndex < MESH_BVH_NUM_SAH_BINS ? binIndex : MESH_BVH_NUM_SAH_BINS - 1;
+}
+
+// Calls function(chunkIndex, firstTriangle, numTriangles) for consecutive chunks of the range, on jobSystem if there is one
+template<typename T_Function>
+static void ForEachTriangleChunk(int firstTriangle, int numTriangles, JobSystem* jobSystem, T_Function const& function)
+{
+	int numChunks = (numTriangles + MESH_BVH_BIN_CHUNK_TRIANGLES - 1) / MESH_BVH_BIN_CHUNK_TRIANGLES;
+	auto doChunk = [&](int chunkIndex)
+		{
+			int chunkFirst = firstTriangle + chunkIndex * MESH_BVH_BIN_CHUNK_TRIANGLES;
+			int chunkEnd = chunkFirst + MESH_BVH_BIN_CHUNK_TRIANGLES < firstTriangle + numTriangles ? chunkFirst + MESH_BVH_BIN_CHUNK_TRIANGLES : firstTriangle + numTriangles;
+			function(chunkIndex, chunkFirst, chunkEnd - chunkFirst);
+		};
+	if (jobSystem != nullptr && numChunks > 1)
+	{
+		jobSystem->ParallelFor(0, numChunks, 1, doChunk);
+		return;
+	}
+	for (int chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
+	{
+		doChunk(chunkIndex);
+	}
+}
+
+static void AddRangeBounds(MeshBVHBuilder const& builder, int firstTriangle, int numTriangles, MeshBVHRangeBounds& bounds)
+{
+	for (int buildIndex = firstTriangle; buildIndex < firstTriangle + numTriangles; ++buildIndex)
+	{
+		MeshBVHBuildTriangle const& triangle = builder.m_triangles[buildIndex];
+		GrowBounds(bounds.m_mins, bounds.m_maxs, triangle.m_mins, triangle.m_maxs);
+		GrowBounds(bounds.m_centroidMins, bounds.m_centroidMaxs, triangle.m_centroid, triangle.m_centroid);
+	}
+}
+
+// Min and max are exact, so merging the chunks in any grouping gives the same bounds and bins as one serial pass
+static void GetRangeBounds(MeshBVHBuilder const& builder, int firstTriangle, int numTriangles, bool isParallel, MeshBVHRangeBounds& out_bounds)
+{
+	out_bounds = MeshBVHRangeBounds();
+	if (!isParallel)
+	{
+		AddRangeBounds(builder, firstTriangle, numTriangles, out_bounds);
+		return;
+	}
+	int numChunks = (numTriangles + MESH_BVH_BIN_CHUNK_TRIANGLES - 1) / MESH_BVH_BIN_CHUNK_TRIANGLES;
+	std::vector<MeshBVHRangeBounds> chunkBounds(numChunks);
+	ForEachTriangleChunk(firstTriangle, numTriangles, builder.m_jobSystem, [&](int chunkIndex, int chunkFirst, int chunkNumTriangles)
+		{
+			AddRangeBounds(builder, chunkFirst, chunkNumTriangles, chunkBounds[chunkIndex]);
+		});
+	for (MeshBVHRangeBounds const& bounds : chunkBounds)
+	{
+		GrowBounds(out_bounds.m_mins, out_bounds.m_maxs, bounds.m_mins, bounds.m_maxs);
+		GrowBounds(out_bounds.m_centroidMins, out_bounds.m_centroidMaxs, bounds.m_centroidMins, bounds.m_centroidMaxs);
+	}
+}
+
+static void AddRangeToBins(MeshBVHBuilder const& builder, int firstTriangle, int numTriangles, float const* centroidMins, float const* binsPerUnit, MeshBVHBinning& binning)
+{
+#if defined MESH_BVH_HAS_SSE_PATH
+	// Same truncation as GetBinIndex, three axes at once
+	__m128 centroidMin = _mm_load_ps(centroidMins);
+	__m128 scale = _mm_load_ps(binsPerUnit);
+	__m128i lastBin = _mm_set1_epi32(MESH_BVH_NUM_SAH_BINS - 1);
+#endif
+	for (int buildIndex = firstTriangle; buildIndex < firstTriangle + numTriangles; ++buildIndex)
+	{
+		MeshBVHBuildTriangle const& triangle = builder.m_triangles[buildIndex];
+		alignas(16) int binIndexes[4];
+#if defined MESH_BVH_HAS_SSE_PATH
+		__m128i binIndex = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(triangle.m_centroid), centroidMin), scale));
+		__m128i isPastLastBin = _mm_cmpgt_epi32(binIndex, lastBin);
+		binIndex = _mm_or_si128(_mm_and_si128(isPastLastBin, lastBin), _mm_andnot_si128(isPastLastBin, binIndex));
+		_mm_store_si128(reinterpret_cast<__m128i*>(binIndexes), binIndex);
+#else
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			binIndexes[axis] = GetBinIndex(triangle.m_centroid[axis], centroidMins[axis], binsPerUnit[axis]);
+		}
+#endif
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			MeshBVHBin& bin = binning.m_bins[axis][binIndexes[axis]];
+			GrowBounds(bin.m_mins, bin.m_maxs, triangle.m_mins, triangle.m_maxs);
+			++bin.m_numTriangles;
+		}
+	}
+}
+
+// Adds the range into binning, which should be freshly constructed; it is too big to clear and copy per node
+static void BinRange(MeshBVHBuilder const& builder, int firstTriangle, int numTriangles, bool isParallel, MeshBVHRangeBounds const& bounds, MeshBVHBinning& binning)
+{
+	alignas(16) float binsPerUnit[4] = {};
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float extent = bounds.m_centroidMaxs[axis] - bounds.m_centroidMins[axis];
+		binsPerUnit[axis] = extent > 0.f ? (float)MESH_BVH_NUM_SAH_BINS / extent : 0.f;
+	}
+	if (!isParallel)
+	{
+		AddRangeToBins(builder, firstTriangle, numTriangles, bounds.m_centroidMins, binsPerUnit, binning);
+		return;
+	}
+	int numChunks = (numTriangles + MESH_BVH_BIN_CHUNK_TRIANGLES - 1) / MESH_BVH_BIN_CHUNK_TRIANGLES;
+	std::vector<MeshBVHBinning> chunkBinnings(numChunks);
+	ForEachTriangleChunk(firstTriangle, numTriangles, builder.m_jobSystem, [&](int chunkIndex, int chunkFirst, int chunkNumTriangles)
+		{
+			AddRangeToBins(builder, chunkFirst, chunkNumTriangles, bounds.m_centroidMins, binsPerUnit, chunkBinnings[chunkIndex]);
+		});
+	for (MeshBVHBinning const& chunkBinning : chunkBinnings)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			for (int binIndex = 0; binIndex < MESH_BVH_NUM_SAH_BINS; ++binIndex)
+			{
+				MeshBVHBin const& bin = chunkBinning.m_bins[axis][binIndex];
+				MeshBVHBin& mergedBin = binning.m_bins[axis][binIndex];
+				GrowBounds(mergedBin.m_mins, mergedBin.m_maxs, bin.m_mins, bin.m_maxs);
+				mergedBin.m_numTriangles += bin.m_numTriangles;
+			}
+		}
+	}
+}
+
+static void PadBounds(float* mins, float* maxs)
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float magnitude = fabsf(mins[axis]) > fabsf(maxs[axis]) ? fabsf(mins[axis]) : fabsf(maxs[axis]);
+		float padding = MESH_BVH_BOUNDS_PADDING_FRACTION * (magnitude + (maxs[axis] - mins[axis]) + 1.f);
+		mins[axis] -= padding;
+		maxs[axis] += padding;
+	}
+}
+
+// Binned SAH, as in BVH3. With out_subtrees, nodes no bigger than MESH_BVH_PARALLEL_SUBTREE_TRIANGLES are left for the
+// caller to build as separate jobs, and the nodes above them bin on the job system.
+// Leaves point at their first build triangle for now; Build() turns that into packs at the end.
+static void BuildNode(MeshBVHBuilder& builder, std::vector<MeshBVHNode>& nodes, int nodeIndex, int firstTriangle, int numTriangles, int depth, std::vector<MeshBVHSubtree>* out_subtrees)
+{
+	if (out_subtrees && numTriangles <= MESH_BVH_PARALLEL_SUBTREE_TRIANGLES)
+	{
+		MeshBVHSubtree subtree;
+		subtree.m_nodeIndex = nodeIndex;
+		subtree.m_firstTriangle = firstTriangle;
+		subtree.m_numTriangles = numTriangles;
+		subtree.m_depth = depth;
+		out_subtrees->push_back(std::move(subtree));
+		return;
+	}
+	bool isParallel = out_subtrees != nullptr && builder.m_jobSystem != nullptr;
+
+	MeshBVHRangeBounds bounds;
+	GetRangeBounds(builder, firstTriangle, numTriangles, isParallel, bounds);
+	float nodeArea = GetSurfaceArea(bounds.m_mins, bounds.m_maxs);
+	MeshBVHNode& node = nodes[nodeIndex];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		node.m_mins[axis] = bounds.m_mins[axis];
+		node.m_maxs[axis] = bounds.m_maxs[axis];
+	}
+	PadBounds(node.m_mins, node.m_maxs);
+	node.m_firstChildOrPack = firstTriangle;
+	node.m_numTriangles = numTriangles;
+	if (numTriangles <= MESH_BVH_MAX_TRIANGLES_PER_LEAF || depth >= MESH_BVH_MAX_DEPTH)
+	{
+		return;
+	}
+
+	MeshBVHBinning binning;
+	BinRange(builder, firstTriangle, numTriangles, isParallel, bounds, binning);
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (bounds.m_centroidMaxs[axis] - bounds.m_centroidMins[axis] <= 0.f)
+		{
+			continue;
+		}
+
+		// Sweep from the right to get the cost of every right side, then from the left to finish each split's cost
+		MeshBVHBin const* bins = binning.m_bins[axis];
+		float rightCosts[MESH_BVH_NUM_SAH_BINS];
+		MeshBVHBin sweep;
+		for (int binIndex = MESH_BVH_NUM_SAH_BINS - 1; binIndex > 0; --binIndex)
+		{
+			GrowBounds(sweep.m_mins, sweep.m_maxs, bins[binIndex].m_mins, bins[binIndex].m_maxs);
+			sweep.m_numTriangles += bins[binIndex].m_numTriangles;
+			rightCosts[binIndex] = sweep.m_numTriangles > 0 ? sweep.m_numTriangles * GetSurfaceArea(sweep.m_mins, sweep.m_maxs) : 0.f;
+		}
+		sweep = MeshBVHBin();
+		for (int split = 1; split < MESH_BVH_NUM_SAH_BINS; ++split)
+		{
+			GrowBounds(sweep.m_mins, sweep.m_maxs, bins[split - 1].m_mins, bins[split - 1].m_maxs);
+			sweep.m_numTriangles += bins[split - 1].m_numTriangles;
+			if (sweep.m_numTriangles == 0 || sweep.m_numTriangles == numTriangles)
+			{
+				continue;
+			}
+			float cost = sweep.m_numTriangles * GetSurfaceArea(sweep.m_mins, sweep.m_maxs) + rightCosts[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	int numLeftTriangles = 0;
+	if (bestAxis >= 0)
+	{
+		if (bestCost >= numTriangles * nodeArea && numTriangles <= 2 * MESH_BVH_MAX_TRIANGLES_PER_LEAF)
+		{
+			return;
+		}
+		float centroidMin = bounds.m_centroidMins[bestAxis];
+		float binsPerUnit = (float)MESH_BVH_NUM_SAH_BINS / (bounds.m_centroidMaxs[bestAxis] - centroidMin);
+		MeshBVHBuildTriangle* firstBuildTriangle = builder.m_triangles.data() + firstTriangle;
+		MeshBVHBuildTriangle* middle = std::partition(firstBuildTriangle, firstBuildTriangle + numTriangles, [&](MeshBVHBuildTriangle const& triangle)
+			{
+				return GetBinIndex(triangle.m_centroid[bestAxis], centroidMin, binsPerUnit) < bestSplit;
+			});
+		numLeftTriangles = (int)(middle - firstBuildTriangle);
+	}
+	if (numLeftTriangles == 0 || numLeftTriangles == numTriangles)
+	{
+		// Every centroid in one place: any split is as good as another
+		numLeftTriangles = numTriangles / 2;
+	}
+
+	int leftChild = (int)nodes.size();
+	nodes.push_back(MeshBVHNode());
+	nodes.push_back(MeshBVHNode());
+	nodes[nodeIndex].m_firstChildOrPack = leftChild;
+	nodes[nodeIndex].m_numTriangles = 0;
+	BuildNode(builder, nodes, leftChild, firstTriangle, numLeftTriangles, depth + 1, out_subtrees);
+	BuildNode(builder, nodes, leftChild + 1, firstTriangle + numLeftTriangles, numTriangles - numLeftTriangles, depth + 1, out_subtrees);
+}
+
+void MeshBVH::Build(std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes, JobSystem* jobSystem)
+{
+	Clear();
+	int numTriangles = (int)(indexes.size() / 3);
+	if (numTriangles == 0)
+	{
+		return;
+	}
+
+	MeshBVHBuilder builder;
+	builder.m_jobSystem = jobSystem != nullptr && jobSystem->GetNumWorkers() > 0 ? jobSystem : nullptr;
+	builder.m_triangles.resize(numTriangles);
+	ForEachTriangleChunk(0, numTriangles, builder.m_jobSystem, [&](int, int chunkFirst, int chunkNumTriangles)
+		{
+			for (int triangleIndex = chunkFirst; triangleIndex < chunkFirst + chunkNumTriangles; ++triangleIndex)
+			{
+				MeshBVHBuildTriangle& triangle = builder.m_triangles[triangleIndex];
+				Vec3 const& corner0 = vertexes[indexes[triangleIndex * 3]].m_position;
+				Vec3 const& corner1 = vertexes[indexes[triangleIndex * 3 + 1]].m_position;
+				Vec3 const& corner2 = vertexes[indexes[triangleIndex * 3 + 2]].m_position;
+				float const* corners[3] = { &corner0.x, &corner1.x, &corner2.x };
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					float minCoord = corners[0][axis] < corners[1][axis] ? corners[0][axis] : corners[1][axis];
+					float maxCoord = corners[0][axis] > corners[1][axis] ? corners[0][axis] : corners[1][axis];
+					triangle.m_mins[axis] = corners[2][axis] < minCoord ? corners[2][axis] : minCoord;
+					triangle.m_maxs[axis] = corners[2][axis] > maxCoord ? corners[2][axis] : maxCoord;
+					triangle.m_centroid[axis] = (triangle.m_mins[axis] + triangle.m_maxs[axis]) * 0.5f;
+				}
+				triangle.m_mins[3] = 0.f;
+				triangle.m_maxs[3] = 0.f;
+				triangle.m_centroid[3] = 0.f;
+				triangle.m_triangleIndex = triangleIndex;
+			}
+		});
+
+	// The top of the tree is split with parallel binning, then each subtree below it is built on its own
+	std::vector<MeshBVHSubtree> subtrees;
+	m_nodes.reserve(2 * numTriangles / MESH_BVH_MAX_TRIANGLES_PER_LEAF + 1);
+	m_nodes.push_back(MeshBVHNode());
+	BuildNode(builder, m_nodes, 0, 0, numTriangles, 0, &subtrees);
+	auto buildSubtree = [&](int subtreeIndex)
+		{
+			MeshBVHSubtree& subtree = subtrees[subtreeIndex];
+			subtree.m_nodes.push_back(MeshBVHNode());
+			BuildNode(builder, subtree.m_nodes, 0, subtree.m_firstTriangle, subtree.m_numTriangles, subtree.m_depth, nullptr);
+		};
+	if (builder.m_jobSystem != nullptr)
+	{
+		builder.m_jobSystem->ParallelFor(0, (int)subtrees.size(), 1, buildSubtree);
+	}
+	else
+	{
+		for (int subtreeIndex = 0; subtreeIndex < (int)subtrees.size(); ++subtreeIndex)
+		{
+			buildSubtree(subtreeIndex);
+		}
+	}
+
+	// Stitch each subtree in: its root replaces the placeholder, the rest are appended with their child links moved
+	for (MeshBVHSubtree const& subtree : subtrees)
+	{
+		int firstNewNode = (int)m_nodes.size() - 1;
+		for (int localIndex = 0; localIndex < (int)subtree.m_nodes.size(); ++localIndex)
+		{
+			MeshBVHNode node = subtree.m_nodes[localIndex];
+			if (node.m_numTriangles == 0)
+			{
+				node.m_firstChildOrPack += firstNewNode;
+			}
+			if (localIndex == 0)
+			{
+				m_nodes[subtree.m_nodeIndex] = node;
+			}
+			else
+			{
+				m_nodes.push_back(node);
+			}
+		}
+	}
+
+	// Each leaf gets enough packs for its triangles, in leaf order, padded out with triangles that never hit
+	std::vector<int> leafNodes;
+	int numPacks = 0;
+	for (int nodeIndex = 0; nodeIndex < (int)m_nodes.size(); ++nodeIndex)
+	{
+		if (m_nodes[nodeIndex].m_numTriangles > 0)
+		{
+			leafNodes.push_back(nodeIndex);
+			numPacks += (m_nodes[nodeIndex].m_numTriangles + MESH_BVH_TRIANGLES_PER_PACK - 1) / MESH_BVH_TRIANGLES_PER_PACK;
+		}
+	}
+	m_packs.resize(numPacks);
+	std::vector<int> leafFirstPacks(leafNodes.size());
+	int nextPack = 0;
+	for (int leafIndex = 0; leafIndex < (int)leafNodes.size(); ++leafIndex)
+	{
+		leafFirstPacks[leafIndex] = nextPack;
+		nextPack += (m_nodes[leafNodes[leafIndex]].m_numTriangles + MESH_BVH_TRIANGLES_PER_PACK - 1) / MESH_BVH_TRIANGLES_PER_PACK;
+	}
+	auto fillLeafPacks = [&](int leafIndex)
+		{
+			MeshBVHNode& leaf = m_nodes[leafNodes[leafIndex]];
+			int firstTriangle = leaf.m_firstChildOrPack;
+			leaf.m_firstChildOrPack = leafFirstPacks[leafIndex];
+			for (int leafTriangle = 0; leafTriangle < leaf.m_numTriangles + MESH_BVH_TRIANGLES_PER_PACK - 1; ++leafTriangle)
+			{
+				MeshBVHTrianglePack& pack = m_packs[leaf.m_firstChildOrPack + leafTriangle / MESH_BVH_TRIANGLES_PER_PACK];
+				int lane = leafTriangle % MESH_BVH_TRIANGLES_PER_PACK;
+				if (leafTriangle >= leaf.m_numTriangles)
+				{
+					if (lane == 0)
+					{
+						break;
+					}
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						pack.m_corner0[axis][lane] = 0.f;
+						pack.m_edge1[axis][lane] = 0.f;
+						pack.m_edge2[axis][lane] = 0.f;
+					}
+					pack.m_triangleIndexes[lane] = -1;
+					continue;
+				}
+				int triangleIndex = builder.m_triangles[firstTriangle + leafTriangle].m_triangleIndex;
+				float const* corner0 = &vertexes[indexes[triangleIndex * 3]].m_position.x;
+				float const* corner1 = &vertexes[indexes[triangleIndex * 3 + 1]].m_position.x;
+				float const* corner2 = &vertexes[indexes[triangleIndex * 3 + 2]].m_position.x;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					pack.m_corner0[axis][lane] = corner0[axis];
+					pack.m_edge1[axis][lane] = corner1[axis] - corner0[axis];
+					pack.m_edge2[axis][lane] = corner2[axis] - corner0[axis];
+				}
+				pack.m_triangleIndexes[lane] = triangleIndex;
+			}
+		};
+	if (builder.m_jobSystem != nullptr)
+	{
+		builder.m_jobSystem->ParallelFor(0, (int)leafNodes.size(), MESH_BVH_PACK_LEAVES_PER_JOB, fillLeafPacks);
+	}
+	else
+	{
+		for (int leafIndex = 0; leafIndex < (int)leafNodes.size(); ++leafIndex)
+		{
+			fillLeafPacks(leafIndex);
+		}
+	}
+}
+
+void MeshBVH::Clear()
+{
+	m_nodes.clear();
+	m_packs.clear();
+}
+
+bool MeshBVH::SetNodesAndPacks(std::vector<MeshBVHNode>&& nodes, std::vector<MeshBVHTrianglePack>&& packs, int numTriangles)
+{
+	Clear();
+	int64_t numNodes = (int64_t)nodes.size();
+	int64_t numPacks = (int64_t)packs.size();
+	// Children always come after their parent, which also rules out cycles, so depths can be worked out going forward.
+	// Raycast's stack only has room for MESH_BVH_MAX_DEPTH levels.
+	std::vector<int> depths(nodes.size(), 0);
+	for (int64_t nodeIndex = 0; nodeIndex < numNodes; ++nodeIndex)
+	{
+		MeshBVHNode const& node = nodes[(size_t)nodeIndex];
+		int64_t firstChildOrPack = node.m_firstChildOrPack;
+		if (node.m_numTriangles < 0 || firstChildOrPack < 0 || depths[(size_t)nodeIndex] > MESH_BVH_MAX_DEPTH)
+		{
+			return false;
+		}
+		if (node.m_numTriangles > 0)
+		{
+			if (firstChildOrPack + (node.m_numTriangles + MESH_BVH_TRIANGLES_PER_PACK - 1) / MESH_BVH_TRIANGLES_PER_PACK > numPacks)
+			{
+				return false;
+			}
+			continue;
+		}
+		if (firstChildOrPack <= nodeIndex || firstChildOrPack + 1 >= numNodes)
+		{
+			return false;
+		}
+		depths[(size_t)firstChildOrPack] = std::max(depths[(size_t)firstChildOrPack], depths[(size_t)nodeIndex] + 1);
+		depths[(size_t)firstChildOrPack + 1] = std::max(depths[(size_t)firstChildOrPack + 1], depths[(size_t)nodeIndex] + 1);
+	}
+	for (MeshBVHTrianglePack const& pack : packs)
+	{
+		for (int lane = 0; lane < MESH_BVH_TRIANGLES_PER_PACK; ++lane)
+		{
+			if (pack.m_triangleIndexes[lane] < -1 || pack.m_triangleIndexes[lane] >= numTriangles)
+			{
+				return false;
+			}
+		}
+	}
+	m_nodes = std::move(nodes);
+	m_packs = std::move(packs);
+	return true;
+}
+
+// Moller-Trumbore, two sided. The SSE2 pack test below does exactly the same operations in the same order, so both
+// find bitwise identical distances and barycentrics.
+static bool RaycastVsTriangle(float const* rayStart, float const* rayDirection, float rayLength, float const* corner0, float const* edge1, float const* edge2, float& out_dist, float& out_u, float& out_v)
+{
+	float px = rayDirection[1] * edge2[2] - rayDirection[2] * edge2[1];
+	float py = rayDirection[2] * edge2[0] - rayDirection[0] * edge2[2];
+	float pz = rayDirection[0] * edge2[1] - rayDirection[1] * edge2[0];
+	float determinant = edge1[0] * px + edge1[1] * py + edge1[2] * pz;
+	if (fabsf(determinant) < MESH_BVH_MIN_DETERMINANT)
+	{
+		return false;
+	}
+	float inverseDeterminant = 1.f / determinant;
+	float sx = rayStart[0] - corner0[0];
+	float sy = rayStart[1] - corner0[1];
+	float sz = rayStart[2] - corner0[2];
+	float u = (sx * px + sy * py + sz * pz) * inverseDeterminant;
+	if (u < 0.f || u > 1.f)
+	{
+		return false;
+	}
+	float qx = sy * edge1[2] - sz * edge1[1];
+	float qy = sz * edge1[0] - sx * edge1[2];
+	float qz = sx * edge1[1] - sy * edge1[0];
+	float v = (rayDirection[0] * qx + rayDirection[1] * qy + rayDirection[2] * qz) * inverseDeterminant;
+	if (v < 0.f || u + v > 1.f)
+	{
+		return false;
+	}
+	float dist = (edge2[0] * qx + edge2[1] * qy + edge2[2] * qz) * inverseDeterminant;
+	if (dist < 0.f || dist > rayLength)
+	{
+		return false;
+	}
+	out_dist = dist;
+	out_u = u;
+	out_v = v;
+	return true;
+}
+
+struct MeshBVHNearestHit
+{
+	int m_triangleIndex = -1;
+	float m_dist = 0.f;
+	float m_u = 0.f;
+	float m_v = 0.f;
+};
+
+static void UpdateNearestHit(MeshBVHNearestHit& nearestHit, int triangleIndex, float dist, float u, float v)
+{
+	if (nearestHit.m_triangleIndex < 0 || dist < nearestHit.m_dist || (dist == nearestHit.m_dist && triangleIndex < nearestHit.m_triangleIndex))
+	{
+		nearestHit.m_triangleIndex = triangleIndex;
+		nearestHit.m_dist = dist;
+		nearestHit.m_u = u;
+		nearestHit.m_v = v;
+	}
+}
+
+static void RaycastVsTrianglePack(MeshBVHTrianglePack const& pack, float const* rayStart, float const* rayDirection, float rayLength, MeshBVHNearestHit& nearestHit)
+{
+#if defined MESH_BVH_HAS_SSE_PATH
+	__m128 dx = _mm_set1_ps(rayDirection[0]);
+	__m128 dy = _mm_set1_ps(rayDirection[1]);
+	__m128 dz = _mm_set1_ps(rayDirection[2]);
+	__m128 e1x = _mm_load_ps(pack.m_edge1[0]);
+	__m128 e1y = _mm_load_ps(pack.m_edge1[1]);
+	__m128 e1z = _mm_load_ps(pack.m_edge1[2]);
+	__m128 e2x = _mm_load_ps(pack.m_edge2[0]);
+	__m128 e2y = _mm_load_ps(pack.m_edge2[1]);
+	__m128 e2z = _mm_load_ps(pack.m_edge2[2]);
+
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+	__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	__m128 absDeterminant = _mm_and_ps(determinant, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+	__m128 hitMask = _mm_cmpge_ps(absDeterminant, _mm_set1_ps(MESH_BVH_MIN_DETERMINANT));
+	if (_mm_movemask_ps(hitMask) == 0)
+	{
+		return;
+	}
+	__m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.f), determinant);
+
+	__m128 sx = _mm_sub_ps(_mm_set1_ps(rayStart[0]), _mm_load_ps(pack.m_corner0[0]));
+	__m128 sy = _mm_sub_ps(_mm_set1_ps(rayStart[1]), _mm_load_ps(pack.m_corner0[1]));
+	__m128 sz = _mm_sub_ps(_mm_set1_ps(rayStart[2]), _mm_load_ps(pack.m_corner0[2]));
+	__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDeterminant);
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.f);
+	hitMask = _mm_and_ps(hitMask, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+	if (_mm_movemask_ps(hitMask) == 0)
+	{
+		return;
+	}
+
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+	__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDeterminant);
+	__m128 dist = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDeterminant);
+	hitMask = _mm_and_ps(hitMask, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+	hitMask = _mm_and_ps(hitMask, _mm_and_ps(_mm_cmpge_ps(dist, zero), _mm_cmple_ps(dist, _mm_set1_ps(rayLength))));
+	int hitBits = _mm_movemask_ps(hitMask);
+	if (hitBits == 0)
+	{
+		return;
+	}
+
+	alignas(16) float dists[MESH_BVH_TRIANGLES_PER_PACK];
+	alignas(16) float us[MESH_BVH_TRIANGLES_PER_PACK];
+	alignas(16) float vs[MESH_BVH_TRIANGLES_PER_PACK];
+	_mm_store_ps(dists, dist);
+	_mm_store_ps(us, u);
+	_mm_store_ps(vs, v);
+	for (int lane = 0; lane < MESH_BVH_TRIANGLES_PER_PACK; ++lane)
+	{
+		if (hitBits & (1 << lane))
+		{
+			UpdateNearestHit(nearestHit, pack.m_triangleIndexes[lane], dists[lane], us[lane], vs[lane]);
+		}
+	}
+#else
+	for (int lane = 0; lane < MESH_BVH_TRIANGLES_PER_PACK; ++lane)
+	{
+		if (pack.m_triangleIndexes[lane] < 0)
+		{
+			continue;
+		}
+		float corner0[3] = { pack.m_corner0[0][lane], pack.m_corner0[1][lane], pack.m_corner0[2][lane] };
+		float edge1[3] = { pack.m_edge1[0][lane], pack.m_edge1[1][lane], pack.m_edge1[2][lane] };
+		float edge2[3] = { pack.m_edge2[0][lane], pack.m_edge2[1][lane], pack.m_edge2[2][lane] };
+		float dist = 0.f;
+		float u = 0.f;
+		float v = 0.f;
+		if (RaycastVsTriangle(rayStart, rayDirection, rayLength, corner0, edge1, edge2, dist, u, v))
+		{
+			UpdateNearestHit(nearestHit, pack.m_triangleIndexes[lane], dist, u, v);
+		}
+	}
+#endif
+}
+
+static MeshRaycastResult3D MakeMeshRaycastResult(MeshBVHNearestHit const& nearestHit, Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength, std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes)
+{
+	MeshRaycastResult3D result;
+	result.m_rayStartPos = rayStart;
+	result.m_rayFwdNormal = rayForwardNormal;
+	result.m_rayMaxLength = rayLength;
+	if (nearestHit.m_triangleIndex < 0)
+	{
+		return result;
+	}
+	Vertex_PCUTBN const& vertex0 = vertexes[indexes[nearestHit.m_triangleIndex * 3]];
+	Vertex_PCUTBN const& vertex1 = vertexes[indexes[nearestHit.m_triangleIndex * 3 + 1]];
+	Vertex_PCUTBN const& vertex2 = vertexes[indexes[nearestHit.m_triangleIndex * 3 + 2]];
+	result.m_didImpact = true;
+	result.m_impactDist = nearestHit.m_dist;
+	result.m_impactPos = rayStart + rayForwardNormal * nearestHit.m_dist;
+	result.m_triangleIndex = nearestHit.m_triangleIndex;
+	result.m_barycentrics = Vec3(1.f - nearestHit.m_u - nearestHit.m_v, nearestHit.m_u, nearestHit.m_v);
+	result.m_impactUV = vertex0.m_uvTexCoords * result.m_barycentrics.x + vertex1.m_uvTexCoords * result.m_barycentrics.y + vertex2.m_uvTexCoords * result.m_barycentrics.z;
+	result.m_impactNormal = (vertex0.m_normal * result.m_barycentrics.x + vertex1.m_normal * result.m_barycentrics.y + vertex2.m_normal * result.m_barycentrics.z).GetNormalized();
+	result.m_faceNormal = CrossProduct3D(vertex1.m_position - vertex0.m_position, vertex2.m_position - vertex0.m_position).GetNormalized();
+	return result;
+}
+
+// Slab test of the ray against a node; out_tNear is where the ray enters it, in distance along the ray
+static bool DoesRayHitNode(MeshBVHNode const& node, float const* rayStart, float const* inverseDirection, float maxDist, float& out_tNear)
+{
+	float tNear = 0.f;
+	float tFar = maxDist;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float tMin = (node.m_mins[axis] - rayStart[axis]) * inverseDirection[axis];
+		float tMax = (node.m_maxs[axis] - rayStart[axis]) * inverseDirection[axis];
+		if (tMin > tMax)
+		{
+			float swap = tMin;
+			tMin = tMax;
+			tMax = swap;
+		}
+		tNear = tMin > tNear ? tMin : tNear;
+		tFar = tMax < tFar ? tMax : tFar;
+	}
+	out_tNear = tNear;
+	return tNear <= tFar;
+}
+
+MeshRaycastResult3D MeshBVH::Raycast(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength, std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes) const
+{
+	MeshBVHNearestHit nearestHit;
+	if (!m_nodes.empty())
+	{
+		float start[3] = { rayStart.x, rayStart.y, rayStart.z };
+		float direction[3] = { rayForwardNormal.x, rayForwardNormal.y, rayForwardNormal.z };
+		float inverseDirection[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			inverseDirection[axis] = direction[axis] != 0.f ? 1.f / direction[axis] : (std::signbit(direction[axis]) ? -MESH_BVH_HUGE_INVERSE_DIRECTION : MESH_BVH_HUGE_INVERSE_DIRECTION);
+		}
+
+		// A triangle at the same distance as the nearest so far can still win with a lower index, so only nodes entered
+		// strictly beyond it are culled
+		float nearestDist = rayLength;
+		int stack[MESH_BVH_MAX_DEPTH + 2];
+		int stackSize = 0;
+		float rootNear = 0.f;
+		if (DoesRayHitNode(m_nodes[0], start, inverseDirection, rayLength, rootNear))
+		{
+			stack[stackSize++] = 0;
+		}
+		while (stackSize > 0)
+		{
+			MeshBVHNode const& node = m_nodes[stack[--stackSize]];
+			if (node.m_numTriangles > 0)
+			{
+				int numPacks = (node.m_numTriangles + MESH_BVH_TRIANGLES_PER_PACK - 1) / MESH_BVH_TRIANGLES_PER_PACK;
+				for (int packIndex = node.m_firstChildOrPack; packIndex < node.m_firstChildOrPack + numPacks; ++packIndex)
+				{
+					RaycastVsTrianglePack(m_packs[packIndex], start, direction, rayLength, nearestHit);
+				}
+				nearestDist = nearestHit.m_triangleIndex >= 0 ? nearestHit.m_dist : rayLength;
+				continue;
+			}
+
+			// Visit the nearer child first so the far one is more likely to be culled by the time it is popped
+			int leftIndex = node.m_firstChildOrPack;
+			float leftNear = 0.f;
+			float rightNear = 0.f;
+			bool hitsLeft = DoesRayHitNode(m_nodes[leftIndex], start, inverseDirection, rayLength, leftNear) && leftNear <= nearestDist;
+			bool hitsRight = DoesRayHitNode(m_nodes[leftIndex + 1], start, inverseDirection, rayLength, rightNear) && rightNear <= nearestDist;
+			if (hitsLeft && hitsRight)
+			{
+				bool isLeftNearer = leftNear <= rightNear;
+				stack[stackSize++] = isLeftNearer ? leftIndex + 1 : leftIndex;
+				stack[stackSize++] = isLeftNearer ? leftIndex : leftIndex + 1;
+			}
+			else if (hitsLeft)
+			{
+				stack[stackSize++] = leftIndex;
+			}
+			else if (hitsRight)
+			{
+				stack[stackSize++] = leftIndex + 1;
+			}
+		}
+	}
+	return MakeMeshRaycastResult(nearestHit, rayStart, rayForwardNormal, rayLength, vertexes, indexes);
+}
+
+MeshRaycastResult3D MeshBVH::RaycastAllTriangles(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength, std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes)
+{
+	MeshBVHNearestHit nearestHit;
+	float start[3] = { rayStart.x, rayStart.y, rayStart.z };
+	float direction[3] = { rayForwardNormal.x, rayForwardNormal.y, rayForwardNormal.z };
+	int numTriangles = (int)(indexes.size() / 3);
+	for (int triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex)
+	{
+		float const* corner0 = &vertexes[indexes[triangleIndex * 3]].m_position.x;
+		float const* corner1 = &vertexes[indexes[triangleIndex * 3 + 1]].m_position.x;
+		float const* corner2 = &vertexes[indexes[triangleIndex * 3 + 2]].m_position.x;
+		float edge1[3] = { corner1[0] - corner0[0], corner1[1] - corner0[1], corner1[2] - corner0[2] };
+		float edge2[3] = { corner2[0] - corner0[0], corner2[1] - corner0[1], corner2[2] - corner0[2] };
+		float dist = 0.f;
+		float u = 0.f;
+		float v = 0.f;
+		if (RaycastVsTriangle(start, direction, rayLength, corner0, edge1, edge2, dist, u, v))
+		{
+			UpdateNearestHit(nearestHit, triangleIndex, dist, u, v);
+		}
+	}
+	return MakeMeshRaycastResult(nearestHit, rayStart, rayForwardNormal, rayLength, vertexes, indexes);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "Engine/Core/Vertex_PCU.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include <vector>
+
+// Bounding volume hierarchy over the triangles of an indexed mesh, for raycasting the actual surface instead of bounds.
+// Leaves keep their triangles as packs of four (structure-of-arrays, precomputed edges) so one SSE2 Moller-Trumbore
+// test covers a whole pack. The tree only keeps positions, so it goes stale when the vertexes or triangle order change.
+// The build bins large nodes and builds the subtrees below them on a job system when given one; the tree comes out the
+// same whichever thread builds what.
+
+constexpr int MESH_BVH_TRIANGLES_PER_PACK = 4;
+constexpr int MESH_BVH_MAX_TRIANGLES_PER_LEAF = 4;
+constexpr int MESH_BVH_NUM_SAH_BINS = 16;
+constexpr int MESH_BVH_MAX_DEPTH = 60;
+
+struct MeshRaycastResult3D
+{
+	bool	m_didImpact = false;
+	float	m_impactDist = 0.f;
+	Vec3	m_impactPos;
+	Vec3	m_impactNormal; // interpolated from the vertex normals
+	Vec3	m_faceNormal; // from the triangle's winding, whichever side was hit
+	Vec2	m_impactUV;
+	Vec3	m_barycentrics; // weights of the triangle's three corners
+	int		m_triangleIndex = -1; // its corners are indexes[3 * m_triangleIndex] to indexes[3 * m_triangleIndex + 2]
+
+	Vec3	m_rayFwdNormal;
+	Vec3	m_rayStartPos;
+	float	m_rayMaxLength = 1.f;
+};
+
+// 32 bytes, two to a cache line. Children are allocated in pairs, so an interior node only stores its first child
+struct MeshBVHNode
+{
+	float m_mins[3];
+	int m_firstChildOrPack = 0; // interior: the left child, right is the next node; leaf: its first triangle pack
+	float m_maxs[3];
+	int m_numTriangles = 0; // 0 for interior nodes
+};
+
+struct alignas(16) MeshBVHTrianglePack
+{
+	float m_corner0[3][MESH_BVH_TRIANGLES_PER_PACK];
+	float m_edge1[3][MESH_BVH_TRIANGLES_PER_PACK]; // corner1 - corner0
+	float m_edge2[3][MESH_BVH_TRIANGLES_PER_PACK]; // corner2 - corner0
+	int m_triangleIndexes[MESH_BVH_TRIANGLES_PER_PACK]; // -1 pads a leaf's last pack, with zero edges that never hit
+};
+
+class MeshBVH
+{
+public:
+	// A null jobSystem (or one without workers) builds it all on the calling thread
+	void Build(std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes, JobSystem* jobSystem = g_theJobSystem);
+	void Clear();
+	bool IsBuilt() const { return !m_nodes.empty(); }
+
+	// Nearest hit on either side of any triangle (the lowest triangle index on ties). The vertexes and indexes must be
+	// the ones the tree was built from; they supply the UV and normal at the hit.
+	MeshRaycastResult3D Raycast(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength, std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes) const;
+	// Tests every triangle one at a time; gives the same results as Raycast without needing a tree
+	static MeshRaycastResult3D RaycastAllTriangles(Vec3 const& rayStart, Vec3 const& rayForwardNormal, float rayLength, std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes);
+
+	int GetNumNodes() const { return (int)m_nodes.size(); }
+	int GetNumPacks() const { return (int)m_packs.size(); }
+
+	// For saving the tree alongside its mesh, e.g. in the mesh cache
+	std::vector<MeshBVHNode> const& GetNodes() const { return m_nodes; }
+	std::vector<MeshBVHTrianglePack> const& GetPacks() const { return m_packs; }
+	// Checks they form a tree over numTriangles triangles that Raycast can walk without leaving the arrays; if not (a
+	// damaged or stale file), returns false and leaves this empty
+	bool SetNodesAndPacks(std::vector<MeshBVHNode>&& nodes, std::vector<MeshBVHTrianglePack>&& packs, int numTriangles);
+
+private:
+	std::vector<MeshBVHNode> m_nodes;
+	std::vector<MeshBVHTrianglePack> m_packs;
+};
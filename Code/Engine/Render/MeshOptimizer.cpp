@@ -0,0 +1,334 @@
+#include "Engine/Render/MeshOptimizer.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+constexpr int FORSYTH_CACHE_SIZE = 32;
+constexpr int FORSYTH_MAX_SCORED_VALENCE = 32;
+
+// Score tables straight from Forsyth's paper: the 3 most recent vertexes score the same so the triangle just emitted
+// doesn't dominate, older ones decay, and vertexes with few triangles left get a boost so no lone triangles are left behind
+struct ForsythScoreTables
+{
+	ForsythScoreTables()
+	{
+		for (int cachePosition = 0; cachePosition < FORSYTH_CACHE_SIZE; ++cachePosition)
+		{
+			m_cachePositionScores[cachePosition] = cachePosition < 3 ? 0.75f : powf(1.f - (float)(cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+		}
+		m_valenceScores[0] = 0.f;
+		for (int valence = 1; valence <= FORSYTH_MAX_SCORED_VALENCE; ++valence)
+		{
+			m_valenceScores[valence] = 2.f / sqrtf((float)valence);
+		}
+	}
+	float m_cachePositionScores[FORSYTH_CACHE_SIZE];
+	float m_valenceScores[FORSYTH_MAX_SCORED_VALENCE + 1];
+};
+
+static float GetForsythVertexScore(int cachePosition, int numLiveTriangles)
+{
+	static ForsythScoreTables const s_scoreTables;
+	if (numLiveTriangles == 0)
+	{
+		return -1.f; // nothing left to draw with it
+	}
+	float score = cachePosition >= 0 ? s_scoreTables.m_cachePositionScores[cachePosition] : 0.f;
+	return score + s_scoreTables.m_valenceScores[numLiveTriangles < FORSYTH_MAX_SCORED_VALENCE ? numLiveTriangles : FORSYTH_MAX_SCORED_VALENCE];
+}
+
+VertexCacheStats SimulateVertexCache(std::vector<unsigned int> const& indexes, size_t numVertexes, int cacheSize)
+{
+	VertexCacheStats stats;
+	stats.m_numTriangles = (int)(indexes.size() / 3);
+
+	// A vertex is still in the FIFO if fewer than cacheSize vertexes have been transformed since it was
+	std::vector<unsigned int> transformTimes(numVertexes, 0);
+	unsigned int time = (unsigned int)cacheSize + 1;
+	for (size_t i = 0; i < (size_t)stats.m_numTriangles * 3; ++i)
+	{
+		unsigned int& transformTime = transformTimes[indexes[i]];
+		if (transformTime == 0)
+		{
+			++stats.m_numVertexesReferenced;
+		}
+		if (time - transformTime > (unsigned int)cacheSize)
+		{
+			transformTime = time++;
+			++stats.m_numTransformedVertexes;
+		}
+	}
+	stats.m_acmr = stats.m_numTriangles > 0 ? (float)stats.m_numTransformedVertexes / (float)stats.m_numTriangles : 0.f;
+	stats.m_atvr = stats.m_numVertexesReferenced > 0 ? (float)stats.m_numTransformedVertexes / (float)stats.m_numVertexesReferenced : 0.f;
+	return stats;
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indexes, size_t numVertexes)
+{
+	size_t numTriangles = indexes.size() / 3;
+	if (numTriangles < 2)
+	{
+		return;
+	}
+
+	// Every vertex's triangles, with the ones not yet emitted kept at the front
+	std::vector<int> numLiveTriangles(numVertexes, 0);
+	for (size_t i = 0; i < numTriangles * 3; ++i)
+	{
+		++numLiveTriangles[indexes[i]];
+	}
+	std::vector<unsigned int> firstAdjacentTriangles(numVertexes + 1, 0);
+	for (size_t vertexIndex = 0; vertexIndex < numVertexes; ++vertexIndex)
+	{
+		firstAdjacentTriangles[vertexIndex + 1] = firstAdjacentTriangles[vertexIndex] + numLiveTriangles[vertexIndex];
+	}
+	std::vector<unsigned int> adjacentTriangles(numTriangles * 3);
+	std::vector<unsigned int> adjacencyCursors(firstAdjacentTriangles.begin(), firstAdjacentTriangles.end() - 1);
+	for (size_t i = 0; i < numTriangles * 3; ++i)
+	{
+		adjacentTriangles[adjacencyCursors[indexes[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<float> vertexScores(numVertexes);
+	for (size_t vertexIndex = 0; vertexIndex < numVertexes; ++vertexIndex)
+	{
+		vertexScores[vertexIndex] = GetForsythVertexScore(-1, numLiveTriangles[vertexIndex]);
+	}
+	std::vector<float> triangleScores(numTriangles);
+	int bestTriangle = 0;
+	for (size_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex)
+	{
+		unsigned int const* corners = &indexes[triangleIndex * 3];
+		triangleScores[triangleIndex] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+		if (triangleScores[triangleIndex] > triangleScores[bestTriangle])
+		{
+			bestTriangle = (int)triangleIndex;
+		}
+	}
+
+	std::vector<unsigned char> isEmitted(numTriangles, 0);
+	std::vector<unsigned int> newIndexes;
+	newIndexes.reserve(numTriangles * 3);
+	unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+	int cacheSize = 0;
+	size_t nextTriangleToScan = 0;
+	for (size_t numEmitted = 0; numEmitted < numTriangles; ++numEmitted)
+	{
+		// Nothing in the cache has triangles left, so start somewhere new
+		if (bestTriangle < 0)
+		{
+			while (isEmitted[nextTriangleToScan])
+			{
+				++nextTriangleToScan;
+			}
+			bestTriangle = (int)nextTriangleToScan;
+		}
+
+		unsigned int const* corners = &indexes[bestTriangle * 3];
+		newIndexes.push_back(corners[0]);
+		newIndexes.push_back(corners[1]);
+		newIndexes.push_back(corners[2]);
+		isEmitted[bestTriangle] = 1;
+
+		// The emitted triangle's vertexes move to the front of the cache, pushing the rest back
+		unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+		int newCacheSize = 0;
+		for (int cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+		{
+			unsigned int vertexIndex = corners[cornerIndex];
+			unsigned int* vertexTriangles = &adjacentTriangles[firstAdjacentTriangles[vertexIndex]];
+			int& vertexNumLiveTriangles = numLiveTriangles[vertexIndex];
+			for (int adjacencyIndex = 0; adjacencyIndex < vertexNumLiveTriangles; ++adjacencyIndex)
+			{
+				if (vertexTriangles[adjacencyIndex] == (unsigned int)bestTriangle)
+				{
+					std::swap(vertexTriangles[adjacencyIndex], vertexTriangles[vertexNumLiveTriangles - 1]);
+					--vertexNumLiveTriangles;
+					break;
+				}
+			}
+			if (std::find(newCache, newCache + newCacheSize, vertexIndex) == newCache + newCacheSize)
+			{
+				newCache[newCacheSize++] = vertexIndex;
+			}
+		}
+		int numTriangleVertexes = newCacheSize;
+		for (int cacheIndex = 0; cacheIndex < cacheSize; ++cacheIndex)
+		{
+			if (std::find(newCache, newCache + numTriangleVertexes, cache[cacheIndex]) == newCache + numTriangleVertexes)
+			{
+				newCache[newCacheSize++] = cache[cacheIndex];
+			}
+		}
+
+		// Rescore everything that moved, including what just fell out
+		for (int cacheIndex = 0; cacheIndex < newCacheSize; ++cacheIndex)
+		{
+			unsigned int vertexIndex = newCache[cacheIndex];
+			float newScore = GetForsythVertexScore(cacheIndex < FORSYTH_CACHE_SIZE ? cacheIndex : -1, numLiveTriangles[vertexIndex]);
+			float scoreChange = newScore - vertexScores[vertexIndex];
+			vertexScores[vertexIndex] = newScore;
+			unsigned int const* vertexTriangles = &adjacentTriangles[firstAdjacentTriangles[vertexIndex]];
+			for (int adjacencyIndex = 0; adjacencyIndex < numLiveTriangles[vertexIndex]; ++adjacencyIndex)
+			{
+				triangleScores[vertexTriangles[adjacencyIndex]] += scoreChange;
+			}
+		}
+		cacheSize = newCacheSize < FORSYTH_CACHE_SIZE ? newCacheSize : FORSYTH_CACHE_SIZE;
+
+		// The next triangle is the best one left touching the cache
+		bestTriangle = -1;
+		float bestTriangleScore = -FLT_MAX;
+		for (int cacheIndex = 0; cacheIndex < cacheSize; ++cacheIndex)
+		{
+			unsigned int vertexIndex = newCache[cacheIndex];
+			unsigned int const* vertexTriangles = &adjacentTriangles[firstAdjacentTriangles[vertexIndex]];
+			for (int adjacencyIndex = 0; adjacencyIndex < numLiveTriangles[vertexIndex]; ++adjacencyIndex)
+			{
+				unsigned int triangleIndex = vertexTriangles[adjacencyIndex];
+				if (triangleScores[triangleIndex] > bestTriangleScore)
+				{
+					bestTriangleScore = triangleScores[triangleIndex];
+					bestTriangle = (int)triangleIndex;
+				}
+			}
+		}
+		std::copy(newCache, newCache + cacheSize, cache);
+	}
+	newIndexes.insert(newIndexes.end(), indexes.begin() + numTriangles * 3, indexes.end());
+	indexes.swap(newIndexes);
+}
+
+struct OverdrawCluster
+{
+	size_t m_firstTriangle = 0;
+	size_t m_numTriangles = 0;
+	float m_sortKey = 0.f;
+};
+
+void OptimizeOverdraw(std::vector<unsigned int>& indexes, std::vector<Vertex_PCUTBN> const& vertexes, float maxAcmrIncrease)
+{
+	size_t numTriangles = indexes.size() / 3;
+	if (numTriangles < 2)
+	{
+		return;
+	}
+
+	// Each cluster is simulated starting from a cold cache, and is cut off as soon as its own ACMR, cold start included,
+	// is back within budget. Clusters can then be drawn in any order without the total going over budget.
+	float acmr = SimulateVertexCache(indexes, vertexes.size()).m_acmr;
+	float maxClusterAcmr = acmr * maxAcmrIncrease;
+	std::vector<OverdrawCluster> clusters;
+	std::vector<unsigned int> transformTimes(vertexes.size(), 0);
+	unsigned int time = (unsigned int)DEFAULT_SIMULATED_VERTEX_CACHE_SIZE + 1;
+	int numClusterTransforms = 0;
+	for (size_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex)
+	{
+		if (clusters.empty() || (float)numClusterTransforms <= maxClusterAcmr * (float)clusters.back().m_numTriangles)
+		{
+			clusters.emplace_back();
+			clusters.back().m_firstTriangle = triangleIndex;
+			numClusterTransforms = 0;
+			time += (unsigned int)DEFAULT_SIMULATED_VERTEX_CACHE_SIZE + 1; // ages everything out of the cache
+		}
+		for (int cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+		{
+			unsigned int& transformTime = transformTimes[indexes[triangleIndex * 3 + cornerIndex]];
+			if (time - transformTime > (unsigned int)DEFAULT_SIMULATED_VERTEX_CACHE_SIZE)
+			{
+				transformTime = time++;
+				++numClusterTransforms;
+			}
+		}
+		++clusters.back().m_numTriangles;
+	}
+	if (clusters.size() < 2)
+	{
+		return;
+	}
+
+	// Clusters whose area weighted center sits furthest out along their average normal are on the outside of the mesh
+	std::vector<Vec3> clusterCenters(clusters.size());
+	std::vector<Vec3> clusterNormals(clusters.size());
+	Vec3 meshCenter;
+	float meshArea = 0.f;
+	for (size_t clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex)
+	{
+		OverdrawCluster const& cluster = clusters[clusterIndex];
+		Vec3 weightedCenter;
+		Vec3 weightedNormal;
+		float clusterArea = 0.f;
+		for (size_t triangleIndex = cluster.m_firstTriangle; triangleIndex < cluster.m_firstTriangle + cluster.m_numTriangles; ++triangleIndex)
+		{
+			Vec3 const& p0 = vertexes[indexes[triangleIndex * 3 + 0]].m_position;
+			Vec3 const& p1 = vertexes[indexes[triangleIndex * 3 + 1]].m_position;
+			Vec3 const& p2 = vertexes[indexes[triangleIndex * 3 + 2]].m_position;
+			Vec3 areaNormal = CrossProduct3D(p1 - p0, p2 - p0);
+			float area = areaNormal.GetLength();
+			weightedCenter += (p0 + p1 + p2) * (area / 3.f);
+			weightedNormal += areaNormal;
+			clusterArea += area;
+		}
+		clusterCenters[clusterIndex] = clusterArea > 0.f ? weightedCenter / clusterArea : Vec3();
+		clusterNormals[clusterIndex] = weightedNormal.GetNormalized();
+		meshCenter += weightedCenter;
+		meshArea += clusterArea;
+	}
+	if (meshArea > 0.f)
+	{
+		meshCenter /= meshArea;
+	}
+	for (size_t clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex)
+	{
+		clusters[clusterIndex].m_sortKey = DotProduct3D(clusterCenters[clusterIndex] - meshCenter, clusterNormals[clusterIndex]);
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](OverdrawCluster const& a, OverdrawCluster const& b)
+		{
+			return a.m_sortKey > b.m_sortKey;
+		});
+
+	std::vector<unsigned int> newIndexes;
+	newIndexes.reserve(indexes.size());
+	for (OverdrawCluster const& cluster : clusters)
+	{
+		newIndexes.insert(newIndexes.end(), indexes.begin() + cluster.m_firstTriangle * 3, indexes.begin() + (cluster.m_firstTriangle + cluster.m_numTriangles) * 3);
+	}
+	newIndexes.insert(newIndexes.end(), indexes.begin() + numTriangles * 3, indexes.end());
+
+	float newAcmr = SimulateVertexCache(newIndexes, vertexes.size()).m_acmr;
+	if (newAcmr <= maxClusterAcmr)
+	{
+		indexes.swap(newIndexes);
+	}
+}
+
+template<typename T_Vertex>
+static void ReorderVertexesByFirstUse(std::vector<T_Vertex>& vertexes, std::vector<unsigned int>& indexes)
+{
+	std::vector<unsigned int> newVertexIndexes(vertexes.size(), UINT_MAX);
+	std::vector<T_Vertex> newVertexes;
+	newVertexes.reserve(vertexes.size());
+	for (unsigned int& index : indexes)
+	{
+		unsigned int& newVertexIndex = newVertexIndexes[index];
+		if (newVertexIndex == UINT_MAX)
+		{
+			newVertexIndex = (unsigned int)newVertexes.size();
+			newVertexes.push_back(vertexes[index]);
+		}
+		index = newVertexIndex;
+	}
+	vertexes.swap(newVertexes);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex_PCUTBN>& vertexes, std::vector<unsigned int>& indexes)
+{
+	ReorderVertexesByFirstUse(vertexes, indexes);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex_PCU>& vertexes, std::vector<unsigned int>& indexes)
+{
+	ReorderVertexesByFirstUse(vertexes, indexes);
+}
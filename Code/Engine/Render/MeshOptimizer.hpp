@@ -0,0 +1,35 @@
+#pragma once
+#include "Engine/Core/Vertex_PCU.hpp"
+#include <vector>
+
+// Reorders indexed triangle lists so the GPU does less work drawing them, without changing what gets drawn.
+// The usual pipeline is OptimizeVertexCache(), then OptimizeOverdraw(), then OptimizeVertexFetch().
+
+constexpr int DEFAULT_SIMULATED_VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats
+{
+	int m_numTriangles = 0;
+	int m_numVertexesReferenced = 0;
+	int m_numTransformedVertexes = 0; // vertex shader invocations, ie cache misses
+	float m_acmr = 0.f; // average cache miss ratio, transformed vertexes per triangle: 3 is worst, ~0.5 is the best a grid can do
+	float m_atvr = 0.f; // average transform to vertex ratio, transformed vertexes per referenced vertex: 1 is ideal
+};
+
+// Software model of a post-transform vertex cache: a FIFO of the last cacheSize vertexes transformed, like most GPUs
+// have behaved since the fixed function days. Good enough to compare index orders without a GPU.
+VertexCacheStats SimulateVertexCache(std::vector<unsigned int> const& indexes, size_t numVertexes, int cacheSize = DEFAULT_SIMULATED_VERTEX_CACHE_SIZE);
+
+// Tom Forsyth's linear-speed vertex cache optimisation: greedily emits whichever triangle scores best given what is in
+// a simulated LRU cache and how many triangles each vertex has left. Does not depend on the real cache size.
+void OptimizeVertexCache(std::vector<unsigned int>& indexes, size_t numVertexes);
+
+// Splits a cache optimized index list into the shortest runs that still have a good ACMR starting from a cold cache,
+// then draws the runs that face away from the mesh center first so they occlude more of what follows. The ACMR grows by
+// at most a factor of maxAcmrIncrease.
+void OptimizeOverdraw(std::vector<unsigned int>& indexes, std::vector<Vertex_PCUTBN> const& vertexes, float maxAcmrIncrease = 1.05f);
+
+// Renumbers vertexes into the order the index list first uses them, so vertex fetches stream through memory.
+// Vertexes no index refers to are dropped.
+void OptimizeVertexFetch(std::vector<Vertex_PCUTBN>& vertexes, std::vector<unsigned int>& indexes);
+void OptimizeVertexFetch(std::vector<Vertex_PCU>& vertexes, std::vector<unsigned int>& indexes);
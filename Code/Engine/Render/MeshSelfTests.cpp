@@ -0,0 +1,379 @@
+#include "MeshSelfTests.hpp"
+#include "Engine/Render/MeshOptimizer.hpp"
+#include "Engine/Render/MeshBVH.hpp"
+#include "Engine/Core/JobSystem.hpp"
+#include "Engine/Core/VertexUtils.hpp"
+#include "Engine/Math/RandomNumberGenerator.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/SelfTestUtils.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+// Rows x columns quads of a height field, two triangles each
+static void MakeGridMesh(int numRows, int numColumns, std::vector<Vertex_PCUTBN>& out_vertexes, std::vector<unsigned int>& out_indexes)
+{
+	out_vertexes.clear();
+	out_indexes.clear();
+	for (int y = 0; y <= numRows; ++y)
+	{
+		for (int x = 0; x <= numColumns; ++x)
+		{
+			Vertex_PCUTBN vertex;
+			vertex.m_position = Vec3((float)x, (float)y, 0.5f * SinDegrees(20.f * (float)x) * CosDegrees(15.f * (float)y));
+			vertex.m_uvTexCoords = Vec2((float)x / (float)numColumns, (float)y / (float)numRows);
+			vertex.m_normal = Vec3(0.f, 0.f, 1.f);
+			out_vertexes.push_back(vertex);
+		}
+	}
+	for (int y = 0; y < numRows; ++y)
+	{
+		for (int x = 0; x < numColumns; ++x)
+		{
+			unsigned int bottomLeft = (unsigned int)(y * (numColumns + 1) + x);
+			unsigned int bottomRight = bottomLeft + 1;
+			unsigned int topLeft = bottomLeft + (unsigned int)(numColumns + 1);
+			unsigned int topRight = topLeft + 1;
+			out_indexes.insert(out_indexes.end(), { bottomLeft, bottomRight, topRight, bottomLeft, topRight, topLeft });
+		}
+	}
+}
+
+// A latitude-longitude sphere, so the optimizer also sees fans at the poles and a closed surface
+static void MakeSphereMesh(int numSlices, int numStacks, std::vector<Vertex_PCUTBN>& out_vertexes, std::vector<unsigned int>& out_indexes)
+{
+	MakeGridMesh(numStacks, numSlices, out_vertexes, out_indexes);
+	for (Vertex_PCUTBN& vertex : out_vertexes)
+	{
+		float longitude = 360.f * vertex.m_uvTexCoords.x;
+		float latitude = -90.f + 180.f * vertex.m_uvTexCoords.y;
+		vertex.m_position = Vec3(CosDegrees(latitude) * CosDegrees(longitude), CosDegrees(latitude) * SinDegrees(longitude), SinDegrees(latitude));
+		vertex.m_normal = vertex.m_position;
+	}
+}
+
+// Triangles over a small pool of vertexes, with no structure for the optimizer to find beyond shared vertexes
+static void MakeTriangleSoup(RandomNumberGenerator& rng, int numVertexes, int numTriangles, std::vector<Vertex_PCUTBN>& out_vertexes, std::vector<unsigned int>& out_indexes)
+{
+	out_vertexes.resize(numVertexes);
+	for (Vertex_PCUTBN& vertex : out_vertexes)
+	{
+		vertex.m_position = rng.RollRandomVector3DInRange(Vec3(-10.f, -10.f, -10.f), Vec3(10.f, 10.f, 10.f));
+	}
+	out_indexes.clear();
+	for (int triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex)
+	{
+		for (int cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+		{
+			out_indexes.push_back((unsigned int)rng.RollRandomIntLessThan(numVertexes));
+		}
+	}
+}
+
+// Mesh generators emit triangles in scanline order, which is already cache friendly; shuffle them to give the optimizer
+// something to do
+static void ShuffleTriangles(RandomNumberGenerator& rng, std::vector<unsigned int>& indexes)
+{
+	int numTriangles = (int)indexes.size() / 3;
+	for (int triangleIndex = numTriangles - 1; triangleIndex > 0; --triangleIndex)
+	{
+		int otherIndex = rng.RollRandomIntLessThan(triangleIndex + 1);
+		for (int cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+		{
+			std::swap(indexes[3 * triangleIndex + cornerIndex], indexes[3 * otherIndex + cornerIndex]);
+		}
+	}
+}
+
+// Every triangle rotated to start at its lowest index (keeping its winding), then sorted, so two index lists drawing the
+// same triangles in any order compare equal
+static std::vector<std::array<unsigned int, 3>> GetSortedTriangles(std::vector<unsigned int> const& indexes)
+{
+	std::vector<std::array<unsigned int, 3>> triangles(indexes.size() / 3);
+	for (size_t triangleIndex = 0; triangleIndex < triangles.size(); ++triangleIndex)
+	{
+		unsigned int const* corners = &indexes[3 * triangleIndex];
+		int lowestCorner = 0;
+		if (corners[1] < corners[lowestCorner])
+		{
+			lowestCorner = 1;
+		}
+		if (corners[2] < corners[lowestCorner])
+		{
+			lowestCorner = 2;
+		}
+		triangles[triangleIndex] = { corners[lowestCorner], corners[(lowestCorner + 1) % 3], corners[(lowestCorner + 2) % 3] };
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// maxOptimizedAcmr < 0 only asks that OptimizeVertexCache makes nothing worse
+static bool CheckVertexCacheOptimizer(char const* meshName, std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes, float maxOptimizedAcmr)
+{
+	bool didPass = true;
+	std::vector<unsigned int> optimizedIndexes = indexes;
+	OptimizeVertexCache(optimizedIndexes, vertexes.size());
+	VertexCacheStats statsBefore = SimulateVertexCache(indexes, vertexes.size());
+	VertexCacheStats statsAfter = SimulateVertexCache(optimizedIndexes, vertexes.size());
+	bool didImprove = maxOptimizedAcmr < 0.f ? statsAfter.m_acmr <= statsBefore.m_acmr : statsAfter.m_acmr < statsBefore.m_acmr && statsAfter.m_acmr <= maxOptimizedAcmr;
+	if (!didImprove)
+	{
+		DebuggerPrintf("Self test failed: %s ACMR %.3f before OptimizeVertexCache, %.3f after\n", meshName, statsBefore.m_acmr, statsAfter.m_acmr);
+		didPass = false;
+	}
+	if (GetSortedTriangles(optimizedIndexes) != GetSortedTriangles(indexes))
+	{
+		DebuggerPrintf("Self test failed: OptimizeVertexCache changed the triangles of %s\n", meshName);
+		didPass = false;
+	}
+
+	std::vector<unsigned int> overdrawIndexes = optimizedIndexes;
+	float const maxAcmrIncrease = 1.05f;
+	OptimizeOverdraw(overdrawIndexes, vertexes, maxAcmrIncrease);
+	VertexCacheStats statsOverdraw = SimulateVertexCache(overdrawIndexes, vertexes.size());
+	if (statsOverdraw.m_acmr > statsAfter.m_acmr * maxAcmrIncrease)
+	{
+		DebuggerPrintf("Self test failed: %s ACMR %.3f after OptimizeOverdraw, over %.3f allowed\n", meshName, statsOverdraw.m_acmr, statsAfter.m_acmr * maxAcmrIncrease);
+		didPass = false;
+	}
+	if (GetSortedTriangles(overdrawIndexes) != GetSortedTriangles(indexes))
+	{
+		DebuggerPrintf("Self test failed: OptimizeOverdraw changed the triangles of %s\n", meshName);
+		didPass = false;
+	}
+	return didPass;
+}
+
+bool SelfTestVertexCacheOptimizer(unsigned int seed)
+{
+	RandomNumberGenerator rng(seed);
+	bool didPass = true;
+	std::vector<Vertex_PCUTBN> vertexes;
+	std::vector<unsigned int> indexes;
+	for (int trial = 0; trial < 4; ++trial)
+	{
+		// A regular grid can be drawn at about 0.5 misses per triangle; a greedy optimizer with a 16 entry cache gets
+		// comfortably under one
+		MakeGridMesh(rng.RollRandomIntInRange(8, 80), rng.RollRandomIntInRange(8, 80), vertexes, indexes);
+		ShuffleTriangles(rng, indexes);
+		didPass = CheckVertexCacheOptimizer("shuffled grid", vertexes, indexes, 1.f) && didPass;
+
+		MakeSphereMesh(rng.RollRandomIntInRange(8, 64), rng.RollRandomIntInRange(4, 32), vertexes, indexes);
+		ShuffleTriangles(rng, indexes);
+		didPass = CheckVertexCacheOptimizer("shuffled sphere", vertexes, indexes, 1.f) && didPass;
+
+		// Random triangles share few vertexes and may leave nothing to gain
+		int numSoupVertexes = rng.RollRandomIntInRange(3, 300);
+		MakeTriangleSoup(rng, numSoupVertexes, rng.RollRandomIntInRange(1, 2000), vertexes, indexes);
+		didPass = CheckVertexCacheOptimizer("triangle soup", vertexes, indexes, -1.f) && didPass;
+	}
+	return didPass;
+}
+
+// Small triangles scattered through a box, some collapsed to a line or a point, and optionally half of them drawn twice
+static void MakeScatteredTriangles(RandomNumberGenerator& rng, int numTriangles, float halfSize, bool duplicateHalf, std::vector<Vertex_PCUTBN>& out_vertexes, std::vector<unsigned int>& out_indexes)
+{
+	out_vertexes.clear();
+	out_indexes.clear();
+	for (int triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex)
+	{
+		Vec3 center = rng.RollRandomVector3DInRange(Vec3(-halfSize, -halfSize, -halfSize), Vec3(halfSize, halfSize, halfSize));
+		float extent = rng.RollRandomFloatInRange(0.01f, 0.2f * halfSize);
+		bool isDegenerate = triangleIndex % 50 == 0;
+		for (int cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+		{
+			Vertex_PCUTBN vertex;
+			vertex.m_position = isDegenerate && cornerIndex > 0 ? out_vertexes.back().m_position : center + rng.RollRandomVector3DInRange(Vec3(-extent, -extent, -extent), Vec3(extent, extent, extent));
+			vertex.m_uvTexCoords = Vec2(rng.RollRandomFloatZeroToOne(), rng.RollRandomFloatZeroToOne());
+			vertex.m_normal = RollSelfTestDirection3D(rng);
+			out_vertexes.push_back(vertex);
+			out_indexes.push_back((unsigned int)out_vertexes.size() - 1);
+		}
+	}
+	if (duplicateHalf)
+	{
+		out_indexes.insert(out_indexes.end(), out_indexes.begin(), out_indexes.begin() + 3 * (numTriangles / 2));
+	}
+}
+
+static bool AreSameMeshHits(MeshRaycastResult3D const& a, MeshRaycastResult3D const& b)
+{
+	return a.m_didImpact == b.m_didImpact && a.m_triangleIndex == b.m_triangleIndex
+		&& memcmp(&a.m_impactDist, &b.m_impactDist, sizeof(float)) == 0
+		&& memcmp(&a.m_barycentrics, &b.m_barycentrics, sizeof(Vec3)) == 0
+		&& memcmp(&a.m_impactUV, &b.m_impactUV, sizeof(Vec2)) == 0;
+}
+
+// Raycasts through the tree against testing every triangle: same triangle, distance, barycentrics and UV, bit for bit
+static void CompareMeshBVHWithAllTriangles(RandomNumberGenerator& rng, MeshBVH const& bvh, std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes, float halfSize, int numRays, int& numMismatches)
+{
+	for (int rayIndex = 0; rayIndex < numRays; ++rayIndex)
+	{
+		Vec3 rayStart = rng.RollRandomVector3DInRange(Vec3(-halfSize, -halfSize, -halfSize), Vec3(halfSize, halfSize, halfSize));
+		Vec3 rayForwardNormal = RollSelfTestDirection3D(rng);
+		if (rayIndex % 7 == 0)
+		{
+			rayForwardNormal = Vec3(0.f, 0.f, -1.f); // straight down the axis, where the slab tests divide by zero
+		}
+		else if (rayIndex % 11 == 0 && rayStart.GetLengthSquared() > 0.f)
+		{
+			rayForwardNormal = -rayStart.GetNormalized(); // through the middle of the mesh, where most triangles are
+		}
+		float rayLength = rng.RollRandomFloatInRange(0.f, 3.f * halfSize);
+		MeshRaycastResult3D treeResult = bvh.Raycast(rayStart, rayForwardNormal, rayLength, vertexes, indexes);
+		MeshRaycastResult3D allResult = MeshBVH::RaycastAllTriangles(rayStart, rayForwardNormal, rayLength, vertexes, indexes);
+		if (!AreSameMeshHits(treeResult, allResult))
+		{
+			if (numMismatches < SELF_TEST_MAX_REPORTED_MISMATCHES)
+			{
+				DebuggerPrintf("Self test mismatch: MeshBVH raycast hit triangle %d at %.9g, expected triangle %d at %.9g\n", treeResult.m_triangleIndex, treeResult.m_impactDist, allResult.m_triangleIndex, allResult.m_impactDist);
+			}
+			++numMismatches;
+		}
+	}
+}
+
+static bool AreSameMeshBVHs(MeshBVH const& a, MeshBVH const& b)
+{
+	return a.GetNodes().size() == b.GetNodes().size() && a.GetPacks().size() == b.GetPacks().size()
+		&& memcmp(a.GetNodes().data(), b.GetNodes().data(), a.GetNodes().size() * sizeof(MeshBVHNode)) == 0
+		&& memcmp(a.GetPacks().data(), b.GetPacks().data(), a.GetPacks().size() * sizeof(MeshBVHTrianglePack)) == 0;
+}
+
+bool SelfTestMeshBVH(unsigned int seed)
+{
+	RandomNumberGenerator rng(seed);
+	int numMismatches = 0;
+	std::vector<Vertex_PCUTBN> vertexes;
+	std::vector<unsigned int> indexes;
+	for (int trial = 0; trial < 20; ++trial)
+	{
+		float halfSize = rng.RollRandomFloatInRange(1.f, 50.f);
+		MakeScatteredTriangles(rng, rng.RollRandomIntInRange(1, 3000), halfSize, trial % 5 == 0, vertexes, indexes);
+		MeshBVH bvh;
+		bvh.Build(vertexes, indexes, nullptr);
+		CompareMeshBVHWithAllTriangles(rng, bvh, vertexes, indexes, halfSize, 200, numMismatches);
+	}
+
+	MeshBVH emptyBVH;
+	vertexes.clear();
+	indexes.clear();
+	emptyBVH.Build(vertexes, indexes, nullptr);
+	if (emptyBVH.IsBuilt() || emptyBVH.Raycast(Vec3(), Vec3(1.f, 0.f, 0.f), 5.f, vertexes, indexes).m_didImpact)
+	{
+		DebuggerPrintf("Self test failed: MeshBVH built from no triangles is not empty\n");
+		++numMismatches;
+	}
+
+	// A closed bumpy sphere big enough that every phase of the build is split into jobs. The tree must come out the same
+	// built serially or on any number of workers.
+	MakeSphereMesh(256, 256, vertexes, indexes);
+	for (Vertex_PCUTBN& vertex : vertexes)
+	{
+		float longitude = 360.f * vertex.m_uvTexCoords.x;
+		float latitude = -90.f + 180.f * vertex.m_uvTexCoords.y;
+		vertex.m_position *= 10.f + 1.5f * SinDegrees(7.f * longitude) * CosDegrees(5.f * latitude);
+	}
+	MeshBVH serialBVH;
+	serialBVH.Build(vertexes, indexes, nullptr);
+	CompareMeshBVHWithAllTriangles(rng, serialBVH, vertexes, indexes, 15.f, 100, numMismatches);
+	int const workerCounts[] = { 1, 2, 4 };
+	for (int numWorkers : workerCounts)
+	{
+		JobConfig jobConfig;
+		jobConfig.m_numWorkers = numWorkers;
+		jobConfig.m_numIOWorkers = 0;
+		JobSystem jobSystem(jobConfig);
+		jobSystem.Startup();
+		MeshBVH parallelBVH;
+		parallelBVH.Build(vertexes, indexes, &jobSystem);
+		jobSystem.Shutdown();
+		if (!AreSameMeshBVHs(parallelBVH, serialBVH))
+		{
+			DebuggerPrintf("Self test failed: MeshBVH built on %d workers differs from the serial build\n", numWorkers);
+			++numMismatches;
+		}
+	}
+
+	if (numMismatches > 0)
+	{
+		DebuggerPrintf("SelfTestMeshBVH (seed %u): %d mismatches\n", seed, numMismatches);
+	}
+	return numMismatches == 0;
+}
+
+// Fresh normals and tangents from a copy of the mesh, as ObjLoader hands them over
+static std::vector<Vertex_PCUTBN> GetTangentSpaceVertexes(std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes, JobSystem* jobSystem)
+{
+	std::vector<Vertex_PCUTBN> tangentVertexes = vertexes;
+	for (Vertex_PCUTBN& vertex : tangentVertexes)
+	{
+		vertex.m_normal = Vec3();
+		vertex.m_tangent = Vec3();
+		vertex.m_bitangent = Vec3();
+	}
+	std::vector<unsigned int> tangentIndexes = indexes;
+	CalculateTangentSpaceBasisVectors(tangentVertexes, tangentIndexes, true, true, jobSystem);
+	return tangentVertexes;
+}
+
+bool SelfTestTangentDeterminism(unsigned int seed)
+{
+	RandomNumberGenerator rng(seed);
+	int numMismatches = 0;
+	char const* meshNames[] = { "grid", "sphere", "shuffled triangle soup" };
+	std::vector<Vertex_PCUTBN> meshVertexes[3];
+	std::vector<unsigned int> meshIndexes[3];
+	MakeGridMesh(128, 160, meshVertexes[0], meshIndexes[0]);
+	MakeSphereMesh(192, 128, meshVertexes[1], meshIndexes[1]);
+	MakeTriangleSoup(rng, 20000, 60000, meshVertexes[2], meshIndexes[2]);
+	for (Vertex_PCUTBN& vertex : meshVertexes[2])
+	{
+		vertex.m_uvTexCoords = Vec2(rng.RollRandomFloatZeroToOne(), rng.RollRandomFloatZeroToOne());
+	}
+	ShuffleTriangles(rng, meshIndexes[2]);
+
+	std::vector<Vertex_PCUTBN> serialVertexes[3];
+	for (int meshIndex = 0; meshIndex < 3; ++meshIndex)
+	{
+		serialVertexes[meshIndex] = GetTangentSpaceVertexes(meshVertexes[meshIndex], meshIndexes[meshIndex], nullptr);
+	}
+	// Below the worker count worth gathering on, the job system version runs the serial scatter too
+	int const workerCounts[] = { 1, 2, 4, 8 };
+	for (int numWorkers : workerCounts)
+	{
+		JobConfig jobConfig;
+		jobConfig.m_numWorkers = numWorkers;
+		jobConfig.m_numIOWorkers = 0;
+		JobSystem jobSystem(jobConfig);
+		jobSystem.Startup();
+		for (int meshIndex = 0; meshIndex < 3; ++meshIndex)
+		{
+			std::vector<Vertex_PCUTBN> parallelVertexes = GetTangentSpaceVertexes(meshVertexes[meshIndex], meshIndexes[meshIndex], &jobSystem);
+			if (memcmp(parallelVertexes.data(), serialVertexes[meshIndex].data(), parallelVertexes.size() * sizeof(Vertex_PCUTBN)) != 0)
+			{
+				DebuggerPrintf("Self test failed: tangent space of the %s on %d workers differs from the serial one\n", meshNames[meshIndex], numWorkers);
+				++numMismatches;
+			}
+		}
+		jobSystem.Shutdown();
+	}
+
+	if (numMismatches > 0)
+	{
+		DebuggerPrintf("SelfTestTangentDeterminism (seed %u): %d mismatches\n", seed, numMismatches);
+	}
+	return numMismatches == 0;
+}
+
+bool Command_MeshSelfTest(EventArgs& args)
+{
+	unsigned int seed = (unsigned int)args.GetValue("seed", 1);
+	ReportSelfTestResult("SelfTestVertexCacheOptimizer", SelfTestVertexCacheOptimizer(seed));
+	ReportSelfTestResult("SelfTestMeshBVH", SelfTestMeshBVH(seed));
+	ReportSelfTestResult("SelfTestTangentDeterminism", SelfTestTangentDeterminism(seed));
+	return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "Engine/Core/EventSystem.hpp"
+
+// Checks of the mesh processing passes against what they promise, over random meshes generated from seed. Each returns
+// true when everything held and reports what failed with DebuggerPrintf.
+
+// OptimizeVertexCache on shuffled grids, spheres and triangle soups: the simulated ACMR must drop (well under one miss
+// per triangle on the connected meshes), OptimizeOverdraw must keep it within its allowed increase, and both must keep
+// every triangle
+bool SelfTestVertexCacheOptimizer(unsigned int seed = 1);
+
+// MeshBVH raycasts against MeshBVH::RaycastAllTriangles over random triangle scatters and a large closed mesh (the same
+// triangle, distance, barycentrics and UV, bitwise), and the large mesh's tree built serially against the trees built on
+// 1, 2 and 4 workers. Builds on its own job systems, never g_theJobSystem.
+bool SelfTestMeshBVH(unsigned int seed = 1);
+
+// CalculateTangentSpaceBasisVectors on a grid, a sphere and a shuffled triangle soup, each big enough to be split into
+// jobs: the vertexes must come out bitwise the same serially as on its own job systems of 1, 2, 4 and 8 workers
+bool SelfTestTangentDeterminism(unsigned int seed = 1);
+
+// "MeshSelfTest seed=N" in the dev console runs all of the above
+bool Command_MeshSelfTest(EventArgs& args);
@@ -0,0 +1,563 @@
+#include "Engine/Render/MeshSimplifier.hpp"
+#include "Engine/Math/MathUtils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+constexpr int MAX_SIMPLIFY_PASSES = 100;
+constexpr int MAX_WEDGES_PER_POSITION = 16;
+constexpr double BORDER_QUADRIC_WEIGHT = 10.0;	// how much harder borders and seams resist moving than the surface
+constexpr float ATTRIBUTE_ERROR_WEIGHT = 0.01f;	// normal and uv differences, against squared distance in unit-extent space
+constexpr float MIN_FLIP_COSINE = 0.25f;		// a collapse may turn a neighboring triangle by up to about 75 degrees
+
+// Sum of squared distances to a set of weighted planes, as the symmetric 4x4 matrix (n, d)(n, d)^T
+struct Quadric
+{
+	void AddPlane(Vec3 const& normal, float distance, double weight)
+	{
+		double a = normal.x;
+		double b = normal.y;
+		double c = normal.z;
+		double d = distance;
+		m_a2 += weight * a * a; m_ab += weight * a * b; m_ac += weight * a * c; m_ad += weight * a * d;
+		m_b2 += weight * b * b; m_bc += weight * b * c; m_bd += weight * b * d;
+		m_c2 += weight * c * c; m_cd += weight * c * d;
+		m_d2 += weight * d * d;
+		m_weight += weight;
+	}
+
+	void Add(Quadric const& other)
+	{
+		m_a2 += other.m_a2; m_ab += other.m_ab; m_ac += other.m_ac; m_ad += other.m_ad;
+		m_b2 += other.m_b2; m_bc += other.m_bc; m_bd += other.m_bd;
+		m_c2 += other.m_c2; m_cd += other.m_cd;
+		m_d2 += other.m_d2;
+		m_weight += other.m_weight;
+	}
+
+	// Weighted mean squared distance from position to the planes
+	double GetError(Vec3 const& position) const
+	{
+		double x = position.x;
+		double y = position.y;
+		double z = position.z;
+		double error = m_a2 * x * x + m_b2 * y * y + m_c2 * z * z + m_d2
+			+ 2.0 * (m_ab * x * y + m_ac * x * z + m_bc * y * z + m_ad * x + m_bd * y + m_cd * z);
+		return m_weight > 0.0 ? fabs(error) / m_weight : 0.0;
+	}
+
+	double m_a2 = 0.0, m_ab = 0.0, m_ac = 0.0, m_ad = 0.0;
+	double m_b2 = 0.0, m_bc = 0.0, m_bd = 0.0;
+	double m_c2 = 0.0, m_cd = 0.0;
+	double m_d2 = 0.0;
+	double m_weight = 0.0;
+};
+
+struct PositionKey
+{
+	bool operator==(PositionKey const& other) const
+	{
+		return m_bits[0] == other.m_bits[0] && m_bits[1] == other.m_bits[1] && m_bits[2] == other.m_bits[2];
+	}
+	unsigned int m_bits[3];
+};
+
+struct PositionKeyHash
+{
+	size_t operator()(PositionKey const& key) const
+	{
+		uint64_t hash = key.m_bits[0] * 0x9E3779B97F4A7C15ull ^ key.m_bits[1] * 0xC2B2AE3D27D4EB4Full ^ key.m_bits[2] * 0x165667B19E3779F9ull;
+		return (size_t)(hash ^ (hash >> 31));
+	}
+};
+
+struct EdgeCollapse
+{
+	float m_cost = 0.f;
+	float m_geometricError = 0.f;
+	unsigned int m_fromPosition = 0;
+	unsigned int m_toPosition = 0;
+};
+
+// The mesh as the simplifier sees it: vertexes sharing a position are wedges of one position, and collapses move
+// positions. Triangle corners stay wedges, so each collapse has to say which wedge of the target each wedge becomes.
+class MeshSimplifier
+{
+public:
+	MeshSimplifier(std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes);
+	float Simplify(std::vector<unsigned int>& out_indexes, size_t targetNumIndexes, float maxError);
+
+private:
+	void AddEdgeQuadrics();
+	void RemoveDegenerateTriangles();
+	void BuildAdjacency();
+	bool MapWedges(unsigned int fromPosition, unsigned int toPosition, unsigned int* out_fromWedges, unsigned int* out_toWedges, int& out_numWedges) const;
+	bool IsCollapseValid(unsigned int fromPosition, unsigned int toPosition) const;
+	bool EvaluateCollapse(unsigned int fromPosition, unsigned int toPosition, EdgeCollapse& out_collapse) const;
+	int Collapse(EdgeCollapse const& collapse, std::vector<unsigned char>& isLockedThisPass);
+
+private:
+	std::vector<Vertex_PCUTBN> const& m_vertexes;
+	std::vector<Vec3> m_positions;			// per position, scaled to fit a unit box so errors are relative
+	std::vector<unsigned int> m_wedgePositions;	// per vertex, which position it is a wedge of
+	std::vector<Quadric> m_quadrics;		// per position
+	std::vector<unsigned char> m_isPositionLocked;	// non-manifold positions never move
+	std::vector<unsigned int> m_triangles;		// wedges, three per triangle
+	std::vector<unsigned int> m_firstAdjacentTriangles;	// per position, into m_adjacentTriangles
+	std::vector<unsigned int> m_adjacentTriangles;
+	float m_extent = 1.f;
+};
+
+MeshSimplifier::MeshSimplifier(std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes)
+	: m_vertexes(vertexes)
+	, m_triangles(indexes.begin(), indexes.begin() + indexes.size() / 3 * 3)
+{
+	Vec3 mins(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vec3 maxs(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (unsigned int index : m_triangles)
+	{
+		Vec3 const& position = vertexes[index].m_position;
+		mins = Vec3(position.x < mins.x ? position.x : mins.x, position.y < mins.y ? position.y : mins.y, position.z < mins.z ? position.z : mins.z);
+		maxs = Vec3(position.x > maxs.x ? position.x : maxs.x, position.y > maxs.y ? position.y : maxs.y, position.z > maxs.z ? position.z : maxs.z);
+	}
+	Vec3 size = maxs - mins;
+	m_extent = size.x > size.y ? (size.x > size.z ? size.x : size.z) : (size.y > size.z ? size.y : size.z);
+	if (!(m_extent > 0.f))
+	{
+		m_extent = 1.f;
+	}
+
+	// Vertexes at exactly the same position are wedges of one position
+	std::unordered_map<PositionKey, unsigned int, PositionKeyHash> positionsByKey;
+	positionsByKey.reserve(vertexes.size());
+	m_wedgePositions.resize(vertexes.size(), 0);
+	for (size_t vertexIndex = 0; vertexIndex < vertexes.size(); ++vertexIndex)
+	{
+		Vec3 const& position = vertexes[vertexIndex].m_position;
+		PositionKey key;
+		float components[3] = { position.x + 0.f, position.y + 0.f, position.z + 0.f }; // + 0 folds -0 into 0
+		memcpy(key.m_bits, components, sizeof(key.m_bits));
+		auto inserted = positionsByKey.emplace(key, (unsigned int)m_positions.size());
+		if (inserted.second)
+		{
+			m_positions.push_back((position - mins) / m_extent);
+		}
+		m_wedgePositions[vertexIndex] = inserted.first->second;
+	}
+	m_quadrics.resize(m_positions.size());
+	m_isPositionLocked.resize(m_positions.size(), 0);
+
+	for (size_t cornerIndex = 0; cornerIndex < m_triangles.size(); cornerIndex += 3)
+	{
+		Vec3 const& p0 = m_positions[m_wedgePositions[m_triangles[cornerIndex + 0]]];
+		Vec3 const& p1 = m_positions[m_wedgePositions[m_triangles[cornerIndex + 1]]];
+		Vec3 const& p2 = m_positions[m_wedgePositions[m_triangles[cornerIndex + 2]]];
+		Vec3 areaNormal = CrossProduct3D(p1 - p0, p2 - p0);
+		float doubleArea = areaNormal.GetLength();
+		if (doubleArea <= 0.f)
+		{
+			continue;
+		}
+		Vec3 normal = areaNormal / doubleArea;
+		Quadric faceQuadric;
+		faceQuadric.AddPlane(normal, -DotProduct3D(normal, p0), 0.5 * doubleArea);
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			m_quadrics[m_wedgePositions[m_triangles[cornerIndex + corner]]].Add(faceQuadric);
+		}
+	}
+	AddEdgeQuadrics();
+}
+
+void MeshSimplifier::AddEdgeQuadrics()
+{
+	// A half edge with no opposite is on a border; one whose opposite uses other wedges is on a seam. Either way it gets a
+	// plane through the edge, perpendicular to its triangle, so collapses that would drag the edge sideways cost more.
+	struct HalfEdge
+	{
+		unsigned int m_fromWedge = 0;
+		unsigned int m_toWedge = 0;
+		int m_count = 0;
+	};
+	std::unordered_map<uint64_t, HalfEdge> halfEdges;
+	halfEdges.reserve(m_triangles.size());
+	for (size_t cornerIndex = 0; cornerIndex < m_triangles.size(); ++cornerIndex)
+	{
+		size_t triangleStart = cornerIndex - cornerIndex % 3;
+		unsigned int fromWedge = m_triangles[cornerIndex];
+		unsigned int toWedge = m_triangles[triangleStart + (cornerIndex + 1) % 3];
+		uint64_t edgeKey = ((uint64_t)m_wedgePositions[fromWedge] << 32) | m_wedgePositions[toWedge];
+		HalfEdge& halfEdge = halfEdges[edgeKey];
+		halfEdge.m_fromWedge = fromWedge;
+		halfEdge.m_toWedge = toWedge;
+		++halfEdge.m_count;
+	}
+
+	for (size_t cornerIndex = 0; cornerIndex < m_triangles.size(); ++cornerIndex)
+	{
+		size_t triangleStart = cornerIndex - cornerIndex % 3;
+		unsigned int fromWedge = m_triangles[cornerIndex];
+		unsigned int toWedge = m_triangles[triangleStart + (cornerIndex + 1) % 3];
+		unsigned int otherWedge = m_triangles[triangleStart + (cornerIndex + 2) % 3];
+		unsigned int fromPosition = m_wedgePositions[fromWedge];
+		unsigned int toPosition = m_wedgePositions[toWedge];
+		if (fromPosition == toPosition)
+		{
+			continue;
+		}
+		HalfEdge const& halfEdge = halfEdges[((uint64_t)fromPosition << 32) | toPosition];
+		auto opposite = halfEdges.find(((uint64_t)toPosition << 32) | fromPosition);
+		if (halfEdge.m_count > 1 || (opposite != halfEdges.end() && opposite->second.m_count > 1))
+		{
+			m_isPositionLocked[fromPosition] = 1; // more than two triangles on one edge
+			m_isPositionLocked[toPosition] = 1;
+			continue;
+		}
+		bool isBorder = opposite == halfEdges.end();
+		bool isSeam = !isBorder && (opposite->second.m_fromWedge != toWedge || opposite->second.m_toWedge != fromWedge);
+		if (!isBorder && !isSeam)
+		{
+			continue;
+		}
+
+		Vec3 const& p0 = m_positions[fromPosition];
+		Vec3 const& p1 = m_positions[toPosition];
+		Vec3 const& p2 = m_positions[m_wedgePositions[otherWedge]];
+		Vec3 edge = p1 - p0;
+		Vec3 edgePlaneNormal = CrossProduct3D(edge, CrossProduct3D(edge, p2 - p0)).GetNormalized();
+		double edgeLengthSquared = (double)edge.GetLengthSquared();
+		Quadric edgeQuadric;
+		edgeQuadric.AddPlane(edgePlaneNormal, -DotProduct3D(edgePlaneNormal, p0), BORDER_QUADRIC_WEIGHT * edgeLengthSquared);
+		m_quadrics[fromPosition].Add(edgeQuadric);
+		m_quadrics[toPosition].Add(edgeQuadric);
+	}
+}
+
+void MeshSimplifier::RemoveDegenerateTriangles()
+{
+	size_t numKeptCorners = 0;
+	for (size_t cornerIndex = 0; cornerIndex < m_triangles.size(); cornerIndex += 3)
+	{
+		unsigned int position0 = m_wedgePositions[m_triangles[cornerIndex + 0]];
+		unsigned int position1 = m_wedgePositions[m_triangles[cornerIndex + 1]];
+		unsigned int position2 = m_wedgePositions[m_triangles[cornerIndex + 2]];
+		if (position0 == position1 || position1 == position2 || position2 == position0)
+		{
+			continue;
+		}
+		m_triangles[numKeptCorners + 0] = m_triangles[cornerIndex + 0];
+		m_triangles[numKeptCorners + 1] = m_triangles[cornerIndex + 1];
+		m_triangles[numKeptCorners + 2] = m_triangles[cornerIndex + 2];
+		numKeptCorners += 3;
+	}
+	m_triangles.resize(numKeptCorners);
+}
+
+void MeshSimplifier::BuildAdjacency()
+{
+	m_firstAdjacentTriangles.assign(m_positions.size() + 1, 0);
+	for (unsigned int wedge : m_triangles)
+	{
+		++m_firstAdjacentTriangles[m_wedgePositions[wedge] + 1];
+	}
+	for (size_t position = 0; position < m_positions.size(); ++position)
+	{
+		m_firstAdjacentTriangles[position + 1] += m_firstAdjacentTriangles[position];
+	}
+	m_adjacentTriangles.resize(m_triangles.size());
+	std::vector<unsigned int> cursors(m_firstAdjacentTriangles.begin(), m_firstAdjacentTriangles.end() - 1);
+	for (size_t cornerIndex = 0; cornerIndex < m_triangles.size(); ++cornerIndex)
+	{
+		m_adjacentTriangles[cursors[m_wedgePositions[m_triangles[cornerIndex]]]++] = (unsigned int)(cornerIndex / 3);
+	}
+}
+
+bool MeshSimplifier::MapWedges(unsigned int fromPosition, unsigned int toPosition, unsigned int* out_fromWedges, unsigned int* out_toWedges, int& out_numWedges) const
+{
+	// Every wedge of the moving position has to land on the target's wedge it shares a triangle with. A wedge that
+	// shares no triangle with the target, or shares them with two of its wedges, would tear or smear a seam.
+	out_numWedges = 0;
+	bool hasUnmappedWedge = false;
+	for (unsigned int adjacencyIndex = m_firstAdjacentTriangles[fromPosition]; adjacencyIndex < m_firstAdjacentTriangles[fromPosition + 1]; ++adjacencyIndex)
+	{
+		unsigned int const* corners = &m_triangles[m_adjacentTriangles[adjacencyIndex] * 3];
+		unsigned int fromWedge = 0;
+		unsigned int toWedge = UINT32_MAX;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			unsigned int position = m_wedgePositions[corners[corner]];
+			if (position == fromPosition)
+			{
+				fromWedge = corners[corner];
+			}
+			else if (position == toPosition)
+			{
+				toWedge = corners[corner];
+			}
+		}
+
+		int wedgeIndex = 0;
+		while (wedgeIndex < out_numWedges && out_fromWedges[wedgeIndex] != fromWedge)
+		{
+			++wedgeIndex;
+		}
+		if (wedgeIndex == out_numWedges)
+		{
+			if (out_numWedges == MAX_WEDGES_PER_POSITION)
+			{
+				return false;
+			}
+			out_fromWedges[out_numWedges] = fromWedge;
+			out_toWedges[out_numWedges] = UINT32_MAX;
+			++out_numWedges;
+		}
+		if (toWedge == UINT32_MAX)
+		{
+			continue;
+		}
+		if (out_toWedges[wedgeIndex] != UINT32_MAX && out_toWedges[wedgeIndex] != toWedge)
+		{
+			return false;
+		}
+		out_toWedges[wedgeIndex] = toWedge;
+	}
+	for (int wedgeIndex = 0; wedgeIndex < out_numWedges; ++wedgeIndex)
+	{
+		hasUnmappedWedge |= out_toWedges[wedgeIndex] == UINT32_MAX;
+	}
+	return !hasUnmappedWedge;
+}
+
+bool MeshSimplifier::IsCollapseValid(unsigned int fromPosition, unsigned int toPosition) const
+{
+	// Link condition: the two positions may only share the neighbors across the triangles that disappear, otherwise
+	// the collapse pinches the surface into a non-manifold edge
+	constexpr int MAX_CHECKED_NEIGHBORS = 64;
+	unsigned int fromNeighbors[MAX_CHECKED_NEIGHBORS];
+	int numFromNeighbors = 0;
+	int numSharedTriangles = 0;
+	Vec3 const& toPoint = m_positions[toPosition];
+	for (unsigned int adjacencyIndex = m_firstAdjacentTriangles[fromPosition]; adjacencyIndex < m_firstAdjacentTriangles[fromPosition + 1]; ++adjacencyIndex)
+	{
+		unsigned int const* corners = &m_triangles[m_adjacentTriangles[adjacencyIndex] * 3];
+		unsigned int positions[3] = { m_wedgePositions[corners[0]], m_wedgePositions[corners[1]], m_wedgePositions[corners[2]] };
+		bool hasTarget = positions[0] == toPosition || positions[1] == toPosition || positions[2] == toPosition;
+		numSharedTriangles += hasTarget ? 1 : 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			if (positions[corner] != fromPosition && positions[corner] != toPosition
+				&& std::find(fromNeighbors, fromNeighbors + numFromNeighbors, positions[corner]) == fromNeighbors + numFromNeighbors)
+			{
+				if (numFromNeighbors == MAX_CHECKED_NEIGHBORS)
+				{
+					return false;
+				}
+				fromNeighbors[numFromNeighbors++] = positions[corner];
+			}
+		}
+
+		// The triangles that stay must not flip or fold over
+		if (!hasTarget)
+		{
+			Vec3 points[3] = { m_positions[positions[0]], m_positions[positions[1]], m_positions[positions[2]] };
+			Vec3 oldNormal = CrossProduct3D(points[1] - points[0], points[2] - points[0]);
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				if (positions[corner] == fromPosition)
+				{
+					points[corner] = toPoint;
+				}
+			}
+			Vec3 newNormal = CrossProduct3D(points[1] - points[0], points[2] - points[0]);
+			float lengthProduct = sqrtf(oldNormal.GetLengthSquared() * newNormal.GetLengthSquared());
+			if (lengthProduct <= 0.f || DotProduct3D(oldNormal, newNormal) < MIN_FLIP_COSINE * lengthProduct)
+			{
+				return false;
+			}
+		}
+	}
+
+	int numSharedNeighbors = 0;
+	unsigned int toNeighbors[MAX_CHECKED_NEIGHBORS];
+	int numToNeighbors = 0;
+	for (unsigned int adjacencyIndex = m_firstAdjacentTriangles[toPosition]; adjacencyIndex < m_firstAdjacentTriangles[toPosition + 1]; ++adjacencyIndex)
+	{
+		unsigned int const* corners = &m_triangles[m_adjacentTriangles[adjacencyIndex] * 3];
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			unsigned int position = m_wedgePositions[corners[corner]];
+			if (position == fromPosition || position == toPosition
+				|| std::find(toNeighbors, toNeighbors + numToNeighbors, position) != toNeighbors + numToNeighbors)
+			{
+				continue;
+			}
+			if (numToNeighbors == MAX_CHECKED_NEIGHBORS)
+			{
+				return false;
+			}
+			toNeighbors[numToNeighbors++] = position;
+			if (std::find(fromNeighbors, fromNeighbors + numFromNeighbors, position) != fromNeighbors + numFromNeighbors)
+			{
+				++numSharedNeighbors;
+			}
+		}
+	}
+	return numSharedTriangles > 0 && numSharedNeighbors <= numSharedTriangles;
+}
+
+bool MeshSimplifier::EvaluateCollapse(unsigned int fromPosition, unsigned int toPosition, EdgeCollapse& out_collapse) const
+{
+	if (m_isPositionLocked[fromPosition])
+	{
+		return false;
+	}
+	unsigned int fromWedges[MAX_WEDGES_PER_POSITION];
+	unsigned int toWedges[MAX_WEDGES_PER_POSITION];
+	int numWedges = 0;
+	if (!MapWedges(fromPosition, toPosition, fromWedges, toWedges, numWedges))
+	{
+		return false;
+	}
+
+	Quadric combinedQuadric = m_quadrics[fromPosition];
+	combinedQuadric.Add(m_quadrics[toPosition]);
+	float geometricError = (float)combinedQuadric.GetError(m_positions[toPosition]);
+
+	// The moving wedges take on the target wedges' normals and uvs
+	float attributeError = 0.f;
+	for (int wedgeIndex = 0; wedgeIndex < numWedges; ++wedgeIndex)
+	{
+		Vertex_PCUTBN const& fromVertex = m_vertexes[fromWedges[wedgeIndex]];
+		Vertex_PCUTBN const& toVertex = m_vertexes[toWedges[wedgeIndex]];
+		attributeError += (fromVertex.m_normal - toVertex.m_normal).GetLengthSquared();
+		attributeError += (fromVertex.m_uvTexCoords - toVertex.m_uvTexCoords).GetLengthSquared();
+	}
+
+	out_collapse.m_fromPosition = fromPosition;
+	out_collapse.m_toPosition = toPosition;
+	out_collapse.m_geometricError = geometricError;
+	out_collapse.m_cost = geometricError + ATTRIBUTE_ERROR_WEIGHT * attributeError;
+	return true;
+}
+
+int MeshSimplifier::Collapse(EdgeCollapse const& collapse, std::vector<unsigned char>& isLockedThisPass)
+{
+	unsigned int fromWedges[MAX_WEDGES_PER_POSITION];
+	unsigned int toWedges[MAX_WEDGES_PER_POSITION];
+	int numWedges = 0;
+	MapWedges(collapse.m_fromPosition, collapse.m_toPosition, fromWedges, toWedges, numWedges);
+
+	// Both positions' neighborhoods change, so nothing touching them collapses again until adjacency is rebuilt
+	for (unsigned int position : { collapse.m_fromPosition, collapse.m_toPosition })
+	{
+		for (unsigned int adjacencyIndex = m_firstAdjacentTriangles[position]; adjacencyIndex < m_firstAdjacentTriangles[position + 1]; ++adjacencyIndex)
+		{
+			unsigned int const* corners = &m_triangles[m_adjacentTriangles[adjacencyIndex] * 3];
+			isLockedThisPass[m_wedgePositions[corners[0]]] = 1;
+			isLockedThisPass[m_wedgePositions[corners[1]]] = 1;
+			isLockedThisPass[m_wedgePositions[corners[2]]] = 1;
+		}
+	}
+
+	int numRemovedTriangles = 0;
+	for (unsigned int adjacencyIndex = m_firstAdjacentTriangles[collapse.m_fromPosition]; adjacencyIndex < m_firstAdjacentTriangles[collapse.m_fromPosition + 1]; ++adjacencyIndex)
+	{
+		unsigned int* corners = &m_triangles[m_adjacentTriangles[adjacencyIndex] * 3];
+		bool hasTarget = false;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			hasTarget |= m_wedgePositions[corners[corner]] == collapse.m_toPosition;
+		}
+		numRemovedTriangles += hasTarget ? 1 : 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			for (int wedgeIndex = 0; wedgeIndex < numWedges; ++wedgeIndex)
+			{
+				if (corners[corner] == fromWedges[wedgeIndex])
+				{
+					corners[corner] = toWedges[wedgeIndex];
+					break;
+				}
+			}
+		}
+	}
+	m_quadrics[collapse.m_toPosition].Add(m_quadrics[collapse.m_fromPosition]);
+	return numRemovedTriangles;
+}
+
+float MeshSimplifier::Simplify(std::vector<unsigned int>& out_indexes, size_t targetNumIndexes, float maxError)
+{
+	size_t targetNumTriangles = targetNumIndexes / 3;
+	double maxRelativeError = (double)maxError / (double)m_extent;
+	float maxRelativeErrorSquared = maxRelativeError * maxRelativeError < (double)FLT_MAX ? (float)(maxRelativeError * maxRelativeError) : FLT_MAX;
+	float resultErrorSquared = 0.f;
+
+	// Each pass collapses the cheapest edges that don't touch each other, then rebuilds adjacency
+	std::vector<EdgeCollapse> collapses;
+	std::vector<unsigned char> isLockedThisPass;
+	RemoveDegenerateTriangles();
+	for (int passIndex = 0; passIndex < MAX_SIMPLIFY_PASSES && m_triangles.size() / 3 > targetNumTriangles; ++passIndex)
+	{
+		BuildAdjacency();
+		collapses.clear();
+		for (size_t cornerIndex = 0; cornerIndex < m_triangles.size(); ++cornerIndex)
+		{
+			size_t triangleStart = cornerIndex - cornerIndex % 3;
+			unsigned int fromPosition = m_wedgePositions[m_triangles[cornerIndex]];
+			unsigned int toPosition = m_wedgePositions[m_triangles[triangleStart + (cornerIndex + 1) % 3]];
+			EdgeCollapse collapse;
+			if (EvaluateCollapse(fromPosition, toPosition, collapse) && collapse.m_geometricError <= maxRelativeErrorSquared)
+			{
+				collapses.push_back(collapse);
+			}
+			if (EvaluateCollapse(toPosition, fromPosition, collapse) && collapse.m_geometricError <= maxRelativeErrorSquared)
+			{
+				collapses.push_back(collapse);
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](EdgeCollapse const& a, EdgeCollapse const& b)
+			{
+				return a.m_cost < b.m_cost;
+			});
+
+		isLockedThisPass.assign(m_positions.size(), 0);
+		size_t numTriangles = m_triangles.size() / 3;
+		int numCollapses = 0;
+		for (EdgeCollapse const& collapse : collapses)
+		{
+			if (numTriangles <= targetNumTriangles)
+			{
+				break;
+			}
+			if (isLockedThisPass[collapse.m_fromPosition] || isLockedThisPass[collapse.m_toPosition]
+				|| !IsCollapseValid(collapse.m_fromPosition, collapse.m_toPosition))
+			{
+				continue;
+			}
+			numTriangles -= Collapse(collapse, isLockedThisPass);
+			resultErrorSquared = collapse.m_geometricError > resultErrorSquared ? collapse.m_geometricError : resultErrorSquared;
+			++numCollapses;
+		}
+		RemoveDegenerateTriangles();
+		if (numCollapses == 0)
+		{
+			break;
+		}
+	}
+
+	out_indexes = m_triangles;
+	return sqrtf(resultErrorSquared) * m_extent;
+}
+
+float SimplifyMesh(std::vector<unsigned int>& out_indexes, std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes, size_t targetNumIndexes, float maxError)
+{
+	if (indexes.size() <= targetNumIndexes)
+	{
+		out_indexes = indexes;
+		return 0.f;
+	}
+	MeshSimplifier simplifier(vertexes, indexes);
+	return simplifier.Simplify(out_indexes, targetNumIndexes, maxError);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "Engine/Core/Vertex_PCU.hpp"
+#include <cfloat>
+#include <vector>
+
+// Quadric error metric simplification (Garland & Heckbert) by collapsing edges onto existing vertexes, so every level
+// of detail can share the original vertex buffer and only needs its own index buffer.
+// Vertexes sharing a position but not attributes (UV seams, hard normals) only collapse together along the seam, open
+// borders and seams are held in place by extra edge quadrics, and collapses that would flip triangles are refused.
+
+// Writes an index list for the same vertexes with at most targetNumIndexes indexes, or fewer collapses if the rest would
+// move the surface more than maxError (in mesh units). Returns how far the result may be from the input, in mesh units.
+float SimplifyMesh(std::vector<unsigned int>& out_indexes, std::vector<Vertex_PCUTBN> const& vertexes, std::vector<unsigned int> const& indexes, size_t targetNumIndexes, float maxError = FLT_MAX);
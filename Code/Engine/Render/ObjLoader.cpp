@@ -1,159 +1,395 @@
 #include "Engine/Render/ObjLoader.hpp"
 #include "Engine/Core/EngineCommon.hpp"
 #include "Engine/Core/FileUtils.hpp"
+#include "Engine/Core/JobSystem.hpp"
+#include "Engine/Core/MemoryMappedFile.hpp"
 #include "Engine/Core/VertexUtils.hpp"
 #include "Engine/Core/ErrorWarningAssert.hpp"
 #include "Engine/Math/MathUtils.hpp"
-#include <unordered_map>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <string_view>
 #include "Game/EngineBuildPreferences.hpp"
-struct VertexIndex 
+
+// The obj is parsed in place out of the mapped file, in chunks of about this many bytes split at line boundaries
+constexpr size_t OBJ_PARSE_CHUNK_SIZE = 1024 * 1024;
+
+struct VertexIndex
 {
 	int m_posIndex = -1;  // Vertex Position index
 	int m_texCoordIndex = -1;  // Texture coordinate index
 	int m_normalIndex = -1; // vertex Normal index
 };
-struct VertexHash
+
+// Open addressing map from a face corner's indexes to its vertex, so deduplicating never allocates per vertex
+class VertexIndexMap
 {
-	std::size_t operator() (const VertexIndex& k) const 
+public:
+	explicit VertexIndexMap(size_t expectedNumKeys)
 	{
-		return std::hash<int>()(k.m_posIndex) ^
-			(std::hash<int>()(k.m_texCoordIndex) << 1) ^
-			(std::hash<int>()(k.m_normalIndex) << 2);
+		size_t numSlots = 64;
+		while (numSlots < expectedNumKeys * 2)
+		{
+			numSlots *= 2;
+		}
+		m_keys.resize(numSlots);
+		m_values.resize(numSlots, -1);
 	}
-};
 
-struct VertexEqual 
-{
-	bool operator() (VertexIndex const& lhs, VertexIndex const& rhs) const
+	// Returns the value already stored for key, or stores valueIfAdded and returns that
+	int FindOrAdd(VertexIndex const& key, int valueIfAdded)
 	{
-		return lhs.m_posIndex == rhs.m_posIndex
-			&& lhs.m_normalIndex == rhs.m_normalIndex
-			&& lhs.m_texCoordIndex == rhs.m_texCoordIndex;
+		size_t mask = m_keys.size() - 1;
+		for (size_t slot = GetHash(key) & mask; ; slot = (slot + 1) & mask)
+		{
+			if (m_values[slot] < 0)
+			{
+				m_keys[slot] = key;
+				m_values[slot] = valueIfAdded;
+				if (++m_numKeys * 2 > m_keys.size())
+				{
+					Grow();
+				}
+				return valueIfAdded;
+			}
+			VertexIndex const& slotKey = m_keys[slot];
+			if (slotKey.m_posIndex == key.m_posIndex && slotKey.m_texCoordIndex == key.m_texCoordIndex && slotKey.m_normalIndex == key.m_normalIndex)
+			{
+				return m_values[slot];
+			}
+		}
 	}
 
-};
-struct Triangle
-{
-	Triangle(VertexIndex const& v1, VertexIndex const& v2, VertexIndex const& v3, Rgba8 const& color = Rgba8::WHITE)
-		:m_color(color)
+private:
+	static size_t GetHash(VertexIndex const& key)
 	{
-		m_vertexes[0] = v1;
-		m_vertexes[1] = v2;
-		m_vertexes[2] = v3;
+		uint64_t hash = (uint32_t)key.m_posIndex * 0x9E3779B97F4A7C15ull;
+		hash ^= (uint32_t)key.m_texCoordIndex * 0xC2B2AE3D27D4EB4Full;
+		hash ^= (uint32_t)key.m_normalIndex * 0x165667B19E3779F9ull;
+		return (size_t)(hash ^ (hash >> 29));
 	}
-	VertexIndex m_vertexes[3];
-	Rgba8 m_color = Rgba8::WHITE;
-};
-class Face
-{
-public:
-	Face(Strings faceTokens, Rgba8 faceColor, std::vector<Triangle> &triangles);
-	Face() {}
-	//std::vector<VertexIndex> m_vertexIndexes;
-	Rgba8 m_faceColor = Rgba8::WHITE;
+
+	void Grow()
+	{
+		std::vector<VertexIndex> oldKeys;
+		std::vector<int> oldValues;
+		oldKeys.swap(m_keys);
+		oldValues.swap(m_values);
+		m_keys.resize(oldKeys.size() * 2);
+		m_values.resize(oldValues.size() * 2, -1);
+		size_t mask = m_keys.size() - 1;
+		for (size_t oldSlot = 0; oldSlot < oldKeys.size(); ++oldSlot)
+		{
+			if (oldValues[oldSlot] < 0)
+			{
+				continue;
+			}
+			size_t slot = GetHash(oldKeys[oldSlot]) & mask;
+			while (m_values[slot] >= 0)
+			{
+				slot = (slot + 1) & mask;
+			}
+			m_keys[slot] = oldKeys[oldSlot];
+			m_values[slot] = oldValues[oldSlot];
+		}
+	}
+
 private:
-	VertexIndex ParseVertexToken(std::string const& token);
+	std::vector<VertexIndex> m_keys;
+	std::vector<int> m_values; // -1 marks an empty slot
+	size_t m_numKeys = 0;
 };
 
+// Everything one worker pulls out of its slice of the file. Vertexes are deduplicated within the chunk first, then
+// across chunks in file order, which gives the same vertexes in the same order as parsing the whole file in one go.
+struct ObjChunk
+{
+	char const* m_begin = nullptr;
+	char const* m_end = nullptr;
+	std::vector<Vec3> m_positions;
+	std::vector<Vec2> m_uvs;
+	std::vector<Vec3> m_normals;
+	std::vector<std::string_view> m_materialLibraries;
+	std::vector<std::string_view> m_materialNames; // from each usemtl, in order
+	std::vector<VertexIndex> m_uniqueVertexes; // in order of first use within the chunk
+	// 0 is whichever material was in use where the chunk starts, n is m_materialNames[n - 1]
+	std::vector<int> m_uniqueVertexMaterials;
+	std::vector<unsigned int> m_indexes; // into m_uniqueVertexes
+	int m_numFaces = 0;
 
+	// Filled in while merging
+	std::vector<Rgba8> m_materialColors;
+	std::vector<unsigned int> m_mergedVertexIndexes;
+	unsigned int m_firstNewMergedVertexIndex = 0; // merged vertexes at or past this were first used in this chunk
+	size_t m_firstMergedIndex = 0;
+};
 
+static bool IsObjSpace(char c)
+{
+	return c == ' ' || c == '\t';
+}
 
-
-Face::Face(Strings faceTokens, Rgba8 faceColor, std::vector<Triangle> &triangles) :m_faceColor(faceColor)
+static char const* SkipObjSpaces(char const* cursor, char const* lineEnd)
 {
-	for (size_t i = 2; i < faceTokens.size() - 1; ++i) {
-		//m_vertexIndexes.push_back(ParseVertexToken(faceTokens[1]));
-		//m_vertexIndexes.push_back(ParseVertexToken(faceTokens[i]));
-		//m_vertexIndexes.push_back(ParseVertexToken(faceTokens[i + 1]));
-		Triangle triangle(ParseVertexToken(faceTokens[1]), ParseVertexToken(faceTokens[i]), ParseVertexToken(faceTokens[i + 1]),m_faceColor);
-		triangles.push_back(triangle);
-         
+	while (cursor < lineEnd && IsObjSpace(*cursor))
+	{
+		++cursor;
 	}
-	
+	return cursor;
 }
 
-VertexIndex Face::ParseVertexToken(std::string const& token)
+static std::string_view ParseObjName(char const* cursor, char const* lineEnd)
 {
-	Strings indices = SplitStringOnDelimiter(token, '/', false);
-	VertexIndex vertex;
-	if (indices.size() > 0 && !indices[0].empty()) 
+	cursor = SkipObjSpaces(cursor, lineEnd);
+	char const* nameEnd = cursor;
+	while (nameEnd < lineEnd && !IsObjSpace(*nameEnd))
 	{
-		vertex.m_posIndex = atoi(indices[0].c_str())-1;
+		++nameEnd;
 	}
-	if (indices.size() > 1 && !indices[1].empty()) 
+	return std::string_view(cursor, nameEnd - cursor);
+}
+
+// Like atof, a malformed number reads as 0
+static float ParseObjFloat(char const*& cursor, char const* lineEnd)
+{
+	cursor = SkipObjSpaces(cursor, lineEnd);
+	if (cursor < lineEnd && *cursor == '+')
 	{
-		vertex.m_texCoordIndex = atoi(indices[1].c_str())-1;
+		++cursor;
 	}
-	if (indices.size() > 2 && !indices[2].empty()) 
+	float value = 0.f;
+	cursor = std::from_chars(cursor, lineEnd, value).ptr;
+	while (cursor < lineEnd && !IsObjSpace(*cursor))
 	{
-		vertex.m_normalIndex = atoi(indices[2].c_str()) -1;
+		++cursor;
 	}
-	return vertex;
+	return value;
 }
 
-bool ObjLoader::Load(std::string const& fileName, std::vector<Vertex_PCUTBN>& outVertexes, std::vector<unsigned int>& outIndexes, bool& outHasNormals, bool& outHasUVs, Mat44 const& transform)
+static int ParseObjIndex(char const*& cursor, char const* lineEnd)
 {
-	auto loadStartTime = std::chrono::high_resolution_clock::now();
-	std::vector<Vec3> vertexPositions;
-	std::vector<Vec2> vertexUVs;
-	std::vector<Vec3> vertexNormals;
-	int faceSize = 0;
-	std::map<std::string, Rgba8> materialLibrary;
-	std::string currentMaterial;
-	std::string objFileString;
-	std::vector<Triangle> triangles;
-	FileReadToString(objFileString, fileName);
-	Strings objStringLines = SplitStringOnDelimiter(objFileString, "\r\n", false);
-	if (objStringLines.size() == 1)
+	int value = 0;
+	cursor = std::from_chars(cursor, lineEnd, value).ptr;
+	return value - 1;
+}
+
+// Parses "p", "p/t", "p//n" or "p/t/n", leaving cursor on the whitespace after it
+static VertexIndex ParseObjFaceCorner(char const*& cursor, char const* lineEnd)
+{
+	VertexIndex vertexIndex;
+	vertexIndex.m_posIndex = ParseObjIndex(cursor, lineEnd);
+	if (cursor < lineEnd && *cursor == '/')
 	{
-		objStringLines = SplitStringOnDelimiter(objFileString, "\n", false);
+		++cursor;
+		if (cursor < lineEnd && *cursor != '/')
+		{
+			vertexIndex.m_texCoordIndex = ParseObjIndex(cursor, lineEnd);
+		}
+		if (cursor < lineEnd && *cursor == '/')
+		{
+			++cursor;
+			vertexIndex.m_normalIndex = ParseObjIndex(cursor, lineEnd);
+		}
 	}
-	for (int i = 0; i < (int)objStringLines.size(); ++i)
+	while (cursor < lineEnd && !IsObjSpace(*cursor))
 	{
-		Strings tokens = SplitStringOnDelimiter(objStringLines[i], ' ', true);
-		if (tokens.empty()) continue;
-		if (tokens[0].compare("mtllib") == 0)
+		++cursor;
+	}
+	return vertexIndex;
+}
+
+static void ParseObjChunk(ObjChunk& chunk)
+{
+	// Roughly one vertex per 100 bytes of a typical obj, the map grows if that is off
+	VertexIndexMap vertexMap((chunk.m_end - chunk.m_begin) / 100);
+	int currentMaterial = 0;
+	unsigned int cornerIndexes[3] = {};
+
+	char const* lineBegin = chunk.m_begin;
+	while (lineBegin < chunk.m_end)
+	{
+		char const* lineEnd = static_cast<char const*>(memchr(lineBegin, '\n', chunk.m_end - lineBegin));
+		char const* nextLineBegin = lineEnd ? lineEnd + 1 : chunk.m_end;
+		if (lineEnd == nullptr)
 		{
-			std::string matLibFilename = tokens[1];
-			LoadMaterialLibrary(GetObjParentPath(fileName)+matLibFilename, materialLibrary);
+			lineEnd = chunk.m_end;
 		}
-		else if (tokens[0].compare("usemtl") == 0)
+		if (lineEnd > lineBegin && lineEnd[-1] == '\r')
 		{
-			currentMaterial = tokens[1];
+			--lineEnd;
 		}
-		else if (tokens[0].compare("v") == 0)
+
+		char const* cursor = SkipObjSpaces(lineBegin, lineEnd);
+		size_t lineSize = lineEnd - cursor;
+		if (lineSize >= 2 && cursor[0] == 'v' && IsObjSpace(cursor[1]))
 		{
-			vertexPositions.push_back(Vec3((float)atof(tokens[1].c_str()), (float)atof(tokens[2].c_str()), (float)atof(tokens[3].c_str())));
+			cursor += 2;
+			float x = ParseObjFloat(cursor, lineEnd);
+			float y = ParseObjFloat(cursor, lineEnd);
+			float z = ParseObjFloat(cursor, lineEnd);
+			chunk.m_positions.push_back(Vec3(x, y, z));
 		}
-		else if (tokens[0].compare("vt") == 0)
+		else if (lineSize >= 3 && cursor[0] == 'v' && cursor[1] == 't' && IsObjSpace(cursor[2]))
 		{
-			vertexUVs.push_back(Vec2((float)atof(tokens[1].c_str()), (float)atof(tokens[2].c_str())));
+			cursor += 3;
+			float u = ParseObjFloat(cursor, lineEnd);
+			float v = ParseObjFloat(cursor, lineEnd);
+			chunk.m_uvs.push_back(Vec2(u, v));
 		}
-		else if (tokens[0].compare("vn") == 0)
+		else if (lineSize >= 3 && cursor[0] == 'v' && cursor[1] == 'n' && IsObjSpace(cursor[2]))
 		{
-			vertexNormals.push_back(Vec3((float)atof(tokens[1].c_str()), (float)atof(tokens[2].c_str()), (float)atof(tokens[3].c_str())));
+			cursor += 3;
+			float x = ParseObjFloat(cursor, lineEnd);
+			float y = ParseObjFloat(cursor, lineEnd);
+			float z = ParseObjFloat(cursor, lineEnd);
+			chunk.m_normals.push_back(Vec3(x, y, z));
 		}
-		else if (tokens[0].compare("f") == 0)
+		else if (lineSize >= 2 && cursor[0] == 'f' && IsObjSpace(cursor[1]))
 		{
-			Face face(tokens, materialLibrary[currentMaterial], triangles);
-			++faceSize;
+			// Polygons are fanned out from their first corner
+			cursor += 2;
+			int numCorners = 0;
+			while ((cursor = SkipObjSpaces(cursor, lineEnd)) < lineEnd)
+			{
+				VertexIndex vertexIndex = ParseObjFaceCorner(cursor, lineEnd);
+				unsigned int uniqueVertexIndex = (unsigned int)vertexMap.FindOrAdd(vertexIndex, (int)chunk.m_uniqueVertexes.size());
+				if (uniqueVertexIndex == chunk.m_uniqueVertexes.size())
+				{
+					chunk.m_uniqueVertexes.push_back(vertexIndex);
+					chunk.m_uniqueVertexMaterials.push_back(currentMaterial);
+				}
+				cornerIndexes[numCorners < 2 ? numCorners : 2] = uniqueVertexIndex;
+				if (++numCorners >= 3)
+				{
+					chunk.m_indexes.push_back(cornerIndexes[0]);
+					chunk.m_indexes.push_back(cornerIndexes[1]);
+					chunk.m_indexes.push_back(cornerIndexes[2]);
+					cornerIndexes[1] = cornerIndexes[2];
+				}
+			}
+			++chunk.m_numFaces;
 		}
+		else if (lineSize >= 7 && memcmp(cursor, "usemtl", 6) == 0 && IsObjSpace(cursor[6]))
+		{
+			chunk.m_materialNames.push_back(ParseObjName(cursor + 6, lineEnd));
+			currentMaterial = (int)chunk.m_materialNames.size();
+		}
+		else if (lineSize >= 7 && memcmp(cursor, "mtllib", 6) == 0 && IsObjSpace(cursor[6]))
+		{
+			chunk.m_materialLibraries.push_back(ParseObjName(cursor + 6, lineEnd));
+		}
+		lineBegin = nextLineBegin;
+	}
+}
+
+bool ObjLoader::Load(std::string const& fileName, std::vector<Vertex_PCUTBN>& outVertexes, std::vector<unsigned int>& outIndexes, bool& outHasNormals, bool& outHasUVs, Mat44 const& transform)
+{
+	auto loadStartTime = std::chrono::high_resolution_clock::now();
+	MemoryMappedFile objFile;
+	if (!objFile.Open(fileName))
+	{
+		ERROR_RECOVERABLE(Stringf("Failed to Read the file located in %s", fileName.c_str()));
+		return false;
+	}
+	char const* fileData = reinterpret_cast<char const*>(objFile.GetData());
+	char const* fileEnd = fileData + objFile.GetFileSize();
+
+	// Chunks start just after a newline, so no line is ever split between two workers
+	std::vector<ObjChunk> chunks;
+	chunks.reserve(objFile.GetFileSize() / OBJ_PARSE_CHUNK_SIZE + 1);
+	for (char const* chunkBegin = fileData; chunkBegin < fileEnd; chunkBegin = chunks.back().m_end)
+	{
+		char const* chunkEnd = fileEnd;
+		if ((size_t)(fileEnd - chunkBegin) > OBJ_PARSE_CHUNK_SIZE)
+		{
+			char const* newline = static_cast<char const*>(memchr(chunkBegin + OBJ_PARSE_CHUNK_SIZE, '\n', fileEnd - chunkBegin - OBJ_PARSE_CHUNK_SIZE));
+			chunkEnd = newline ? newline + 1 : fileEnd;
+		}
+		chunks.emplace_back();
+		chunks.back().m_begin = chunkBegin;
+		chunks.back().m_end = chunkEnd;
+	}
+
+	if (g_theJobSystem && chunks.size() > 1)
+	{
+		g_theJobSystem->ParallelFor(0, (int)chunks.size(), 1, [&](int chunkIndex)
+			{
+				ParseObjChunk(chunks[chunkIndex]);
+			});
+	}
+	else
+	{
+		for (ObjChunk& chunk : chunks)
+		{
+			ParseObjChunk(chunk);
+		}
+	}
+
+	// Gather the attributes, and carry the material in use from the end of each chunk into the next
+	std::vector<Vec3> vertexPositions;
+	std::vector<Vec2> vertexUVs;
+	std::vector<Vec3> vertexNormals;
+	std::map<std::string, Rgba8> materialLibrary;
+	int faceSize = 0;
+	size_t numIndexes = 0;
+	size_t numUniqueVertexes = 0;
+	for (ObjChunk const& chunk : chunks)
+	{
+		vertexPositions.insert(vertexPositions.end(), chunk.m_positions.begin(), chunk.m_positions.end());
+		vertexUVs.insert(vertexUVs.end(), chunk.m_uvs.begin(), chunk.m_uvs.end());
+		vertexNormals.insert(vertexNormals.end(), chunk.m_normals.begin(), chunk.m_normals.end());
+		for (std::string_view const& matLibFilename : chunk.m_materialLibraries)
+		{
+			LoadMaterialLibrary(GetObjParentPath(fileName) + std::string(matLibFilename), materialLibrary);
+		}
+		faceSize += chunk.m_numFaces;
+		numIndexes += chunk.m_indexes.size();
+		numUniqueVertexes += chunk.m_uniqueVertexes.size();
+	}
+	Rgba8 currentMaterialColor = Rgba8::WHITE;
+	for (ObjChunk& chunk : chunks)
+	{
+		chunk.m_materialColors.reserve(chunk.m_materialNames.size() + 1);
+		chunk.m_materialColors.push_back(currentMaterialColor);
+		for (std::string_view const& materialName : chunk.m_materialNames)
+		{
+			auto materialIter = materialLibrary.find(std::string(materialName));
+			currentMaterialColor = materialIter != materialLibrary.end() ? materialIter->second : Rgba8::WHITE;
+			chunk.m_materialColors.push_back(currentMaterialColor);
+		}
+	}
 
+	// Deduplicating across chunks is the only serial step, and it only touches each chunk's unique vertexes
+	VertexIndexMap vertexMap(numUniqueVertexes);
+	unsigned int numMergedVertexes = 0;
+	size_t firstMergedIndex = 0;
+	for (ObjChunk& chunk : chunks)
+	{
+		chunk.m_firstNewMergedVertexIndex = numMergedVertexes;
+		chunk.m_firstMergedIndex = firstMergedIndex;
+		chunk.m_mergedVertexIndexes.resize(chunk.m_uniqueVertexes.size());
+		for (size_t uniqueVertexIndex = 0; uniqueVertexIndex < chunk.m_uniqueVertexes.size(); ++uniqueVertexIndex)
+		{
+			unsigned int mergedVertexIndex = (unsigned int)vertexMap.FindOrAdd(chunk.m_uniqueVertexes[uniqueVertexIndex], (int)numMergedVertexes);
+			if (mergedVertexIndex == numMergedVertexes)
+			{
+				++numMergedVertexes;
+			}
+			chunk.m_mergedVertexIndexes[uniqueVertexIndex] = mergedVertexIndex;
+		}
+		firstMergedIndex += chunk.m_indexes.size();
 	}
 
 #if !defined ENGINE_DISABLE_OBJ_DEBUGTIME
 	auto loadEndTime = std::chrono::high_resolution_clock::now();
 	auto loadTime = std::chrono::duration_cast<std::chrono::microseconds>(loadEndTime - loadStartTime).count();
 #endif
-	outVertexes.reserve(triangles.size() * 3);
-	outIndexes.reserve(triangles.size() * 3);
 
 	if (vertexUVs.size() != 0)
 	{
 		outHasUVs = true;
 	}
-
-
 	if (vertexNormals.size() != 0)
 	{
 		outHasNormals = true;
@@ -162,126 +398,75 @@ bool ObjLoader::Load(std::string const& fileName, std::vector<Vertex_PCUTBN>& ou
 	//If the OBJ file has no faces/triangles, Create faces/triangles
 	if (faceSize == 0)
 	{
-		for (int i = 2; i < vertexPositions.size(); ++i)
+		unsigned int firstOutVertex = (unsigned int)outVertexes.size();
+		for (int i = 0; i < (int)vertexPositions.size() && vertexPositions.size() >= 3; ++i)
 		{
-			VertexIndex vertexIndex[3];
-			
-			vertexIndex[0].m_posIndex = i - 2;
-			//face.m_vertexIndexes.push_back(vertexIndex);
-			vertexIndex[1].m_posIndex = i - 1;
-			//face.m_vertexIndexes.push_back(vertexIndex);
-			vertexIndex[2].m_posIndex = i;
-			//face.m_vertexIndexes.push_back(vertexIndex);
-			triangles.push_back(Triangle(vertexIndex[0],vertexIndex[1],vertexIndex[2]));
+			outVertexes.push_back(Vertex_PCUTBN(vertexPositions[i], Rgba8::WHITE, Vec2::ZERO, Vec3::ZERO, Vec3::ZERO, Vec3::ZERO));
 		}
-	}
-
-	//for (auto const& face : faces)
-	//{
-	//	VertexIndex vertexes[3];
-	//	vertexes[0] = face.m_vertexIndexes[0];
-	//	vertexes[1] = face.m_vertexIndexes[1];
-	//	vertexes[2] = face.m_vertexIndexes[2];
-	//	for (size_t i = 2; i < face.m_vertexIndexes.size(); i++)
-	//	{
-	//		vertexes[1] = face.m_vertexIndexes[i - 1];
-	//		vertexes[2] = face.m_vertexIndexes[i];
-	//		Triangle triangle(vertexes[0], vertexes[1], vertexes[2], face.m_faceColor);
-	//		triangles.push_back(triangle);
-	//	}
-	//}
-
-	std::unordered_map<VertexIndex, int, VertexHash, VertexEqual> vertexMap;
-	for (size_t i = 0; i < triangles.size(); i++)
-	{
-		Triangle& triangle = triangles[i];
-
-		VertexIndex &vertexIndex0 = triangle.m_vertexes[0];
-		VertexIndex &vertexIndex1 = triangle.m_vertexes[1];
-		VertexIndex &vertexIndex2 = triangle.m_vertexes[2];
-
-		int index0 = (unsigned int)outVertexes.size();
-		auto it0 = vertexMap.find(vertexIndex0);
-		if (it0 == vertexMap.end())
-		{
-			Vec3 const& p0 = vertexPositions[triangle.m_vertexes[0].m_posIndex];
-			Vec2 const& t0 = triangle.m_vertexes[0].m_texCoordIndex	== -1 ? Vec2::ZERO : vertexUVs[triangle.m_vertexes[0].m_texCoordIndex];
-			Vec3 const& n0 = triangle.m_vertexes[0].m_normalIndex == -1 ? Vec3::ZERO : vertexNormals[triangle.m_vertexes[0].m_normalIndex];
-			Vertex_PCUTBN v0(p0, triangle.m_color, t0, Vec3::ZERO, Vec3::ZERO, n0);
-			outVertexes.push_back(v0);
-
-			vertexMap[vertexIndex0] = index0;
-		}
-		else 
+		for (int i = 2; i < (int)vertexPositions.size(); ++i)
 		{
-			index0 = it0->second;
+			outIndexes.push_back(firstOutVertex + i - 2);
+			outIndexes.push_back(firstOutVertex + i - 1);
+			outIndexes.push_back(firstOutVertex + i);
 		}
-
-		int index1 = (unsigned int)outVertexes.size();
-		auto it1 = vertexMap.find(vertexIndex1);
-		if (it1 == vertexMap.end()) 
+	}
+	else
+	{
+		// Each chunk builds the vertexes it used first, and rewrites its indexes into the merged vertexes
+		size_t firstOutVertex = outVertexes.size();
+		size_t firstOutIndex = outIndexes.size();
+		outVertexes.resize(firstOutVertex + numMergedVertexes);
+		outIndexes.resize(firstOutIndex + numIndexes);
+		std::atomic<bool> hasBadIndex = false;
+		auto buildChunkVertexes = [&](int chunkIndex)
+			{
+				ObjChunk const& chunk = chunks[chunkIndex];
+				for (size_t uniqueVertexIndex = 0; uniqueVertexIndex < chunk.m_uniqueVertexes.size(); ++uniqueVertexIndex)
+				{
+					unsigned int mergedVertexIndex = chunk.m_mergedVertexIndexes[uniqueVertexIndex];
+					if (mergedVertexIndex < chunk.m_firstNewMergedVertexIndex)
+					{
+						continue;
+					}
+					VertexIndex const& vertexIndex = chunk.m_uniqueVertexes[uniqueVertexIndex];
+					if ((unsigned int)vertexIndex.m_posIndex >= vertexPositions.size()
+						|| (vertexIndex.m_texCoordIndex != -1 && (unsigned int)vertexIndex.m_texCoordIndex >= vertexUVs.size())
+						|| (vertexIndex.m_normalIndex != -1 && (unsigned int)vertexIndex.m_normalIndex >= vertexNormals.size()))
+					{
+						hasBadIndex = true;
+						continue;
+					}
+					Vec2 const& uv = vertexIndex.m_texCoordIndex == -1 ? Vec2::ZERO : vertexUVs[vertexIndex.m_texCoordIndex];
+					Vec3 const& normal = vertexIndex.m_normalIndex == -1 ? Vec3::ZERO : vertexNormals[vertexIndex.m_normalIndex];
+					Rgba8 const& color = chunk.m_materialColors[chunk.m_uniqueVertexMaterials[uniqueVertexIndex]];
+					outVertexes[firstOutVertex + mergedVertexIndex] = Vertex_PCUTBN(vertexPositions[vertexIndex.m_posIndex], color, uv, Vec3::ZERO, Vec3::ZERO, normal);
+				}
+				unsigned int* chunkOutIndexes = outIndexes.data() + firstOutIndex + chunk.m_firstMergedIndex;
+				for (size_t i = 0; i < chunk.m_indexes.size(); ++i)
+				{
+					chunkOutIndexes[i] = (unsigned int)firstOutVertex + chunk.m_mergedVertexIndexes[chunk.m_indexes[i]];
+				}
+			};
+		if (g_theJobSystem && chunks.size() > 1)
 		{
-			Vec3 const& p1 = vertexPositions[triangle.m_vertexes[1].m_posIndex];
-			Vec2 const& t1 = triangle.m_vertexes[1].m_texCoordIndex	== -1 ? Vec2::ZERO : vertexUVs[triangle.m_vertexes[1].m_texCoordIndex];
-			Vec3 const& n1 = triangle.m_vertexes[1].m_normalIndex == -1 ? Vec3::ZERO : vertexNormals[triangle.m_vertexes[1].m_normalIndex];
-			Vertex_PCUTBN v1(p1, triangle.m_color, t1, Vec3::ZERO, Vec3::ZERO, n1);
-			outVertexes.push_back(v1);
-			vertexMap[vertexIndex1] = index1;
+			g_theJobSystem->ParallelFor(0, (int)chunks.size(), 1, buildChunkVertexes);
 		}
 		else
 		{
-			index1 = it1->second; 
-		}
-
-		int index2 = (unsigned int)outVertexes.size();
-		auto it2 = vertexMap.find(vertexIndex2); 
-		if (it2 == vertexMap.end()) 
-		{
-			Vec3 const& p2 = vertexPositions[triangle.m_vertexes[2].m_posIndex];
-			Vec2 const& t2 = triangle.m_vertexes[2].m_texCoordIndex == -1 ? Vec2::ZERO : vertexUVs[triangle.m_vertexes[2].m_texCoordIndex];
-			Vec3 const& n2 = triangle.m_vertexes[2].m_normalIndex == -1 ? Vec3::ZERO : vertexNormals[triangle.m_vertexes[2].m_normalIndex];
-			Vertex_PCUTBN v2(p2, triangle.m_color, t2, Vec3::ZERO, Vec3::ZERO, n2);
-			outVertexes.push_back(v2);
-			vertexMap[vertexIndex2] = index2;
+			for (int chunkIndex = 0; chunkIndex < (int)chunks.size(); ++chunkIndex)
+			{
+				buildChunkVertexes(chunkIndex);
+			}
 		}
-		else 
+		if (hasBadIndex)
 		{
-			index2 = it2->second; 
+			// Relative (negative) indexes end up here too, they are not supported
+			ERROR_RECOVERABLE(Stringf("%s has faces using vertex attributes that do not exist", fileName.c_str()));
+			outVertexes.resize(firstOutVertex);
+			outIndexes.resize(firstOutIndex);
+			return false;
 		}
-		outIndexes.push_back(index0);
-		outIndexes.push_back(index1);
-		outIndexes.push_back(index2);
 	}
-	//for (auto const& face : faces)
-	//{
-	//	for (auto const& indexes : face.m_vertexIndexes)
-	//	{
-	//		Rgba8 currentColor = Rgba8::WHITE;
-	//		Vertex_PCUTBN outVertex;
-	//		outVertex.m_position = vertexPositions[indexes.m_posIndex];
-	//		outVertex.m_color = face.m_faceColor;
-	//		if (indexes.m_texCoordIndex != -1) //Has valid uv or not
-	//		{
-	//			outVertex.m_uvTexCoords = vertexUVs[indexes.m_texCoordIndex];
-	//		}
-	//		else
-	//		{
-	//			outVertex.m_uvTexCoords = Vec2(0.f, 0.f);
-	//		}
-	//
-	//		if (indexes.m_normalIndex != -1) //Has valid normal or not
-	//		{
-	//			outVertex.m_normal = vertexNormals[indexes.m_normalIndex];
-	//		}
-	//		else
-	//		{
-	//			outVertex.m_normal = Vec3(0.f, 0.f, 1.f);
-	//		}
-	//		outIndexes.push_back(static_cast<unsigned int>(outIndexes.size()));
-	//		outVertexes.push_back(outVertex);
-	//	}
-	//}
-	
 
 	TransformVertexArray3D(outVertexes, transform);
 
@@ -300,7 +485,7 @@ bool ObjLoader::Load(std::string const& fileName, std::vector<Vertex_PCUTBN>& ou
 	PrintTextToDebug(Stringf("\t\t\t\t\t\t "));
 	PrintTextToDebug(Stringf("vertexes: %d  ", (int)outVertexes.size()));
 	PrintTextToDebug(Stringf("indexes: %d  ", (int)outIndexes.size()));
-	PrintTextToDebug(Stringf("triangles: %d  ", (int)triangles.size()));
+	PrintTextToDebug(Stringf("triangles: %d  ", (int)outIndexes.size() / 3));
 	PrintTextToDebug(Stringf("time:%.8fs\n", (double)loadTime / 1000000.0));
 	PrintTextToDebug(Stringf("Created CPU Mesh         time: %.8fs\n", (double)createCPUMeshTime / 1000000.0));
 #endif